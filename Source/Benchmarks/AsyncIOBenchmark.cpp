@@ -0,0 +1,229 @@
+// Copyright Snaps 2022, All Rights Reserved.
+
+#include "Benchmark.h"
+#include "ChunkStorage.h"
+#include "JobSystem.h"
+#include "RegionFile.h"
+#include "VoxelChunk.h"
+#include "WorldGenerator.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <thread>
+
+#if defined(_WIN32)
+#include <windows.h>
+#else
+#include <time.h>
+#endif
+
+/*
+	Autosaves a generated region of chunks in one go and reports what it costs
+	the main thread per frame, first with plain synchronous region file saves,
+	then through FChunkStorage on each async I/O backend. Frames are simulated
+	as Update() plus a millisecond of "rendering" for the workers and the disk
+	to make progress in. Everything is then loaded back the same way and
+	checked against what was saved.
+
+	Frame times are wall clock, so with fewer cores than threads they include
+	whatever the workers and I/O threads ran while the main thread was waiting
+	for a core. The busy time next to them is the main thread's own CPU time.
+*/
+
+static const char* StorageDirectory = ".";
+static const double FrameSleepSeconds = 0.001;
+
+struct FSavedChunk
+{
+	int32 				X, Y, Z;
+	const FVoxelChunk* 	Chunk;
+	uint64 				Hash;
+};
+
+struct FFrameStats
+{
+	uint32 	NumFrames 		= 0;
+	double 	MaxSeconds 		= 0.0;
+	double 	SumSeconds 		= 0.0;
+	double 	MaxBusySeconds 	= 0.0;
+
+	void Add(double Seconds, double BusySeconds)
+	{
+		NumFrames++;
+		MaxSeconds = std::max(MaxSeconds, Seconds);
+		SumSeconds += Seconds;
+		MaxBusySeconds = std::max(MaxBusySeconds, BusySeconds);
+	}
+};
+
+// CPU time the calling thread has used so far.
+static double GetThreadCpuSeconds()
+{
+#if defined(_WIN32)
+	FILETIME Creation, Exit, Kernel, User;
+	GetThreadTimes(GetCurrentThread(), &Creation, &Exit, &Kernel, &User);
+	const uint64 Ticks = ((uint64)Kernel.dwHighDateTime << 32 | Kernel.dwLowDateTime) + ((uint64)User.dwHighDateTime << 32 | User.dwLowDateTime);
+	return Ticks * 100e-9;
+#else
+	timespec Time;
+	clock_gettime(CLOCK_THREAD_CPUTIME_ID, &Time);
+	return Time.tv_sec + Time.tv_nsec * 1e-9;
+#endif
+}
+
+static uint64 HashChunk(const FVoxelChunk& Chunk, std::vector<FBlockId>& Blocks)
+{
+	Chunk.CopyToDense(Blocks.data());
+	uint64 Hash = 0xCBF29CE484222325ull;
+	for(FBlockId Block : Blocks)
+	{
+		Hash = (Hash ^ Block) * 0x100000001B3ull;
+	}
+	return Hash;
+}
+
+static void RemoveRegionFile()
+{
+	std::remove((std::string(StorageDirectory) + "/" + FRegionFile::GetFileName(0, 0, 0)).c_str());
+}
+
+// Runs frames until the storage has nothing pending, Queue is called inside the first one.
+template<typename FunctionType>
+static FFrameStats RunFrames(FChunkStorage& Storage, const FunctionType& Queue)
+{
+	FFrameStats Frames;
+	for(bool bFirst = true; bFirst || Storage.GetNumPending() > 0; bFirst = false)
+	{
+		FBenchmarkTimer Timer;
+		const double CpuStart = GetThreadCpuSeconds();
+		if(bFirst)
+		{
+			Queue();
+		}
+		Storage.Update();
+		Frames.Add(Timer.GetElapsedSeconds(), GetThreadCpuSeconds() - CpuStart);
+
+		std::this_thread::sleep_for(std::chrono::duration<double>(FrameSleepSeconds));
+	}
+	return Frames;
+}
+
+static void ReportFrames(const char* Name, uint32 NumChunks, double Seconds, const FFrameStats& Frames)
+{
+	BENCHMARK_REPORT("  %-5s %.1f chunks/s, %u frames, main thread %.3f ms worst frame (%.3f ms busy), %.3f ms average",
+		Name,
+		NumChunks / Seconds,
+		Frames.NumFrames,
+		Frames.MaxSeconds * 1000.0,
+		Frames.MaxBusySeconds * 1000.0,
+		Frames.SumSeconds * 1000.0 / Frames.NumFrames
+	);
+}
+
+static void OnChunkLoaded(void* UserData, FVoxelChunk*, bool bLoaded)
+{
+	static_cast<std::atomic<uint32>*>(UserData)->fetch_add(bLoaded ? 0 : 1, std::memory_order_relaxed);
+}
+
+REGISTER_BENCHMARK(AsyncIO_Autosave)
+{
+	// The workers and the I/O have to make progress while the main thread sleeps, even on one core.
+	FJobSystem JobSystem;
+	JobSystem.Initialize(std::thread::hardware_concurrency() > 1 ? 0 : 2);
+	{
+		FWorldGenerator Generator(&JobSystem, 1337, 8);
+		const double Center = FRegionFile::RegionSize / 2 * ChunkSize;
+		Generator.Update(Center, Center);
+		Generator.Flush();
+
+		std::vector<FSavedChunk> Saved;
+		std::vector<FBlockId> Blocks(ChunkVolume);
+		Generator.GetChunkMap().ForEach([&](int32 X, int32 Y, int32 Z, FVoxelChunk* Chunk)
+		{
+			int32 RegionCoords[3];
+			int32 Local[3];
+			FRegionFile::ToRegionCoords(X, Y, Z, RegionCoords, Local);
+			if(RegionCoords[0] == 0 && RegionCoords[1] == 0 && RegionCoords[2] == 0)
+			{
+				Saved.push_back({ X, Y, Z, Chunk, HashChunk(*Chunk, Blocks) });
+			}
+		});
+		const uint32 NumChunks = (uint32)Saved.size();
+
+		// Baseline, every save on the main thread in the frame the autosave happens.
+		{
+			RemoveRegionFile();
+			FBenchmarkTimer Timer;
+			FRegionFile Region;
+			Region.Open(std::string(StorageDirectory) + "/" + FRegionFile::GetFileName(0, 0, 0), true);
+			for(const FSavedChunk& Entry : Saved)
+			{
+				int32 RegionCoords[3];
+				int32 Local[3];
+				FRegionFile::ToRegionCoords(Entry.X, Entry.Y, Entry.Z, RegionCoords, Local);
+				Region.SaveChunk(Local[0], Local[1], Local[2], *Entry.Chunk);
+			}
+			const double Seconds = Timer.GetElapsedSeconds();
+
+			FFrameStats Frames;
+			Frames.Add(Seconds, Seconds);
+			BENCHMARK_REPORT("synchronous, %u chunks", NumChunks);
+			ReportFrames("save", NumChunks, Seconds, Frames);
+		}
+
+		const bool bAllowIoUring[] = { false, true };
+		for(bool bIoUring : bAllowIoUring)
+		{
+			RemoveRegionFile();
+			FChunkStorage Storage(&JobSystem, StorageDirectory, bIoUring);
+			if(bIoUring && Storage.GetBackend() != EAsyncIOBackend::IoUring)
+			{
+				BENCHMARK_REPORT("io_uring unavailable, skipped");
+				continue;
+			}
+			BENCHMARK_REPORT("%s, %u chunks", FAsyncIO::GetBackendName(Storage.GetBackend()), NumChunks);
+
+			FBenchmarkTimer SaveTimer;
+			const FFrameStats SaveFrames = RunFrames(Storage, [&]()
+			{
+				for(const FSavedChunk& Entry : Saved)
+				{
+					Storage.SaveChunk(Entry.X, Entry.Y, Entry.Z, Entry.Chunk);
+				}
+			});
+			Storage.Flush();
+			ReportFrames("save", NumChunks, SaveTimer.GetElapsedSeconds(), SaveFrames);
+
+			std::vector<FVoxelChunk> Loaded(NumChunks);
+			std::atomic<uint32> NumMissing(0);
+			FBenchmarkTimer LoadTimer;
+			const FFrameStats LoadFrames = RunFrames(Storage, [&]()
+			{
+				for(uint32 Index = 0; Index < NumChunks; Index++)
+				{
+					Storage.LoadChunk(Saved[Index].X, Saved[Index].Y, Saved[Index].Z, &Loaded[Index], &OnChunkLoaded, &NumMissing);
+				}
+			});
+			ReportFrames("load", NumChunks, LoadTimer.GetElapsedSeconds(), LoadFrames);
+
+			uint32 NumBad = NumMissing.load();
+			for(uint32 Index = 0; Index < NumChunks; Index++)
+			{
+				NumBad += HashChunk(Loaded[Index], Blocks) != Saved[Index].Hash ? 1 : 0;
+			}
+
+			const FChunkStorageStats Stats = Storage.GetStats();
+			if(NumBad > 0 || Stats.NumFailed > 0 || Stats.NumSaved != NumChunks)
+			{
+				BENCHMARK_REPORT("MISMATCH: %u chunks failed to load or differ, %llu I/O failures",
+					NumBad,
+					(unsigned long long)Stats.NumFailed
+				);
+			}
+		}
+
+		RemoveRegionFile();
+	}
+	JobSystem.Shutdown();
+}
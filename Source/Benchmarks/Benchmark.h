@@ -0,0 +1,76 @@
+// Copyright Snaps 2022, All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include <chrono>
+#include <cstdio>
+#include <vector>
+
+using FBenchmarkFunction = void(*)();
+
+/*
+	A named benchmark, registered at static init time with REGISTER_BENCHMARK.
+*/
+struct FBenchmark
+{
+	const char* 		Name;
+	FBenchmarkFunction 	Function;
+};
+
+/*
+	Global list of benchmarks the VoxelBenchmarks executable can run.
+*/
+class FBenchmarkRegistry
+{
+public:
+
+	static std::vector<FBenchmark>& Get()
+	{
+		static std::vector<FBenchmark> Benchmarks;
+		return Benchmarks;
+	}
+
+	static bool Register(const char* Name, FBenchmarkFunction Function)
+	{
+		Get().push_back({ Name, Function });
+		return true;
+	}
+};
+
+/*
+	Simple wall clock timer for benchmarks.
+*/
+class FBenchmarkTimer
+{
+public:
+
+	FBenchmarkTimer()
+	{
+		Reset();
+	}
+
+	void Reset()
+	{
+		StartTime = std::chrono::high_resolution_clock::now();
+	}
+
+	double GetElapsedSeconds() const
+	{
+		const std::chrono::duration<double> Elapsed = std::chrono::high_resolution_clock::now() - StartTime;
+		return Elapsed.count();
+	}
+
+private:
+
+	std::chrono::high_resolution_clock::time_point StartTime;
+};
+
+// Defines and registers a benchmark function, e.g. REGISTER_BENCHMARK(JobSystem_EmptyJobs) { ... }
+#define REGISTER_BENCHMARK(Name) 														\
+	static void Name(); 																\
+	static const bool Name##_Registered = FBenchmarkRegistry::Register(#Name, &Name); 	\
+	static void Name()
+
+// Prints a single result line, keeps output consistent between benchmarks.
+#define BENCHMARK_REPORT(Format, ...) std::printf("    " Format "\n", ##__VA_ARGS__)
@@ -0,0 +1,35 @@
+// Copyright Snaps 2022, All Rights Reserved.
+
+#include "Benchmark.h"
+#include <cstring>
+
+/*
+	Entry point for VoxelBenchmarks. Runs every registered benchmark, or only those
+	whose name contains the first command line argument.
+	Usage: VoxelBenchmarks [NameFilter]
+*/
+int main(int ArgCount, char** Args)
+{
+	const char* Filter = ArgCount > 1 ? Args[1] : nullptr;
+
+	int32 NumRun = 0;
+	for(const FBenchmark& Benchmark : FBenchmarkRegistry::Get())
+	{
+		if(Filter && !std::strstr(Benchmark.Name, Filter))
+		{
+			continue;
+		}
+
+		std::printf("[%s]\n", Benchmark.Name);
+		Benchmark.Function();
+		std::fflush(stdout);
+		NumRun++;
+	}
+
+	if(NumRun == 0)
+	{
+		std::printf("No benchmarks matched '%s'.\n", Filter ? Filter : "");
+		return 1;
+	}
+	return 0;
+}
@@ -0,0 +1,111 @@
+// Copyright Snaps 2022, All Rights Reserved.
+
+#include "BenchmarkTerrain.h"
+#include <cmath>
+
+static uint32 HashLattice(int32 X, int32 Y, int32 Z, uint32 Seed)
+{
+	uint32 Hash = (uint32)X * 0x8DA6B343u ^ (uint32)Y * 0xD8163841u ^ (uint32)Z * 0xCB1AB31Fu ^ Seed;
+	Hash ^= Hash >> 15;
+	Hash *= 0x2C1B3C6Du;
+	Hash ^= Hash >> 12;
+	Hash *= 0x297A2D39u;
+	Hash ^= Hash >> 15;
+	return Hash;
+}
+
+static float LatticeValue(int32 X, int32 Y, int32 Z, uint32 Seed)
+{
+	return (HashLattice(X, Y, Z, Seed) & 0xFFFF) / 65535.f;
+}
+
+static float SmoothStep(float T)
+{
+	return T * T * (3.f - 2.f * T);
+}
+
+// Trilinear value noise in [0, 1], Scale is the lattice spacing in blocks.
+static float ValueNoise(float X, float Y, float Z, float Scale, uint32 Seed)
+{
+	X /= Scale;
+	Y /= Scale;
+	Z /= Scale;
+
+	const int32 X0 = (int32)std::floor(X);
+	const int32 Y0 = (int32)std::floor(Y);
+	const int32 Z0 = (int32)std::floor(Z);
+	const float TX = SmoothStep(X - X0);
+	const float TY = SmoothStep(Y - Y0);
+	const float TZ = SmoothStep(Z - Z0);
+
+	float Corners[2][2];
+	for(int32 DY = 0; DY < 2; DY++)
+	{
+		for(int32 DZ = 0; DZ < 2; DZ++)
+		{
+			const float A = LatticeValue(X0, Y0 + DY, Z0 + DZ, Seed);
+			const float B = LatticeValue(X0 + 1, Y0 + DY, Z0 + DZ, Seed);
+			Corners[DY][DZ] = A + (B - A) * TX;
+		}
+	}
+
+	const float Bottom = Corners[0][0] + (Corners[0][1] - Corners[0][0]) * TZ;
+	const float Top = Corners[1][0] + (Corners[1][1] - Corners[1][0]) * TZ;
+	return Bottom + (Top - Bottom) * TY;
+}
+
+void GenerateBenchmarkTerrain(FMeshVolume& Volume, int32 ChunkX, int32 ChunkY, int32 ChunkZ, uint32 Seed, bool bCaves)
+{
+	const int32 Size = Volume.Size;
+
+	for(int32 Z = -1; Z <= Size; Z++)
+	{
+		for(int32 X = -1; X <= Size; X++)
+		{
+			const float WorldX = (float)(ChunkX * Size + X);
+			const float WorldZ = (float)(ChunkZ * Size + Z);
+
+			// Two octaves of gentle hills between roughly 40 and 86 blocks high.
+			const float Height = 40.f
+				+ 40.f * ValueNoise(WorldX, 0.f, WorldZ, 96.f, Seed)
+				+ 6.f * ValueNoise(WorldX, 0.f, WorldZ, 24.f, Seed + 1);
+			const int32 Surface = (int32)Height;
+
+			for(int32 Y = -1; Y <= Size; Y++)
+			{
+				const int32 WorldY = ChunkY * Size + Y;
+				FBlockId Block = BlockAir;
+
+				if(WorldY < Surface - 4)
+				{
+					Block = BenchmarkStone;
+
+					// Ore specks.
+					if(HashLattice((int32)WorldX, WorldY, (int32)WorldZ, Seed + 2) % 97 == 0)
+					{
+						Block = BenchmarkOre;
+					}
+				}
+				else if(WorldY < Surface)
+				{
+					Block = BenchmarkDirt;
+				}
+				else if(WorldY == Surface)
+				{
+					Block = BenchmarkGrass;
+				}
+
+				// Carve caves below the surface.
+				if(bCaves && Block != BlockAir && WorldY < Surface - 2)
+				{
+					if(ValueNoise(WorldX, (float)WorldY, WorldZ, 12.f, Seed + 3) > 0.72f)
+					{
+						Block = BlockAir;
+					}
+				}
+
+				Volume.Set(X, Y, Z, Block);
+			}
+		}
+	}
+}
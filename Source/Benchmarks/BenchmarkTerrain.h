@@ -0,0 +1,19 @@
+// Copyright Snaps 2022, All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "MeshTypes.h"
+
+/*
+	Cheap deterministic terrain for benchmarks: rolling hills of grass, dirt and
+	stone with caves and ore specks. Generated in world space so neighbouring
+	chunks line up, including the padding border of the volume.
+*/
+void GenerateBenchmarkTerrain(FMeshVolume& Volume, int32 ChunkX, int32 ChunkY, int32 ChunkZ, uint32 Seed, bool bCaves = true);
+
+// Block ids used by the benchmark terrain.
+static const FBlockId BenchmarkStone 	= 1;
+static const FBlockId BenchmarkDirt 	= 2;
+static const FBlockId BenchmarkGrass 	= 3;
+static const FBlockId BenchmarkOre 		= 4;
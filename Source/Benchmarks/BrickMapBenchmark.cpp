@@ -0,0 +1,271 @@
+// Copyright Snaps 2022, All Rights Reserved.
+
+#include "Benchmark.h"
+#include "BrickMap.h"
+#include "JobSystem.h"
+#include "VoxelChunk.h"
+#include "WorldGenerator.h"
+#include <cmath>
+#include <random>
+
+/*
+	Builds a brick map from a generated area, serially and with the chunk
+	conversion spread over the job system, and reports build time and what the
+	bricks cost per voxel next to the palette chunks they came from. The map is
+	checked against the chunks, then refilled under a tight budget to exercise
+	eviction, and finally ray marched the way a GPU far field pass would.
+*/
+
+static const uint32 WorldSeed = 1337;
+static const int32 ViewDistance = 8;
+static const uint64 LargeBudget = 512ull << 20;
+static const uint32 NumRays = 100000;
+static const uint32 NumCheckedRays = 2000;
+static const float RayLength = 256.0f;
+
+struct FSourceChunk
+{
+	int32 				X, Y, Z;
+	const FVoxelChunk* 	Chunk;
+};
+
+// Chunks the map disagrees with.
+static uint32 CountMismatches(const FBrickMap& BrickMap, const std::vector<FSourceChunk>& Chunks, bool bOnlyResident)
+{
+	std::vector<FBlockId> Expected(ChunkVolume);
+	std::vector<FBlockId> Actual(ChunkVolume);
+	uint32 NumBad = 0;
+	for(const FSourceChunk& Source : Chunks)
+	{
+		if(bOnlyResident && !BrickMap.HasChunk(Source.X, Source.Y, Source.Z))
+		{
+			continue;
+		}
+		Source.Chunk->CopyToDense(Expected.data());
+		BrickMap.CopyBlocks(Source.X * ChunkSize, Source.Y * ChunkSize, Source.Z * ChunkSize, ChunkSize, ChunkSize, ChunkSize, Actual.data());
+		NumBad += Expected != Actual ? 1 : 0;
+	}
+	return NumBad;
+}
+
+// One voxel at a time with GetBlock, what Raycast has to agree with.
+static bool RaycastReference(const FBrickMap& BrickMap, const float Origin[3], const float Direction[3], float MaxDistance, FBrickMapHit& OutHit)
+{
+	int32 Voxel[3];
+	int32 Step[3];
+	float Next[3];
+	float Delta[3];
+	for(int32 Axis = 0; Axis < 3; Axis++)
+	{
+		Voxel[Axis] = (int32)std::floor(Origin[Axis]);
+		Step[Axis] = Direction[Axis] > 0.0f ? 1 : (Direction[Axis] < 0.0f ? -1 : 0);
+		Delta[Axis] = Step[Axis] ? std::fabs(1.0f / Direction[Axis]) : 1e30f;
+		Next[Axis] = Step[Axis] ? ((float)(Voxel[Axis] + (Step[Axis] > 0 ? 1 : 0)) - Origin[Axis]) / Direction[Axis] : 1e30f;
+	}
+
+	float Distance = 0.0f;
+	while(Distance <= MaxDistance)
+	{
+		const FBlockId Block = BrickMap.GetBlock(Voxel[0], Voxel[1], Voxel[2]);
+		if(Block != BlockAir)
+		{
+			OutHit.X = Voxel[0];
+			OutHit.Y = Voxel[1];
+			OutHit.Z = Voxel[2];
+			OutHit.BlockId = Block;
+			OutHit.Distance = Distance;
+			return true;
+		}
+
+		const int32 Axis = Next[0] < Next[1] ? (Next[0] < Next[2] ? 0 : 2) : (Next[1] < Next[2] ? 1 : 2);
+		Distance = Next[Axis];
+		Voxel[Axis] += Step[Axis];
+		Next[Axis] += Delta[Axis];
+	}
+	return false;
+}
+
+REGISTER_BENCHMARK(BrickMap_Build)
+{
+	FJobSystem JobSystem;
+	JobSystem.Initialize();
+	{
+		FWorldGenerator Generator(&JobSystem, WorldSeed, ViewDistance);
+		Generator.Update(0.0, 0.0);
+		Generator.Flush();
+
+		std::vector<FSourceChunk> Chunks;
+		uint64 PaletteBytes = 0;
+		Generator.GetChunkMap().ForEach([&](int32 X, int32 Y, int32 Z, FVoxelChunk* Chunk)
+		{
+			Chunks.push_back({ X, Y, Z, Chunk });
+			PaletteBytes += Chunk->GetMemoryUsage();
+		});
+		const uint32 NumChunks = (uint32)Chunks.size();
+		const double NumVoxels = (double)NumChunks * ChunkVolume;
+
+		// Serial, converting and adding each chunk on this thread.
+		FBrickMap BrickMap(LargeBudget);
+		{
+			FBenchmarkTimer Timer;
+			for(const FSourceChunk& Source : Chunks)
+			{
+				BrickMap.AddChunk(Source.X, Source.Y, Source.Z, *Source.Chunk);
+			}
+			const double Seconds = Timer.GetElapsedSeconds();
+			BENCHMARK_REPORT("serial:   %u chunks in %.2f ms, %.1f chunks/s, %.2f us/chunk",
+				NumChunks,
+				Seconds * 1000.0,
+				NumChunks / Seconds,
+				Seconds * 1e6 / NumChunks
+			);
+		}
+
+		// Conversion on the job system, only the cheap copy into the map stays serial.
+		{
+			FBrickMap ParallelMap(LargeBudget);
+			std::vector<FBrickMapChunk> Built(NumChunks);
+			FBenchmarkTimer Timer;
+			JobSystem.ParallelFor(NumChunks, 16, [&](uint32 Index)
+			{
+				FBrickMap::BuildChunk(*Chunks[Index].Chunk, Built[Index]);
+			});
+			const double BuildSeconds = Timer.GetElapsedSeconds();
+			for(uint32 Index = 0; Index < NumChunks; Index++)
+			{
+				ParallelMap.AddChunk(Chunks[Index].X, Chunks[Index].Y, Chunks[Index].Z, Built[Index]);
+			}
+			const double Seconds = Timer.GetElapsedSeconds();
+			BENCHMARK_REPORT("parallel: %u chunks in %.2f ms (%.2f ms adding), %.1f chunks/s on %u threads",
+				NumChunks,
+				Seconds * 1000.0,
+				(Seconds - BuildSeconds) * 1000.0,
+				NumChunks / Seconds,
+				JobSystem.GetNumThreads()
+			);
+
+			if(ParallelMap.GetNumBricks() != BrickMap.GetNumBricks())
+			{
+				BENCHMARK_REPORT("MISMATCH: parallel build made %u bricks, serial %u", ParallelMap.GetNumBricks(), BrickMap.GetNumBricks());
+			}
+		}
+
+		uint32 NumEmpty = 0;
+		uint32 NumUniform = 0;
+		for(const FSourceChunk& Source : Chunks)
+		{
+			for(int32 Y = 0; Y < BricksPerChunk; Y++)
+			for(int32 Z = 0; Z < BricksPerChunk; Z++)
+			for(int32 X = 0; X < BricksPerChunk; X++)
+			{
+				const uint32 Cell = BrickMap.GetCell(Source.X * BricksPerChunk + X, Source.Y * BricksPerChunk + Y, Source.Z * BricksPerChunk + Z);
+				NumEmpty += Cell == FBrickMap::EmptyCell ? 1 : 0;
+				NumUniform += (Cell & FBrickMap::UniformCellFlag) ? 1 : 0;
+			}
+		}
+		const double NumCells = (double)NumChunks * ChunkBrickCount;
+		BENCHMARK_REPORT("cells: %.1f%% empty, %.1f%% uniform, %.1f%% bricks (%u bricks of %u bytes)",
+			NumEmpty * 100.0 / NumCells,
+			NumUniform * 100.0 / NumCells,
+			BrickMap.GetNumBricks() * 100.0 / NumCells,
+			BrickMap.GetNumBricks(),
+			(uint32)sizeof(FBrick)
+		);
+		BENCHMARK_REPORT("bytes/voxel: brick map %.4f (%.1f MB used, %.1f MB with the whole grid), palette chunks %.4f, dense 16 bit %.1f",
+			BrickMap.GetUsedBytes() / NumVoxels,
+			BrickMap.GetUsedBytes() / (1024.0 * 1024.0),
+			BrickMap.GetMemoryUsage() / (1024.0 * 1024.0),
+			PaletteBytes / NumVoxels,
+			(double)sizeof(FBlockId)
+		);
+
+		const uint32 NumBad = CountMismatches(BrickMap, Chunks, false);
+		if(NumBad > 0)
+		{
+			BENCHMARK_REPORT("MISMATCH: %u of %u chunks differ from the brick map", NumBad, NumChunks);
+		}
+
+		// A quarter of the bricks the area needs, later chunks push the earliest out.
+		{
+			const uint64 Budget = (BrickMap.GetMemoryUsage() - (uint64)BrickMap.GetNumPages() * FBrickMap::BricksPerPage * sizeof(FBrick))
+				+ (uint64)BrickMap.GetNumBricks() / 4 * sizeof(FBrick);
+			FBrickMap SmallMap(Budget);
+			for(const FSourceChunk& Source : Chunks)
+			{
+				SmallMap.AddChunk(Source.X, Source.Y, Source.Z, *Source.Chunk);
+			}
+			BENCHMARK_REPORT("budget %.1f MB: %u of %u chunks resident, %u bricks of %u allowed, %llu evictions, %.1f MB allocated",
+				Budget / (1024.0 * 1024.0),
+				SmallMap.GetNumChunks(),
+				NumChunks,
+				SmallMap.GetNumBricks(),
+				SmallMap.GetMaxBricks(),
+				(unsigned long long)SmallMap.GetNumEvictions(),
+				SmallMap.GetMemoryUsage() / (1024.0 * 1024.0)
+			);
+
+			const uint32 NumResidentBad = CountMismatches(SmallMap, Chunks, true);
+			if(SmallMap.GetMemoryUsage() > Budget || NumResidentBad > 0)
+			{
+				BENCHMARK_REPORT("MISMATCH: over budget or %u resident chunks differ", NumResidentBad);
+			}
+		}
+
+		// Rays from above the terrain looking down at the far field.
+		{
+			std::mt19937 Random(WorldSeed);
+			std::uniform_real_distribution<float> Unit(-1.0f, 1.0f);
+			std::vector<float> Rays(NumRays * 6);
+			const float Extent = (float)(ViewDistance * ChunkSize);
+			for(uint32 Ray = 0; Ray < NumRays; Ray++)
+			{
+				float* Origin = &Rays[Ray * 6];
+				float* Direction = Origin + 3;
+				Origin[0] = Unit(Random) * Extent * 0.5f;
+				Origin[1] = (float)(WorldHeight - 1);
+				Origin[2] = Unit(Random) * Extent * 0.5f;
+				Direction[0] = Unit(Random);
+				Direction[1] = -0.2f - std::fabs(Unit(Random));
+				Direction[2] = Unit(Random);
+				const float Length = std::sqrt(Direction[0] * Direction[0] + Direction[1] * Direction[1] + Direction[2] * Direction[2]);
+				for(int32 Axis = 0; Axis < 3; Axis++)
+				{
+					Direction[Axis] /= Length;
+				}
+			}
+
+			uint32 NumHits = 0;
+			FBenchmarkTimer Timer;
+			for(uint32 Ray = 0; Ray < NumRays; Ray++)
+			{
+				FBrickMapHit Hit;
+				NumHits += BrickMap.Raycast(&Rays[Ray * 6], &Rays[Ray * 6 + 3], RayLength, Hit) ? 1 : 0;
+			}
+			const double Seconds = Timer.GetElapsedSeconds();
+			BENCHMARK_REPORT("raycast: %u rays in %.2f ms, %.2f Mrays/s, %.1f%% hit",
+				NumRays,
+				Seconds * 1000.0,
+				NumRays / Seconds / 1e6,
+				NumHits * 100.0 / NumRays
+			);
+
+			uint32 NumRayBad = 0;
+			for(uint32 Ray = 0; Ray < NumCheckedRays; Ray++)
+			{
+				FBrickMapHit Hit;
+				FBrickMapHit Expected;
+				const bool bHit = BrickMap.Raycast(&Rays[Ray * 6], &Rays[Ray * 6 + 3], RayLength, Hit);
+				const bool bExpected = RaycastReference(BrickMap, &Rays[Ray * 6], &Rays[Ray * 6 + 3], RayLength, Expected);
+				if(bHit != bExpected || (bHit && (Hit.X != Expected.X || Hit.Y != Expected.Y || Hit.Z != Expected.Z || Hit.BlockId != Expected.BlockId)))
+				{
+					NumRayBad++;
+				}
+			}
+			if(NumRayBad > 0)
+			{
+				BENCHMARK_REPORT("MISMATCH: %u of %u rays disagree with a voxel by voxel march", NumRayBad, NumCheckedRays);
+			}
+		}
+	}
+	JobSystem.Shutdown();
+}
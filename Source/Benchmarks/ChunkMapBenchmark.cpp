@@ -0,0 +1,203 @@
+// Copyright Snaps 2022, All Rights Reserved.
+
+#include "Benchmark.h"
+#include "ChunkMap.h"
+#include "JobSystem.h"
+#include "VoxelChunk.h"
+#include <unordered_map>
+
+/*
+	Cost of the 3x3x3 neighbourhood lookup meshing and lighting do for every
+	chunk, FChunkMap against std::unordered_map over the same loaded area.
+*/
+
+// Roughly a 24 chunk view distance, 16 chunks tall.
+static const int32 AreaSizeXZ = 48;
+static const int32 AreaSizeY = 16;
+static const int32 NumAreaChunks = AreaSizeXZ * AreaSizeY * AreaSizeXZ;
+
+static uint32 ToAreaIndex(int32 X, int32 Y, int32 Z)
+{
+	return (uint32)(X + Z * AreaSizeXZ + Y * AreaSizeXZ * AreaSizeXZ);
+}
+
+static void ReportLookupTiming(const char* Label, double Seconds, uint32 NumLookups)
+{
+	BENCHMARK_REPORT("%-36s %8.2f ms  %6.2f ns/lookup",
+		Label,
+		Seconds * 1000.0,
+		Seconds * 1e9 / NumLookups
+	);
+}
+
+// Gathers the neighbourhood of every loaded chunk, in the area's natural X, Z, Y order.
+REGISTER_BENCHMARK(ChunkMap_GatherNeighbours)
+{
+	std::vector<FVoxelChunk> Chunks(NumAreaChunks);
+
+	FChunkMap ChunkMap;
+	std::unordered_map<uint64, FVoxelChunk*> UnorderedMap;
+	for(int32 Y = 0; Y < AreaSizeY; Y++)
+	for(int32 Z = 0; Z < AreaSizeXZ; Z++)
+	for(int32 X = 0; X < AreaSizeXZ; X++)
+	{
+		FVoxelChunk* Chunk = &Chunks[ToAreaIndex(X, Y, Z)];
+		ChunkMap.Insert(X, Y, Z, Chunk);
+		UnorderedMap[FChunkMap::PackKey(X, Y, Z)] = Chunk;
+	}
+	BENCHMARK_REPORT("Chunks: %u  Capacity: %u", ChunkMap.GetSize(), ChunkMap.GetCapacity());
+
+	const uint32 NumLookups = NumAreaChunks * 27;
+
+	for(int32 Run = 0; Run < 3; Run++)
+	{
+		uint64 Checksum = 0;
+		FBenchmarkTimer Timer;
+
+		for(int32 Y = 0; Y < AreaSizeY; Y++)
+		for(int32 Z = 0; Z < AreaSizeXZ; Z++)
+		for(int32 X = 0; X < AreaSizeXZ; X++)
+		{
+			FVoxelChunk* Neighbours[27];
+			ChunkMap.GatherNeighbours(X, Y, Z, Neighbours);
+			for(FVoxelChunk* Neighbour : Neighbours)
+			{
+				Checksum += (uint64)(uintptr_t)Neighbour;
+			}
+		}
+		ReportLookupTiming("FChunkMap gather 27:", Timer.GetElapsedSeconds(), NumLookups);
+
+		uint64 UnorderedChecksum = 0;
+		Timer.Reset();
+
+		for(int32 Y = 0; Y < AreaSizeY; Y++)
+		for(int32 Z = 0; Z < AreaSizeXZ; Z++)
+		for(int32 X = 0; X < AreaSizeXZ; X++)
+		{
+			FVoxelChunk* Neighbours[27];
+			for(int32 DeltaY = -1; DeltaY <= 1; DeltaY++)
+			for(int32 DeltaZ = -1; DeltaZ <= 1; DeltaZ++)
+			for(int32 DeltaX = -1; DeltaX <= 1; DeltaX++)
+			{
+				auto Found = UnorderedMap.find(FChunkMap::PackKey(X + DeltaX, Y + DeltaY, Z + DeltaZ));
+				Neighbours[FChunkMap::NeighbourIndex(DeltaX, DeltaY, DeltaZ)] = Found != UnorderedMap.end() ? Found->second : nullptr;
+			}
+			for(FVoxelChunk* Neighbour : Neighbours)
+			{
+				UnorderedChecksum += (uint64)(uintptr_t)Neighbour;
+			}
+		}
+		ReportLookupTiming("std::unordered_map gather 27:", Timer.GetElapsedSeconds(), NumLookups);
+
+		if(Checksum != UnorderedChecksum)
+		{
+			BENCHMARK_REPORT("MISMATCH: chunk map and unordered map disagree");
+		}
+	}
+}
+
+struct FConcurrentReadData
+{
+	const FChunkMap* 			ChunkMap;
+	const FVoxelChunk* 			Chunks;
+	std::atomic<bool>* 			bWriterDone;
+	std::atomic<uint32>* 		NumErrors;
+	std::atomic<uint32>* 		NextReader;
+};
+
+// Gathers every neighbourhood of a quarter of the columns until the writer is done, checking each center column.
+static void ConcurrentReadJob(void* Data)
+{
+	FConcurrentReadData* Read = static_cast<FConcurrentReadData*>(Data);
+	const int32 Reader = (int32)Read->NextReader->fetch_add(1, std::memory_order_relaxed);
+
+	while(!Read->bWriterDone->load(std::memory_order_acquire))
+	{
+		for(int32 Y = 1; Y < AreaSizeY * 2 - 1; Y++)
+		for(int32 Z = 1; Z < AreaSizeXZ - 1; Z++)
+		for(int32 X = 1 + Reader % 4; X < AreaSizeXZ - 1; X += 4)
+		{
+			FVoxelChunk* Neighbours[27];
+			Read->ChunkMap->GatherNeighbours(X, Y, Z, Neighbours);
+
+			for(int32 DeltaY = -1; DeltaY <= 1; DeltaY++)
+			{
+				// The first layer is always there, the second may be any mix of loaded and not.
+				const int32 ChunkY = Y + DeltaY;
+				const uint32 Expected = ChunkY < AreaSizeY ?
+					ToAreaIndex(X, ChunkY, Z) : NumAreaChunks + ToAreaIndex(X, ChunkY - AreaSizeY, Z);
+				const FVoxelChunk* Center = Neighbours[FChunkMap::NeighbourIndex(0, DeltaY, 0)];
+
+				if(Center ? Center != &Read->Chunks[Expected] : ChunkY < AreaSizeY)
+				{
+					Read->NumErrors->fetch_add(1, std::memory_order_relaxed);
+				}
+			}
+		}
+	}
+}
+
+// Workers gather neighbourhoods while the main thread loads a second layer of chunks and unloads it
+// again, checks readers only ever see the right chunk or nothing while the table grows under them.
+REGISTER_BENCHMARK(ChunkMap_ConcurrentReaders)
+{
+	std::vector<FVoxelChunk> Chunks(NumAreaChunks * 2);
+
+	FJobSystem JobSystem;
+	JobSystem.Initialize();
+
+	// Readers spin until the writer is done, so only the workers read and the main thread writes.
+	const uint32 NumReaders = JobSystem.GetNumThreads() - 1;
+
+	for(int32 Run = 0; Run < 3; Run++)
+	{
+		// Start small so the writer has to grow the table while readers are on it.
+		FChunkMap ChunkMap(64);
+		for(int32 Y = 0; Y < AreaSizeY; Y++)
+		for(int32 Z = 0; Z < AreaSizeXZ; Z++)
+		for(int32 X = 0; X < AreaSizeXZ; X++)
+		{
+			ChunkMap.Insert(X, Y, Z, &Chunks[ToAreaIndex(X, Y, Z)]);
+		}
+
+		std::atomic<bool> bWriterDone { false };
+		std::atomic<uint32> NumErrors { 0 };
+		std::atomic<uint32> NextReader { 0 };
+		FConcurrentReadData ReadData { &ChunkMap, Chunks.data(), &bWriterDone, &NumErrors, &NextReader };
+
+		FJobCounter Counter;
+		for(uint32 Reader = 0; Reader < NumReaders; Reader++)
+		{
+			JobSystem.Schedule(&ConcurrentReadJob, &ReadData, &Counter);
+		}
+
+		FBenchmarkTimer Timer;
+		for(int32 Y = 0; Y < AreaSizeY; Y++)
+		for(int32 Z = 0; Z < AreaSizeXZ; Z++)
+		for(int32 X = 0; X < AreaSizeXZ; X++)
+		{
+			ChunkMap.Insert(X, Y + AreaSizeY, Z, &Chunks[NumAreaChunks + ToAreaIndex(X, Y, Z)]);
+		}
+		for(int32 Y = 0; Y < AreaSizeY; Y++)
+		for(int32 Z = 0; Z < AreaSizeXZ; Z++)
+		for(int32 X = 0; X < AreaSizeXZ; X++)
+		{
+			ChunkMap.Remove(X, Y + AreaSizeY, Z);
+		}
+		const double WriteSeconds = Timer.GetElapsedSeconds();
+
+		bWriterDone.store(true, std::memory_order_release);
+		JobSystem.Wait(Counter);
+
+		BENCHMARK_REPORT("Insert + remove %u chunks under %u readers: %8.2f ms  errors: %u",
+			NumAreaChunks,
+			NumReaders,
+			WriteSeconds * 1000.0,
+			NumErrors.load()
+		);
+
+		ChunkMap.ReclaimRetiredTables();
+	}
+
+	JobSystem.Shutdown();
+}
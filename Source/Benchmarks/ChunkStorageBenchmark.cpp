@@ -0,0 +1,167 @@
+// Copyright Snaps 2022, All Rights Reserved.
+
+#include "Benchmark.h"
+#include "VoxelChunk.h"
+
+/*
+	Memory per chunk and access cost for palette compressed chunk storage,
+	compared against a raw uint16 per voxel array.
+*/
+
+static const size_t RawChunkBytes = ChunkVolume * sizeof(FBlockId);
+
+static uint32 HashVoxel(uint32 X, uint32 Y, uint32 Z, uint32 Seed)
+{
+	uint32 Hash = X * 0x8DA6B343u ^ Y * 0xD8163841u ^ Z * 0xCB1AB31Fu ^ Seed;
+	Hash ^= Hash >> 15;
+	Hash *= 0x2C1B3C6Du;
+	Hash ^= Hash >> 12;
+	return Hash;
+}
+
+// Stone, dirt and grass under a rolling surface with a few ores mixed in.
+static void GenerateTerrain(FBlockId* Blocks, uint32 Seed, int32 NumOres)
+{
+	for(int32 Y = 0; Y < ChunkSize; Y++)
+	for(int32 Z = 0; Z < ChunkSize; Z++)
+	for(int32 X = 0; X < ChunkSize; X++)
+	{
+		const int32 Surface = 16 + (int32)(HashVoxel(X / 8, 0, Z / 8, Seed) % 8);
+		FBlockId Block = BlockAir;
+
+		if(Y < Surface - 3)
+		{
+			Block = 1;
+			if(NumOres > 0 && HashVoxel(X, Y, Z, Seed) % 64 == 0)
+			{
+				Block = (FBlockId)(4 + HashVoxel(X, Y, Z, Seed + 1) % NumOres);
+			}
+		}
+		else if(Y < Surface)
+		{
+			Block = 2;
+		}
+		else if(Y == Surface)
+		{
+			Block = 3;
+		}
+
+		Blocks[FVoxelChunk::ToIndex(X, Y, Z)] = Block;
+	}
+}
+
+static void GenerateRandom(FBlockId* Blocks, uint32 Seed, uint32 NumTypes)
+{
+	for(int32 Index = 0; Index < ChunkVolume; Index++)
+	{
+		Blocks[Index] = (FBlockId)(HashVoxel(Index, 0, 0, Seed) % NumTypes);
+	}
+}
+
+static void ReportChunk(const char* Label, const FVoxelChunk& Chunk)
+{
+	const size_t Bytes = Chunk.GetMemoryUsage();
+	BENCHMARK_REPORT("%-26s %7zu bytes  %2u bits  %3u palette  %5.1fx smaller than raw  %8.0f chunks/GB",
+		Label,
+		Bytes,
+		Chunk.GetBitsPerIndex(),
+		Chunk.GetPaletteSize(),
+		(double)RawChunkBytes / Bytes,
+		1024.0 * 1024.0 * 1024.0 / Bytes
+	);
+}
+
+REGISTER_BENCHMARK(ChunkStorage_MemoryPerChunk)
+{
+	std::vector<FBlockId> Blocks(ChunkVolume);
+	BENCHMARK_REPORT("Raw uint16 chunk:          %7zu bytes", RawChunkBytes);
+
+	FVoxelChunk Air;
+	ReportChunk("Uniform air:", Air);
+
+	FVoxelChunk Stone(1);
+	ReportChunk("Uniform stone:", Stone);
+
+	FVoxelChunk Terrain;
+	GenerateTerrain(Blocks.data(), 1337, 0);
+	Terrain.SetFromDense(Blocks.data());
+	ReportChunk("Surface terrain:", Terrain);
+
+	FVoxelChunk OreTerrain;
+	GenerateTerrain(Blocks.data(), 1337, 8);
+	OreTerrain.SetFromDense(Blocks.data());
+	ReportChunk("Surface terrain + 8 ores:", OreTerrain);
+
+	FVoxelChunk Random64;
+	GenerateRandom(Blocks.data(), 7, 64);
+	Random64.SetFromDense(Blocks.data());
+	ReportChunk("Random, 64 block types:", Random64);
+
+	FVoxelChunk Random1024;
+	GenerateRandom(Blocks.data(), 7, 1024);
+	Random1024.SetFromDense(Blocks.data());
+	ReportChunk("Random, 1024 block types:", Random1024);
+
+	// Typical resident world, mostly air and solid underground chunks with a band of surface chunks.
+	const double AverageBytes = 0.55 * Air.GetMemoryUsage()
+		+ 0.25 * Stone.GetMemoryUsage()
+		+ 0.15 * OreTerrain.GetMemoryUsage()
+		+ 0.05 * Random64.GetMemoryUsage();
+
+	BENCHMARK_REPORT("300k chunk world (55%% air, 25%% stone, 15%% surface, 5%% busy): %.1f MB palette vs %.1f MB raw",
+		AverageBytes * 300000 / (1024.0 * 1024.0),
+		(double)RawChunkBytes * 300000 / (1024.0 * 1024.0)
+	);
+}
+
+REGISTER_BENCHMARK(ChunkStorage_Access)
+{
+	std::vector<FBlockId> Blocks(ChunkVolume);
+	GenerateTerrain(Blocks.data(), 42, 8);
+
+	FVoxelChunk Chunk;
+	const int32 NumChunks = 200;
+
+	FBenchmarkTimer Timer;
+	for(int32 Run = 0; Run < NumChunks; Run++)
+	{
+		Chunk.SetFromDense(Blocks.data());
+	}
+	const double FromDenseSeconds = Timer.GetElapsedSeconds();
+
+	Timer.Reset();
+	for(int32 Run = 0; Run < NumChunks; Run++)
+	{
+		Chunk.CopyToDense(Blocks.data());
+	}
+	const double ToDenseSeconds = Timer.GetElapsedSeconds();
+
+	Timer.Reset();
+	uint32 Checksum = 0;
+	for(int32 Run = 0; Run < NumChunks; Run++)
+	{
+		for(int32 Index = 0; Index < ChunkVolume; Index++)
+		{
+			Checksum += Chunk.Get(Index);
+		}
+	}
+	const double GetSeconds = Timer.GetElapsedSeconds();
+
+	// Random edits, includes palette growth as new ids appear.
+	Timer.Reset();
+	for(int32 Run = 0; Run < NumChunks; Run++)
+	{
+		for(int32 Edit = 0; Edit < 4096; Edit++)
+		{
+			const uint32 Hash = HashVoxel(Edit, Run, 0, 99);
+			Chunk.Set((int32)(Hash % ChunkVolume), (FBlockId)(Hash >> 24) % 24);
+		}
+	}
+	const double SetSeconds = Timer.GetElapsedSeconds();
+
+	const double NumVoxels = (double)NumChunks * ChunkVolume;
+	BENCHMARK_REPORT("SetFromDense:  %6.2f us/chunk", FromDenseSeconds * 1e6 / NumChunks);
+	BENCHMARK_REPORT("CopyToDense:   %6.2f us/chunk", ToDenseSeconds * 1e6 / NumChunks);
+	BENCHMARK_REPORT("Get:           %6.2f ns/voxel (checksum %u)", GetSeconds * 1e9 / NumVoxels, Checksum);
+	BENCHMARK_REPORT("Set:           %6.2f ns/edit", SetSeconds * 1e9 / (NumChunks * 4096.0));
+}
@@ -0,0 +1,111 @@
+// Copyright Snaps 2022, All Rights Reserved.
+
+#include "Benchmark.h"
+#include "PacingController.h"
+#include <algorithm>
+#include <cmath>
+#include <random>
+
+/*
+	Present wait pacing against a simulated 60 Hz FIFO display. Each frame
+	waits for the previous one to be shown, sleeps for the controller's delay,
+	then takes its CPU and GPU work to be ready and is shown at the first free
+	vblank after that. Reports missed vblanks while the delay settles and once
+	it has, which should be none bar spikes bigger than the margin, and the
+	input to display latency it buys.
+*/
+
+static const double RefreshSeconds = 1.0 / 60.0;
+static const double MinMarginSeconds = 0.001;
+static const uint32 PacingSeed = 1337;
+static const int32 SettleFrames = 120;
+static const int32 NumFrames = 3600;
+
+struct FPacingLoad
+{
+	const char* Name;
+	double 		WorkMs;
+	double 		JitterMs; 		// Standard deviation of the work.
+	double 		SpikeChance; 	// Frames that take SpikeMs on top.
+	double 		SpikeMs;
+};
+
+static void SimulatePacing(const FPacingLoad& Load)
+{
+	FPacingController Controller;
+	Controller.Initialize(RefreshSeconds, MinMarginSeconds);
+
+	std::mt19937 Random(PacingSeed);
+	std::normal_distribution<double> WorkDistribution(Load.WorkMs / 1000.0, Load.JitterMs / 1000.0);
+	std::uniform_real_distribution<double> SpikeDistribution(0.0, 1.0);
+
+	double LastDisplay = 0.0;
+	uint64 SettlingMisses = 0;
+	uint64 SettledMisses = 0;
+	uint64 SettledSpikes = 0;
+	double SettledLatency = 0.0;
+	double SettledDelay = 0.0;
+	double UnpacedLatency = 0.0;
+
+	for(int32 Frame = 0; Frame < NumFrames; Frame++)
+	{
+		double Work = std::max(0.0, WorkDistribution(Random));
+		const bool bSpike = SpikeDistribution(Random) < Load.SpikeChance;
+		if(bSpike)
+		{
+			Work += Load.SpikeMs / 1000.0;
+		}
+
+		// Shown at the first vblank the frame is ready for, one frame per vblank.
+		const double Start = LastDisplay + Controller.GetDelay();
+		const double Ready = Start + Work;
+		const double Display = std::max(std::ceil(Ready / RefreshSeconds - 1e-9), std::round(LastDisplay / RefreshSeconds) + 1.0) * RefreshSeconds;
+
+		const bool bMissed = Controller.OnFrameDisplayed(Display - Start, Work, Frame > 0 ? Display - LastDisplay : RefreshSeconds);
+		if(Frame < SettleFrames)
+		{
+			SettlingMisses += bMissed ? 1 : 0;
+		}
+		else
+		{
+			SettledMisses += bMissed ? 1 : 0;
+			SettledSpikes += bSpike ? 1 : 0;
+			SettledLatency += Display - Start;
+			SettledDelay += Controller.GetDelay();
+
+			// Without pacing the frame starts as soon as the last one is shown, a whole refresh before its own.
+			UnpacedLatency += std::max(std::ceil(Work / RefreshSeconds - 1e-9), 1.0) * RefreshSeconds;
+		}
+		LastDisplay = Display;
+	}
+
+	const int32 NumSettled = NumFrames - SettleFrames;
+	BENCHMARK_REPORT("%-8s work %4.1f ms +- %.1f: %llu missed vblanks settling, %llu of %d after (%llu spikes), delay %5.2f ms, latency %5.2f ms (%5.2f ms unpaced)",
+		Load.Name,
+		Load.WorkMs,
+		Load.JitterMs,
+		(unsigned long long)SettlingMisses,
+		(unsigned long long)SettledMisses,
+		NumSettled,
+		(unsigned long long)SettledSpikes,
+		SettledDelay * 1000.0 / NumSettled,
+		SettledLatency * 1000.0 / NumSettled,
+		UnpacedLatency * 1000.0 / NumSettled
+	);
+}
+
+REGISTER_BENCHMARK(FramePacing_Simulated)
+{
+	const FPacingLoad Loads[] =
+	{
+		{ "Light:", 	4.0, 	0.2, 	0.0, 	0.0 },
+		{ "Steady:", 	9.0, 	0.5, 	0.0, 	0.0 },
+		{ "Noisy:", 	9.0, 	1.5, 	0.0, 	0.0 },
+		{ "Spiky:", 	9.0, 	0.5, 	0.005, 	4.0 },
+	};
+
+	for(const FPacingLoad& Load : Loads)
+	{
+		SimulatePacing(Load);
+	}
+}
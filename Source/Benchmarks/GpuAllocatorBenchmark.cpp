@@ -0,0 +1,249 @@
+// Copyright Snaps 2022, All Rights Reserved.
+
+#include "Benchmark.h"
+#include "GpuAllocator.h"
+#include <algorithm>
+#include <cstring>
+
+/*
+	Drives FGpuAllocator against a mock heap, so allocation speed, fragmentation
+	and defragmentation can be measured (and checked) without a GPU. The mock can
+	back its blocks with host memory, which lets the defragment benchmark carry
+	out the moves for real and verify no data was lost.
+*/
+
+class FMockGpuMemoryHeap : public IGpuMemoryHeap
+{
+public:
+
+	explicit FMockGpuMemoryHeap(bool bInBackWithMemory = false, uint64 InBudget = ~0ull)
+		: bBackWithMemory(bInBackWithMemory)
+		, Budget(InBudget)
+	{
+	}
+
+	virtual bool AllocateBlock(uint64 Size, uint64& OutHandle) override
+	{
+		if(ReservedBytes + Size > Budget)
+		{
+			return false;
+		}
+
+		ReservedBytes += Size;
+		OutHandle = Blocks.size();
+		Blocks.push_back(std::vector<uint8>(bBackWithMemory ? (size_t)Size : 0));
+		BlockSizes.push_back(Size);
+		return true;
+	}
+
+	virtual void FreeBlock(uint64 Handle) override
+	{
+		ReservedBytes -= BlockSizes[(size_t)Handle];
+		BlockSizes[(size_t)Handle] = 0;
+		std::vector<uint8>().swap(Blocks[(size_t)Handle]);
+	}
+
+	uint8* GetMemory(uint64 Handle)
+	{
+		return Blocks[(size_t)Handle].data();
+	}
+
+	uint64 GetReservedBytes() const
+	{
+		return ReservedBytes;
+	}
+
+private:
+
+	bool 							bBackWithMemory;
+	uint64 							Budget;
+	uint64 							ReservedBytes = 0;
+	std::vector<std::vector<uint8>> Blocks;
+	std::vector<uint64> 			BlockSizes;
+};
+
+static uint32 NextRandom(uint32& State)
+{
+	State ^= State << 13;
+	State ^= State >> 17;
+	State ^= State << 5;
+	return State;
+}
+
+// Chunk mesh sized requests, roughly log uniform between 1 KB and 256 KB.
+static uint64 RandomMeshSize(uint32& State)
+{
+	const uint32 Shift = 10 + NextRandom(State) % 8;
+	return (1ull << Shift) + NextRandom(State) % (1u << Shift);
+}
+
+// True if no two live allocations overlap and none runs past its block.
+static bool CheckNoOverlaps(const std::vector<FGpuAllocation>& Allocations, uint64 BlockSize)
+{
+	std::vector<const FGpuAllocation*> Sorted;
+	for(const FGpuAllocation& Allocation : Allocations)
+	{
+		if(Allocation.IsValid())
+		{
+			Sorted.push_back(&Allocation);
+		}
+	}
+
+	std::sort(Sorted.begin(), Sorted.end(), [](const FGpuAllocation* A, const FGpuAllocation* B)
+	{
+		return A->Block != B->Block ? A->Block < B->Block : A->Offset < B->Offset;
+	});
+
+	for(size_t Index = 0; Index < Sorted.size(); Index++)
+	{
+		const FGpuAllocation& Current = *Sorted[Index];
+		if(Current.Offset + Current.Size > BlockSize)
+		{
+			return false;
+		}
+		if(Index > 0 && Sorted[Index - 1]->Block == Current.Block && Sorted[Index - 1]->Offset + Sorted[Index - 1]->Size > Current.Offset)
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+static void ReportHeapStats(const char* Label, const FGpuHeapStats& Stats)
+{
+	BENCHMARK_REPORT("%-14s %5u allocs  %3u blocks  %7.1f / %7.1f MB used  largest free %6.1f MB  fragmentation %.2f",
+		Label,
+		Stats.NumAllocations,
+		Stats.NumBlocks,
+		Stats.AllocatedBytes / (1024.0 * 1024.0),
+		Stats.ReservedBytes / (1024.0 * 1024.0),
+		Stats.LargestFreeRange / (1024.0 * 1024.0),
+		Stats.GetFragmentation()
+	);
+}
+
+// Steady state streaming: thousands of live chunk meshes with random ones replaced every op.
+REGISTER_BENCHMARK(GpuAllocator_Churn)
+{
+	static const uint32 NumLiveMeshes = 8192;
+	static const uint32 NumOps = 1000000;
+	static const uint64 BlockSize = 64ull * 1024 * 1024;
+
+	FMockGpuMemoryHeap Heap;
+	FGpuAllocator Allocator;
+	Allocator.Initialize(&Heap, BlockSize);
+
+	uint32 Random = 0x12345678;
+	std::vector<FGpuAllocation> Allocations(NumLiveMeshes);
+
+	FBenchmarkTimer FillTimer;
+	for(FGpuAllocation& Allocation : Allocations)
+	{
+		Allocator.Allocate(RandomMeshSize(Random), 16, Allocation);
+	}
+	const double FillSeconds = FillTimer.GetElapsedSeconds();
+	ReportHeapStats("After fill:", Allocator.GetStats());
+
+	FBenchmarkTimer ChurnTimer;
+	for(uint32 Op = 0; Op < NumOps; Op++)
+	{
+		FGpuAllocation& Allocation = Allocations[NextRandom(Random) % NumLiveMeshes];
+		Allocator.Free(Allocation);
+		Allocator.Allocate(RandomMeshSize(Random), 16, Allocation);
+	}
+	const double ChurnSeconds = ChurnTimer.GetElapsedSeconds();
+
+	const FGpuHeapStats Stats = Allocator.GetStats();
+	ReportHeapStats("After churn:", Stats);
+	BENCHMARK_REPORT("Fill:  %7.1f ns/alloc", FillSeconds * 1e9 / NumLiveMeshes);
+	BENCHMARK_REPORT("Churn: %7.1f ns/free+alloc", ChurnSeconds * 1e9 / NumOps);
+	BENCHMARK_REPORT("Driver allocations: %llu for %u meshes and %u replacements",
+		(unsigned long long)Stats.TotalBlockAllocations,
+		NumLiveMeshes,
+		NumOps
+	);
+	BENCHMARK_REPORT("Validate: %s, overlaps: %s",
+		Allocator.Validate() ? "ok" : "FAILED",
+		CheckNoOverlaps(Allocations, BlockSize) ? "none" : "FOUND"
+	);
+
+	Allocator.Shutdown();
+}
+
+// Frees most meshes at random to leave sparse blocks, then compacts them. Blocks are backed by
+// host memory and every mesh is filled with its own id, so the moves are carried out and checked.
+REGISTER_BENCHMARK(GpuAllocator_Defragment)
+{
+	static const uint32 NumMeshes = 4096;
+	static const uint64 BlockSize = 16ull * 1024 * 1024;
+
+	FMockGpuMemoryHeap Heap(true);
+	FGpuAllocator Allocator;
+	Allocator.Initialize(&Heap, BlockSize);
+
+	uint32 Random = 0x9E3779B9;
+	std::vector<FGpuAllocation> Allocations(NumMeshes);
+	for(uint32 Index = 0; Index < NumMeshes; Index++)
+	{
+		Allocator.Allocate(RandomMeshSize(Random), 16, Allocations[Index]);
+		std::memset(Heap.GetMemory(Allocator.GetBlockHandle(Allocations[Index].Block)) + Allocations[Index].Offset, Index & 0xFF, (size_t)Allocations[Index].Size);
+	}
+
+	// Keep roughly one in three.
+	for(FGpuAllocation& Allocation : Allocations)
+	{
+		if(NextRandom(Random) % 3 != 0)
+		{
+			Allocator.Free(Allocation);
+		}
+	}
+	ReportHeapStats("Before:", Allocator.GetStats());
+
+	std::vector<FGpuAllocation*> Movable;
+	for(FGpuAllocation& Allocation : Allocations)
+	{
+		Movable.push_back(&Allocation);
+	}
+
+	std::vector<FGpuMove> Moves;
+	FBenchmarkTimer Timer;
+	Allocator.BeginDefragment(Movable.data(), (uint32)Movable.size(), ~0ull, Moves);
+	const double PlanSeconds = Timer.GetElapsedSeconds();
+
+	// Stand in for the GPU copies, old ranges are still valid until EndDefragment.
+	uint64 BytesMoved = 0;
+	for(const FGpuMove& Move : Moves)
+	{
+		std::memcpy(
+			Heap.GetMemory(Allocator.GetBlockHandle(Move.DstBlock)) + Move.DstOffset,
+			Heap.GetMemory(Allocator.GetBlockHandle(Move.SrcBlock)) + Move.SrcOffset,
+			(size_t)Move.Size
+		);
+		BytesMoved += Move.Size;
+	}
+	Allocator.EndDefragment();
+
+	ReportHeapStats("After:", Allocator.GetStats());
+	BENCHMARK_REPORT("Planned %zu moves (%.1f MB) in %.3f ms", Moves.size(), BytesMoved / (1024.0 * 1024.0), PlanSeconds * 1000.0);
+
+	bool bContentsIntact = true;
+	for(uint32 Index = 0; Index < NumMeshes; Index++)
+	{
+		const FGpuAllocation& Allocation = Allocations[Index];
+		if(!Allocation.IsValid())
+		{
+			continue;
+		}
+
+		const uint8* Memory = Heap.GetMemory(Allocator.GetBlockHandle(Allocation.Block)) + Allocation.Offset;
+		bContentsIntact &= Memory[0] == (Index & 0xFF) && Memory[Allocation.Size - 1] == (Index & 0xFF);
+	}
+
+	BENCHMARK_REPORT("Validate: %s, overlaps: %s, contents: %s",
+		Allocator.Validate() ? "ok" : "FAILED",
+		CheckNoOverlaps(Allocations, BlockSize) ? "none" : "FOUND",
+		bContentsIntact ? "intact" : "CORRUPT"
+	);
+
+	Allocator.Shutdown();
+}
@@ -0,0 +1,116 @@
+// Copyright Snaps 2022, All Rights Reserved.
+
+#include "Benchmark.h"
+#include "JobSystem.h"
+
+/*
+	Measures raw scheduling overhead of the job system using empty jobs.
+*/
+
+static const uint32 NumEmptyJobs = 1000000;
+
+static void EmptyJob(void*)
+{
+}
+
+static void ReportJobTiming(const char* Label, double Seconds, uint32 NumJobs)
+{
+	BENCHMARK_REPORT("%-28s %8.2f ms  %7.1f ns/job  %6.2f Mjobs/s",
+		Label,
+		Seconds * 1000.0,
+		Seconds * 1e9 / NumJobs,
+		NumJobs / Seconds / 1e6
+	);
+}
+
+// 1M empty jobs pushed from the main thread, workers have to steal all of them.
+REGISTER_BENCHMARK(JobSystem_EmptyJobs)
+{
+	FJobSystem JobSystem;
+	JobSystem.Initialize();
+	BENCHMARK_REPORT("Threads: %u", JobSystem.GetNumThreads());
+
+	for(int32 Run = 0; Run < 3; Run++)
+	{
+		FJobCounter Counter;
+		FBenchmarkTimer Timer;
+
+		for(uint32 Index = 0; Index < NumEmptyJobs; Index++)
+		{
+			JobSystem.Schedule(&EmptyJob, nullptr, &Counter);
+		}
+		JobSystem.Wait(Counter);
+
+		ReportJobTiming("Schedule + finish 1M jobs:", Timer.GetElapsedSeconds(), NumEmptyJobs);
+	}
+
+	JobSystem.Shutdown();
+}
+
+// 1000 jobs that each spawn 1000 empty jobs, so every worker is scheduling into its own deque.
+REGISTER_BENCHMARK(JobSystem_NestedEmptyJobs)
+{
+	struct FSpawnerData
+	{
+		FJobSystem* 	JobSystem;
+		FJobCounter* 	Counter;
+	};
+
+	static const uint32 NumSpawners = 1000;
+	static const uint32 JobsPerSpawner = NumEmptyJobs / NumSpawners;
+
+	FJobSystem JobSystem;
+	JobSystem.Initialize();
+
+	for(int32 Run = 0; Run < 3; Run++)
+	{
+		FJobCounter Counter;
+		FSpawnerData SpawnerData { &JobSystem, &Counter };
+		FBenchmarkTimer Timer;
+
+		for(uint32 Index = 0; Index < NumSpawners; Index++)
+		{
+			JobSystem.Schedule([](void* Data)
+			{
+				FSpawnerData* Spawner = static_cast<FSpawnerData*>(Data);
+				for(uint32 Job = 0; Job < JobsPerSpawner; Job++)
+				{
+					Spawner->JobSystem->Schedule(&EmptyJob, nullptr, Spawner->Counter);
+				}
+			}, &SpawnerData, &Counter);
+		}
+		JobSystem.Wait(Counter);
+
+		ReportJobTiming("Nested 1000 x 1000 jobs:", Timer.GetElapsedSeconds(), NumEmptyJobs + NumSpawners);
+	}
+
+	JobSystem.Shutdown();
+}
+
+// 1M iterations through ParallelFor, shows how much batching amortizes the per-job cost.
+REGISTER_BENCHMARK(JobSystem_ParallelFor)
+{
+	FJobSystem JobSystem;
+	JobSystem.Initialize();
+
+	const uint32 BatchSizes[] = { 1, 64, 1024 };
+	for(uint32 BatchSize : BatchSizes)
+	{
+		std::atomic<uint32> Sum { 0 };
+		FBenchmarkTimer Timer;
+
+		JobSystem.ParallelFor(NumEmptyJobs, BatchSize, [&Sum](uint32 Index)
+		{
+			if(Index == 0)
+			{
+				Sum.fetch_add(1, std::memory_order_relaxed);
+			}
+		});
+
+		char Label[64];
+		std::snprintf(Label, sizeof(Label), "ParallelFor 1M, batch %u:", BatchSize);
+		ReportJobTiming(Label, Timer.GetElapsedSeconds(), NumEmptyJobs);
+	}
+
+	JobSystem.Shutdown();
+}
@@ -0,0 +1,170 @@
+// Copyright Snaps 2022, All Rights Reserved.
+
+#include "Benchmark.h"
+#include "BenchmarkTerrain.h"
+#include "ChunkMap.h"
+#include "JobSystem.h"
+#include "LightEngine.h"
+#include "VoxelChunk.h"
+#include <algorithm>
+#include <memory>
+#include <random>
+
+/*
+	Sky and block light over the hills terrain, with ore glowing in the caves.
+	The whole area is lit from scratch first, then editors dig and build
+	around the surface, some of them placing more ore, and each frame's
+	Update relights around their edits. Light updates are voxels whose light
+	a flood fill wrote. Afterwards the area is lit again from scratch and has
+	to come out the same as the incremental updates left it.
+*/
+
+static const uint32 TerrainSeed = 1337;
+static const int32 AreaColumns = 8;
+static const int32 AreaHeightChunks = 3;
+static const int32 NumFrames = 60;
+static const uint8 OreEmission = 12;
+
+// Edits land around the hills' surface, between chunk Y 1 and 2.
+static const int32 EditMinY = ChunkSize;
+static const int32 EditMaxY = ChunkSize * AreaHeightChunks - 1;
+
+static void SetupBlockLight(FLightEngine& Light)
+{
+	Light.SetBlockLight(BenchmarkOre, OreEmission, true);
+}
+
+REGISTER_BENCHMARK(Lighting_Updates)
+{
+	FJobSystem JobSystem;
+	JobSystem.Initialize();
+
+	FChunkMap ChunkMap;
+	std::vector<std::unique_ptr<FVoxelChunk>> Chunks;
+	{
+		FMeshVolume Volume;
+		std::vector<FBlockId> Blocks(ChunkVolume);
+		for(int32 Y = 0; Y < AreaHeightChunks; Y++)
+		for(int32 Z = 0; Z < AreaColumns; Z++)
+		for(int32 X = 0; X < AreaColumns; X++)
+		{
+			GenerateBenchmarkTerrain(Volume, X, Y, Z, TerrainSeed);
+			for(int32 LocalY = 0; LocalY < ChunkSize; LocalY++)
+			for(int32 LocalZ = 0; LocalZ < ChunkSize; LocalZ++)
+			for(int32 LocalX = 0; LocalX < ChunkSize; LocalX++)
+			{
+				Blocks[FVoxelChunk::ToIndex(LocalX, LocalY, LocalZ)] = Volume.Get(LocalX, LocalY, LocalZ);
+			}
+
+			Chunks.emplace_back(new FVoxelChunk());
+			Chunks.back()->SetFromDense(Blocks.data());
+			ChunkMap.Insert(X, Y, Z, Chunks.back().get());
+		}
+	}
+
+	FLightEngine Light(&JobSystem, &ChunkMap);
+	SetupBlockLight(Light);
+	{
+		for(int32 Y = 0; Y < AreaHeightChunks; Y++)
+		for(int32 Z = 0; Z < AreaColumns; Z++)
+		for(int32 X = 0; X < AreaColumns; X++)
+		{
+			Light.OnChunkLoaded(X, Y, Z);
+		}
+
+		FBenchmarkTimer Timer;
+		Light.Update();
+		const double Seconds = Timer.GetElapsedSeconds();
+
+		size_t LightBytes = 0;
+		for(const std::unique_ptr<FVoxelChunk>& Chunk : Chunks)
+		{
+			LightBytes += Chunk->IsLightUniform() ? 0 : ChunkVolume;
+		}
+
+		const FLightStats& Stats = Light.GetStats();
+		BENCHMARK_REPORT("%u chunks lit in %.2f ms on %u threads: %.0f chunks/s, %.1f M light updates/s, %llu waves",
+			(uint32)Chunks.size(),
+			Seconds * 1000.0,
+			JobSystem.GetNumThreads(),
+			Chunks.size() / Seconds,
+			Stats.NumVoxelsSet / Seconds / 1e6,
+			(unsigned long long)Stats.NumWaves
+		);
+		BENCHMARK_REPORT("light data %.1f KB per chunk, the rest are uniform", LightBytes / 1024.0 / Chunks.size());
+	}
+
+	std::mt19937 Random(TerrainSeed);
+
+	const uint32 EditorCounts[] = { 1, 16, 256 };
+	for(uint32 NumEditors : EditorCounts)
+	{
+		std::uniform_int_distribution<int32> HorizontalDistribution(0, AreaColumns * ChunkSize - 1);
+		std::uniform_int_distribution<int32> VerticalDistribution(EditMinY, EditMaxY);
+
+		double TotalSeconds = 0.0;
+		double WorstSeconds = 0.0;
+		const FLightStats Before = Light.GetStats();
+
+		for(int32 Frame = 0; Frame < NumFrames; Frame++)
+		{
+			// Every editor digs out or fills in one block a frame, one in four fills is a light.
+			for(uint32 Editor = 0; Editor < NumEditors; Editor++)
+			{
+				const int32 X = HorizontalDistribution(Random);
+				const int32 Y = VerticalDistribution(Random);
+				const int32 Z = HorizontalDistribution(Random);
+				FVoxelChunk* Chunk = ChunkMap.Find(X >> ChunkSizeLog2, Y >> ChunkSizeLog2, Z >> ChunkSizeLog2);
+				const int32 Index = FVoxelChunk::ToIndex(X & (ChunkSize - 1), Y & (ChunkSize - 1), Z & (ChunkSize - 1));
+				const bool bSolid = Chunk->Get(Index) != BlockAir;
+				Chunk->Set(Index, bSolid ? BlockAir : (Random() % 4 == 0 ? BenchmarkOre : BenchmarkStone));
+				Light.OnBlockChanged(X, Y, Z);
+			}
+
+			FBenchmarkTimer Timer;
+			Light.Update();
+			const double Seconds = Timer.GetElapsedSeconds();
+			TotalSeconds += Seconds;
+			WorstSeconds = std::max(WorstSeconds, Seconds);
+		}
+
+		const FLightStats& Stats = Light.GetStats();
+		BENCHMARK_REPORT("%3u editors: %6.3f ms avg %6.3f ms worst per frame, %8.0f edits/s, %5.1f M light updates/s, %4.1f waves",
+			NumEditors,
+			TotalSeconds * 1000.0 / NumFrames,
+			WorstSeconds * 1000.0,
+			(Stats.NumEdits - Before.NumEdits) / TotalSeconds,
+			(Stats.NumVoxelsSet - Before.NumVoxelsSet) / TotalSeconds / 1e6,
+			(double)(Stats.NumWaves - Before.NumWaves) / NumFrames
+		);
+	}
+
+	// Lighting copies of the edited chunks from scratch has to give the same light everywhere.
+	FChunkMap FreshMap;
+	std::vector<std::unique_ptr<FVoxelChunk>> FreshChunks;
+	FLightEngine FreshLight(&JobSystem, &FreshMap);
+	SetupBlockLight(FreshLight);
+	ChunkMap.ForEach([&](int32 X, int32 Y, int32 Z, FVoxelChunk* Chunk)
+	{
+		FreshChunks.emplace_back(new FVoxelChunk(*Chunk));
+		FreshMap.Insert(X, Y, Z, FreshChunks.back().get());
+		FreshLight.OnChunkLoaded(X, Y, Z);
+	});
+	FreshLight.Update();
+
+	uint64 NumMismatches = 0;
+	ChunkMap.ForEach([&](int32 X, int32 Y, int32 Z, FVoxelChunk* Chunk)
+	{
+		const FVoxelChunk* Fresh = FreshMap.Find(X, Y, Z);
+		for(int32 Index = 0; Index < ChunkVolume; Index++)
+		{
+			NumMismatches += Chunk->GetLight(Index) != Fresh->GetLight(Index) ? 1 : 0;
+		}
+	});
+	if(NumMismatches > 0)
+	{
+		BENCHMARK_REPORT("MISMATCH: %llu voxels differ from lighting from scratch", (unsigned long long)NumMismatches);
+	}
+
+	JobSystem.Shutdown();
+}
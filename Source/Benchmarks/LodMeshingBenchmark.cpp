@@ -0,0 +1,407 @@
+// Copyright Snaps 2022, All Rights Reserved.
+
+#include "Benchmark.h"
+#include "BenchmarkTerrain.h"
+#include "JobSystem.h"
+#include "LodMesher.h"
+#include "LodTerrain.h"
+#include "VoxelChunk.h"
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <unordered_map>
+
+/*
+	Meshes the hills terrain around a viewer twice: a 16 chunk radius at full
+	detail, and a 64 chunk radius with LODs, full detail out to 6 chunks and one
+	level coarser every time the distance doubles. The LOD terrain should cost
+	about as many triangles as the full detail one while reaching four times as
+	far. Every LOD border is checked for cracks with rays that cross it, and
+	then the viewer steps one chunk over and the cost of reselecting and
+	remeshing what changed is reported.
+*/
+
+static const uint32 TerrainSeed = 1337;
+static const int32 FullDetailRadius = 16;
+static const int32 LodRadius = 64;
+static const uint32 ColumnsPerBatch = 256;
+
+// The hills sit between chunk Y 1 and 2, everything below is stone and above is air.
+static const int32 TerrainMinChunkY = 1;
+static const int32 TerrainMaxChunkY = 2;
+
+// Crack rays start in the air above the hills on one side of a border and end in the stone under
+// them on the other, within a chunk of it. Per chunk of border, both ways across.
+static const float CrackRayTop = (TerrainMaxChunkY + 1) * ChunkSize + 8.f;
+static const float CrackRayBottom = TerrainMinChunkY * ChunkSize - 24.f;
+static const int32 CrackRaysAlongBorder = 8;
+static const int32 CrackRaysAcrossBorder = 16;
+
+static void MakeChunk(int32 X, int32 Y, int32 Z, FMeshVolume& Volume, std::vector<FBlockId>& Blocks, FVoxelChunk& OutChunk)
+{
+	if(Y < TerrainMinChunkY)
+	{
+		OutChunk.Fill(BenchmarkStone);
+		return;
+	}
+
+	// Ore specks would put a brick in every underground cell, they're stone from this far away.
+	GenerateBenchmarkTerrain(Volume, X, Y, Z, TerrainSeed, false);
+	for(int32 LocalY = 0; LocalY < ChunkSize; LocalY++)
+	for(int32 LocalZ = 0; LocalZ < ChunkSize; LocalZ++)
+	for(int32 LocalX = 0; LocalX < ChunkSize; LocalX++)
+	{
+		const FBlockId Block = Volume.Get(LocalX, LocalY, LocalZ);
+		Blocks[FVoxelChunk::ToIndex(LocalX, LocalY, LocalZ)] = Block == BenchmarkOre ? BenchmarkStone : Block;
+	}
+	OutChunk.SetFromDense(Blocks.data());
+}
+
+static void ReportTerrain(const char* Label, const FLodTerrain& Terrain, double Seconds)
+{
+	const FLodTerrainStats Stats = Terrain.GetStats();
+	uint64 NumTriangles = 0;
+	uint32 NumNodes = 0;
+	for(int32 Lod = 0; Lod < 4; Lod++)
+	{
+		NumTriangles += Stats.NumTriangles[Lod];
+		NumNodes += Stats.NumNodes[Lod];
+	}
+
+	BENCHMARK_REPORT("%s: %u nodes, %llu triangles, meshed in %.2f ms",
+		Label,
+		NumNodes,
+		(unsigned long long)NumTriangles,
+		Seconds * 1000.0
+	);
+	for(int32 Lod = 0; Lod < 4; Lod++)
+	{
+		if(Stats.NumNodes[Lod] > 0)
+		{
+			BENCHMARK_REPORT("  LOD %d (%dx): %5u nodes %9llu triangles %7.0f triangles/node",
+				Lod,
+				1 << Lod,
+				Stats.NumNodes[Lod],
+				(unsigned long long)Stats.NumTriangles[Lod],
+				(double)Stats.NumTriangles[Lod] / Stats.NumNodes[Lod]
+			);
+		}
+	}
+}
+
+// A node mesh quad in world voxel units, flat along one axis.
+struct FWorldQuad
+{
+	float 	Min[3];
+	float 	Max[3];
+};
+
+struct FCrackCheck
+{
+	uint32 	NumBorders 	= 0; 	// Chunk long stretches of LOD border.
+	uint64 	NumRays 	= 0; 	// That the brick map says hit the ground.
+	uint64 	NumCracks 	= 0; 	// Of those, ones that went through no node mesh.
+};
+
+static bool SegmentHitsQuads(const float Origin[3], const float Direction[3], float Length, const std::vector<FWorldQuad>& Quads)
+{
+	for(const FWorldQuad& Quad : Quads)
+	{
+		const int32 Axis = Quad.Min[0] == Quad.Max[0] ? 0 : (Quad.Min[1] == Quad.Max[1] ? 1 : 2);
+		if(Direction[Axis] == 0.f)
+		{
+			continue;
+		}
+
+		const float Distance = (Quad.Min[Axis] - Origin[Axis]) / Direction[Axis];
+		if(Distance < 0.f || Distance > Length)
+		{
+			continue;
+		}
+
+		// Edges count as hits, a ray down the seam between two quads isn't a crack.
+		bool bInside = true;
+		for(int32 Other = 0; Other < 3; Other++)
+		{
+			const float Position = Origin[Other] + Direction[Other] * Distance;
+			bInside &= Other == Axis || (Position >= Quad.Min[Other] - 1e-3f && Position <= Quad.Max[Other] + 1e-3f);
+		}
+		if(bInside)
+		{
+			return true;
+		}
+	}
+	return false;
+}
+
+static uint64 PackColumnKey(int32 ChunkX, int32 ChunkZ)
+{
+	return ((uint64)(uint32)ChunkX << 32) | (uint32)ChunkZ;
+}
+
+/*
+	Casts rays across every border between columns at different LODs, from air
+	on one side down into stone on the other at angles that cross the border
+	plane all the way from above the hills to below them. Any such ray has to
+	pass through the surface, so one that the brick map says hits the ground
+	but that misses every node mesh slipped through a crack. Meshes override
+	the terrain's own for some nodes, to check the check.
+*/
+static FCrackCheck CheckLodBorders(const FLodTerrain& Terrain, const std::unordered_map<const FLodNode*, FChunkMesh>& Meshes)
+{
+	// Nodes standing on every chunk column.
+	struct FColumn
+	{
+		int32 							Lod;
+		std::vector<const FLodNode*> 	Nodes;
+	};
+	std::unordered_map<uint64, FColumn> Columns;
+	for(const FLodNode* Node : Terrain.GetVisibleNodes())
+	{
+		const int32 Size = 1 << Node->Lod;
+		for(int32 Z = Node->Z * Size; Z < (Node->Z + 1) * Size; Z++)
+		for(int32 X = Node->X * Size; X < (Node->X + 1) * Size; X++)
+		{
+			FColumn& Column = Columns[PackColumnKey(X, Z)];
+			Column.Lod = Node->Lod;
+			Column.Nodes.push_back(Node);
+		}
+	}
+
+	FCrackCheck Result;
+	std::vector<FWorldQuad> Quads;
+	for(const auto& Pair : Columns)
+	{
+		const int32 ChunkX = (int32)(Pair.first >> 32);
+		const int32 ChunkZ = (int32)(uint32)Pair.first;
+
+		// Each border once, from the column on its negative side. Axis is the one crossing it.
+		for(int32 Axis = 0; Axis < 3; Axis += 2)
+		{
+			const auto Neighbour = Columns.find(PackColumnKey(ChunkX + (Axis == 0), ChunkZ + (Axis == 2)));
+			if(Neighbour == Columns.end() || Neighbour->second.Lod == Pair.second.Lod)
+			{
+				continue;
+			}
+
+			const int32 AlongAxis = 2 - Axis;
+			const float Border = (float)(((Axis == 0 ? ChunkX : ChunkZ) + 1) * ChunkSize);
+			const float AlongMin = (float)((Axis == 0 ? ChunkZ : ChunkX) * ChunkSize);
+
+			// Quads of both columns the rays could reach.
+			Quads.clear();
+			const FColumn* BorderColumns[2] = { &Pair.second, &Neighbour->second };
+			for(const FColumn* Column : BorderColumns)
+			for(const FLodNode* Node : Column->Nodes)
+			{
+				const auto Override = Meshes.find(Node);
+				const FChunkMesh& Mesh = Override != Meshes.end() ? Override->second : Node->Mesh;
+				int32 Origin[3];
+				Node->GetOrigin(Origin);
+
+				for(uint32 Quad = 0; Quad < Mesh.GetNumQuads(); Quad++)
+				{
+					FWorldQuad WorldQuad;
+					for(int32 Index = 0; Index < 3; Index++)
+					{
+						WorldQuad.Min[Index] = FLT_MAX;
+						WorldQuad.Max[Index] = -FLT_MAX;
+					}
+					for(int32 Corner = 0; Corner < 4; Corner++)
+					{
+						const uint32 Packed = Mesh.Vertices[Quad * 4 + Corner].PositionFaceAO;
+						for(int32 Index = 0; Index < 3; Index++)
+						{
+							const float Position = (float)(Origin[Index] + (int32)((Packed >> (VertexPositionBits * Index)) & MaxVertexPosition));
+							WorldQuad.Min[Index] = std::min(WorldQuad.Min[Index], Position);
+							WorldQuad.Max[Index] = std::max(WorldQuad.Max[Index], Position);
+						}
+					}
+
+					if(WorldQuad.Max[Axis] >= Border - ChunkSize && WorldQuad.Min[Axis] <= Border + ChunkSize
+						&& WorldQuad.Max[AlongAxis] >= AlongMin && WorldQuad.Min[AlongAxis] <= AlongMin + ChunkSize)
+					{
+						Quads.push_back(WorldQuad);
+					}
+				}
+			}
+
+			// Off voxel boundaries so rays don't run exactly along quad edges.
+			Result.NumBorders++;
+			for(int32 Along = 0; Along < CrackRaysAlongBorder; Along++)
+			for(int32 Across = 0; Across < CrackRaysAcrossBorder; Across++)
+			for(float Side = -1.f; Side <= 1.f; Side += 2.f)
+			{
+				const float StartOffset = 1.25f + Across * (ChunkSize - 2.5f) / (CrackRaysAcrossBorder - 1);
+
+				float Start[3];
+				float End[3];
+				Start[AlongAxis] = End[AlongAxis] = AlongMin + (Along + 0.5f) * ChunkSize / CrackRaysAlongBorder + 0.37f;
+				Start[Axis] = Border + Side * StartOffset;
+				End[Axis] = Border - Side * (ChunkSize - StartOffset);
+				Start[1] = CrackRayTop;
+				End[1] = CrackRayBottom;
+
+				float Direction[3] = { End[0] - Start[0], End[1] - Start[1], End[2] - Start[2] };
+				const float Length = std::sqrt(Direction[0] * Direction[0] + Direction[1] * Direction[1] + Direction[2] * Direction[2]);
+				for(float& Component : Direction)
+				{
+					Component /= Length;
+				}
+
+				FBrickMapHit Hit;
+				if(!Terrain.GetBrickMap().Raycast(Start, Direction, Length, Hit))
+				{
+					continue;
+				}
+
+				Result.NumRays++;
+				Result.NumCracks += SegmentHitsQuads(Start, Direction, Length, Quads) ? 0 : 1;
+			}
+		}
+	}
+	return Result;
+}
+
+static uint64 CountTriangles(const FLodTerrain& Terrain)
+{
+	const FLodTerrainStats Stats = Terrain.GetStats();
+	return Stats.NumTriangles[0] + Stats.NumTriangles[1] + Stats.NumTriangles[2] + Stats.NumTriangles[3];
+}
+
+// Fills the terrain's brick map with every column within Radius chunks of the origin, a batch at a time.
+static double FillTerrain(FLodTerrain& Terrain, int32 Radius)
+{
+	FMeshVolume Volume;
+	std::vector<FBlockId> Blocks(ChunkVolume);
+	FVoxelChunk Chunk;
+	double Seconds = 0.0;
+	uint32 NumColumns = 0;
+	uint32 NumChunks = 0;
+
+	for(int32 Z = -Radius; Z <= Radius; Z++)
+	for(int32 X = -Radius; X <= Radius; X++)
+	{
+		if(X * X + Z * Z > Radius * Radius)
+		{
+			continue;
+		}
+
+		for(int32 Y = 0; Y <= TerrainMaxChunkY; Y++)
+		{
+			MakeChunk(X, Y, Z, Volume, Blocks, Chunk);
+			FBenchmarkTimer Timer;
+			Terrain.QueueChunk(X, Y, Z, Chunk);
+			Seconds += Timer.GetElapsedSeconds();
+			NumChunks++;
+		}
+
+		if(++NumColumns % ColumnsPerBatch == 0)
+		{
+			FBenchmarkTimer Timer;
+			Terrain.Flush();
+			Seconds += Timer.GetElapsedSeconds();
+		}
+	}
+
+	FBenchmarkTimer Timer;
+	Terrain.Flush();
+	Seconds += Timer.GetElapsedSeconds();
+
+	const FBrickMap& BrickMap = Terrain.GetBrickMap();
+	BENCHMARK_REPORT("brick map: %u columns, %u chunks, %u bricks (%.1f MB) built in %.2f ms",
+		NumColumns,
+		NumChunks,
+		BrickMap.GetNumBricks(),
+		BrickMap.GetUsedBytes() / (1024.0 * 1024.0),
+		Seconds * 1000.0
+	);
+	return Seconds;
+}
+
+REGISTER_BENCHMARK(LodMeshing_ViewDistance)
+{
+	FJobSystem JobSystem;
+	JobSystem.Initialize();
+
+	const double ViewerX = 0.5 * ChunkSize;
+	const double ViewerZ = 0.5 * ChunkSize;
+
+	uint64 FullDetailTriangles = 0;
+	{
+		FLodSettings Settings;
+		Settings.FullDetailDistance = FullDetailRadius + 1;
+		Settings.ViewDistance = FullDetailRadius;
+		Settings.MaxLod = 0;
+		Settings.WidthChunksLog2 = 6;
+		FLodTerrain Terrain(&JobSystem, Settings);
+		FillTerrain(Terrain, FullDetailRadius);
+
+		FBenchmarkTimer Timer;
+		Terrain.Update(ViewerX, ViewerZ);
+		Terrain.Flush();
+		ReportTerrain("full detail, 16 chunk radius", Terrain, Timer.GetElapsedSeconds());
+		FullDetailTriangles = CountTriangles(Terrain);
+	}
+
+	{
+		// The 2^8 chunk wide grid fits the whole 64 chunk radius without wrapping onto itself.
+		FLodSettings Settings;
+		Settings.FullDetailDistance = 6;
+		Settings.ViewDistance = LodRadius;
+		Settings.MaxLod = 3;
+		Settings.WidthChunksLog2 = 8;
+		Settings.BrickMapBudget = 768ull << 20;
+		FLodTerrain Terrain(&JobSystem, Settings);
+		FillTerrain(Terrain, LodRadius + 8);
+
+		FBenchmarkTimer Timer;
+		Terrain.Update(ViewerX, ViewerZ);
+		Terrain.Flush();
+		ReportTerrain("LOD, 64 chunk radius", Terrain, Timer.GetElapsedSeconds());
+
+		const uint64 LodTriangles = CountTriangles(Terrain);
+		BENCHMARK_REPORT("LOD at 4x the radius costs %.2fx the triangles of full detail", (double)LodTriangles / FullDetailTriangles);
+
+		// Walls off on every border node should open cracks, or the check isn't seeing anything.
+		const FCrackCheck Walled = CheckLodBorders(Terrain, std::unordered_map<const FLodNode*, FChunkMesh>());
+		std::unordered_map<const FLodNode*, FChunkMesh> UnwalledMeshes;
+		FLodMesher Mesher;
+		FMeshVolume Volume;
+		for(const FLodNode* Node : Terrain.GetVisibleNodes())
+		{
+			if(Node->WalledSides != 0)
+			{
+				const int32 Size = Volume.Size;
+				Terrain.GetBrickMap().SampleLod(Node->X * Size - 1, Node->Y * Size - 1, Node->Z * Size - 1, Size + 2, Size + 2, Size + 2, Node->Lod, Volume.Blocks.data());
+				Mesher.Mesh(Volume, Node->Lod, 0, UnwalledMeshes[Node]);
+			}
+		}
+		const FCrackCheck Unwalled = CheckLodBorders(Terrain, UnwalledMeshes);
+		BENCHMARK_REPORT("LOD borders: %u chunk lengths, %llu rays into the ground across them, %llu slipped through a crack (%llu without walls)",
+			Walled.NumBorders,
+			(unsigned long long)Walled.NumRays,
+			(unsigned long long)Walled.NumCracks,
+			(unsigned long long)Unwalled.NumCracks
+		);
+		if(Walled.NumCracks > 0)
+		{
+			BENCHMARK_REPORT("CRACKS: %llu rays went through a LOD border", (unsigned long long)Walled.NumCracks);
+		}
+
+		// One chunk over, the selection changes along every LOD border.
+		const uint64 MeshedBefore = Terrain.GetStats().NumMeshed;
+		FBenchmarkTimer UpdateTimer;
+		Terrain.Update(ViewerX + ChunkSize, ViewerZ);
+		const double UpdateSeconds = UpdateTimer.GetElapsedSeconds();
+		Terrain.Flush();
+		const double MoveSeconds = UpdateTimer.GetElapsedSeconds();
+		BENCHMARK_REPORT("viewer moved a chunk: Update %.3f ms on the main thread, %llu nodes remeshed in %.2f ms",
+			UpdateSeconds * 1000.0,
+			(unsigned long long)(Terrain.GetStats().NumMeshed - MeshedBefore),
+			MoveSeconds * 1000.0
+		);
+	}
+
+	JobSystem.Shutdown();
+}
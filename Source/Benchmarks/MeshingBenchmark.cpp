@@ -0,0 +1,181 @@
+// Copyright Snaps 2022, All Rights Reserved.
+
+#include "Benchmark.h"
+#include "BenchmarkTerrain.h"
+#include "BinaryMesher.h"
+#include "GreedyMesher.h"
+#include "JobSystem.h"
+
+/*
+	Meshes a corpus of generated terrain chunks and reports throughput and
+	output size. Runs without a window or GPU so it can run on CI machines.
+	Meshers bake ambient occlusion by default, the NoAO runs turn it off to
+	show what it costs in time and in quads it stops from merging.
+*/
+
+static const int32 CorpusSizeXZ = 8;
+static const int32 CorpusSizeY = 4;
+static const uint32 CorpusSeed = 1337;
+
+static std::vector<FMeshVolume> BuildCorpus(bool bCaves = true)
+{
+	std::vector<FMeshVolume> Corpus;
+	for(int32 Y = 0; Y < CorpusSizeY; Y++)
+	for(int32 Z = 0; Z < CorpusSizeXZ; Z++)
+	for(int32 X = 0; X < CorpusSizeXZ; X++)
+	{
+		FMeshVolume Volume;
+		GenerateBenchmarkTerrain(Volume, X, Y, Z, CorpusSeed, bCaves);
+		Corpus.push_back(std::move(Volume));
+	}
+	return Corpus;
+}
+
+struct FMeshingResult
+{
+	double 	Seconds 	= 0.0;
+	uint64 	Vertices 	= 0;
+};
+
+// Float3 position, normal and float2 UV with 32 bit indices, what a mesh would cost without FMeshVertex.
+static const double UnpackedBytesPerQuad = 4 * 32 + 6 * sizeof(uint32);
+
+template<typename MeshFunctionType>
+static FMeshingResult MeshCorpus(const std::vector<FMeshVolume>& Corpus, int32 NumPasses, const MeshFunctionType& MeshFunction)
+{
+	FMeshingResult Result;
+	FChunkMesh Mesh;
+
+	FBenchmarkTimer Timer;
+	for(int32 Pass = 0; Pass < NumPasses; Pass++)
+	{
+		for(const FMeshVolume& Volume : Corpus)
+		{
+			MeshFunction(Volume, Mesh);
+			Result.Vertices += Mesh.Vertices.size();
+		}
+	}
+	Result.Seconds = Timer.GetElapsedSeconds();
+	return Result;
+}
+
+static void ReportMeshing(const char* Label, const FMeshingResult& Result, uint64 NumChunks)
+{
+	// What the chunk costs on the GPU once uploaded, only vertices as indices come from the shared quad index buffer.
+	const double BytesPerChunk = (double)(Result.Vertices * sizeof(FMeshVertex)) / NumChunks;
+
+	BENCHMARK_REPORT("%-12s %9.0f chunks/s  %8.1f us/chunk  %8.0f vertices/chunk  %8.0f triangles/chunk  %6.1f KB/chunk",
+		Label,
+		NumChunks / Result.Seconds,
+		Result.Seconds * 1e6 / NumChunks,
+		(double)Result.Vertices / NumChunks,
+		(double)Result.Vertices / 2.0 / NumChunks,
+		BytesPerChunk / 1024.0
+	);
+}
+
+static void RunMeshers(const char* CorpusName, bool bCaves)
+{
+	const std::vector<FMeshVolume> Corpus = BuildCorpus(bCaves);
+	const int32 NumPasses = 4;
+	const uint64 NumChunks = Corpus.size() * NumPasses;
+	BENCHMARK_REPORT("%s corpus: %zu chunks of %d^3, %d passes", CorpusName, Corpus.size(), ChunkSize, NumPasses);
+
+	FGreedyMesher Mesher;
+	const FMeshingResult Naive = MeshCorpus(Corpus, NumPasses, [&Mesher](const FMeshVolume& Volume, FChunkMesh& Mesh)
+	{
+		Mesher.MeshNaive(Volume, Mesh);
+	});
+
+	const FMeshingResult Greedy = MeshCorpus(Corpus, NumPasses, [&Mesher](const FMeshVolume& Volume, FChunkMesh& Mesh)
+	{
+		Mesher.Mesh(Volume, Mesh);
+	});
+
+	FBinaryMesher BinaryMesher;
+	const FMeshingResult Binary = MeshCorpus(Corpus, NumPasses, [&BinaryMesher](const FMeshVolume& Volume, FChunkMesh& Mesh)
+	{
+		BinaryMesher.Mesh(Volume, Mesh);
+	});
+
+	// Quads only, leaves out vertex expansion so the culling and merging cost is visible on its own.
+	std::vector<FMeshQuad> Quads;
+	const FMeshingResult BinaryQuads = MeshCorpus(Corpus, NumPasses, [&BinaryMesher, &Quads](const FMeshVolume& Volume, FChunkMesh& Mesh)
+	{
+		Quads.clear();
+		BinaryMesher.MeshQuads(Volume, Quads);
+		Mesh.Vertices.resize(Quads.size() * 4);
+	});
+
+	Mesher.SetAmbientOcclusion(false);
+	const FMeshingResult GreedyNoAO = MeshCorpus(Corpus, NumPasses, [&Mesher](const FMeshVolume& Volume, FChunkMesh& Mesh)
+	{
+		Mesher.Mesh(Volume, Mesh);
+	});
+
+	BinaryMesher.SetAmbientOcclusion(false);
+	const FMeshingResult BinaryNoAO = MeshCorpus(Corpus, NumPasses, [&BinaryMesher](const FMeshVolume& Volume, FChunkMesh& Mesh)
+	{
+		BinaryMesher.Mesh(Volume, Mesh);
+	});
+
+	ReportMeshing("Naive:", Naive, NumChunks);
+	ReportMeshing("Greedy:", Greedy, NumChunks);
+	ReportMeshing("GreedyNoAO:", GreedyNoAO, NumChunks);
+	ReportMeshing("Binary:", Binary, NumChunks);
+	ReportMeshing("BinaryNoAO:", BinaryNoAO, NumChunks);
+	ReportMeshing("BinQuads:", BinaryQuads, NumChunks);
+	BENCHMARK_REPORT("Greedy emits %.1fx fewer vertices than naive, %.1fx without AO",
+		(double)Naive.Vertices / Greedy.Vertices,
+		(double)Naive.Vertices / GreedyNoAO.Vertices
+	);
+	BENCHMARK_REPORT("Binary meshes take %.1f KB/chunk unpacked, %.1fx what they take packed",
+		Binary.Vertices / 4 * UnpackedBytesPerQuad / NumChunks / 1024.0,
+		Binary.Vertices / 4 * UnpackedBytesPerQuad / (Binary.Vertices * sizeof(FMeshVertex))
+	);
+	BENCHMARK_REPORT("AO costs %+.0f%% time greedy, %+.0f%% binary, and %+.0f%% vertices",
+		(Greedy.Seconds / GreedyNoAO.Seconds - 1.0) * 100.0,
+		(Binary.Seconds / BinaryNoAO.Seconds - 1.0) * 100.0,
+		((double)Binary.Vertices / BinaryNoAO.Vertices - 1.0) * 100.0
+	);
+}
+
+REGISTER_BENCHMARK(Meshing_Corpus)
+{
+	BENCHMARK_REPORT("Binary mesher SIMD path: %s", FBinaryMesher::GetSimdPath());
+	RunMeshers("Hills", false);
+	RunMeshers("Hills + caves", true);
+}
+
+REGISTER_BENCHMARK(Meshing_Parallel)
+{
+	const std::vector<FMeshVolume> Corpus = BuildCorpus();
+	const int32 NumPasses = 4;
+
+	FJobSystem JobSystem;
+	JobSystem.Initialize();
+
+	// Meshers keep scratch state, so give every thread its own.
+	std::vector<FBinaryMesher> Meshers(JobSystem.GetNumThreads());
+	std::vector<FChunkMesh> Meshes(JobSystem.GetNumThreads());
+	std::atomic<uint64> NumVertices { 0 };
+
+	FBenchmarkTimer Timer;
+	for(int32 Pass = 0; Pass < NumPasses; Pass++)
+	{
+		JobSystem.ParallelFor((uint32)Corpus.size(), 1, [&](uint32 Index)
+		{
+			const int32 ThreadIndex = JobSystem.GetCurrentThreadIndex();
+			Meshers[ThreadIndex].Mesh(Corpus[Index], Meshes[ThreadIndex]);
+			NumVertices.fetch_add(Meshes[ThreadIndex].Vertices.size(), std::memory_order_relaxed);
+		});
+	}
+
+	FMeshingResult Result;
+	Result.Seconds = Timer.GetElapsedSeconds();
+	Result.Vertices = NumVertices.load();
+
+	BENCHMARK_REPORT("Threads: %u", JobSystem.GetNumThreads());
+	ReportMeshing("Binary:", Result, Corpus.size() * NumPasses);
+	JobSystem.Shutdown();
+}
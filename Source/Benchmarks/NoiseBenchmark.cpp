@@ -0,0 +1,136 @@
+// Copyright Snaps 2022, All Rights Reserved.
+
+#include "Benchmark.h"
+#include "NoiseGenerator.h"
+#include <cstring>
+
+/*
+	Noise throughput per instruction set, over the grids terrain generation
+	asks for: 32^3 chunk volumes for density and 32x32 column grids for
+	heightmaps. Every ISA's output is also checked bit for bit against the
+	scalar kernel, a mismatch would mean worlds differ between machines.
+*/
+
+static const int32 GridSize = 32;
+static const int32 NumChunks3D = 16;
+static const int32 NumChunks2D = 512;
+
+struct FNoiseCase
+{
+	const char* 	Label;
+	FNoiseSettings 	Settings;
+	bool 			b3D;
+};
+
+static std::vector<FNoiseCase> BuildNoiseCases()
+{
+	std::vector<FNoiseCase> Cases;
+
+	FNoiseSettings Settings;
+	Settings.Frequency = 0.02f;
+
+	Settings.Type = ENoiseType::Perlin;
+	Cases.push_back({ "Perlin 3D", Settings, true });
+
+	Settings.Type = ENoiseType::OpenSimplex2;
+	Cases.push_back({ "OpenSimplex2 3D", Settings, true });
+
+	Settings.Type = ENoiseType::Cellular;
+	Cases.push_back({ "Cellular 3D", Settings, true });
+
+	Settings.Type = ENoiseType::OpenSimplex2;
+	Settings.Octaves = 4;
+	Cases.push_back({ "OpenSimplex2 3D fBm x4", Settings, true });
+
+	Settings.Octaves = 1;
+	Settings.WarpAmplitude = 20.0f;
+	Cases.push_back({ "OpenSimplex2 3D warped", Settings, true });
+
+	Settings.WarpAmplitude = 0.0f;
+	Cases.push_back({ "OpenSimplex2 2D", Settings, false });
+
+	Settings.Octaves = 5;
+	Cases.push_back({ "OpenSimplex2 2D fBm x5", Settings, false });
+
+	Settings.Type = ENoiseType::Perlin;
+	Settings.Octaves = 1;
+	Cases.push_back({ "Perlin 2D", Settings, false });
+
+	return Cases;
+}
+
+// Generates a row of chunks, returns the seconds it took. Out holds every sample for comparing ISAs.
+static double GenerateChunks(const FNoiseGenerator& Generator, bool b3D, std::vector<float>& Out)
+{
+	const int32 NumChunks = b3D ? NumChunks3D : NumChunks2D;
+	const int32 ChunkSamples = b3D ? GridSize * GridSize * GridSize : GridSize * GridSize;
+	Out.resize((size_t)NumChunks * ChunkSamples);
+
+	FBenchmarkTimer Timer;
+	for(int32 Chunk = 0; Chunk < NumChunks; Chunk++)
+	{
+		float* ChunkOut = Out.data() + (size_t)Chunk * ChunkSamples;
+		const float ChunkX = (float)(Chunk * GridSize);
+		if(b3D)
+		{
+			Generator.GenerateGrid3D(ChunkX, -64.0f, 96.0f, 1.0f, GridSize, GridSize, GridSize, ChunkOut);
+		}
+		else
+		{
+			Generator.GenerateGrid2D(ChunkX, 96.0f, 1.0f, GridSize, GridSize, ChunkOut);
+		}
+	}
+	return Timer.GetElapsedSeconds();
+}
+
+REGISTER_BENCHMARK(Noise_Throughput)
+{
+	BENCHMARK_REPORT("Best ISA: %s", FNoiseGenerator::GetIsaName(FNoiseGenerator::GetBestIsa()));
+
+	std::vector<float> ScalarOut;
+	std::vector<float> IsaOut;
+
+	for(const FNoiseCase& Case : BuildNoiseCases())
+	{
+		BENCHMARK_REPORT("%s:", Case.Label);
+
+		double ScalarSeconds = 0.0;
+		for(uint32 IsaIndex = 0; IsaIndex < (uint32)ENoiseIsa::Count; IsaIndex++)
+		{
+			const ENoiseIsa Isa = (ENoiseIsa)IsaIndex;
+			if(!FNoiseGenerator::IsIsaSupported(Isa))
+			{
+				BENCHMARK_REPORT("  %-8s unsupported", FNoiseGenerator::GetIsaName(Isa));
+				continue;
+			}
+
+			const FNoiseGenerator Generator(Case.Settings, Isa);
+			std::vector<float>& Out = Isa == ENoiseIsa::Scalar ? ScalarOut : IsaOut;
+
+			// Best of a few runs, the first also warms the caches.
+			double Seconds = 0.0;
+			for(int32 Run = 0; Run < 3; Run++)
+			{
+				const double RunSeconds = GenerateChunks(Generator, Case.b3D, Out);
+				Seconds = Run == 0 ? RunSeconds : std::min(Seconds, RunSeconds);
+			}
+
+			if(Isa == ENoiseIsa::Scalar)
+			{
+				ScalarSeconds = Seconds;
+			}
+
+			BENCHMARK_REPORT("  %-8s %8.2f ms  %6.2f ns/sample  %5.2fx scalar",
+				FNoiseGenerator::GetIsaName(Isa),
+				Seconds * 1000.0,
+				Seconds * 1e9 / Out.size(),
+				ScalarSeconds / Seconds
+			);
+
+			if(Isa != ENoiseIsa::Scalar && std::memcmp(Out.data(), ScalarOut.data(), Out.size() * sizeof(float)) != 0)
+			{
+				BENCHMARK_REPORT("  MISMATCH: %s output differs from scalar", FNoiseGenerator::GetIsaName(Isa));
+			}
+		}
+	}
+}
@@ -0,0 +1,111 @@
+// Copyright Snaps 2022, All Rights Reserved.
+
+#include "Benchmark.h"
+#include "CoreMacros.h"
+#include "JobSystem.h"
+#include "Profiler.h"
+
+/*
+	Cost of profiling zones, disabled and enabled, and of draining the rings.
+	Zones are nested two deep so the numbers include the nesting the engine does.
+*/
+
+static const uint32 NumZones = 4000000;
+
+// Keeps the optimizer from folding the loop bodies away.
+static volatile uint32 GZoneSink = 0;
+
+static double TimeNestedZones(uint32 Count)
+{
+	FBenchmarkTimer Timer;
+	for(uint32 Index = 0; Index < Count / 2; Index++)
+	{
+		PROFILE_SCOPE("Outer");
+		{
+			PROFILE_SCOPE("Inner");
+			GZoneSink = Index;
+		}
+	}
+	return Timer.GetElapsedSeconds();
+}
+
+REGISTER_BENCHMARK(Profiler_ZoneCost)
+{
+	FProfiler::Initialize();
+
+	// Baseline loop with no zones at all, subtracted from both runs.
+	FBenchmarkTimer BaselineTimer;
+	for(uint32 Index = 0; Index < NumZones / 2; Index++)
+	{
+		GZoneSink = Index;
+	}
+	const double BaselineSeconds = BaselineTimer.GetElapsedSeconds();
+
+	FProfiler::SetEnabled(false);
+	const double DisabledSeconds = TimeNestedZones(NumZones) - BaselineSeconds;
+
+	FProfiler::SetEnabled(true);
+	const double EnabledSeconds = TimeNestedZones(NumZones) - BaselineSeconds;
+
+	// Every enabled zone reads the timestamp twice, which can be slow under virtualization.
+	FBenchmarkTimer TimestampTimer;
+	uint64 TimestampSum = 0;
+	for(uint32 Index = 0; Index < NumZones; Index++)
+	{
+		TimestampSum += FProfiler::GetTimestamp();
+	}
+	GZoneSink = (uint32)TimestampSum;
+	const double TimestampSeconds = TimestampTimer.GetElapsedSeconds();
+
+	BENCHMARK_REPORT("Disabled zone: %6.2f ns", DisabledSeconds * 1e9 / NumZones);
+	BENCHMARK_REPORT("Enabled zone:  %6.2f ns, %.2f ns of that reading two timestamps",
+		EnabledSeconds * 1e9 / NumZones,
+		TimestampSeconds * 2e9 / NumZones
+	);
+
+	// Draining what's left in the ring into stats, as EndFrame does once per frame.
+	FBenchmarkTimer DrainTimer;
+	FProfiler::EndFrame();
+	BENCHMARK_REPORT("EndFrame with a full ring: %.2f ms", DrainTimer.GetElapsedSeconds() * 1000.0);
+
+	FProfiler::Shutdown();
+}
+
+// Every worker recording zones at once, then the whole capture written out as a trace.
+REGISTER_BENCHMARK(Profiler_ParallelCapture)
+{
+	FProfiler::Initialize();
+
+	FJobSystem JobSystem;
+	JobSystem.Initialize();
+
+	static const uint32 NumJobs = 4096;
+	static const uint32 ZonesPerJob = 64;
+
+	FBenchmarkTimer Timer;
+	JobSystem.ParallelFor(NumJobs, 16, [](uint32 Index)
+	{
+		for(uint32 Zone = 0; Zone < ZonesPerJob; Zone++)
+		{
+			PROFILE_SCOPE("ParallelZone");
+			GZoneSink = Index;
+		}
+	});
+	const double Seconds = Timer.GetElapsedSeconds();
+
+	FProfiler::EndFrame();
+
+	BENCHMARK_REPORT("Threads: %u", JobSystem.GetNumThreads());
+	BENCHMARK_REPORT("%u zones in %.2f ms, %.1f ns per zone per thread",
+		NumJobs * ZonesPerJob,
+		Seconds * 1000.0,
+		Seconds * 1e9 * JobSystem.GetNumThreads() / (NumJobs * ZonesPerJob)
+	);
+
+	FBenchmarkTimer WriteTimer;
+	const bool bWritten = FProfiler::WriteChromeTrace("VoxelBenchmarks.trace.json");
+	BENCHMARK_REPORT("Trace written: %s in %.1f ms", bWritten ? "yes" : "no", WriteTimer.GetElapsedSeconds() * 1000.0);
+
+	JobSystem.Shutdown();
+	FProfiler::Shutdown();
+}
@@ -0,0 +1,218 @@
+// Copyright Snaps 2022, All Rights Reserved.
+
+#include "Benchmark.h"
+#include "JobSystem.h"
+#include "RegionFile.h"
+#include "VoxelChunk.h"
+#include "WorldGenerator.h"
+#include <cstdio>
+
+/*
+	Saves a generated region to disk and loads it back, reporting chunks per
+	second for saves, loads from a warm page cache and loads after the file has
+	been evicted from it. Cold numbers depend on the file system honouring the
+	eviction, on tmpfs or a RAM disk they match the warm ones. Some chunks are
+	then edited and resaved to leave free sectors behind, which compaction has
+	to drop without losing any chunk.
+*/
+
+static const char* RegionPath = "RegionFileBenchmark.region";
+static const int32 WarmPasses = 5;
+
+struct FStoredChunk
+{
+	int32 	X, Y, Z; 	// Local to the region.
+	uint64 	Hash; 		// Of the chunk's dense blocks.
+};
+
+static uint64 HashChunk(const FVoxelChunk& Chunk, std::vector<FBlockId>& Blocks)
+{
+	Chunk.CopyToDense(Blocks.data());
+	uint64 Hash = 0xCBF29CE484222325ull;
+	for(FBlockId Block : Blocks)
+	{
+		Hash = (Hash ^ Block) * 0x100000001B3ull;
+	}
+	return Hash;
+}
+
+// Loads every stored chunk, returns the time taken and counts chunks that fail or come back different.
+static double LoadAll(FRegionFile& Region, const std::vector<FStoredChunk>& Stored, uint32& OutNumBad)
+{
+	std::vector<FBlockId> Blocks(ChunkVolume);
+	FVoxelChunk Chunk;
+	double Seconds = 0.0;
+	OutNumBad = 0;
+
+	for(const FStoredChunk& Entry : Stored)
+	{
+		FBenchmarkTimer Timer;
+		const bool bLoaded = Region.LoadChunk(Entry.X, Entry.Y, Entry.Z, Chunk);
+		Seconds += Timer.GetElapsedSeconds();
+
+		if(!bLoaded || HashChunk(Chunk, Blocks) != Entry.Hash)
+		{
+			OutNumBad++;
+		}
+	}
+	return Seconds;
+}
+
+REGISTER_BENCHMARK(RegionFile_SaveLoad)
+{
+	std::remove(RegionPath);
+
+	FJobSystem JobSystem;
+	JobSystem.Initialize(0);
+
+	std::vector<FStoredChunk> Stored;
+	std::vector<FBlockId> Blocks(ChunkVolume);
+	uint64 RawBytes = 0;
+	double SaveSeconds = 0.0;
+	{
+		// Centered on region 0 so the whole view fits in one file.
+		FWorldGenerator Generator(&JobSystem, 1337, 8);
+		const double Center = FRegionFile::RegionSize / 2 * ChunkSize;
+		Generator.Update(Center, Center);
+		Generator.Flush();
+
+		FRegionFile Region;
+		if(!Region.Open(RegionPath, true))
+		{
+			BENCHMARK_REPORT("MISMATCH: couldn't create %s", RegionPath);
+			JobSystem.Shutdown();
+			return;
+		}
+
+		Generator.GetChunkMap().ForEach([&](int32 X, int32 Y, int32 Z, FVoxelChunk* Chunk)
+		{
+			int32 RegionCoords[3];
+			int32 Local[3];
+			FRegionFile::ToRegionCoords(X, Y, Z, RegionCoords, Local);
+			if(RegionCoords[0] != 0 || RegionCoords[1] != 0 || RegionCoords[2] != 0)
+			{
+				return;
+			}
+
+			FBenchmarkTimer Timer;
+			const bool bSaved = Region.SaveChunk(Local[0], Local[1], Local[2], *Chunk);
+			SaveSeconds += Timer.GetElapsedSeconds();
+
+			if(bSaved)
+			{
+				Stored.push_back({ Local[0], Local[1], Local[2], HashChunk(*Chunk, Blocks) });
+				RawBytes += Chunk->GetMemoryUsage();
+			}
+		});
+
+		FBenchmarkTimer Timer;
+		Region.Flush();
+		SaveSeconds += Timer.GetElapsedSeconds();
+
+		BENCHMARK_REPORT("save: %u chunks in %.2f ms (flush included), %.1f chunks/s, %.1f KB in memory -> %.1f KB on disk (%.2fx)",
+			(uint32)Stored.size(),
+			SaveSeconds * 1000.0,
+			Stored.size() / SaveSeconds,
+			RawBytes / 1024.0,
+			Region.GetNumSectors() * (double)FRegionFile::SectorSize / 1024.0,
+			RawBytes / (double)(Region.GetNumSectors() * (uint64)FRegionFile::SectorSize)
+		);
+	}
+	JobSystem.Shutdown();
+
+	uint32 NumBad = 0;
+	{
+		FRegionFile Region;
+		Region.Open(RegionPath, false);
+
+		double Seconds = 0.0;
+		for(int32 Pass = 0; Pass < WarmPasses; Pass++)
+		{
+			uint32 PassBad = 0;
+			Seconds += LoadAll(Region, Stored, PassBad);
+			NumBad += PassBad;
+		}
+
+		BENCHMARK_REPORT("warm load: %.2f us/chunk, %.1f chunks/s",
+			Seconds * 1e6 / (Stored.size() * WarmPasses),
+			Stored.size() * WarmPasses / Seconds
+		);
+	}
+
+	// Mapped pages can't be dropped, the file has to be closed while evicting.
+	{
+		const bool bEvicted = FRegionFile::EvictFromPageCache(RegionPath);
+
+		FBenchmarkTimer Timer;
+		FRegionFile Region;
+		Region.Open(RegionPath, false);
+		const double OpenSeconds = Timer.GetElapsedSeconds();
+
+		uint32 PassBad = 0;
+		const double Seconds = OpenSeconds + LoadAll(Region, Stored, PassBad);
+		NumBad += PassBad;
+
+		BENCHMARK_REPORT("cold load%s: %.2f us/chunk, %.1f chunks/s (open included)",
+			bEvicted ? "" : " (eviction unsupported, still cached)",
+			Seconds * 1e6 / Stored.size(),
+			Stored.size() / Seconds
+		);
+	}
+
+	// Edit every fourth chunk so its record changes size and moves, then compact the holes away.
+	{
+		FRegionFile Region;
+		Region.Open(RegionPath, false);
+
+		FVoxelChunk Chunk;
+		for(size_t Index = 0; Index < Stored.size(); Index += 4)
+		{
+			FStoredChunk& Entry = Stored[Index];
+			Region.LoadChunk(Entry.X, Entry.Y, Entry.Z, Chunk);
+			for(int32 Voxel = 0; Voxel < ChunkVolume; Voxel += 61)
+			{
+				Chunk.Set(Voxel, (FBlockId)(BlockCobblestone + Voxel % 7));
+			}
+			Region.SaveChunk(Entry.X, Entry.Y, Entry.Z, Chunk);
+			Entry.Hash = HashChunk(Chunk, Blocks);
+		}
+
+		BENCHMARK_REPORT("resaved %u chunks: %u of %u sectors free",
+			(uint32)((Stored.size() + 3) / 4),
+			Region.GetNumFreeSectors(),
+			Region.GetNumSectors()
+		);
+		Region.Flush();
+	}
+
+	uint64 BytesBefore = 0;
+	uint64 BytesAfter = 0;
+	FBenchmarkTimer CompactTimer;
+	const bool bCompacted = FRegionFile::Compact(RegionPath, &BytesBefore, &BytesAfter);
+	BENCHMARK_REPORT("compact: %.1f KB -> %.1f KB in %.2f ms",
+		BytesBefore / 1024.0,
+		BytesAfter / 1024.0,
+		CompactTimer.GetElapsedSeconds() * 1000.0
+	);
+
+	{
+		FRegionFile Region;
+		Region.Open(RegionPath, false);
+
+		uint32 PassBad = 0;
+		LoadAll(Region, Stored, PassBad);
+		NumBad += PassBad;
+
+		if(!bCompacted || Region.GetNumFreeSectors() != 0)
+		{
+			BENCHMARK_REPORT("MISMATCH: compaction failed or left free sectors");
+		}
+	}
+
+	if(NumBad > 0)
+	{
+		BENCHMARK_REPORT("MISMATCH: %u chunk loads failed or differ from what was saved", NumBad);
+	}
+
+	std::remove(RegionPath);
+}
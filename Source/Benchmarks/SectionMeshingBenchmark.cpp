@@ -0,0 +1,225 @@
+// Copyright Snaps 2022, All Rights Reserved.
+
+#include "Benchmark.h"
+#include "BenchmarkTerrain.h"
+#include "BinaryMesher.h"
+#include "ChunkMap.h"
+#include "JobSystem.h"
+#include "SectionMeshes.h"
+#include "VoxelChunk.h"
+#include <algorithm>
+#include <cstring>
+#include <memory>
+#include <random>
+
+/*
+	Block edits on the hills terrain, from one editor up to a crowd of them all
+	digging and building at once. Each frame's Update applies the edits and
+	remeshes every section they touched before returning, so its time is the
+	CPU side of the edit to pixel latency and has to fit well inside a frame.
+	Edits past what the workers mesh in a frame wait for the next one, and
+	once a frame's worth is waiting new ones are refused, the crowd shows how
+	many that pushes back on. Remeshing the whole chunks the edits landed in is
+	reported next to it, and every section is checked against a mesh built
+	from scratch afterwards.
+*/
+
+static const uint32 TerrainSeed = 1337;
+static const int32 AreaColumns = 8;
+static const int32 AreaHeightChunks = 3;
+static const int32 NumFrames = 60;
+static const double FrameBudgetMs = 1000.0 / 60.0;
+
+// Edits land around the hills' surface, between chunk Y 1 and 2.
+static const int32 EditMinY = ChunkSize;
+static const int32 EditMaxY = ChunkSize * AreaHeightChunks - 1;
+
+// What a whole chunk remesh costs, gathering the padded volume the same way sections do.
+static void MeshWholeChunk(const FChunkMap& ChunkMap, int32 ChunkX, int32 ChunkY, int32 ChunkZ, FMeshVolume& Volume, FBinaryMesher& Mesher, FChunkMesh& OutMesh)
+{
+	FVoxelChunk* Chunks[27];
+	ChunkMap.GatherNeighbours(ChunkX, ChunkY, ChunkZ, Chunks);
+
+	const auto Split = [](int32 Voxel, int32& OutLocal) -> int32
+	{
+		const int32 Delta = Voxel < 0 ? -1 : (Voxel >= ChunkSize ? 1 : 0);
+		OutLocal = Voxel - Delta * ChunkSize;
+		return Delta;
+	};
+
+	for(int32 Y = -1; Y <= ChunkSize; Y++)
+	for(int32 Z = -1; Z <= ChunkSize; Z++)
+	{
+		int32 LocalY, LocalZ;
+		const int32 DeltaY = Split(Y, LocalY);
+		const int32 DeltaZ = Split(Z, LocalZ);
+		const FVoxelChunk* Before = Chunks[FChunkMap::NeighbourIndex(-1, DeltaY, DeltaZ)];
+		const FVoxelChunk* Row = Chunks[FChunkMap::NeighbourIndex(0, DeltaY, DeltaZ)];
+		const FVoxelChunk* After = Chunks[FChunkMap::NeighbourIndex(1, DeltaY, DeltaZ)];
+
+		FBlockId* Blocks = &Volume.Blocks[Volume.Index(-1, Y, Z)];
+		Blocks[0] = Before ? Before->Get(ChunkSize - 1, LocalY, LocalZ) : BlockAir;
+		if(Row)
+		{
+			Row->CopyRun(FVoxelChunk::ToIndex(0, LocalY, LocalZ), ChunkSize, Blocks + 1);
+		}
+		else
+		{
+			std::fill(Blocks + 1, Blocks + 1 + ChunkSize, BlockAir);
+		}
+		Blocks[ChunkSize + 1] = After ? After->Get(0, LocalY, LocalZ) : BlockAir;
+	}
+	Mesher.Mesh(Volume, OutMesh);
+}
+
+static bool MeshesMatch(const FChunkMesh& A, const FChunkMesh& B)
+{
+	return A.Vertices.size() == B.Vertices.size()
+		&& std::memcmp(A.Vertices.data(), B.Vertices.data(), A.Vertices.size() * sizeof(FMeshVertex)) == 0;
+}
+
+REGISTER_BENCHMARK(SectionMeshing_Edits)
+{
+	FJobSystem JobSystem;
+	JobSystem.Initialize();
+
+	FChunkMap ChunkMap;
+	std::vector<std::unique_ptr<FVoxelChunk>> Chunks;
+	{
+		FMeshVolume Volume;
+		std::vector<FBlockId> Blocks(ChunkVolume);
+		for(int32 Y = 0; Y < AreaHeightChunks; Y++)
+		for(int32 Z = 0; Z < AreaColumns; Z++)
+		for(int32 X = 0; X < AreaColumns; X++)
+		{
+			GenerateBenchmarkTerrain(Volume, X, Y, Z, TerrainSeed);
+			for(int32 LocalY = 0; LocalY < ChunkSize; LocalY++)
+			for(int32 LocalZ = 0; LocalZ < ChunkSize; LocalZ++)
+			for(int32 LocalX = 0; LocalX < ChunkSize; LocalX++)
+			{
+				Blocks[FVoxelChunk::ToIndex(LocalX, LocalY, LocalZ)] = Volume.Get(LocalX, LocalY, LocalZ);
+			}
+
+			Chunks.emplace_back(new FVoxelChunk());
+			Chunks.back()->SetFromDense(Blocks.data());
+			ChunkMap.Insert(X, Y, Z, Chunks.back().get());
+		}
+	}
+
+	FSectionMeshes Sections(&JobSystem, &ChunkMap);
+	std::vector<FMeshSection*> Changed;
+	{
+		for(int32 Y = 0; Y < AreaHeightChunks; Y++)
+		for(int32 Z = 0; Z < AreaColumns; Z++)
+		for(int32 X = 0; X < AreaColumns; X++)
+		{
+			Sections.OnChunkLoaded(X, Y, Z);
+		}
+
+		FBenchmarkTimer Timer;
+		Sections.Flush();
+		Sections.TakeChangedSections(Changed);
+		BENCHMARK_REPORT("%u chunks, %u sections meshed in %.2f ms on %u threads",
+			(uint32)Chunks.size(),
+			Sections.GetNumSections(),
+			Timer.GetElapsedSeconds() * 1000.0,
+			JobSystem.GetNumThreads()
+		);
+	}
+
+	FMeshVolume ChunkVolumeScratch;
+	FBinaryMesher ChunkMesher;
+	FChunkMesh ChunkMesh;
+	std::mt19937 Random(TerrainSeed);
+
+	for(uint32 NumEditors : { 1, 16, 256 })
+	{
+		std::uniform_int_distribution<int32> HorizontalDistribution(0, AreaColumns * ChunkSize - 1);
+		std::uniform_int_distribution<int32> VerticalDistribution(EditMinY, EditMaxY);
+
+		double TotalSeconds = 0.0;
+		double WorstSeconds = 0.0;
+		double WholeChunkSeconds = 0.0;
+		uint64 CarriedEdits = 0;
+		uint64 RefusedEdits = 0;
+		const uint64 MeshedBefore = Sections.GetNumMeshed();
+
+		for(int32 Frame = 0; Frame < NumFrames; Frame++)
+		{
+			// Every editor digs out or fills in one block a frame.
+			for(uint32 Editor = 0; Editor < NumEditors; Editor++)
+			{
+				const int32 X = HorizontalDistribution(Random);
+				const int32 Y = VerticalDistribution(Random);
+				const int32 Z = HorizontalDistribution(Random);
+				const FVoxelChunk* Chunk = ChunkMap.Find(X >> ChunkSizeLog2, Y >> ChunkSizeLog2, Z >> ChunkSizeLog2);
+				const bool bSolid = Chunk->Get(X & (ChunkSize - 1), Y & (ChunkSize - 1), Z & (ChunkSize - 1)) != BlockAir;
+				if(!Sections.QueueEdit(X, Y, Z, bSolid ? BlockAir : BenchmarkStone))
+				{
+					RefusedEdits++;
+				}
+			}
+
+			FBenchmarkTimer Timer;
+			Sections.Update();
+			Sections.TakeChangedSections(Changed);
+			const double Seconds = Timer.GetElapsedSeconds();
+			TotalSeconds += Seconds;
+			WorstSeconds = std::max(WorstSeconds, Seconds);
+			CarriedEdits += Sections.GetNumPendingEdits();
+
+			FBenchmarkTimer ChunkTimer;
+			for(uint64 Key : Sections.GetEditedChunks())
+			{
+				int32 ChunkX, ChunkY, ChunkZ;
+				FChunkMap::UnpackKey(Key, ChunkX, ChunkY, ChunkZ);
+				MeshWholeChunk(ChunkMap, ChunkX, ChunkY, ChunkZ, ChunkVolumeScratch, ChunkMesher, ChunkMesh);
+			}
+			WholeChunkSeconds += ChunkTimer.GetElapsedSeconds();
+		}
+
+		// Whatever's still queued drains once the editors stop.
+		int32 DrainFrames = 0;
+		while(Sections.GetNumPendingEdits() > 0)
+		{
+			Sections.Update();
+			Sections.TakeChangedSections(Changed);
+			DrainFrames++;
+		}
+
+		BENCHMARK_REPORT("%3u editors: %6.3f ms avg %6.3f ms worst per frame (%5.1f%% of a 60 Hz frame), %5.1f sections remeshed",
+			NumEditors,
+			TotalSeconds * 1000.0 / NumFrames,
+			WorstSeconds * 1000.0,
+			WorstSeconds * 1000.0 * 100.0 / FrameBudgetMs,
+			(double)(Sections.GetNumMeshed() - MeshedBefore) / NumFrames
+		);
+		BENCHMARK_REPORT("             %5.1f edits carried to the next frame and %5.1f refused on average, the last ones waited %d frames after the editors stopped",
+			(double)CarriedEdits / NumFrames,
+			(double)RefusedEdits / NumFrames,
+			DrainFrames
+		);
+		BENCHMARK_REPORT("             remeshing whole chunks instead would take %6.3f ms per frame", WholeChunkSeconds * 1000.0 / NumFrames);
+	}
+
+	// Every section has to match what meshing it from scratch gives now.
+	uint32 NumMismatches = 0;
+	FChunkMesh Expected;
+	for(int32 Y = 0; Y < AreaHeightChunks << SectionsPerChunkLog2; Y++)
+	for(int32 Z = 0; Z < AreaColumns << SectionsPerChunkLog2; Z++)
+	for(int32 X = 0; X < AreaColumns << SectionsPerChunkLog2; X++)
+	{
+		const FMeshSection* Section = Sections.FindSection(X, Y, Z);
+		FSectionMeshes::MeshSection(ChunkMap, X, Y, Z, Expected);
+		if(!Section || !MeshesMatch(Section->Mesh, Expected))
+		{
+			NumMismatches++;
+		}
+	}
+	if(NumMismatches > 0)
+	{
+		BENCHMARK_REPORT("MISMATCH: %u sections differ from a fresh mesh", NumMismatches);
+	}
+
+	JobSystem.Shutdown();
+}
@@ -0,0 +1,102 @@
+// Copyright Snaps 2022, All Rights Reserved.
+
+#include "Benchmark.h"
+#include "JobSystem.h"
+#include "VoxelChunk.h"
+#include "WorldGenerator.h"
+
+/*
+	Generates the area around a viewer with the staged world generator and
+	reports throughput per stage. The same area is then generated on a single
+	thread with the viewer walking in from further away, which changes both the
+	thread count and the order columns finish in, and the two worlds have to
+	come out identical.
+*/
+
+static const uint32 WorldSeed = 1337;
+static const int32 ViewDistance = 8;
+
+// Order independent hash of every finished chunk within Radius columns of the origin.
+static uint64 HashWorld(const FWorldGenerator& Generator, int32 Radius)
+{
+	std::vector<FBlockId> Blocks(ChunkVolume);
+	uint64 Result = 0;
+
+	Generator.GetChunkMap().ForEach([&](int32 X, int32 Y, int32 Z, FVoxelChunk* Chunk)
+	{
+		if(X * X + Z * Z > Radius * Radius)
+		{
+			return;
+		}
+
+		Chunk->CopyToDense(Blocks.data());
+		uint64 Hash = 0xCBF29CE484222325ull ^ FChunkMap::PackKey(X, Y, Z);
+		for(FBlockId Block : Blocks)
+		{
+			Hash = (Hash ^ Block) * 0x100000001B3ull;
+		}
+		Result += Hash ^ (Hash >> 29);
+	});
+	return Result;
+}
+
+REGISTER_BENCHMARK(WorldGen_Pipeline)
+{
+	uint64 Hashes[2];
+
+	for(int32 Run = 0; Run < 2; Run++)
+	{
+		const bool bSingleThread = Run == 1;
+
+		FJobSystem JobSystem;
+		JobSystem.Initialize(bSingleThread ? 1 : 0);
+		{
+			FWorldGenerator Generator(&JobSystem, WorldSeed, ViewDistance);
+			FBenchmarkTimer Timer;
+
+			// Walk in from the west, flushing along the way so columns at every step get generated.
+			if(bSingleThread)
+			{
+				for(int32 Step = -6; Step < 0; Step++)
+				{
+					Generator.Update(Step * ChunkSize * 2.0, 0.0);
+					Generator.Flush();
+				}
+			}
+
+			Generator.Update(0.0, 0.0);
+			Generator.Flush();
+			const double Seconds = Timer.GetElapsedSeconds();
+
+			const uint64 NumChunks = Generator.GetChunkMap().GetSize();
+			BENCHMARK_REPORT("%u thread%s%s: %u columns, %llu chunks finished in %.2f ms, %.1f chunks/s",
+				JobSystem.GetNumThreads(),
+				JobSystem.GetNumThreads() == 1 ? "" : "s",
+				bSingleThread ? " walking in" : "",
+				Generator.GetNumColumns(),
+				(unsigned long long)NumChunks,
+				Seconds * 1000.0,
+				NumChunks / Seconds
+			);
+
+			for(uint32 Stage = 0; Stage < (uint32)EWorldGenStage::Count; Stage++)
+			{
+				const FWorldGenStageStats Stats = Generator.GetStageStats((EWorldGenStage)Stage);
+				BENCHMARK_REPORT("  %-12s %5llu columns %9.2f ms %9.1f us/column",
+					FWorldGenerator::GetStageName((EWorldGenStage)Stage),
+					(unsigned long long)Stats.NumColumns,
+					Stats.Seconds * 1000.0,
+					Stats.NumColumns > 0 ? Stats.Seconds * 1e6 / Stats.NumColumns : 0.0
+				);
+			}
+
+			Hashes[Run] = HashWorld(Generator, ViewDistance);
+		}
+		JobSystem.Shutdown();
+	}
+
+	if(Hashes[0] != Hashes[1])
+	{
+		BENCHMARK_REPORT("MISMATCH: world differs between thread counts or generation orders");
+	}
+}
@@ -2,29 +2,85 @@
 
 #include "Application.h"
 #include "Engine.h"
+#include "FramePacer.h"
+#include "CoreMacros.h"
+#include "Profiler.h"
+#include "Renderer.h"
+#include "WorldGenerator.h"
 #include "SDL.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
 
 std::unique_ptr<FApp> FApp::AppSingleton;
 
-int FApp::Initialize(HINSTANCE hInstance, int32 nCmdShow)
+// Finds -Name or -Name=Value on the command line. Values run to the next space, so no quoted paths.
+static bool FindArgument(const char* CommandLine, const char* Name, std::string* OutValue = nullptr)
+{
+	const size_t NameLength = std::strlen(Name);
+	for(const char* Token = CommandLine; Token && *Token; )
+	{
+		while(*Token == ' ')
+		{
+			Token++;
+		}
+
+		const char* TokenEnd = std::strchr(Token, ' ');
+		const size_t TokenLength = TokenEnd ? (size_t)(TokenEnd - Token) : std::strlen(Token);
+
+		const bool bNameMatches = TokenLength >= NameLength && std::strncmp(Token, Name, NameLength) == 0;
+		if(bNameMatches && (TokenLength == NameLength || Token[NameLength] == '='))
+		{
+			if(OutValue)
+			{
+				*OutValue = TokenLength > NameLength ? std::string(Token + NameLength + 1, TokenLength - NameLength - 1) : std::string();
+			}
+			return true;
+		}
+		Token = TokenEnd;
+	}
+	return false;
+}
+
+int FApp::Initialize(HINSTANCE hInstance, LPSTR CommandLine, int32 nCmdShow)
 {
 	SDL_Event LatestEvent;
 
+	// -frames=N quits after N frames and logs frame times, -screenshot=Path saves the last
+	// frame of a headless run. Together they make reproducible benchmark and image diff runs.
+	std::string FrameLimitArgument;
+	std::string ScreenshotPath;
+	const uint32 FrameLimit = FindArgument(CommandLine, "-frames", &FrameLimitArgument) ? (uint32)std::strtoul(FrameLimitArgument.c_str(), nullptr, 10) : 0;
+	FindArgument(CommandLine, "-screenshot", &ScreenshotPath);
+
 	// Create the main app singleton
 	FApp::AppSingleton = std::make_unique<FApp>();
 	FApp* App = FApp::Get();
 	App->AppState = EAppState::Starting;
+	App->bHeadless = AppSettings::Headless || FindArgument(CommandLine, "-headless");
 
-	// Initialize SDL & create blank SDL window
-	SDL_Init(SDL_INIT_VIDEO);
-	App->Window = SDL_CreateWindow(
-		"Voxel Engine", 						// Window title
-		SDL_WINDOWPOS_UNDEFINED, 				// ScreenPos X (Don't care)
-		SDL_WINDOWPOS_UNDEFINED, 				// ScreenPos Y (Don't care)
-		AppSettings::WindowWidth, 				// Window width in pixels
-		AppSettings::WindowHeight, 				// Window height in pixels
-		(SDL_WindowFlags)(SDL_WINDOW_VULKAN) 	// Set window flags
-	);
+	// Start profiling first so startup shows up in captures too.
+	FProfiler::Initialize();
+
+	if(App->bHeadless)
+	{
+		// No display needed, only events so the loop can still be stopped with ctrl-c.
+		SDL_Init(SDL_INIT_EVENTS);
+	}
+	else
+	{
+		// Initialize SDL & create blank SDL window
+		SDL_Init(SDL_INIT_VIDEO);
+		App->Window = SDL_CreateWindow(
+			"Voxel Engine", 						// Window title
+			SDL_WINDOWPOS_UNDEFINED, 				// ScreenPos X (Don't care)
+			SDL_WINDOWPOS_UNDEFINED, 				// ScreenPos Y (Don't care)
+			AppSettings::WindowWidth, 				// Window width in pixels
+			AppSettings::WindowHeight, 				// Window height in pixels
+			(SDL_WindowFlags)(SDL_WINDOW_VULKAN | SDL_WINDOW_RESIZABLE) 	// Set window flags
+		);
+	}
 
 	// Create engine and initialize. Process will exit if engine init fails.
 	App->GEngine = std::make_shared<FEngine>();
@@ -33,21 +89,69 @@ int FApp::Initialize(HINSTANCE hInstance, int32 nCmdShow)
 		return 1; // Quit process with error code 1.
 	}
 
+	std::vector<double> FrameTimes;
+	FrameTimes.reserve(FrameLimit);
+
 	App->AppState = EAppState::Running;
 	while(App->AppState != EAppState::Exiting)
 	{
-		App->GEngine.get()->Tick(); // Tick our engine.
+		const std::chrono::steady_clock::time_point FrameStart = std::chrono::steady_clock::now();
+		{
+			PROFILE_SCOPE("Frame");
 
-		// Poll for SDL window events
-		while(SDL_PollEvent(&LatestEvent) != 0)
+			// Start as late as still makes the next vblank, so the input below is as fresh as it can be.
+			App->GEngine.get()->WaitForFrameStart();
+
+			// Poll for SDL window events
+			{
+				PROFILE_SCOPE("PollEvents");
+				while(SDL_PollEvent(&LatestEvent) != 0)
+				{
+					// Process window quit events like close and alt-f4
+					if(LatestEvent.type == SDL_QUIT)
+					{
+						App->AppState = EAppState::Exiting;
+					}
+
+					// The renderer rebuilds its swapchain at the start of the next frame.
+					if(LatestEvent.type == SDL_WINDOWEVENT && LatestEvent.window.event == SDL_WINDOWEVENT_SIZE_CHANGED)
+					{
+						App->GEngine.get()->GetRenderer()->OnWindowResized();
+					}
+
+					// F12 captures the last few frames of zones to a trace file next to the exe.
+					if(LatestEvent.type == SDL_KEYDOWN && LatestEvent.key.keysym.sym == SDLK_F12)
+					{
+						App->CaptureProfile();
+					}
+				}
+			}
+
+			App->GEngine.get()->Tick(); // Tick our engine.
+		}
+
+		FProfiler::EndFrame();
+
+		if(FrameLimit > 0)
 		{
-			// Process window quit events like close and alt-f4
-			if(LatestEvent.type == SDL_QUIT)
+			FrameTimes.push_back(std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - FrameStart).count());
+			if(FrameTimes.size() >= FrameLimit)
 			{
 				App->AppState = EAppState::Exiting;
 			}
 		}
 	}
+
+	if(!FrameTimes.empty())
+	{
+		ReportFrameTimes(FrameTimes);
+	}
+
+	if(!ScreenshotPath.empty())
+	{
+		App->GEngine.get()->GetRenderer()->SaveScreenshot(ScreenshotPath.c_str());
+	}
+
 	App->Shutdown(); // Run all shutdown prereqs & cleanup.
 	return 0;
 }
@@ -57,8 +161,59 @@ void FApp::Shutdown()
 	// Shutdown engine.
 	GEngine.get()->Shutdown();
 
-	// Kill the active SDL window.
-	SDL_DestroyWindow(Window);
+	// Kill the active SDL window, headless runs never made one.
+	if(Window)
+	{
+		SDL_DestroyWindow(Window);
+	}
+
+	FProfiler::Shutdown();
+}
+
+void FApp::CaptureProfile()
+{
+	const char* TracePath = "VoxelEngine.trace.json";
+	if(FProfiler::WriteChromeTrace(TracePath))
+	{
+		SDL_Log("Wrote profile capture to %s, open it in chrome://tracing or ui.perfetto.dev", TracePath);
+	}
+
+	SDL_Log("Zone timings:\n%s", FProfiler::FormatZoneStats().c_str());
+	SDL_Log("World generation:\n%s", GEngine.get()->GetWorldGenerator()->FormatStats().c_str());
+
+	const FFramePacingStats& Pacing = GEngine.get()->GetRenderer()->GetFramePacer()->GetStats();
+	SDL_Log("Frame pacing %s (%s): delay %.2f ms, slack %.2f ms, blocked %.2f ms, present interval %.2f ms, %llu of %llu frames missed vblank",
+		Pacing.bEnabled ? "on" : "off",
+		Pacing.bPresentWait ? "present wait" : "fences",
+		Pacing.DelayMs,
+		Pacing.SlackMs,
+		Pacing.BlockedMs,
+		Pacing.PresentIntervalMs,
+		(unsigned long long)Pacing.NumMissedVblanks,
+		(unsigned long long)Pacing.NumFrames
+	);
+}
+
+void FApp::ReportFrameTimes(std::vector<double>& FrameTimes)
+{
+	double TotalMs = 0.0;
+	for(double FrameMs : FrameTimes)
+	{
+		TotalMs += FrameMs;
+	}
+
+	// Sorted for percentiles, the first frame is left in since startup hitches are worth seeing.
+	std::sort(FrameTimes.begin(), FrameTimes.end());
+	const size_t Count = FrameTimes.size();
+
+	SDL_Log("%zu frames: avg %.3f ms, min %.3f ms, median %.3f ms, p99 %.3f ms, max %.3f ms",
+		Count,
+		TotalMs / Count,
+		FrameTimes.front(),
+		FrameTimes[Count / 2],
+		FrameTimes[std::min(Count - 1, Count * 99 / 100)],
+		FrameTimes.back()
+	);
 }
 
 void FApp::SetWindowTexture()
@@ -3,6 +3,7 @@
 #pragma once
 
 #include "CoreMinimal.h"
+#include <vector>
 
 class FEngine;
 struct SDL_Window;
@@ -12,6 +13,13 @@ namespace AppSettings
 	static int32 	WindowWidth 	= 500;
 	static int32 	WindowHeight 	= 500;
 	static bool		VSync 			= true;
+	static int32	FramesInFlight 	= 2;		// How many frames the CPU may get ahead of the GPU, 1 to 4.
+	static int32	TickRate 		= 60;		// Fixed simulation ticks per second, rendering runs as fast as VSync allows.
+	static bool		FramePacing 	= true;		// With VSync, start each frame's CPU work as late as still makes the next vblank.
+	static bool		Headless 		= false;	// No window, render offscreen and skip presenting. Also -headless on the command line.
+	static uint32	WorldSeed 		= 1337;
+	static int32	ViewDistance 	= 12;		// Radius in chunks the world is generated out to around the viewer.
+	static const char*	SaveDirectory 	= "Saves";	// Region files are read from and written to here, relative to the working directory.
 }
 
 enum class EAppState : uint8_t
@@ -33,7 +41,7 @@ public:
 	EAppState 					AppState = EAppState::None;
 	std::shared_ptr<FEngine> 	GEngine;
 
-	static int 	Initialize(HINSTANCE hInstance, int32 nCmdShow);
+	static int 	Initialize(HINSTANCE hInstance, LPSTR CommandLine, int32 nCmdShow);
 	void 		Shutdown();
 
 	static FApp* Get()
@@ -43,9 +51,23 @@ public:
 
 	void SetWindowTexture();
 
+	// Writes a Chrome trace of recent frames and logs the zone stats.
+	void CaptureProfile();
+
+	// Headless runs have no window, the renderer draws into offscreen images and never presents.
+	bool IsHeadless() const
+	{
+		return bHeadless;
+	}
+
 	SDL_Window* Window = nullptr;
 
 private:
 
+	// Logs frame time stats for runs with a frame limit, FrameTimes in milliseconds.
+	static void ReportFrameTimes(std::vector<double>& FrameTimes);
+
+	bool bHeadless = false;
+
 	static std::unique_ptr<FApp> AppSingleton;
 };
\ No newline at end of file
@@ -0,0 +1,510 @@
+// Copyright Snaps 2022, All Rights Reserved.
+
+#include "AsyncIO.h"
+#include <condition_variable>
+#include <cstring>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#if defined(_WIN32)
+#include <windows.h>
+#else
+#include <cerrno>
+#include <unistd.h>
+#endif
+
+#if defined(__linux__) && defined(__has_include)
+#if __has_include(<linux/io_uring.h>)
+#define VOXEL_IO_URING 1
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#endif
+#endif
+
+#ifndef VOXEL_IO_URING
+#define VOXEL_IO_URING 0
+#endif
+
+// Blocking I/O threads for the fallback. They only wait on the disk, so this isn't tied to the core count.
+static const uint32 IOThreadCount = 4;
+
+// Submission queue size of the ring, requests past it wait in the backlog.
+static const uint32 IoUringEntries = 256;
+
+/*
+	Shared by the backends: hands a finished request to the job system.
+*/
+class FAsyncIOBackend
+{
+public:
+
+	FAsyncIOBackend(FJobSystem* InJobSystem, std::atomic<uint32>* InNumInFlight)
+		: JobSystem(InJobSystem)
+		, NumInFlight(InNumInFlight)
+	{
+	}
+
+	virtual ~FAsyncIOBackend() {}
+
+	virtual void Submit(FAsyncIORequest* const* Requests, uint32 Count) = 0;
+
+protected:
+
+	// Result is the request's progress so far, or an error, when called.
+	void Complete(FAsyncIORequest* Request)
+	{
+		if(Request->OnComplete)
+		{
+			JobSystem->Schedule(Request->OnComplete, Request, Request->Counter);
+		}
+
+		// After scheduling, so no transfers in flight means every completion is queued.
+		NumInFlight->fetch_sub(1, std::memory_order_release);
+	}
+
+	FJobSystem* 			JobSystem;
+	std::atomic<uint32>* 	NumInFlight;
+};
+
+// Rest of the transfer, Request->Result bytes are done already. Returns bytes moved or a negative error.
+static int32 TransferBlocking(FAsyncIORequest* Request)
+{
+	uint8* Buffer = static_cast<uint8*>(Request->Buffer) + Request->Result;
+	const uint64 Offset = Request->Offset + (uint32)Request->Result;
+	const uint32 Size = Request->Size - (uint32)Request->Result;
+
+#if defined(_WIN32)
+	OVERLAPPED Overlapped = {};
+	Overlapped.Offset = (DWORD)Offset;
+	Overlapped.OffsetHigh = (DWORD)(Offset >> 32);
+
+	DWORD Transferred = 0;
+	const BOOL bSucceeded = Request->bWrite
+		? WriteFile((HANDLE)Request->File, Buffer, Size, &Transferred, &Overlapped)
+		: ReadFile((HANDLE)Request->File, Buffer, Size, &Transferred, &Overlapped);
+	return bSucceeded ? (int32)Transferred : -(int32)GetLastError();
+#else
+	const ssize_t Transferred = Request->bWrite
+		? pwrite((int)Request->File, Buffer, Size, (off_t)Offset)
+		: pread((int)Request->File, Buffer, Size, (off_t)Offset);
+	return Transferred >= 0 ? (int32)Transferred : -errno;
+#endif
+}
+
+/*
+	Fallback backend, a few threads doing blocking positional reads and writes.
+*/
+class FThreadPoolBackend : public FAsyncIOBackend
+{
+public:
+
+	FThreadPoolBackend(FJobSystem* InJobSystem, std::atomic<uint32>* InNumInFlight)
+		: FAsyncIOBackend(InJobSystem, InNumInFlight)
+		, bStopping(false)
+	{
+		for(uint32 Index = 0; Index < IOThreadCount; Index++)
+		{
+			Threads.emplace_back(&FThreadPoolBackend::ThreadMain, this);
+		}
+	}
+
+	// Threads drain the queue before they exit.
+	~FThreadPoolBackend() override
+	{
+		{
+			std::lock_guard<std::mutex> Lock(Mutex);
+			bStopping = true;
+		}
+		WakeCondition.notify_all();
+
+		for(std::thread& Thread : Threads)
+		{
+			Thread.join();
+		}
+	}
+
+	void Submit(FAsyncIORequest* const* Requests, uint32 Count) override
+	{
+		{
+			std::lock_guard<std::mutex> Lock(Mutex);
+			Queue.insert(Queue.end(), Requests, Requests + Count);
+		}
+
+		if(Count == 1)
+		{
+			WakeCondition.notify_one();
+		}
+		else
+		{
+			WakeCondition.notify_all();
+		}
+	}
+
+private:
+
+	void ThreadMain()
+	{
+		for(;;)
+		{
+			FAsyncIORequest* Request;
+			{
+				std::unique_lock<std::mutex> Lock(Mutex);
+				WakeCondition.wait(Lock, [this]() { return bStopping || !Queue.empty(); });
+				if(Queue.empty())
+				{
+					return;
+				}
+				Request = Queue.front();
+				Queue.pop_front();
+			}
+
+			// Zero bytes moved before the end is end of file, report what we got.
+			while(Request->Result < (int32)Request->Size)
+			{
+				const int32 Transferred = TransferBlocking(Request);
+				if(Transferred <= 0)
+				{
+					Request->Result = Transferred < 0 ? Transferred : Request->Result;
+					break;
+				}
+				Request->Result += Transferred;
+			}
+
+			Complete(Request);
+		}
+	}
+
+	std::mutex 						Mutex;
+	std::condition_variable 		WakeCondition;
+	std::deque<FAsyncIORequest*> 	Queue;
+	std::vector<std::thread> 		Threads;
+	bool 							bStopping;
+};
+
+#if VOXEL_IO_URING
+
+/*
+	io_uring backend, set up with the raw system calls so there's no liburing
+	dependency. The submitting thread fills the submission ring and enters the
+	kernel once per batch, a completion thread blocks in the kernel for
+	completions and tops the ring up from the backlog. At most as many requests
+	as the submission ring holds are in the kernel, so the completion ring,
+	twice that size, can't overflow.
+*/
+class FIoUringBackend : public FAsyncIOBackend
+{
+public:
+
+	FIoUringBackend(FJobSystem* InJobSystem, std::atomic<uint32>* InNumInFlight)
+		: FAsyncIOBackend(InJobSystem, InNumInFlight)
+		, RingFd(-1)
+		, SqRing(nullptr)
+		, SqRingSize(0)
+		, CqRing(nullptr)
+		, CqRingSize(0)
+		, Sqes(nullptr)
+		, SqesSize(0)
+		, NumInKernel(0)
+		, bStopping(false)
+	{
+	}
+
+	~FIoUringBackend() override
+	{
+		if(CompletionThread.joinable())
+		{
+			// A no-op wakes the completion thread, it leaves once everything before it has completed.
+			{
+				std::lock_guard<std::mutex> Lock(Mutex);
+				bStopping = true;
+				Backlog.push_back(nullptr);
+				SubmitBacklog();
+			}
+			CompletionThread.join();
+		}
+
+		if(Sqes)
+		{
+			munmap(Sqes, SqesSize);
+		}
+		if(CqRing && CqRing != SqRing)
+		{
+			munmap(CqRing, CqRingSize);
+		}
+		if(SqRing)
+		{
+			munmap(SqRing, SqRingSize);
+		}
+		if(RingFd >= 0)
+		{
+			close(RingFd);
+		}
+	}
+
+	// False when the kernel has no io_uring, it's blocked, or it's too old for plain reads and writes.
+	bool Initialize()
+	{
+		io_uring_params Params = {};
+		RingFd = (int)syscall(__NR_io_uring_setup, IoUringEntries, &Params);
+		if(RingFd < 0)
+		{
+			return false;
+		}
+
+		// IORING_OP_READ and IORING_OP_WRITE arrived in the same kernel as this feature flag.
+		if(!(Params.features & IORING_FEAT_RW_CUR_POS))
+		{
+			return false;
+		}
+
+		SqRingSize = Params.sq_off.array + Params.sq_entries * sizeof(uint32);
+		CqRingSize = Params.cq_off.cqes + Params.cq_entries * sizeof(io_uring_cqe);
+
+		// Newer kernels map both rings with one call.
+		const bool bSingleMap = (Params.features & IORING_FEAT_SINGLE_MMAP) != 0;
+		if(bSingleMap)
+		{
+			SqRingSize = CqRingSize = SqRingSize > CqRingSize ? SqRingSize : CqRingSize;
+		}
+
+		SqRing = MapRing(SqRingSize, IORING_OFF_SQ_RING);
+		CqRing = bSingleMap ? SqRing : MapRing(CqRingSize, IORING_OFF_CQ_RING);
+		SqesSize = Params.sq_entries * sizeof(io_uring_sqe);
+		Sqes = static_cast<io_uring_sqe*>(MapRing(SqesSize, IORING_OFF_SQES));
+		if(!SqRing || !CqRing || !Sqes)
+		{
+			return false;
+		}
+
+		uint8* SqBytes = static_cast<uint8*>(SqRing);
+		SqTail = reinterpret_cast<uint32*>(SqBytes + Params.sq_off.tail);
+		SqMask = *reinterpret_cast<uint32*>(SqBytes + Params.sq_off.ring_mask);
+		SqArray = reinterpret_cast<uint32*>(SqBytes + Params.sq_off.array);
+		SqEntries = Params.sq_entries;
+
+		uint8* CqBytes = static_cast<uint8*>(CqRing);
+		CqHead = reinterpret_cast<uint32*>(CqBytes + Params.cq_off.head);
+		CqTail = reinterpret_cast<uint32*>(CqBytes + Params.cq_off.tail);
+		CqMask = *reinterpret_cast<uint32*>(CqBytes + Params.cq_off.ring_mask);
+		Cqes = reinterpret_cast<io_uring_cqe*>(CqBytes + Params.cq_off.cqes);
+
+		CompletionThread = std::thread(&FIoUringBackend::CompletionMain, this);
+		return true;
+	}
+
+	void Submit(FAsyncIORequest* const* Requests, uint32 Count) override
+	{
+		std::lock_guard<std::mutex> Lock(Mutex);
+		Backlog.insert(Backlog.end(), Requests, Requests + Count);
+		SubmitBacklog();
+	}
+
+private:
+
+	void* MapRing(size_t Size, uint64 Offset)
+	{
+		void* Ring = mmap(nullptr, Size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, RingFd, (off_t)Offset);
+		return Ring == MAP_FAILED ? nullptr : Ring;
+	}
+
+	// Mutex held. Moves as much of the backlog into the ring as fits and hands it to the kernel.
+	void SubmitBacklog()
+	{
+		uint32 Tail = *SqTail;
+		uint32 NumQueued = 0;
+
+		while(!Backlog.empty() && NumInKernel < SqEntries)
+		{
+			FAsyncIORequest* Request = Backlog.front();
+			Backlog.pop_front();
+
+			const uint32 Slot = Tail & SqMask;
+			io_uring_sqe& Sqe = Sqes[Slot];
+			std::memset(&Sqe, 0, sizeof(Sqe));
+			Sqe.user_data = (uint64)(uintptr_t)Request;
+
+			if(Request)
+			{
+				Sqe.opcode = Request->bWrite ? IORING_OP_WRITE : IORING_OP_READ;
+				Sqe.fd = (int)Request->File;
+				Sqe.addr = (uint64)(uintptr_t)(static_cast<uint8*>(Request->Buffer) + Request->Result);
+				Sqe.len = Request->Size - (uint32)Request->Result;
+				Sqe.off = Request->Offset + (uint32)Request->Result;
+			}
+			else
+			{
+				Sqe.opcode = IORING_OP_NOP;
+			}
+
+			SqArray[Slot] = Slot;
+			Tail++;
+			NumInKernel++;
+			NumQueued++;
+		}
+
+		if(NumQueued == 0)
+		{
+			return;
+		}
+
+		// Entries have to be visible before the kernel sees the new tail.
+		__atomic_store_n(SqTail, Tail, __ATOMIC_RELEASE);
+
+		uint32 NumSubmitted = 0;
+		while(NumSubmitted < NumQueued)
+		{
+			const int Result = (int)syscall(__NR_io_uring_enter, RingFd, NumQueued - NumSubmitted, 0, 0, nullptr, 0);
+			if(Result < 0 && errno != EINTR && errno != EAGAIN && errno != EBUSY)
+			{
+				break;
+			}
+			NumSubmitted += Result > 0 ? (uint32)Result : 0;
+		}
+	}
+
+	void CompletionMain()
+	{
+		for(;;)
+		{
+			const int Result = (int)syscall(__NR_io_uring_enter, RingFd, 0, 1, IORING_ENTER_GETEVENTS, nullptr, 0);
+			if(Result < 0 && errno != EINTR)
+			{
+				return;
+			}
+
+			uint32 Head = *CqHead;
+			const uint32 Tail = __atomic_load_n(CqTail, __ATOMIC_ACQUIRE);
+			uint32 NumReaped = 0;
+
+			// Partly done transfers go back to the front of the backlog to carry on.
+			std::vector<FAsyncIORequest*> Continued;
+			for(; Head != Tail; Head++)
+			{
+				const io_uring_cqe& Cqe = Cqes[Head & CqMask];
+				FAsyncIORequest* Request = (FAsyncIORequest*)(uintptr_t)Cqe.user_data;
+				NumReaped++;
+
+				if(!Request)
+				{
+					continue;
+				}
+
+				if(Cqe.res > 0 && Request->Result + Cqe.res < (int32)Request->Size)
+				{
+					Request->Result += Cqe.res;
+					Continued.push_back(Request);
+					continue;
+				}
+
+				Request->Result = Cqe.res < 0 ? Cqe.res : Request->Result + Cqe.res;
+				Complete(Request);
+			}
+			__atomic_store_n(CqHead, Head, __ATOMIC_RELEASE);
+
+			std::lock_guard<std::mutex> Lock(Mutex);
+			NumInKernel -= NumReaped;
+			Backlog.insert(Backlog.begin(), Continued.begin(), Continued.end());
+			SubmitBacklog();
+
+			if(bStopping && NumInKernel == 0 && Backlog.empty())
+			{
+				return;
+			}
+		}
+	}
+
+	int 							RingFd;
+	void* 							SqRing;
+	size_t 							SqRingSize;
+	void* 							CqRing;
+	size_t 							CqRingSize;
+	io_uring_sqe* 					Sqes;
+	size_t 							SqesSize;
+
+	uint32* 						SqTail;
+	uint32 							SqMask;
+	uint32* 						SqArray;
+	uint32 							SqEntries;
+
+	uint32* 						CqHead;
+	uint32* 						CqTail;
+	uint32 							CqMask;
+	io_uring_cqe* 					Cqes;
+
+	std::mutex 						Mutex;
+	std::deque<FAsyncIORequest*> 	Backlog; 		// Not in the ring yet, nullptr is a wake up no-op.
+	uint32 							NumInKernel;
+	bool 							bStopping;
+	std::thread 					CompletionThread;
+};
+
+#endif
+
+FAsyncIO::FAsyncIO()
+	: Backend(EAsyncIOBackend::None)
+	, NumInFlight(0)
+{
+}
+
+FAsyncIO::~FAsyncIO()
+{
+	Shutdown();
+}
+
+bool FAsyncIO::Initialize(FJobSystem* JobSystem, bool bAllowIoUring)
+{
+	Shutdown();
+
+#if VOXEL_IO_URING
+	if(bAllowIoUring)
+	{
+		std::unique_ptr<FIoUringBackend> Ring(new FIoUringBackend(JobSystem, &NumInFlight));
+		if(Ring->Initialize())
+		{
+			Impl = std::move(Ring);
+			Backend = EAsyncIOBackend::IoUring;
+			return true;
+		}
+	}
+#endif
+
+	Impl.reset(new FThreadPoolBackend(JobSystem, &NumInFlight));
+	Backend = EAsyncIOBackend::ThreadPool;
+	return true;
+}
+
+void FAsyncIO::Shutdown()
+{
+	// Both backends finish what they have before their destructors return.
+	Impl.reset();
+	Backend = EAsyncIOBackend::None;
+}
+
+void FAsyncIO::Submit(FAsyncIORequest* const* Requests, uint32 Count)
+{
+	if(Count == 0)
+	{
+		return;
+	}
+
+	for(uint32 Index = 0; Index < Count; Index++)
+	{
+		Requests[Index]->Result = 0;
+	}
+
+	NumInFlight.fetch_add(Count, std::memory_order_relaxed);
+	Impl->Submit(Requests, Count);
+}
+
+const char* FAsyncIO::GetBackendName(EAsyncIOBackend Backend)
+{
+	switch(Backend)
+	{
+		case EAsyncIOBackend::IoUring: 		return "io_uring";
+		case EAsyncIOBackend::ThreadPool: 	return "thread pool";
+		default: 							return "none";
+	}
+}
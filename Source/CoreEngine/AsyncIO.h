@@ -0,0 +1,84 @@
+// Copyright Snaps 2022, All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "JobSystem.h"
+#include <atomic>
+#include <memory>
+
+/*
+	One positional read or write. The caller owns the request and its buffer
+	and must keep both alive until the completion job has run.
+*/
+struct FAsyncIORequest
+{
+	intptr_t 		File 		= -1; 		// Platform file handle, e.g. FRegionFile::GetFileHandle().
+	uint64 			Offset 		= 0;
+	void* 			Buffer 		= nullptr;
+	uint32 			Size 		= 0;
+	bool 			bWrite 		= false;
+
+	// Scheduled on the job system with this request as its data once the transfer is over.
+	FJobFunction 	OnComplete 	= nullptr;
+	void* 			UserData 	= nullptr;
+	FJobCounter* 	Counter 	= nullptr; 	// Optional, the completion job is scheduled with it.
+
+	// Bytes transferred, Size on success, or a negative error code. Valid once OnComplete runs.
+	int32 			Result 		= 0;
+};
+
+enum class EAsyncIOBackend : uint8
+{
+	None,
+	IoUring,
+	ThreadPool
+};
+
+class FAsyncIOBackend;
+
+/*
+	Batched asynchronous file I/O that completes into the job system. On Linux
+	requests go through an io_uring: a whole batch is one system call and a
+	single thread reaps completions and schedules their jobs. Elsewhere, or
+	when the kernel doesn't support it, a few blocking I/O threads stand in.
+	Either way the thread submitting never waits on the disk.
+*/
+class FAsyncIO
+{
+public:
+
+	FAsyncIO();
+	~FAsyncIO();
+
+	FAsyncIO(const FAsyncIO&) = delete;
+	FAsyncIO& operator=(const FAsyncIO&) = delete;
+
+	// Uses io_uring where available unless bAllowIoUring is false, the thread pool otherwise.
+	bool Initialize(FJobSystem* JobSystem, bool bAllowIoUring = true);
+
+	// Finishes every transfer in flight and schedules its completion, then stops the backend.
+	void Shutdown();
+
+	// Owner thread only. Queues Count requests, short transfers are continued until done or failed.
+	void Submit(FAsyncIORequest* const* Requests, uint32 Count);
+
+	// Transfers not finished yet. Once this drops to zero every completion job has been scheduled.
+	uint32 GetNumInFlight() const
+	{
+		return NumInFlight.load(std::memory_order_acquire);
+	}
+
+	EAsyncIOBackend GetBackend() const
+	{
+		return Backend;
+	}
+
+	static const char* GetBackendName(EAsyncIOBackend Backend);
+
+private:
+
+	std::unique_ptr<FAsyncIOBackend> 	Impl;
+	EAsyncIOBackend 					Backend;
+	std::atomic<uint32> 				NumInFlight;
+};
@@ -0,0 +1,98 @@
+// Copyright Snaps 2022, All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+/*
+	Portable bit scan and population count helpers. Results are undefined for
+	zero inputs where noted, same as the underlying instructions.
+*/
+namespace BitMath
+{
+	// Index of the lowest set bit. Value must not be 0.
+	inline uint32 CountTrailingZeros64(uint64 Value)
+	{
+#if defined(_MSC_VER)
+		unsigned long Index;
+		_BitScanForward64(&Index, Value);
+		return (uint32)Index;
+#else
+		return (uint32)__builtin_ctzll(Value);
+#endif
+	}
+
+	// Number of leading zero bits. Value must not be 0.
+	inline uint32 CountLeadingZeros64(uint64 Value)
+	{
+#if defined(_MSC_VER)
+		unsigned long Index;
+		_BitScanReverse64(&Index, Value);
+		return 63 - (uint32)Index;
+#else
+		return (uint32)__builtin_clzll(Value);
+#endif
+	}
+
+	inline uint32 PopCount64(uint64 Value)
+	{
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+		return (uint32)__popcnt64(Value);
+#elif defined(_MSC_VER)
+		Value = Value - ((Value >> 1) & 0x5555555555555555ull);
+		Value = (Value & 0x3333333333333333ull) + ((Value >> 2) & 0x3333333333333333ull);
+		Value = (Value + (Value >> 4)) & 0x0F0F0F0F0F0F0F0Full;
+		return (uint32)((Value * 0x0101010101010101ull) >> 56);
+#else
+		return (uint32)__builtin_popcountll(Value);
+#endif
+	}
+
+	// Mask with the lowest Count bits set, Count may be 0 to 64.
+	inline uint64 LowBitsMask64(uint32 Count)
+	{
+		return Count >= 64 ? ~0ull : (1ull << Count) - 1;
+	}
+
+	// Spreads the low 21 bits of Value out to every third bit.
+	inline uint64 SpreadBits3(uint64 Value)
+	{
+		Value &= 0x1FFFFF;
+		Value = (Value | (Value << 32)) & 0x001F00000000FFFFull;
+		Value = (Value | (Value << 16)) & 0x001F0000FF0000FFull;
+		Value = (Value | (Value << 8)) & 0x100F00F00F00F00Full;
+		Value = (Value | (Value << 4)) & 0x10C30C30C30C30C3ull;
+		Value = (Value | (Value << 2)) & 0x1249249249249249ull;
+		return Value;
+	}
+
+	// Inverse of SpreadBits3, gathers every third bit back into the low 21 bits.
+	inline uint32 CompactBits3(uint64 Value)
+	{
+		Value &= 0x1249249249249249ull;
+		Value = (Value | (Value >> 2)) & 0x10C30C30C30C30C3ull;
+		Value = (Value | (Value >> 4)) & 0x100F00F00F00F00Full;
+		Value = (Value | (Value >> 8)) & 0x001F0000FF0000FFull;
+		Value = (Value | (Value >> 16)) & 0x001F00000000FFFFull;
+		Value = (Value | (Value >> 32)) & 0x1FFFFF;
+		return (uint32)Value;
+	}
+
+	// Interleaves three 21 bit values into a 63 bit Morton code. X takes the lowest bit, then Z, then Y,
+	// the same axis order as voxels within a chunk.
+	inline uint64 MortonEncode3(uint32 X, uint32 Y, uint32 Z)
+	{
+		return SpreadBits3(X) | (SpreadBits3(Z) << 1) | (SpreadBits3(Y) << 2);
+	}
+
+	inline void MortonDecode3(uint64 Code, uint32& OutX, uint32& OutY, uint32& OutZ)
+	{
+		OutX = CompactBits3(Code);
+		OutZ = CompactBits3(Code >> 1);
+		OutY = CompactBits3(Code >> 2);
+	}
+}
@@ -0,0 +1,584 @@
+// Copyright Snaps 2022, All Rights Reserved.
+
+#include "BrickMap.h"
+#include "BitMath.h"
+#include "ChunkMap.h"
+#include "VoxelChunk.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+
+// Dense copy of the chunk being converted.
+static thread_local FBlockId GBrickScratch[ChunkVolume];
+
+static int32 FloorToInt(float Value)
+{
+	return (int32)std::floor(Value);
+}
+
+// Converts the 8^3 voxels at brick BrickX, BrickY, BrickZ of a dense chunk. Returns the cell value,
+// or 1 with OutBrick filled in when the voxels need a brick.
+static uint32 BuildBrick(const FBlockId* Blocks, int32 BrickX, int32 BrickY, int32 BrickZ, FBrick& OutBrick)
+{
+	// Distinct solid ids and their counts, bricks rarely have more than a handful.
+	FBlockId Ids[BrickVolume];
+	uint32 Counts[BrickVolume];
+	uint32 NumIds = 0;
+	uint32 NumSolid = 0;
+
+	std::memset(OutBrick.Occupancy, 0, sizeof(OutBrick.Occupancy));
+	const int32 Base = FVoxelChunk::ToIndex(BrickX * BrickSize, BrickY * BrickSize, BrickZ * BrickSize);
+	for(int32 Y = 0; Y < BrickSize; Y++)
+	for(int32 Z = 0; Z < BrickSize; Z++)
+	{
+		const FBlockId* Row = Blocks + Base + FVoxelChunk::ToIndex(0, Y, Z);
+		for(int32 X = 0; X < BrickSize; X++)
+		{
+			const FBlockId Block = Row[X];
+			if(Block == BlockAir)
+			{
+				continue;
+			}
+
+			const int32 Index = FBrick::ToIndex(X, Y, Z);
+			OutBrick.Occupancy[Index >> 6] |= 1ull << (Index & 63);
+			NumSolid++;
+
+			uint32 Id = 0;
+			while(Id < NumIds && Ids[Id] != Block)
+			{
+				Id++;
+			}
+			if(Id == NumIds)
+			{
+				Ids[NumIds] = Block;
+				Counts[NumIds++] = 0;
+			}
+			Counts[Id]++;
+		}
+	}
+
+	if(NumSolid == 0)
+	{
+		return FBrickMap::EmptyCell;
+	}
+	if(NumSolid == BrickVolume && NumIds == 1)
+	{
+		return FBrickMap::UniformCellFlag | Ids[0];
+	}
+
+	// Most common first, anything past the 16th falls back to the most common.
+	uint32 Order[BrickVolume];
+	for(uint32 Id = 0; Id < NumIds; Id++)
+	{
+		Order[Id] = Id;
+	}
+	const uint32 PaletteSize = std::min<uint32>(NumIds, 16);
+	std::partial_sort(Order, Order + PaletteSize, Order + NumIds, [&](uint32 A, uint32 B)
+	{
+		return Counts[A] > Counts[B];
+	});
+	for(uint32 Entry = 0; Entry < 16; Entry++)
+	{
+		OutBrick.Palette[Entry] = Entry < PaletteSize ? Ids[Order[Entry]] : BlockAir;
+	}
+
+	std::memset(OutBrick.Indices, 0, sizeof(OutBrick.Indices));
+	if(PaletteSize == 1)
+	{
+		return 1;
+	}
+
+	FBlockId LastBlock = OutBrick.Palette[0];
+	uint32 LastEntry = 0;
+	for(int32 Y = 0; Y < BrickSize; Y++)
+	for(int32 Z = 0; Z < BrickSize; Z++)
+	{
+		const FBlockId* Row = Blocks + Base + FVoxelChunk::ToIndex(0, Y, Z);
+		for(int32 X = 0; X < BrickSize; X++)
+		{
+			const FBlockId Block = Row[X];
+			if(Block == BlockAir)
+			{
+				continue;
+			}
+
+			if(Block != LastBlock)
+			{
+				uint32 Entry = 0;
+				while(Entry < PaletteSize && OutBrick.Palette[Entry] != Block)
+				{
+					Entry++;
+				}
+				LastBlock = Block;
+				LastEntry = Entry < PaletteSize ? Entry : 0;
+			}
+
+			const int32 Index = FBrick::ToIndex(X, Y, Z);
+			OutBrick.Indices[Index >> 1] |= (uint8)(LastEntry << ((Index & 1) * 4));
+		}
+	}
+	return 1;
+}
+
+// Downsampled block for the Scale^3 voxels of a brick starting at CellX, CellY, CellZ.
+static FBlockId SampleBrickCell(const FBrick& Brick, int32 CellX, int32 CellY, int32 CellZ, int32 Scale)
+{
+	uint32 NumSolid = 0;
+	for(int32 Y = CellY; Y < CellY + Scale; Y++)
+	{
+		const uint64 RowMask = BitMath::LowBitsMask64((uint32)Scale) << CellX;
+		for(int32 Z = CellZ; Z < CellZ + Scale; Z++)
+		{
+			NumSolid += BitMath::PopCount64(Brick.Occupancy[Y] & (RowMask << (Z * BrickSize)));
+		}
+	}
+	if(NumSolid * 2 < (uint32)(Scale * Scale * Scale))
+	{
+		return BlockAir;
+	}
+
+	// Vote with the highest solid voxel of every column, what the cell looks like from above.
+	uint32 Votes[16] = {};
+	for(int32 Z = CellZ; Z < CellZ + Scale; Z++)
+	for(int32 X = CellX; X < CellX + Scale; X++)
+	{
+		for(int32 Y = CellY + Scale - 1; Y >= CellY; Y--)
+		{
+			const int32 Index = FBrick::ToIndex(X, Y, Z);
+			if(Brick.IsSolid(Index))
+			{
+				Votes[(Brick.Indices[Index >> 1] >> ((Index & 1) * 4)) & 15]++;
+				break;
+			}
+		}
+	}
+
+	uint32 Best = 0;
+	for(uint32 Entry = 1; Entry < 16; Entry++)
+	{
+		Best = Votes[Entry] > Votes[Best] ? Entry : Best;
+	}
+	return Brick.Palette[Best];
+}
+
+FBrickMap::FBrickMap(uint64 InBudgetBytes, int32 InWidthChunksLog2, int32 InHeightChunksLog2)
+	: WidthChunksLog2(InWidthChunksLog2)
+	, WidthMask((1 << InWidthChunksLog2) - 1)
+	, HeightMask((1 << InHeightChunksLog2) - 1)
+	, CellWidthLog2(InWidthChunksLog2 + ChunkSizeLog2 - BrickSizeLog2)
+	, CellWidthMask((1 << (InWidthChunksLog2 + ChunkSizeLog2 - BrickSizeLog2)) - 1)
+	, CellHeightMask((1 << (InHeightChunksLog2 + ChunkSizeLog2 - BrickSizeLog2)) - 1)
+	, NumAllocatedBricks(0)
+	, LruHead(-1)
+	, LruTail(-1)
+	, NumChunks(0)
+	, NumBricks(0)
+	, MaxBricks(0)
+	, NumEvictions(0)
+{
+	Cells.assign((size_t)(CellWidthMask + 1) * (CellWidthMask + 1) * (CellHeightMask + 1), (uint32)EmptyCell);
+	Slots.resize((size_t)(WidthMask + 1) * (WidthMask + 1) * (HeightMask + 1));
+
+	// Whatever the grid leaves of the budget, in whole pages so the pages never go over it.
+	const uint64 FixedBytes = Cells.size() * sizeof(uint32) + Slots.size() * sizeof(FChunkSlot);
+	if(InBudgetBytes > FixedBytes)
+	{
+		const uint64 NumPages = (InBudgetBytes - FixedBytes) / (BricksPerPage * sizeof(FBrick));
+		MaxBricks = (uint32)std::min<uint64>(NumPages * BricksPerPage, UniformCellFlag - 1);
+	}
+}
+
+FBrickMap::~FBrickMap()
+{
+}
+
+void FBrickMap::BuildChunk(const FVoxelChunk& Chunk, FBrickMapChunk& OutChunk)
+{
+	OutChunk.Bricks.clear();
+	if(Chunk.IsUniform())
+	{
+		const FBlockId Block = Chunk.Get(0);
+		std::fill(OutChunk.Cells, OutChunk.Cells + ChunkBrickCount, Block == BlockAir ? EmptyCell : UniformCellFlag | Block);
+		return;
+	}
+
+	Chunk.CopyToDense(GBrickScratch);
+
+	FBrick Brick;
+	int32 Index = 0;
+	for(int32 Y = 0; Y < BricksPerChunk; Y++)
+	for(int32 Z = 0; Z < BricksPerChunk; Z++)
+	for(int32 X = 0; X < BricksPerChunk; X++, Index++)
+	{
+		uint32 Cell = BuildBrick(GBrickScratch, X, Y, Z, Brick);
+		if(Cell == 1)
+		{
+			OutChunk.Bricks.push_back(Brick);
+			Cell = (uint32)OutChunk.Bricks.size();
+		}
+		OutChunk.Cells[Index] = Cell;
+	}
+}
+
+bool FBrickMap::AddChunk(int32 X, int32 Y, int32 Z, const FBrickMapChunk& Chunk)
+{
+	const uint64 Key = FChunkMap::PackKey(X, Y, Z);
+	const int32 SlotIndex = ToSlotIndex(X, Y, Z);
+	if(Slots[SlotIndex].Key != NoChunk)
+	{
+		NumEvictions += Slots[SlotIndex].Key != Key ? 1 : 0;
+		EvictSlot(SlotIndex);
+	}
+
+	const uint32 NumNeeded = (uint32)Chunk.Bricks.size();
+	if(NumNeeded > MaxBricks)
+	{
+		return false;
+	}
+	while(NumBricks + NumNeeded > MaxBricks)
+	{
+		EvictSlot(LruTail);
+		NumEvictions++;
+	}
+
+	int32 Index = 0;
+	for(int32 BrickY = Y * BricksPerChunk; BrickY < (Y + 1) * BricksPerChunk; BrickY++)
+	for(int32 BrickZ = Z * BricksPerChunk; BrickZ < (Z + 1) * BricksPerChunk; BrickZ++)
+	for(int32 BrickX = X * BricksPerChunk; BrickX < (X + 1) * BricksPerChunk; BrickX++, Index++)
+	{
+		uint32 Cell = Chunk.Cells[Index];
+		if(Cell != EmptyCell && !(Cell & UniformCellFlag))
+		{
+			const FBrick& Source = Chunk.Bricks[Cell - 1];
+			Cell = AllocateBrick() + 1;
+			GetMutableBrick(Cell) = Source;
+		}
+		Cells[ToCellIndex(BrickX, BrickY, BrickZ)] = Cell;
+	}
+
+	FChunkSlot& Slot = Slots[SlotIndex];
+	Slot.Key = Key;
+	Slot.NumBricks = NumNeeded;
+	NumBricks += NumNeeded;
+	NumChunks++;
+	LinkFront(SlotIndex);
+	return true;
+}
+
+bool FBrickMap::AddChunk(int32 X, int32 Y, int32 Z, const FVoxelChunk& Chunk)
+{
+	BuildChunk(Chunk, Scratch);
+	return AddChunk(X, Y, Z, Scratch);
+}
+
+void FBrickMap::RemoveChunk(int32 X, int32 Y, int32 Z)
+{
+	const int32 SlotIndex = FindSlot(X, Y, Z);
+	if(SlotIndex >= 0)
+	{
+		EvictSlot(SlotIndex);
+	}
+}
+
+void FBrickMap::Touch(int32 X, int32 Y, int32 Z)
+{
+	const int32 SlotIndex = FindSlot(X, Y, Z);
+	if(SlotIndex >= 0 && SlotIndex != LruHead)
+	{
+		Unlink(SlotIndex);
+		LinkFront(SlotIndex);
+	}
+}
+
+FBlockId FBrickMap::GetBlock(int32 X, int32 Y, int32 Z) const
+{
+	const uint32 Cell = GetCell(X >> BrickSizeLog2, Y >> BrickSizeLog2, Z >> BrickSizeLog2);
+	if(Cell == EmptyCell)
+	{
+		return BlockAir;
+	}
+	if(Cell & UniformCellFlag)
+	{
+		return (FBlockId)Cell;
+	}
+	return GetBrick(Cell).Get(FBrick::ToIndex(X & (BrickSize - 1), Y & (BrickSize - 1), Z & (BrickSize - 1)));
+}
+
+void FBrickMap::CopyBlocks(int32 MinX, int32 MinY, int32 MinZ, int32 SizeX, int32 SizeY, int32 SizeZ, FBlockId* OutBlocks) const
+{
+	const int32 MaxX = MinX + SizeX - 1;
+	const int32 MaxY = MinY + SizeY - 1;
+	const int32 MaxZ = MinZ + SizeZ - 1;
+
+	// One brick at a time, clipped to the box.
+	for(int32 BrickY = MinY >> BrickSizeLog2; BrickY <= MaxY >> BrickSizeLog2; BrickY++)
+	for(int32 BrickZ = MinZ >> BrickSizeLog2; BrickZ <= MaxZ >> BrickSizeLog2; BrickZ++)
+	for(int32 BrickX = MinX >> BrickSizeLog2; BrickX <= MaxX >> BrickSizeLog2; BrickX++)
+	{
+		const int32 BeginX = std::max(MinX, BrickX * BrickSize);
+		const int32 BeginY = std::max(MinY, BrickY * BrickSize);
+		const int32 BeginZ = std::max(MinZ, BrickZ * BrickSize);
+		const int32 EndX = std::min(MaxX, BrickX * BrickSize + BrickSize - 1);
+		const int32 EndY = std::min(MaxY, BrickY * BrickSize + BrickSize - 1);
+		const int32 EndZ = std::min(MaxZ, BrickZ * BrickSize + BrickSize - 1);
+
+		const uint32 Cell = GetCell(BrickX, BrickY, BrickZ);
+		const bool bBrick = Cell != EmptyCell && !(Cell & UniformCellFlag);
+		const FBlockId Fill = Cell == EmptyCell ? BlockAir : (FBlockId)Cell;
+		for(int32 Y = BeginY; Y <= EndY; Y++)
+		for(int32 Z = BeginZ; Z <= EndZ; Z++)
+		{
+			FBlockId* Row = OutBlocks + (size_t)(Y - MinY) * SizeX * SizeZ + (size_t)(Z - MinZ) * SizeX - MinX;
+			if(!bBrick)
+			{
+				std::fill(Row + BeginX, Row + EndX + 1, Fill);
+				continue;
+			}
+
+			const FBrick& Brick = GetBrick(Cell);
+			const int32 RowIndex = FBrick::ToIndex(0, Y & (BrickSize - 1), Z & (BrickSize - 1));
+			for(int32 X = BeginX; X <= EndX; X++)
+			{
+				Row[X] = Brick.Get(RowIndex | (X & (BrickSize - 1)));
+			}
+		}
+	}
+}
+
+void FBrickMap::SampleLod(int32 MinX, int32 MinY, int32 MinZ, int32 SizeX, int32 SizeY, int32 SizeZ, int32 Lod, FBlockId* OutBlocks) const
+{
+	if(Lod == 0)
+	{
+		CopyBlocks(MinX, MinY, MinZ, SizeX, SizeY, SizeZ, OutBlocks);
+		return;
+	}
+
+	const int32 Scale = 1 << Lod;
+	const int32 CellsLog2 = BrickSizeLog2 - Lod; 	// log2 of cells per brick along each axis.
+	const int32 CellMask = (1 << CellsLog2) - 1;
+	const int32 MaxX = MinX + SizeX - 1;
+	const int32 MaxY = MinY + SizeY - 1;
+	const int32 MaxZ = MinZ + SizeZ - 1;
+
+	for(int32 BrickY = MinY >> CellsLog2; BrickY <= MaxY >> CellsLog2; BrickY++)
+	for(int32 BrickZ = MinZ >> CellsLog2; BrickZ <= MaxZ >> CellsLog2; BrickZ++)
+	for(int32 BrickX = MinX >> CellsLog2; BrickX <= MaxX >> CellsLog2; BrickX++)
+	{
+		const int32 BeginX = std::max(MinX, BrickX << CellsLog2);
+		const int32 BeginY = std::max(MinY, BrickY << CellsLog2);
+		const int32 BeginZ = std::max(MinZ, BrickZ << CellsLog2);
+		const int32 EndX = std::min(MaxX, (BrickX << CellsLog2) + CellMask);
+		const int32 EndY = std::min(MaxY, (BrickY << CellsLog2) + CellMask);
+		const int32 EndZ = std::min(MaxZ, (BrickZ << CellsLog2) + CellMask);
+
+		const uint32 Cell = GetCell(BrickX, BrickY, BrickZ);
+		const bool bBrick = Cell != EmptyCell && !(Cell & UniformCellFlag);
+		const FBlockId Fill = Cell == EmptyCell ? BlockAir : (FBlockId)Cell;
+		for(int32 Y = BeginY; Y <= EndY; Y++)
+		for(int32 Z = BeginZ; Z <= EndZ; Z++)
+		{
+			FBlockId* Row = OutBlocks + (size_t)(Y - MinY) * SizeX * SizeZ + (size_t)(Z - MinZ) * SizeX - MinX;
+			if(!bBrick)
+			{
+				std::fill(Row + BeginX, Row + EndX + 1, Fill);
+				continue;
+			}
+
+			const FBrick& Brick = GetBrick(Cell);
+			for(int32 X = BeginX; X <= EndX; X++)
+			{
+				Row[X] = SampleBrickCell(Brick, (X & CellMask) * Scale, (Y & CellMask) * Scale, (Z & CellMask) * Scale, Scale);
+			}
+		}
+	}
+}
+
+bool FBrickMap::Raycast(const float Origin[3], const float Direction[3], float MaxDistance, FBrickMapHit& OutHit) const
+{
+	const float Infinity = std::numeric_limits<float>::infinity();
+
+	int32 Step[3];
+	int32 CellPos[3];
+	float CellNext[3];
+	float CellDelta[3];
+	for(int32 Axis = 0; Axis < 3; Axis++)
+	{
+		Step[Axis] = Direction[Axis] > 0.0f ? 1 : (Direction[Axis] < 0.0f ? -1 : 0);
+		CellPos[Axis] = FloorToInt(Origin[Axis] / BrickSize);
+		CellDelta[Axis] = Step[Axis] ? BrickSize / std::fabs(Direction[Axis]) : Infinity;
+
+		const float Boundary = (float)((CellPos[Axis] + (Step[Axis] > 0 ? 1 : 0)) * BrickSize);
+		CellNext[Axis] = Step[Axis] ? (Boundary - Origin[Axis]) / Direction[Axis] : Infinity;
+	}
+
+	// Distance the ray entered the current cell at, and the axis it crossed to get there.
+	float Distance = 0.0f;
+	int32 EnterAxis = -1;
+	while(Distance <= MaxDistance)
+	{
+		const uint32 Cell = GetCell(CellPos[0], CellPos[1], CellPos[2]);
+		if(Cell != EmptyCell)
+		{
+			// Voxel the ray enters the cell at, clamped against rounding at the cell edge.
+			int32 Voxel[3];
+			float VoxelNext[3];
+			for(int32 Axis = 0; Axis < 3; Axis++)
+			{
+				const int32 CellMin = CellPos[Axis] * BrickSize;
+				Voxel[Axis] = std::min(std::max(FloorToInt(Origin[Axis] + Direction[Axis] * Distance), CellMin), CellMin + BrickSize - 1);
+
+				const float Boundary = (float)(Voxel[Axis] + (Step[Axis] > 0 ? 1 : 0));
+				VoxelNext[Axis] = Step[Axis] ? (Boundary - Origin[Axis]) / Direction[Axis] : Infinity;
+			}
+
+			const FBrick* Brick = (Cell & UniformCellFlag) ? nullptr : &GetBrick(Cell);
+			float VoxelDistance = Distance;
+			int32 VoxelAxis = EnterAxis;
+			for(;;)
+			{
+				const int32 Index = FBrick::ToIndex(Voxel[0] & (BrickSize - 1), Voxel[1] & (BrickSize - 1), Voxel[2] & (BrickSize - 1));
+				if(!Brick || Brick->IsSolid(Index))
+				{
+					OutHit.X = Voxel[0];
+					OutHit.Y = Voxel[1];
+					OutHit.Z = Voxel[2];
+					for(int32 Axis = 0; Axis < 3; Axis++)
+					{
+						OutHit.Normal[Axis] = Axis == VoxelAxis ? -Step[Axis] : 0;
+					}
+					OutHit.BlockId = Brick ? Brick->Get(Index) : (FBlockId)Cell;
+					OutHit.Distance = VoxelDistance;
+					return true;
+				}
+
+				VoxelAxis = VoxelNext[0] < VoxelNext[1] ? (VoxelNext[0] < VoxelNext[2] ? 0 : 2) : (VoxelNext[1] < VoxelNext[2] ? 1 : 2);
+				VoxelDistance = VoxelNext[VoxelAxis];
+				Voxel[VoxelAxis] += Step[VoxelAxis];
+				if(VoxelDistance > MaxDistance || (Voxel[VoxelAxis] >> BrickSizeLog2) != CellPos[VoxelAxis])
+				{
+					break;
+				}
+				VoxelNext[VoxelAxis] += std::fabs(1.0f / Direction[VoxelAxis]);
+			}
+		}
+
+		EnterAxis = CellNext[0] < CellNext[1] ? (CellNext[0] < CellNext[2] ? 0 : 2) : (CellNext[1] < CellNext[2] ? 1 : 2);
+		Distance = CellNext[EnterAxis];
+		CellPos[EnterAxis] += Step[EnterAxis];
+		CellNext[EnterAxis] += CellDelta[EnterAxis];
+	}
+	return false;
+}
+
+uint32 FBrickMap::GetCell(int32 BrickX, int32 BrickY, int32 BrickZ) const
+{
+	const int32 Shift = ChunkSizeLog2 - BrickSizeLog2;
+	if(FindSlot(BrickX >> Shift, BrickY >> Shift, BrickZ >> Shift) < 0)
+	{
+		return EmptyCell;
+	}
+	return Cells[ToCellIndex(BrickX, BrickY, BrickZ)];
+}
+
+uint64 FBrickMap::GetMemoryUsage() const
+{
+	return sizeof(*this)
+		+ Cells.size() * sizeof(uint32)
+		+ Slots.size() * sizeof(FChunkSlot)
+		+ Pages.size() * (BricksPerPage * sizeof(FBrick) + sizeof(Pages[0]))
+		+ FreeBricks.capacity() * sizeof(uint32);
+}
+
+uint64 FBrickMap::GetUsedBytes() const
+{
+	return (uint64)NumChunks * ChunkBrickCount * sizeof(uint32) + (uint64)NumBricks * sizeof(FBrick);
+}
+
+int32 FBrickMap::FindSlot(int32 X, int32 Y, int32 Z) const
+{
+	const int32 SlotIndex = ToSlotIndex(X, Y, Z);
+	return Slots[SlotIndex].Key == FChunkMap::PackKey(X, Y, Z) ? SlotIndex : -1;
+}
+
+void FBrickMap::EvictSlot(int32 SlotIndex)
+{
+	FChunkSlot& Slot = Slots[SlotIndex];
+	int32 X, Y, Z;
+	FChunkMap::UnpackKey(Slot.Key, X, Y, Z);
+
+	for(int32 BrickY = Y * BricksPerChunk; BrickY < (Y + 1) * BricksPerChunk; BrickY++)
+	for(int32 BrickZ = Z * BricksPerChunk; BrickZ < (Z + 1) * BricksPerChunk; BrickZ++)
+	for(int32 BrickX = X * BricksPerChunk; BrickX < (X + 1) * BricksPerChunk; BrickX++)
+	{
+		uint32& Cell = Cells[ToCellIndex(BrickX, BrickY, BrickZ)];
+		if(Cell != EmptyCell && !(Cell & UniformCellFlag))
+		{
+			FreeBricks.push_back(Cell - 1);
+		}
+		Cell = EmptyCell;
+	}
+
+	NumBricks -= Slot.NumBricks;
+	NumChunks--;
+	Unlink(SlotIndex);
+	Slot.Key = NoChunk;
+	Slot.NumBricks = 0;
+}
+
+void FBrickMap::LinkFront(int32 SlotIndex)
+{
+	FChunkSlot& Slot = Slots[SlotIndex];
+	Slot.Prev = -1;
+	Slot.Next = LruHead;
+	if(LruHead >= 0)
+	{
+		Slots[LruHead].Prev = SlotIndex;
+	}
+	else
+	{
+		LruTail = SlotIndex;
+	}
+	LruHead = SlotIndex;
+}
+
+void FBrickMap::Unlink(int32 SlotIndex)
+{
+	FChunkSlot& Slot = Slots[SlotIndex];
+	if(Slot.Prev >= 0)
+	{
+		Slots[Slot.Prev].Next = Slot.Next;
+	}
+	else
+	{
+		LruHead = Slot.Next;
+	}
+
+	if(Slot.Next >= 0)
+	{
+		Slots[Slot.Next].Prev = Slot.Prev;
+	}
+	else
+	{
+		LruTail = Slot.Prev;
+	}
+	Slot.Prev = -1;
+	Slot.Next = -1;
+}
+
+uint32 FBrickMap::AllocateBrick()
+{
+	if(!FreeBricks.empty())
+	{
+		const uint32 Index = FreeBricks.back();
+		FreeBricks.pop_back();
+		return Index;
+	}
+
+	if(NumAllocatedBricks % BricksPerPage == 0)
+	{
+		Pages.emplace_back(new FBrick[BricksPerPage]);
+	}
+	return NumAllocatedBricks++;
+}
@@ -0,0 +1,259 @@
+// Copyright Snaps 2022, All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "VoxelTypes.h"
+#include <memory>
+#include <vector>
+
+class FVoxelChunk;
+
+static const int32 BrickSizeLog2 	= 3;
+static const int32 BrickSize 		= 1 << BrickSizeLog2; 			// 8 voxels along each axis.
+static const int32 BrickVolume 		= BrickSize * BrickSize * BrickSize;
+static const int32 BricksPerChunk 	= ChunkSize / BrickSize; 		// Along each axis.
+static const int32 ChunkBrickCount 	= BricksPerChunk * BricksPerChunk * BricksPerChunk;
+
+/*
+	One 8^3 block of voxels that isn't all one block id. Voxels are laid out X
+	fastest, then Z, then Y like chunks, so Occupancy[Y] is the XZ plane at
+	height Y with one bit per solid voxel. Block ids are 4 bit indices into a
+	palette sorted by how common each id is, Palette[0] is the brick's most
+	common solid block.
+
+	Bricks with more than 16 block types keep the 16 most common and store
+	everything else as Palette[0]. Occupancy is always exact.
+*/
+struct FBrick
+{
+	uint64 		Occupancy[BrickSize];
+	FBlockId 	Palette[16];
+	uint8 		Indices[BrickVolume / 2];
+
+	static int32 ToIndex(int32 X, int32 Y, int32 Z)
+	{
+		return X | (Z << BrickSizeLog2) | (Y << (BrickSizeLog2 * 2));
+	}
+
+	bool IsSolid(int32 Index) const
+	{
+		return (Occupancy[Index >> 6] >> (Index & 63)) & 1;
+	}
+
+	FBlockId Get(int32 Index) const
+	{
+		return IsSolid(Index) ? Palette[(Indices[Index >> 1] >> ((Index & 1) * 4)) & 15] : BlockAir;
+	}
+};
+
+/*
+	A chunk converted to bricks, ready to go into a brick map. Cells are in
+	FBrickMap's cell format except that brick cells index Bricks here.
+*/
+struct FBrickMapChunk
+{
+	uint32 					Cells[ChunkBrickCount];
+	std::vector<FBrick> 	Bricks;
+};
+
+/*
+	Hit returned by FBrickMap::Raycast. Normal is the face of the voxel the ray
+	came in through, zero if the ray started inside a solid voxel.
+*/
+struct FBrickMapHit
+{
+	int32 		X, Y, Z;
+	int32 		Normal[3];
+	FBlockId 	BlockId;
+	float 		Distance;
+};
+
+/*
+	Two level brick map for the far field, a flat grid of cells over a window of
+	the world and a pool of 8^3 bricks the cells point into. A cell is either
+	empty, a single block id for a brick of all one block, or the index of a
+	brick. Most of a terrain is empty or solid underground, so only the bricks
+	along the surface cost anything. This is the layout a GPU ray marcher wants
+	as is (upload the cells and the brick pages as two buffers), and what LOD
+	meshing samples instead of the full chunks.
+
+	The grid wraps around: a chunk goes into the cells at its coordinates modulo
+	the grid size, and evicts whatever chunk was there. Chunks are added and
+	replaced one at a time as they load or change. Brick memory is kept under a
+	budget by evicting the least recently used chunks, Touch the chunks that are
+	still in view to keep them.
+
+	Converting a chunk (BuildChunk) is safe on any thread, everything else is
+	single threaded.
+*/
+class FBrickMap
+{
+public:
+
+	// Cell values. Anything else is a brick index + 1.
+	static const uint32 EmptyCell 		= 0;
+	static const uint32 UniformCellFlag = 0x80000000u; 	// Low 16 bits are the block id.
+
+	static const uint32 BricksPerPage 	= 1024;
+
+	// The grid covers 2^WidthChunksLog2 chunks along X and Z and 2^HeightChunksLog2 along Y.
+	// BudgetBytes is for the whole map, grid included.
+	FBrickMap(uint64 InBudgetBytes, int32 InWidthChunksLog2 = 6, int32 InHeightChunksLog2 = 3);
+	~FBrickMap();
+
+	FBrickMap(const FBrickMap&) = delete;
+	FBrickMap& operator=(const FBrickMap&) = delete;
+
+	// Converts a chunk to bricks. Safe on any thread, OutChunk can be reused between calls.
+	static void BuildChunk(const FVoxelChunk& Chunk, FBrickMapChunk& OutChunk);
+
+	// Adds or replaces a chunk, evicting the least recently used ones to make room.
+	// Returns false if the chunk alone needs more bricks than the budget allows.
+	bool AddChunk(int32 X, int32 Y, int32 Z, const FBrickMapChunk& Chunk);
+
+	// BuildChunk then AddChunk, on the calling thread.
+	bool AddChunk(int32 X, int32 Y, int32 Z, const FVoxelChunk& Chunk);
+
+	void RemoveChunk(int32 X, int32 Y, int32 Z);
+
+	// Marks a chunk as used so it's the last to be evicted. Does nothing if it isn't in the map.
+	void Touch(int32 X, int32 Y, int32 Z);
+
+	bool HasChunk(int32 X, int32 Y, int32 Z) const
+	{
+		return FindSlot(X, Y, Z) >= 0;
+	}
+
+	// World voxel coordinates, air outside the chunks in the map.
+	FBlockId GetBlock(int32 X, int32 Y, int32 Z) const;
+
+	// Fills a SizeX * SizeY * SizeZ box of blocks starting at Min, laid out X fastest then Z then Y.
+	// Much faster than GetBlock per voxel. Voxels outside the chunks in the map are air.
+	void CopyBlocks(int32 MinX, int32 MinY, int32 MinZ, int32 SizeX, int32 SizeY, int32 SizeZ, FBlockId* OutBlocks) const;
+
+	// Downsampled blocks for LOD meshing, one per cell of 2^Lod voxels along each axis. Min and Size are in
+	// cells, layout as in CopyBlocks. A cell is solid if at least half its voxels are, and takes the block
+	// most common on the top of its solid voxels so grass stays grass from a distance.
+	void SampleLod(int32 MinX, int32 MinY, int32 MinZ, int32 SizeX, int32 SizeY, int32 SizeZ, int32 Lod, FBlockId* OutBlocks) const;
+
+	// Finds the first solid voxel along a ray, Direction must be normalized. Steps over empty and
+	// missing cells a whole cell at a time, the same traversal a GPU ray marcher does.
+	bool Raycast(const float Origin[3], const float Direction[3], float MaxDistance, FBrickMapHit& OutHit) const;
+
+	// Cell of a world brick coordinate, EmptyCell if its chunk isn't in the map.
+	uint32 GetCell(int32 BrickX, int32 BrickY, int32 BrickZ) const;
+
+	const FBrick& GetBrick(uint32 Cell) const
+	{
+		const uint32 Index = Cell - 1;
+		return Pages[Index / BricksPerPage][Index % BricksPerPage];
+	}
+
+	// Raw cells in grid order, X fastest then Z then Y, and the brick pages, for uploading to the GPU.
+	const std::vector<uint32>& GetCells() const
+	{
+		return Cells;
+	}
+
+	uint32 GetNumPages() const
+	{
+		return (uint32)Pages.size();
+	}
+
+	const FBrick* GetPage(uint32 Page) const
+	{
+		return Pages[Page].get();
+	}
+
+	uint32 GetNumChunks() const
+	{
+		return NumChunks;
+	}
+
+	uint32 GetNumBricks() const
+	{
+		return NumBricks;
+	}
+
+	uint32 GetMaxBricks() const
+	{
+		return MaxBricks;
+	}
+
+	uint64 GetNumEvictions() const
+	{
+		return NumEvictions;
+	}
+
+	// Bytes allocated for the grid, chunk slots and brick pages.
+	uint64 GetMemoryUsage() const;
+
+	// Bytes the map would need for the chunks and bricks it holds if nothing was preallocated.
+	uint64 GetUsedBytes() const;
+
+private:
+
+	static const uint64 NoChunk = ~0ull;
+
+	// One per grid chunk, the chunk it holds and its place in the LRU list.
+	struct FChunkSlot
+	{
+		uint64 		Key 		= NoChunk;
+		int32 		Prev 		= -1;
+		int32 		Next 		= -1;
+		uint32 		NumBricks 	= 0;
+	};
+
+	int32 ToSlotIndex(int32 X, int32 Y, int32 Z) const
+	{
+		return (X & WidthMask) | ((Z & WidthMask) << WidthChunksLog2) | ((Y & HeightMask) << (WidthChunksLog2 * 2));
+	}
+
+	uint32 ToCellIndex(int32 BrickX, int32 BrickY, int32 BrickZ) const
+	{
+		return (uint32)(BrickX & CellWidthMask)
+			| ((uint32)(BrickZ & CellWidthMask) << CellWidthLog2)
+			| ((uint32)(BrickY & CellHeightMask) << (CellWidthLog2 * 2));
+	}
+
+	// Slot holding chunk X, Y, Z, or -1 if the chunk isn't in the map.
+	int32 FindSlot(int32 X, int32 Y, int32 Z) const;
+
+	// Frees the chunk's bricks, clears its cells and unlinks it.
+	void EvictSlot(int32 SlotIndex);
+
+	void LinkFront(int32 SlotIndex);
+	void Unlink(int32 SlotIndex);
+
+	uint32 AllocateBrick();
+
+	FBrick& GetMutableBrick(uint32 Cell)
+	{
+		const uint32 Index = Cell - 1;
+		return Pages[Index / BricksPerPage][Index % BricksPerPage];
+	}
+
+	int32 								WidthChunksLog2;
+	int32 								WidthMask;
+	int32 								HeightMask;
+	int32 								CellWidthLog2;
+	int32 								CellWidthMask;
+	int32 								CellHeightMask;
+
+	std::vector<uint32> 				Cells;
+	std::vector<FChunkSlot> 			Slots;
+	std::vector<std::unique_ptr<FBrick[]>> Pages;
+	std::vector<uint32> 				FreeBricks; 	// Brick indices, not cells.
+	uint32 								NumAllocatedBricks;
+
+	int32 								LruHead; 		// Most recently used.
+	int32 								LruTail;
+
+	uint32 								NumChunks;
+	uint32 								NumBricks;
+	uint32 								MaxBricks;
+	uint64 								NumEvictions;
+
+	FBrickMapChunk 						Scratch;
+};
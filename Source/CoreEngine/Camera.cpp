@@ -0,0 +1,83 @@
+// Copyright Snaps 2022, All Rights Reserved.
+
+#include "Camera.h"
+#include <cmath>
+
+void FCamera::GetViewProjection(float AspectRatio, float OutMatrix[16]) const
+{
+	// Camera basis, right handed with the camera looking down its -Z.
+	const double Forward[3] = {
+		std::cos(Pitch) * std::sin(Yaw),
+		std::sin(Pitch),
+		-std::cos(Pitch) * std::cos(Yaw)
+	};
+	const double Right[3] = { std::cos(Yaw), 0.0, std::sin(Yaw) };
+	const double Up[3] = {
+		Right[1] * Forward[2] - Right[2] * Forward[1],
+		Right[2] * Forward[0] - Right[0] * Forward[2],
+		Right[0] * Forward[1] - Right[1] * Forward[0]
+	};
+
+	// Rows of the view matrix, translation folded into the last column.
+	double View[3][4];
+	for(int32 Axis = 0; Axis < 3; Axis++)
+	{
+		View[0][Axis] = Right[Axis];
+		View[1][Axis] = Up[Axis];
+		View[2][Axis] = -Forward[Axis];
+	}
+	for(int32 Row = 0; Row < 3; Row++)
+	{
+		View[Row][3] = -(View[Row][0] * X + View[Row][1] * Y + View[Row][2] * Z);
+	}
+
+	// Y is flipped for Vulkan's clip space, depth maps near to 0 and far to 1.
+	const double Focal = 1.0 / std::tan(FieldOfViewY * 0.5);
+	const double DepthScale = FarPlane / (NearPlane - FarPlane);
+	const double DepthOffset = NearPlane * FarPlane / (NearPlane - FarPlane);
+
+	for(int32 Column = 0; Column < 4; Column++)
+	{
+		const double W = Column == 3 ? 1.0 : 0.0;
+		OutMatrix[Column * 4 + 0] = (float)(Focal / AspectRatio * View[0][Column]);
+		OutMatrix[Column * 4 + 1] = (float)(-Focal * View[1][Column]);
+		OutMatrix[Column * 4 + 2] = (float)(DepthScale * View[2][Column] + DepthOffset * W);
+		OutMatrix[Column * 4 + 3] = (float)(-View[2][Column]);
+	}
+}
+
+FFrustum::FFrustum(const float ViewProjection[16])
+{
+	// Clip space bounds are -W <= X, Y <= W and 0 <= Z <= W, each one is a combination of the matrix rows.
+	const auto Row = [ViewProjection](int32 Index, int32 Column)
+	{
+		return ViewProjection[Column * 4 + Index];
+	};
+
+	for(int32 Column = 0; Column < 4; Column++)
+	{
+		Planes[0][Column] = Row(3, Column) + Row(0, Column);
+		Planes[1][Column] = Row(3, Column) - Row(0, Column);
+		Planes[2][Column] = Row(3, Column) + Row(1, Column);
+		Planes[3][Column] = Row(3, Column) - Row(1, Column);
+		Planes[4][Column] = Row(2, Column);
+		Planes[5][Column] = Row(3, Column) - Row(2, Column);
+	}
+}
+
+bool FFrustum::IntersectsBox(const float Min[3], const float Max[3]) const
+{
+	// Outside if the corner furthest along a plane's normal is still behind it.
+	for(const float* Plane : Planes)
+	{
+		const float Distance = Plane[0] * (Plane[0] > 0.f ? Max[0] : Min[0])
+			+ Plane[1] * (Plane[1] > 0.f ? Max[1] : Min[1])
+			+ Plane[2] * (Plane[2] > 0.f ? Max[2] : Min[2])
+			+ Plane[3];
+		if(Distance < 0.f)
+		{
+			return false;
+		}
+	}
+	return true;
+}
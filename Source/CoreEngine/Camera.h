@@ -0,0 +1,40 @@
+// Copyright Snaps 2022, All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+/*
+	Perspective camera in world units, Y up. Yaw turns around Y with 0 looking
+	down -Z, pitch tilts up from the horizon. The position is kept in doubles
+	so the view matrix is built relative to it without losing precision far
+	from the origin.
+*/
+struct FCamera
+{
+	double 	X 				= 0.0;
+	double 	Y 				= 0.0;
+	double 	Z 				= 0.0;
+	float 	Yaw 			= 0.f;		// Radians.
+	float 	Pitch 			= 0.f;		// Radians, positive looks up.
+	float 	FieldOfViewY 	= 1.2f;		// Radians, about 70 degrees.
+	float 	NearPlane 		= 0.1f;
+	float 	FarPlane 		= 1000.f;
+
+	// Column major world to Vulkan clip space (Y down, depth 0 near to 1 far), what the chunk pipeline takes.
+	void GetViewProjection(float AspectRatio, float OutMatrix[16]) const;
+};
+
+/*
+	View frustum as six inward facing planes pulled out of a view projection
+	matrix, for culling boxes before they're drawn.
+*/
+struct FFrustum
+{
+	explicit FFrustum(const float ViewProjection[16]);
+
+	// Conservative, boxes near a frustum corner can pass without being on screen.
+	bool IntersectsBox(const float Min[3], const float Max[3]) const;
+
+	float 	Planes[6][4];	// A X + B Y + C Z + D >= 0 inside.
+};
@@ -0,0 +1,230 @@
+// Copyright Snaps 2022, All Rights Reserved.
+
+#include "ChunkMap.h"
+
+// Bricks, empty ones included, may fill at most this share of the slots before the table is rebuilt.
+static const uint64 MaxLoadNumerator = 1;
+static const uint64 MaxLoadDenominator = 2;
+
+FChunkMap::FChunkMap(uint32 InitialCapacity)
+	: NumChunks(0)
+{
+	// InitialCapacity is in chunks, assume they come in full bricks.
+	uint64 Capacity = 16;
+	while(Capacity * BrickSize * MaxLoadNumerator < (uint64)InitialCapacity * MaxLoadDenominator)
+	{
+		Capacity <<= 1;
+	}
+	CurrentTable.store(CreateTable(Capacity), std::memory_order_relaxed);
+}
+
+FChunkMap::~FChunkMap()
+{
+	delete CurrentTable.load(std::memory_order_relaxed);
+}
+
+FChunkMap::FTable* FChunkMap::CreateTable(uint64 Capacity)
+{
+	FTable* Table = new FTable();
+	Table->Mask = Capacity - 1;
+	Table->Bricks.reset(new FBrick[Capacity]);
+	for(uint64 Index = 0; Index < Capacity; Index++)
+	{
+		FBrick& Brick = Table->Bricks[Index];
+		Brick.Key.store(EmptyKey, std::memory_order_relaxed);
+		for(std::atomic<FVoxelChunk*>& Chunk : Brick.Chunks)
+		{
+			Chunk.store(nullptr, std::memory_order_relaxed);
+		}
+	}
+	return Table;
+}
+
+FVoxelChunk* FChunkMap::FindKey(uint64 Key) const
+{
+	const FBrick* Brick = FindBrick(*CurrentTable.load(std::memory_order_acquire), Key >> 3);
+	return Brick ? Brick->Chunks[Key & 7].load(std::memory_order_acquire) : nullptr;
+}
+
+void FChunkMap::GatherNeighbours(int32 X, int32 Y, int32 Z, FVoxelChunk* OutChunks[27]) const
+{
+	// Spread each axis once, the 27 keys are then just ORs of the 9 spread coordinates.
+	const uint32 LowX = (uint32)(X - 1 - MinCoord);
+	const uint32 LowY = (uint32)(Y - 1 - MinCoord);
+	const uint32 LowZ = (uint32)(Z - 1 - MinCoord);
+
+	uint64 SpreadX[3], SpreadY[3], SpreadZ[3];
+	for(uint32 Delta = 0; Delta < 3; Delta++)
+	{
+		SpreadX[Delta] = BitMath::SpreadBits3(LowX + Delta);
+		SpreadY[Delta] = BitMath::SpreadBits3(LowY + Delta) << 2;
+		SpreadZ[Delta] = BitMath::SpreadBits3(LowZ + Delta) << 1;
+	}
+
+	// 3 chunks along an axis span exactly 2 bricks, the low one holds delta 0 and the high one delta 2.
+	// Fetch each of the 8 bricks once, all from one table so a rebuild midway can't mix two.
+	const FTable& Table = *CurrentTable.load(std::memory_order_acquire);
+	const FBrick* Bricks[8];
+	for(uint32 Brick = 0; Brick < 8; Brick++)
+	{
+		const uint64 Corner = SpreadX[(Brick & 1) * 2] | SpreadZ[Brick & 2] | SpreadY[(Brick & 4) / 2];
+		Bricks[Brick] = FindBrick(Table, Corner >> 3);
+	}
+
+	// Which of the two bricks along an axis each delta falls in, pre-scaled into the Bricks index.
+	uint32 BrickX[3], BrickY[3], BrickZ[3];
+	for(uint32 Delta = 0; Delta < 3; Delta++)
+	{
+		BrickX[Delta] = ((LowX + Delta) >> 1) - (LowX >> 1);
+		BrickZ[Delta] = (((LowZ + Delta) >> 1) - (LowZ >> 1)) * 2;
+		BrickY[Delta] = (((LowY + Delta) >> 1) - (LowY >> 1)) * 4;
+	}
+
+	for(uint32 DeltaY = 0; DeltaY < 3; DeltaY++)
+	for(uint32 DeltaZ = 0; DeltaZ < 3; DeltaZ++)
+	for(uint32 DeltaX = 0; DeltaX < 3; DeltaX++)
+	{
+		const FBrick* Brick = Bricks[BrickX[DeltaX] + BrickZ[DeltaZ] + BrickY[DeltaY]];
+		const uint64 Offset = (SpreadX[DeltaX] | SpreadY[DeltaY] | SpreadZ[DeltaZ]) & 7;
+		OutChunks[DeltaX + DeltaZ * 3 + DeltaY * 9] = Brick ? Brick->Chunks[Offset].load(std::memory_order_acquire) : nullptr;
+	}
+}
+
+FChunkMap::FBrick* FChunkMap::FindOrAddBrick(uint64 BrickKey, bool bAddIfMissing)
+{
+	FTable* Table = CurrentTable.load(std::memory_order_relaxed);
+	for(uint64 Index = HashBrick(BrickKey) & Table->Mask; ; Index = (Index + 1) & Table->Mask)
+	{
+		FBrick& Brick = Table->Bricks[Index];
+		const uint64 SlotKey = Brick.Key.load(std::memory_order_relaxed);
+		if(SlotKey == BrickKey)
+		{
+			return &Brick;
+		}
+
+		if(SlotKey == EmptyKey)
+		{
+			if(!bAddIfMissing)
+			{
+				return nullptr;
+			}
+
+			// The slot's chunks are all still null, publishing the key makes an empty brick visible.
+			Brick.Key.store(BrickKey, std::memory_order_release);
+			NumBricks++;
+			return &Brick;
+		}
+	}
+}
+
+FVoxelChunk* FChunkMap::Insert(int32 X, int32 Y, int32 Z, FVoxelChunk* Chunk)
+{
+	std::lock_guard<std::mutex> Lock(WriteMutex);
+
+	const uint64 Key = PackKey(X, Y, Z);
+
+	// Make room first so the brick is added to the table it ends up in.
+	const uint64 Capacity = CurrentTable.load(std::memory_order_relaxed)->Mask + 1;
+	if((NumBricks + 1) * MaxLoadDenominator > Capacity * MaxLoadNumerator)
+	{
+		Rehash(Capacity);
+	}
+
+	FBrick* Brick = FindOrAddBrick(Key >> 3, true);
+	FVoxelChunk* Previous = Brick->Chunks[Key & 7].exchange(Chunk, std::memory_order_acq_rel);
+	if(!Previous)
+	{
+		NumChunks.fetch_add(1, std::memory_order_relaxed);
+	}
+	return Previous;
+}
+
+FVoxelChunk* FChunkMap::Remove(int32 X, int32 Y, int32 Z)
+{
+	std::lock_guard<std::mutex> Lock(WriteMutex);
+
+	const uint64 Key = PackKey(X, Y, Z);
+	FBrick* Brick = FindOrAddBrick(Key >> 3, false);
+	if(!Brick)
+	{
+		return nullptr;
+	}
+
+	// The brick stays, even empty, so probes for bricks past it keep working. Rehash drops it.
+	FVoxelChunk* Previous = Brick->Chunks[Key & 7].exchange(nullptr, std::memory_order_acq_rel);
+	if(Previous)
+	{
+		NumChunks.fetch_sub(1, std::memory_order_relaxed);
+	}
+	return Previous;
+}
+
+static bool HasChunks(const std::atomic<FVoxelChunk*>* Chunks, uint32 NumChunks)
+{
+	for(uint32 Index = 0; Index < NumChunks; Index++)
+	{
+		if(Chunks[Index].load(std::memory_order_relaxed))
+		{
+			return true;
+		}
+	}
+	return false;
+}
+
+void FChunkMap::Rehash(uint64 Capacity)
+{
+	FTable* OldTable = CurrentTable.load(std::memory_order_relaxed);
+
+	// Only bricks with chunks in them move over.
+	uint64 NumLiveBricks = 0;
+	for(uint64 Index = 0; Index <= OldTable->Mask; Index++)
+	{
+		const FBrick& Brick = OldTable->Bricks[Index];
+		if(Brick.Key.load(std::memory_order_relaxed) != EmptyKey && HasChunks(Brick.Chunks, BrickSize))
+		{
+			NumLiveBricks++;
+		}
+	}
+
+	// Double until the live bricks fill at most half the load limit, so a rebuild that only clears
+	// out empty bricks still leaves room for as many new ones again.
+	while((NumLiveBricks + 1) * MaxLoadDenominator * 2 > Capacity * MaxLoadNumerator)
+	{
+		Capacity <<= 1;
+	}
+
+	FTable* NewTable = CreateTable(Capacity);
+	for(uint64 OldIndex = 0; OldIndex <= OldTable->Mask; OldIndex++)
+	{
+		const FBrick& OldBrick = OldTable->Bricks[OldIndex];
+		const uint64 BrickKey = OldBrick.Key.load(std::memory_order_relaxed);
+		if(BrickKey == EmptyKey || !HasChunks(OldBrick.Chunks, BrickSize))
+		{
+			continue;
+		}
+
+		uint64 Index = HashBrick(BrickKey) & NewTable->Mask;
+		while(NewTable->Bricks[Index].Key.load(std::memory_order_relaxed) != EmptyKey)
+		{
+			Index = (Index + 1) & NewTable->Mask;
+		}
+
+		FBrick& NewBrick = NewTable->Bricks[Index];
+		NewBrick.Key.store(BrickKey, std::memory_order_relaxed);
+		for(uint32 Offset = 0; Offset < BrickSize; Offset++)
+		{
+			NewBrick.Chunks[Offset].store(OldBrick.Chunks[Offset].load(std::memory_order_relaxed), std::memory_order_relaxed);
+		}
+	}
+
+	// Readers still probing the old table finish there, it stays alive until reclaimed.
+	CurrentTable.store(NewTable, std::memory_order_release);
+	RetiredTables.emplace_back(OldTable);
+	NumBricks = NumLiveBricks;
+}
+
+void FChunkMap::ReclaimRetiredTables()
+{
+	std::lock_guard<std::mutex> Lock(WriteMutex);
+	RetiredTables.clear();
+}
@@ -0,0 +1,242 @@
+// Copyright Snaps 2022, All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "BitMath.h"
+#include <algorithm>
+#include <atomic>
+#include <mutex>
+#include <vector>
+
+class FVoxelChunk;
+
+/*
+	Sparse map from chunk coordinates to chunks, for the loaded part of the
+	world. Chunk coordinates pack into a 63 bit key, the Morton code of the
+	coordinate (21 bits per axis), so the top 60 bits of a key name the 2x2x2
+	brick of chunks it is in and the low 3 bits its place in the brick.
+
+	The table is open addressed with linear probing over bricks rather than
+	chunks, each slot holds a brick's key and its 8 chunk pointers. A 3x3x3
+	neighbourhood always spans exactly 8 bricks, so GatherNeighbours does 8
+	probes where a map of chunks would do 27, and the chunks of a brick share
+	a cache line or two.
+
+	Any number of threads may read while one thread at a time writes (writers
+	are serialized internally). Bricks never leave a table once published,
+	removing a chunk only clears its pointer, so a reader can never see a slot
+	change owner under it. Empty bricks are dropped when the table is rebuilt.
+	Rebuilding publishes a new table and keeps the old one around for readers
+	that are still on it, until ReclaimRetiredTables is called at a point no
+	reads can be in flight.
+
+	The map doesn't own chunks. Removed chunks may still be in the hands of
+	readers, free them the same way the engine frees anything else readers or
+	the GPU might still be using (a frame later).
+*/
+class FChunkMap
+{
+public:
+
+	// Chunk coordinates must lie in [MinCoord, MaxCoord] on every axis.
+	static const int32 CoordBits 	= 21;
+	static const int32 MinCoord 	= -(1 << (CoordBits - 1));
+	static const int32 MaxCoord 	= (1 << (CoordBits - 1)) - 1;
+
+	// Neighbourhood order used by GatherNeighbours, X fastest then Z then Y like voxels.
+	static int32 NeighbourIndex(int32 DeltaX, int32 DeltaY, int32 DeltaZ)
+	{
+		return (DeltaX + 1) + (DeltaZ + 1) * 3 + (DeltaY + 1) * 9;
+	}
+
+	explicit FChunkMap(uint32 InitialCapacity = 1024);
+	~FChunkMap();
+
+	FChunkMap(const FChunkMap&) = delete;
+	FChunkMap& operator=(const FChunkMap&) = delete;
+
+	// Packed key of a chunk coordinate, also its Morton code. Sorting keys sorts chunks in Morton order.
+	static uint64 PackKey(int32 X, int32 Y, int32 Z)
+	{
+		return BitMath::MortonEncode3((uint32)(X - MinCoord), (uint32)(Y - MinCoord), (uint32)(Z - MinCoord));
+	}
+
+	static void UnpackKey(uint64 Key, int32& OutX, int32& OutY, int32& OutZ)
+	{
+		uint32 X, Y, Z;
+		BitMath::MortonDecode3(Key, X, Y, Z);
+		OutX = (int32)X + MinCoord;
+		OutY = (int32)Y + MinCoord;
+		OutZ = (int32)Z + MinCoord;
+	}
+
+	// Lock free, safe from any thread. Returns nullptr if the chunk isn't loaded.
+	FVoxelChunk* Find(int32 X, int32 Y, int32 Z) const
+	{
+		return FindKey(PackKey(X, Y, Z));
+	}
+
+	FVoxelChunk* FindKey(uint64 Key) const;
+
+	// Fetches the chunk at X, Y, Z and its 26 neighbours into OutChunks, in NeighbourIndex order.
+	// Missing chunks come back as nullptr. Lock free, safe from any thread.
+	void GatherNeighbours(int32 X, int32 Y, int32 Z, FVoxelChunk* OutChunks[27]) const;
+
+	// Adds or replaces the chunk at X, Y, Z. Returns the chunk that was there before, if any.
+	FVoxelChunk* Insert(int32 X, int32 Y, int32 Z, FVoxelChunk* Chunk);
+
+	// Returns the removed chunk, or nullptr if there wasn't one.
+	FVoxelChunk* Remove(int32 X, int32 Y, int32 Z);
+
+	// Calls Function(X, Y, Z, Chunk) for every loaded chunk inside the inclusive box, in Morton order
+	// so consecutive chunks are close together in space and in the table. Safe alongside writers,
+	// chunks inserted or removed during the walk may or may not be visited.
+	template<typename FunctionType>
+	void ForEachInBox(int32 MinX, int32 MinY, int32 MinZ, int32 MaxX, int32 MaxY, int32 MaxZ, const FunctionType& Function) const;
+
+	// Calls Function(X, Y, Z, Chunk) for every loaded chunk, in table order.
+	template<typename FunctionType>
+	void ForEach(const FunctionType& Function) const;
+
+	uint32 GetSize() const
+	{
+		return NumChunks.load(std::memory_order_relaxed);
+	}
+
+	// Chunks the current table has room for before it has to grow, if they were packed into full bricks.
+	uint32 GetCapacity() const
+	{
+		return (uint32)((CurrentTable.load(std::memory_order_acquire)->Mask + 1) * BrickSize / 2);
+	}
+
+	// Frees tables replaced by rebuilding. Only call when no thread can be inside a read.
+	void ReclaimRetiredTables();
+
+private:
+
+	static const uint32 BrickSize = 8;
+
+	// Brick keys are 60 bit, so an all ones key can't clash with a real one.
+	static const uint64 EmptyKey = ~0ull;
+
+	// Key is published while every chunk is still null, chunks are then set and cleared in place.
+	struct FBrick
+	{
+		std::atomic<uint64> 		Key;
+		std::atomic<FVoxelChunk*> 	Chunks[BrickSize];
+	};
+
+	struct FTable
+	{
+		uint64 						Mask;
+		std::unique_ptr<FBrick[]> 	Bricks;
+	};
+
+	// Murmur3's finalizer, Morton codes of nearby bricks differ in few bits and need a full mix.
+	static uint64 HashBrick(uint64 BrickKey)
+	{
+		BrickKey ^= BrickKey >> 33;
+		BrickKey *= 0xFF51AFD7ED558CCDull;
+		BrickKey ^= BrickKey >> 33;
+		BrickKey *= 0xC4CEB9FE1A85EC53ull;
+		BrickKey ^= BrickKey >> 33;
+		return BrickKey;
+	}
+
+	// Lock free probe, the read side of everything. Returns nullptr if no chunk of the brick is loaded.
+	static const FBrick* FindBrick(const FTable& Table, uint64 BrickKey)
+	{
+		for(uint64 Index = HashBrick(BrickKey) & Table.Mask; ; Index = (Index + 1) & Table.Mask)
+		{
+			const FBrick& Brick = Table.Bricks[Index];
+			const uint64 SlotKey = Brick.Key.load(std::memory_order_acquire);
+			if(SlotKey == BrickKey)
+			{
+				return &Brick;
+			}
+			if(SlotKey == EmptyKey)
+			{
+				return nullptr;
+			}
+		}
+	}
+
+	static FTable* CreateTable(uint64 Capacity);
+
+	// Writer only. Finds BrickKey's brick in the current table, adding it if bAddIfMissing.
+	FBrick* FindOrAddBrick(uint64 BrickKey, bool bAddIfMissing);
+
+	// Writer only. Rebuilds into a table of at least Capacity slots, dropping bricks with no chunks left.
+	void Rehash(uint64 Capacity);
+
+	std::atomic<FTable*> 				CurrentTable;
+	std::vector<std::unique_ptr<FTable>> RetiredTables;		// Writer only, until reclaimed.
+	std::mutex 							WriteMutex;
+	std::atomic<uint32> 				NumChunks;
+	uint64 								NumBricks = 0;		// Writer only, includes empty bricks.
+};
+
+template<typename FunctionType>
+void FChunkMap::ForEachInBox(int32 MinX, int32 MinY, int32 MinZ, int32 MaxX, int32 MaxY, int32 MaxZ, const FunctionType& Function) const
+{
+	// Boxes are small (view distance), sorting their keys is cheaper than walking Morton ranges.
+	std::vector<uint64> Keys;
+	Keys.reserve((size_t)(MaxX - MinX + 1) * (MaxY - MinY + 1) * (MaxZ - MinZ + 1));
+
+	for(int32 Y = MinY; Y <= MaxY; Y++)
+	for(int32 Z = MinZ; Z <= MaxZ; Z++)
+	for(int32 X = MinX; X <= MaxX; X++)
+	{
+		Keys.push_back(PackKey(X, Y, Z));
+	}
+	std::sort(Keys.begin(), Keys.end());
+
+	// Sorted keys come a brick at a time, only probe when the brick changes.
+	const FTable& Table = *CurrentTable.load(std::memory_order_acquire);
+	const FBrick* Brick = nullptr;
+	uint64 BrickKey = EmptyKey;
+
+	for(uint64 Key : Keys)
+	{
+		if((Key >> 3) != BrickKey)
+		{
+			BrickKey = Key >> 3;
+			Brick = FindBrick(Table, BrickKey);
+		}
+
+		FVoxelChunk* Chunk = Brick ? Brick->Chunks[Key & 7].load(std::memory_order_acquire) : nullptr;
+		if(Chunk)
+		{
+			int32 X, Y, Z;
+			UnpackKey(Key, X, Y, Z);
+			Function(X, Y, Z, Chunk);
+		}
+	}
+}
+
+template<typename FunctionType>
+void FChunkMap::ForEach(const FunctionType& Function) const
+{
+	const FTable& Table = *CurrentTable.load(std::memory_order_acquire);
+	for(uint64 Index = 0; Index <= Table.Mask; Index++)
+	{
+		const FBrick& Brick = Table.Bricks[Index];
+		const uint64 BrickKey = Brick.Key.load(std::memory_order_acquire);
+		if(BrickKey == EmptyKey)
+		{
+			continue;
+		}
+
+		for(uint32 Offset = 0; Offset < BrickSize; Offset++)
+		{
+			FVoxelChunk* Chunk = Brick.Chunks[Offset].load(std::memory_order_acquire);
+			if(Chunk)
+			{
+				int32 X, Y, Z;
+				UnpackKey((BrickKey << 3) | Offset, X, Y, Z);
+				Function(X, Y, Z, Chunk);
+			}
+		}
+	}
+}
@@ -0,0 +1,451 @@
+// Copyright Snaps 2022, All Rights Reserved.
+
+#include "ChunkStorage.h"
+#include "CoreMacros.h"
+#include "VoxelChunk.h"
+#include <thread>
+
+#if defined(_WIN32)
+#include <windows.h>
+#else
+#include <sys/stat.h>
+#endif
+
+// Encode jobs in flight per job system thread, saves past that wait in QueuedSaves.
+static const uint32 EncodesPerThread = 32;
+
+// Reads and writes FAsyncIO may have in flight, the rest wait in QueuedIO. Every completion schedules a
+// job, decoding a load for one, so this also bounds the completion work that lands on a single frame.
+static const uint32 MaxIOInFlight = 64;
+
+static uint64 PackRegionKey(const int32 RegionCoords[3])
+{
+	return ((uint64)(RegionCoords[0] & 0x1FFFFF) << 42) | ((uint64)(RegionCoords[1] & 0x1FFFFF) << 21) | (uint64)(RegionCoords[2] & 0x1FFFFF);
+}
+
+static void CreateDirectoryIfMissing(const std::string& Path)
+{
+#if defined(_WIN32)
+	CreateDirectoryA(Path.c_str(), nullptr);
+#else
+	mkdir(Path.c_str(), 0755);
+#endif
+}
+
+FChunkStorage::FChunkStorage(FJobSystem* InJobSystem, const std::string& InDirectory, bool bAllowIoUring)
+	: JobSystem(InJobSystem)
+	, Directory(InDirectory)
+	, MaxEncodesInFlight(InJobSystem->GetNumThreads() * EncodesPerThread)
+	, NumEncoding(0)
+	, NumPending(0)
+	, NextSequence(0)
+	, NumLoaded(0)
+	, NumLoadsFailed(0)
+{
+	CreateDirectoryIfMissing(Directory);
+	AsyncIO.Initialize(JobSystem, bAllowIoUring);
+}
+
+FChunkStorage::~FChunkStorage()
+{
+	Flush();
+	AsyncIO.Shutdown();
+}
+
+void FChunkStorage::SaveChunk(int32 X, int32 Y, int32 Z, const FVoxelChunk* Chunk, FJobCounter* Encoded)
+{
+	int32 RegionCoords[3];
+	int32 Local[3];
+	FRegionFile::ToRegionCoords(X, Y, Z, RegionCoords, Local);
+
+	FRegion* Region = FindRegion(RegionCoords, true);
+	if(!Region)
+	{
+		Stats.NumFailed++;
+		return;
+	}
+
+	if(FreeSaves.empty())
+	{
+		SavePool.emplace_back(new FSaveRequest());
+		FreeSaves.push_back(SavePool.back().get());
+	}
+
+	FSaveRequest* Request = FreeSaves.back();
+	FreeSaves.pop_back();
+
+	Request->Storage = this;
+	Request->Region = Region;
+	Request->Local[0] = Local[0];
+	Request->Local[1] = Local[1];
+	Request->Local[2] = Local[2];
+	Request->Chunk = Chunk;
+	Request->Encoded = Encoded;
+	Request->Sequence = NextSequence++;
+	Region->LatestSaves[FRegionFile::ToIndex(Local[0], Local[1], Local[2])] = Request->Sequence;
+
+	// Same contract as a scheduled job, the encode job brings it back down.
+	if(Encoded)
+	{
+		Encoded->Value.fetch_add(1, std::memory_order_relaxed);
+	}
+
+	QueuedSaves.push_back(Request);
+	NumPending++;
+}
+
+void FChunkStorage::LoadChunk(int32 X, int32 Y, int32 Z, FVoxelChunk* OutChunk, FChunkLoadedFunction OnLoaded, void* UserData)
+{
+	int32 RegionCoords[3];
+	int32 Local[3];
+	FRegionFile::ToRegionCoords(X, Y, Z, RegionCoords, Local);
+
+	if(FreeLoads.empty())
+	{
+		LoadPool.emplace_back(new FLoadRequest());
+		FreeLoads.push_back(LoadPool.back().get());
+	}
+
+	FLoadRequest* Request = FreeLoads.back();
+	FreeLoads.pop_back();
+
+	FRegion* Region = FindRegion(RegionCoords, false);
+	Request->Storage = this;
+	Request->Region = Region;
+	Request->Entry = Region ? Region->File.GetEntry(Local[0], Local[1], Local[2]) : 0;
+	Request->OutChunk = OutChunk;
+	Request->OnLoaded = OnLoaded;
+	Request->UserData = UserData;
+	NumPending++;
+
+	// Nothing to read, report it straight away.
+	Request->IO.UserData = Request;
+	if(Request->Entry == 0)
+	{
+		JobSystem->Schedule(&FChunkStorage::LoadDoneJob, &Request->IO, &JobsInFlight);
+		return;
+	}
+
+	// The record's sectors can't be reused until this read is done.
+	Region->NumReads++;
+
+	// The buffer is sized when the read is submitted, so a burst of loads doesn't fault in all
+	// their memory in the frame they're queued.
+	FAsyncIORequest& IO = Request->IO;
+	IO.File = Region->File.GetFileHandle();
+	IO.Offset = (uint64)(Request->Entry >> 8) * FRegionFile::SectorSize;
+	IO.Buffer = nullptr;
+	IO.Size = (Request->Entry & 0xFF) * FRegionFile::SectorSize;
+	IO.bWrite = false;
+	IO.OnComplete = &FChunkStorage::LoadDoneJob;
+	IO.Counter = &JobsInFlight;
+	QueuedIO.push_back(&IO);
+}
+
+void FChunkStorage::Update()
+{
+	PROFILE_FUNCTION();
+
+	std::vector<FSaveRequest*> Encoded;
+	std::vector<FSaveRequest*> Written;
+	std::vector<FRegion*> Tables;
+	std::vector<FLoadRequest*> Loads;
+	{
+		std::lock_guard<std::mutex> Lock(DoneMutex);
+		Encoded.swap(EncodedSaves);
+		Written.swap(WrittenSaves);
+		Tables.swap(WrittenTables);
+		Loads.swap(FinishedLoads);
+	}
+
+	for(FLoadRequest* Request : Loads)
+	{
+		if(Request->Entry != 0)
+		{
+			Request->Region->NumReads--;
+		}
+		FreeLoads.push_back(Request);
+		NumPending--;
+	}
+
+	// The on disk table no longer points at these, once reads are done they can be reused. A failed
+	// write left the old entries on disk, so the range is written again and nothing is freed yet.
+	for(FRegion* Region : Tables)
+	{
+		Region->bTableWriteInFlight = false;
+		std::vector<std::pair<uint32, uint32>>& Frees = Region->TableWrite.Result == (int32)Region->TableWrite.Size ? Region->PendingFrees : Region->UnwrittenFrees;
+		Frees.insert(Frees.end(), Region->TableWriteFrees.begin(), Region->TableWriteFrees.end());
+		Region->TableWriteFrees.clear();
+
+		if(Region->TableWrite.Result != (int32)Region->TableWrite.Size)
+		{
+			const uint32 WrittenBegin = (uint32)((Region->TableWrite.Offset - FRegionFile::GetTableOffset(0)) / sizeof(uint32));
+			const uint32 WrittenEnd = WrittenBegin + (uint32)Region->TableSnapshot.size();
+			Region->DirtyBegin = Region->DirtyBegin < Region->DirtyEnd && Region->DirtyBegin < WrittenBegin ? Region->DirtyBegin : WrittenBegin;
+			Region->DirtyEnd = Region->DirtyEnd > WrittenEnd ? Region->DirtyEnd : WrittenEnd;
+			Stats.NumFailed++;
+		}
+	}
+
+	// Records on disk, point the table at them unless a newer save of the chunk came in meanwhile.
+	for(FSaveRequest* Request : Written)
+	{
+		FRegion& Region = *Request->Region;
+		const uint32 Index = FRegionFile::ToIndex(Request->Local[0], Request->Local[1], Request->Local[2]);
+		const std::unordered_map<uint32, uint64>::iterator Latest = Region.LatestSaves.find(Index);
+		const bool bNewest = Latest != Region.LatestSaves.end() && Latest->second == Request->Sequence;
+
+		if(Request->IO.Result != (int32)Request->IO.Size || !bNewest)
+		{
+			Stats.NumFailed += bNewest ? 1 : 0;
+			Region.File.FreeSectors(Request->FirstSector, Request->NumSectors);
+		}
+		else
+		{
+			const uint32 OldEntry = Region.File.SetEntry(Request->Local[0], Request->Local[1], Request->Local[2], (Request->FirstSector << 8) | Request->NumSectors);
+			if(OldEntry != 0)
+			{
+				Region.UnwrittenFrees.emplace_back(OldEntry >> 8, OldEntry & 0xFF);
+			}
+
+			Region.DirtyBegin = Region.DirtyBegin < Region.DirtyEnd && Region.DirtyBegin < Index ? Region.DirtyBegin : Index;
+			Region.DirtyEnd = Region.DirtyEnd > Index + 1 ? Region.DirtyEnd : Index + 1;
+			Stats.NumSaved++;
+			Stats.BytesWritten += Request->IO.Size;
+		}
+
+		if(bNewest)
+		{
+			Region.LatestSaves.erase(Latest);
+		}
+		FreeSaves.push_back(Request);
+		NumPending--;
+	}
+
+	// Encoded records get sectors now, allocation stays on this thread.
+	for(FSaveRequest* Request : Encoded)
+	{
+		NumEncoding--;
+		if(Request->NumSectors == 0)
+		{
+			const uint32 Index = FRegionFile::ToIndex(Request->Local[0], Request->Local[1], Request->Local[2]);
+			const std::unordered_map<uint32, uint64>::iterator Latest = Request->Region->LatestSaves.find(Index);
+			if(Latest != Request->Region->LatestSaves.end() && Latest->second == Request->Sequence)
+			{
+				Request->Region->LatestSaves.erase(Latest);
+			}
+
+			Stats.NumFailed++;
+			FreeSaves.push_back(Request);
+			NumPending--;
+			continue;
+		}
+
+		FRegion& Region = *Request->Region;
+		Request->FirstSector = Region.File.AllocateSectors(Request->NumSectors);
+
+		FAsyncIORequest& IO = Request->IO;
+		IO.File = Region.File.GetFileHandle();
+		IO.Offset = (uint64)Request->FirstSector * FRegionFile::SectorSize;
+		IO.Buffer = Request->Record.data();
+		IO.Size = Request->NumSectors * FRegionFile::SectorSize;
+		IO.bWrite = true;
+		IO.OnComplete = &FChunkStorage::WriteDoneJob;
+		IO.UserData = Request;
+		IO.Counter = &JobsInFlight;
+		QueuedIO.push_back(&IO);
+	}
+
+	for(FRegion* Region : OpenRegions)
+	{
+		// One write for the whole changed range, from a copy since the table keeps changing.
+		if(!Region->bTableWriteInFlight && Region->DirtyBegin < Region->DirtyEnd)
+		{
+			const uint32* Table = Region->File.GetTable();
+			Region->TableSnapshot.assign(Table + Region->DirtyBegin, Table + Region->DirtyEnd);
+			Region->TableWriteFrees.swap(Region->UnwrittenFrees);
+
+			FAsyncIORequest& IO = Region->TableWrite;
+			IO.File = Region->File.GetFileHandle();
+			IO.Offset = FRegionFile::GetTableOffset(Region->DirtyBegin);
+			IO.Buffer = Region->TableSnapshot.data();
+			IO.Size = (uint32)(Region->TableSnapshot.size() * sizeof(uint32));
+			IO.bWrite = true;
+			IO.OnComplete = &FChunkStorage::TableWriteDoneJob;
+			IO.UserData = Region;
+			IO.Counter = &JobsInFlight;
+			QueuedIO.push_back(&IO);
+
+			Region->bTableWriteInFlight = true;
+			Region->DirtyBegin = Region->DirtyEnd = 0;
+		}
+
+		FreeOldRecords(*Region);
+	}
+
+	// Capped, with the page cache warm the kernel may do the copies right in the submitting call, and
+	// each completion is a job that competes with the rest of the frame for the cores.
+	const uint32 NumInFlight = AsyncIO.GetNumInFlight();
+	const size_t NumFree = NumInFlight < MaxIOInFlight ? MaxIOInFlight - NumInFlight : 0;
+	const size_t NumSubmitted = QueuedIO.size() < NumFree ? QueuedIO.size() : NumFree;
+	const std::vector<FAsyncIORequest*> Batch(QueuedIO.begin(), QueuedIO.begin() + NumSubmitted);
+	QueuedIO.erase(QueuedIO.begin(), QueuedIO.begin() + NumSubmitted);
+
+	for(FAsyncIORequest* IO : Batch)
+	{
+		if(!IO->bWrite && !IO->Buffer)
+		{
+			std::vector<uint8>& Buffer = static_cast<FLoadRequest*>(IO->UserData)->Buffer;
+			Buffer.resize(IO->Size);
+			IO->Buffer = Buffer.data();
+		}
+	}
+	AsyncIO.Submit(Batch.data(), (uint32)Batch.size());
+
+	// Kick encodes last so they overlap with the writes just submitted.
+	uint32 NumScheduled = 0;
+	while(NumScheduled < QueuedSaves.size() && NumEncoding < MaxEncodesInFlight)
+	{
+		JobSystem->Schedule(&FChunkStorage::EncodeJob, QueuedSaves[NumScheduled++], &JobsInFlight);
+		NumEncoding++;
+	}
+	QueuedSaves.erase(QueuedSaves.begin(), QueuedSaves.begin() + NumScheduled);
+}
+
+void FChunkStorage::Flush()
+{
+	PROFILE_FUNCTION();
+
+	for(;;)
+	{
+		Update();
+
+		bool bTablesWritten = true;
+		for(FRegion* Region : OpenRegions)
+		{
+			bTablesWritten &= !Region->bTableWriteInFlight && Region->DirtyBegin == Region->DirtyEnd;
+		}
+
+		// Jobs that handed their request back may still be returning, their counter has to settle too.
+		if(NumPending == 0 && bTablesWritten)
+		{
+			JobSystem->Wait(JobsInFlight);
+			break;
+		}
+
+		// Completion jobs may only be scheduled once the I/O lands, give the disk a moment.
+		JobSystem->Wait(JobsInFlight);
+		if(AsyncIO.GetNumInFlight() > 0)
+		{
+			std::this_thread::yield();
+		}
+	}
+
+	for(FRegion* Region : OpenRegions)
+	{
+		Region->File.Flush();
+	}
+}
+
+FChunkStorageStats FChunkStorage::GetStats() const
+{
+	FChunkStorageStats Result = Stats;
+	Result.NumLoaded = NumLoaded.load(std::memory_order_relaxed);
+	Result.NumFailed += NumLoadsFailed.load(std::memory_order_relaxed);
+	return Result;
+}
+
+FChunkStorage::FRegion* FChunkStorage::FindRegion(const int32 RegionCoords[3], bool bCreate)
+{
+	const uint64 Key = PackRegionKey(RegionCoords);
+	const std::unordered_map<uint64, std::unique_ptr<FRegion>>::iterator Found = Regions.find(Key);
+	if(Found != Regions.end() && (Found->second || !bCreate))
+	{
+		return Found->second.get();
+	}
+
+	const std::string Path = Directory + "/" + FRegionFile::GetFileName(RegionCoords[0], RegionCoords[1], RegionCoords[2]);
+	std::unique_ptr<FRegion> Region(new FRegion());
+	Region->Storage = this;
+	if(!Region->File.Open(Path, bCreate))
+	{
+		// Remembered as missing so loads don't keep trying to open it.
+		Regions[Key] = nullptr;
+		return nullptr;
+	}
+
+	FRegion* Result = Region.get();
+	Regions[Key] = std::move(Region);
+	OpenRegions.push_back(Result);
+	return Result;
+}
+
+void FChunkStorage::FreeOldRecords(FRegion& Region)
+{
+	if(Region.NumReads > 0)
+	{
+		return;
+	}
+
+	for(const std::pair<uint32, uint32>& Sectors : Region.PendingFrees)
+	{
+		Region.File.FreeSectors(Sectors.first, Sectors.second);
+	}
+	Region.PendingFrees.clear();
+}
+
+void FChunkStorage::EncodeJob(void* Data)
+{
+	FSaveRequest* Request = static_cast<FSaveRequest*>(Data);
+	Request->NumSectors = FRegionFile::EncodeRecord(*Request->Chunk, Request->Record);
+
+	// The chunk isn't touched again, the caller may change it from here.
+	if(Request->Encoded)
+	{
+		Request->Encoded->Value.fetch_sub(1, std::memory_order_release);
+	}
+
+	FChunkStorage* Storage = Request->Storage;
+	std::lock_guard<std::mutex> Lock(Storage->DoneMutex);
+	Storage->EncodedSaves.push_back(Request);
+}
+
+void FChunkStorage::WriteDoneJob(void* Data)
+{
+	FSaveRequest* Request = static_cast<FSaveRequest*>(static_cast<FAsyncIORequest*>(Data)->UserData);
+	FChunkStorage* Storage = Request->Storage;
+
+	std::lock_guard<std::mutex> Lock(Storage->DoneMutex);
+	Storage->WrittenSaves.push_back(Request);
+}
+
+void FChunkStorage::TableWriteDoneJob(void* Data)
+{
+	FRegion* Region = static_cast<FRegion*>(static_cast<FAsyncIORequest*>(Data)->UserData);
+	FChunkStorage* Storage = Region->Storage;
+
+	std::lock_guard<std::mutex> Lock(Storage->DoneMutex);
+	Storage->WrittenTables.push_back(Region);
+}
+
+void FChunkStorage::LoadDoneJob(void* Data)
+{
+	FLoadRequest* Request = static_cast<FLoadRequest*>(static_cast<FAsyncIORequest*>(Data)->UserData);
+	FChunkStorage* Storage = Request->Storage;
+
+	bool bLoaded = false;
+	if(Request->Entry != 0)
+	{
+		bLoaded = Request->IO.Result == (int32)Request->IO.Size
+			&& FRegionFile::DecodeRecord(Request->Buffer.data(), Request->Buffer.size(), *Request->OutChunk);
+		(bLoaded ? Storage->NumLoaded : Storage->NumLoadsFailed).fetch_add(1, std::memory_order_relaxed);
+	}
+
+	if(Request->OnLoaded)
+	{
+		Request->OnLoaded(Request->UserData, Request->OutChunk, bLoaded);
+	}
+
+	std::lock_guard<std::mutex> Lock(Storage->DoneMutex);
+	Storage->FinishedLoads.push_back(Request);
+}
@@ -0,0 +1,176 @@
+// Copyright Snaps 2022, All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "AsyncIO.h"
+#include "JobSystem.h"
+#include "RegionFile.h"
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+class FVoxelChunk;
+
+// Runs on a job once a load is over. bLoaded is false, and the chunk untouched, if nothing was stored or it was damaged.
+using FChunkLoadedFunction = void(*)(void* UserData, FVoxelChunk* Chunk, bool bLoaded);
+
+struct FChunkStorageStats
+{
+	uint64 	NumSaved 		= 0;
+	uint64 	NumLoaded 		= 0;
+	uint64 	NumFailed 		= 0; 	// Saves and loads that hit an I/O error or a damaged record.
+	uint64 	BytesWritten 	= 0;
+};
+
+/*
+	Saves and loads chunks to region files in a directory without the main
+	thread ever waiting on the disk. Chunks are encoded on the job system, the
+	records go to disk through FAsyncIO in one batch per Update, and loads are
+	decoded on the job that their read completes into.
+
+	A save only becomes visible once its record is on disk: Update then points
+	the region's in memory table at it, writes the changed part of the table
+	in one request, and frees the old record's sectors after that write and
+	any reads still in flight on the region are done. Only one table write per
+	region is in flight at a time, so they land in order. Saving the same
+	chunk again before the last save finished is fine, the newest one wins.
+
+	Opening a region file the first time it's touched is still synchronous.
+	Everything except the completion callbacks is main thread only.
+*/
+class FChunkStorage
+{
+public:
+
+	FChunkStorage(FJobSystem* InJobSystem, const std::string& InDirectory, bool bAllowIoUring = true);
+	~FChunkStorage();
+
+	FChunkStorage(const FChunkStorage&) = delete;
+	FChunkStorage& operator=(const FChunkStorage&) = delete;
+
+	// World chunk coordinates. Chunk is read by a job after this returns, it has to stay alive and
+	// unchanged until Encoded (optional) is done or Flush returns.
+	void SaveChunk(int32 X, int32 Y, int32 Z, const FVoxelChunk* Chunk, FJobCounter* Encoded = nullptr);
+
+	// Fills OutChunk with the last save that finished before this call, then runs OnLoaded on a job.
+	void LoadChunk(int32 X, int32 Y, int32 Z, FVoxelChunk* OutChunk, FChunkLoadedFunction OnLoaded, void* UserData);
+
+	// Once a frame. Moves finished work along and submits the next batch, never waits on I/O.
+	void Update();
+
+	// Blocks until every save and load queued so far is done and the region files are on disk.
+	void Flush();
+
+	// Saves and loads queued but not finished.
+	uint32 GetNumPending() const
+	{
+		return NumPending;
+	}
+
+	FChunkStorageStats GetStats() const;
+
+	EAsyncIOBackend GetBackend() const
+	{
+		return AsyncIO.GetBackend();
+	}
+
+private:
+
+	struct FRegion;
+
+	struct FSaveRequest
+	{
+		FChunkStorage* 			Storage;
+		FRegion* 				Region;
+		int32 					Local[3];
+		const FVoxelChunk* 		Chunk;
+		FJobCounter* 			Encoded;
+		uint64 					Sequence; 		// Tells saves of the same chunk apart, the newest wins.
+		std::vector<uint8> 		Record;
+		uint32 					NumSectors;
+		uint32 					FirstSector;
+		FAsyncIORequest 		IO;
+	};
+
+	struct FLoadRequest
+	{
+		FChunkStorage* 			Storage;
+		FRegion* 				Region; 		// nullptr when the region has no file.
+		uint32 					Entry; 			// Table entry when the load was queued, 0 if not stored.
+		FVoxelChunk* 			OutChunk;
+		FChunkLoadedFunction 	OnLoaded;
+		void* 					UserData;
+		std::vector<uint8> 		Buffer;
+		FAsyncIORequest 		IO;
+	};
+
+	struct FRegion
+	{
+		FChunkStorage* 							Storage 	= nullptr;
+		FRegionFile 							File;
+
+		// Saves waiting for their records to land, by table index.
+		std::unordered_map<uint32, uint64> 		LatestSaves;
+
+		// Table entries changed since the last table write, as an index range.
+		uint32 									DirtyBegin 	= 0;
+		uint32 									DirtyEnd 	= 0;
+
+		// Old records, first sector and count. Unwritten ones are still in the on disk table, the
+		// others wait for reads in flight.
+		std::vector<std::pair<uint32, uint32>> 	UnwrittenFrees;
+		std::vector<std::pair<uint32, uint32>> 	PendingFrees;
+
+		bool 									bTableWriteInFlight = false;
+		std::vector<uint32> 					TableSnapshot;
+		std::vector<std::pair<uint32, uint32>> 	TableWriteFrees;
+		FAsyncIORequest 						TableWrite;
+
+		uint32 									NumReads = 0;
+	};
+
+	// nullptr if the region has no file and bCreate is false, or it can't be opened.
+	FRegion* FindRegion(const int32 RegionCoords[3], bool bCreate);
+
+	void FreeOldRecords(FRegion& Region);
+
+	static void EncodeJob(void* Data);
+	static void WriteDoneJob(void* Data);
+	static void TableWriteDoneJob(void* Data);
+	static void LoadDoneJob(void* Data);
+
+	FJobSystem* 										JobSystem;
+	std::string 										Directory;
+	FAsyncIO 											AsyncIO;
+	FJobCounter 										JobsInFlight;
+	uint32 												MaxEncodesInFlight;
+
+	std::unordered_map<uint64, std::unique_ptr<FRegion>> Regions; 	// nullptr for regions known to have no file.
+	std::vector<FRegion*> 								OpenRegions;
+
+	std::vector<FSaveRequest*> 							QueuedSaves; 	// Not handed to an encode job yet.
+	std::deque<FAsyncIORequest*> 						QueuedIO; 		// Reads and writes for the next batches.
+	uint32 												NumEncoding;
+	uint32 												NumPending;
+	uint64 												NextSequence;
+
+	// Handed back from jobs, picked up by Update.
+	std::mutex 											DoneMutex;
+	std::vector<FSaveRequest*> 							EncodedSaves;
+	std::vector<FSaveRequest*> 							WrittenSaves;
+	std::vector<FRegion*> 								WrittenTables;
+	std::vector<FLoadRequest*> 							FinishedLoads;
+
+	std::vector<std::unique_ptr<FSaveRequest>> 			SavePool;
+	std::vector<std::unique_ptr<FLoadRequest>> 			LoadPool;
+	std::vector<FSaveRequest*> 							FreeSaves;
+	std::vector<FLoadRequest*> 							FreeLoads;
+
+	FChunkStorageStats 									Stats;
+	std::atomic<uint64> 								NumLoaded;
+	std::atomic<uint64> 								NumLoadsFailed;
+};
@@ -0,0 +1,239 @@
+// Copyright Snaps 2022, All Rights Reserved.
+
+#include "Compression.h"
+#include "BitMath.h"
+#include <cstring>
+
+namespace Compression
+{
+	static const size_t MinMatch 	= 4;
+	static const size_t MaxOffset 	= 65535;
+	static const uint32 HashLog 	= 12;
+
+	// Misses before the search starts skipping ahead, incompressible data costs little that way.
+	static const uint32 SkipTrigger = 6;
+
+	static uint32 Read32(const uint8* Bytes)
+	{
+		uint32 Value;
+		std::memcpy(&Value, Bytes, sizeof(Value));
+		return Value;
+	}
+
+	static uint64 Read64(const uint8* Bytes)
+	{
+		uint64 Value;
+		std::memcpy(&Value, Bytes, sizeof(Value));
+		return Value;
+	}
+
+	static uint32 HashSequence(uint32 Sequence)
+	{
+		return (Sequence * 2654435761u) >> (32 - HashLog);
+	}
+
+	// Bytes in common from A and B onwards, stopping at End (which bounds B, A is behind it).
+	static size_t CountMatching(const uint8* A, const uint8* B, const uint8* End)
+	{
+		const uint8* Start = B;
+		while(B + sizeof(uint64) <= End)
+		{
+			const uint64 Difference = Read64(A) ^ Read64(B);
+			if(Difference != 0)
+			{
+				return (size_t)(B - Start) + BitMath::CountTrailingZeros64(Difference) / 8;
+			}
+			A += sizeof(uint64);
+			B += sizeof(uint64);
+		}
+
+		while(B < End && *A == *B)
+		{
+			A++;
+			B++;
+		}
+		return (size_t)(B - Start);
+	}
+
+	static uint8* WriteLengthBytes(uint8* Out, size_t Length)
+	{
+		while(Length >= 255)
+		{
+			*Out++ = 255;
+			Length -= 255;
+		}
+		*Out++ = (uint8)Length;
+		return Out;
+	}
+
+	static bool ReadLengthBytes(const uint8*& In, const uint8* InEnd, size_t& Length)
+	{
+		uint8 Byte;
+		do
+		{
+			if(In == InEnd)
+			{
+				return false;
+			}
+			Byte = *In++;
+			Length += Byte;
+		}
+		while(Byte == 255);
+		return true;
+	}
+
+	// Writes one sequence, a match of MatchLength at Offset unless it's the last (literals only) one.
+	// Returns nullptr if it doesn't fit.
+	static uint8* WriteSequence(uint8* Out, const uint8* OutEnd, const uint8* Literals, size_t NumLiterals, size_t Offset, size_t MatchLength, bool bLast)
+	{
+		const size_t MatchCode = bLast ? 0 : MatchLength - MinMatch;
+		const size_t MaxSize = 1 + (NumLiterals / 255 + 1) + NumLiterals + 2 + (MatchCode / 255 + 1);
+		if((size_t)(OutEnd - Out) < MaxSize)
+		{
+			return nullptr;
+		}
+
+		uint8* Token = Out++;
+		*Token = (uint8)(((NumLiterals < 15 ? NumLiterals : 15) << 4) | (MatchCode < 15 ? MatchCode : 15));
+		if(NumLiterals >= 15)
+		{
+			Out = WriteLengthBytes(Out, NumLiterals - 15);
+		}
+
+		std::memcpy(Out, Literals, NumLiterals);
+		Out += NumLiterals;
+
+		if(!bLast)
+		{
+			Out[0] = (uint8)(Offset & 0xFF);
+			Out[1] = (uint8)(Offset >> 8);
+			Out += 2;
+
+			if(MatchCode >= 15)
+			{
+				Out = WriteLengthBytes(Out, MatchCode - 15);
+			}
+		}
+		return Out;
+	}
+
+	size_t Compress(const void* Source, size_t SourceSize, void* Dest, size_t DestCapacity)
+	{
+		const uint8* const In = static_cast<const uint8*>(Source);
+		const uint8* const InEnd = In + SourceSize;
+		uint8* const OutStart = static_cast<uint8*>(Dest);
+		uint8* Out = OutStart;
+		const uint8* const OutEnd = OutStart + DestCapacity;
+
+		// Last position each hashed 4 byte sequence was seen at. Stale or colliding entries are fine,
+		// candidates are always checked.
+		uint32 Table[1 << HashLog];
+		std::memset(Table, 0, sizeof(Table));
+
+		const uint8* Anchor = In;
+		const uint8* Cursor = In;
+		uint32 NumMisses = 0;
+
+		while(SourceSize >= MinMatch && Cursor <= InEnd - MinMatch)
+		{
+			const uint32 Sequence = Read32(Cursor);
+			const uint32 Hash = HashSequence(Sequence);
+			const uint8* Candidate = In + Table[Hash];
+			Table[Hash] = (uint32)(Cursor - In);
+
+			if(Candidate >= Cursor || (size_t)(Cursor - Candidate) > MaxOffset || Read32(Candidate) != Sequence)
+			{
+				Cursor += 1 + (NumMisses++ >> SkipTrigger);
+				continue;
+			}
+
+			const size_t MatchLength = MinMatch + CountMatching(Candidate + MinMatch, Cursor + MinMatch, InEnd);
+			Out = WriteSequence(Out, OutEnd, Anchor, (size_t)(Cursor - Anchor), (size_t)(Cursor - Candidate), MatchLength, false);
+			if(!Out)
+			{
+				return 0;
+			}
+
+			Cursor += MatchLength;
+			Anchor = Cursor;
+			NumMisses = 0;
+		}
+
+		Out = WriteSequence(Out, OutEnd, Anchor, (size_t)(InEnd - Anchor), 0, 0, true);
+		return Out ? (size_t)(Out - OutStart) : 0;
+	}
+
+	bool Decompress(const void* Source, size_t SourceSize, void* Dest, size_t DestSize)
+	{
+		const uint8* In = static_cast<const uint8*>(Source);
+		const uint8* const InEnd = In + SourceSize;
+		uint8* const OutStart = static_cast<uint8*>(Dest);
+		uint8* Out = OutStart;
+		uint8* const OutEnd = OutStart + DestSize;
+
+		for(;;)
+		{
+			if(In == InEnd)
+			{
+				return false;
+			}
+
+			const uint8 Token = *In++;
+			size_t NumLiterals = Token >> 4;
+			if(NumLiterals == 15 && !ReadLengthBytes(In, InEnd, NumLiterals))
+			{
+				return false;
+			}
+
+			if((size_t)(InEnd - In) < NumLiterals || (size_t)(OutEnd - Out) < NumLiterals)
+			{
+				return false;
+			}
+			std::memcpy(Out, In, NumLiterals);
+			In += NumLiterals;
+			Out += NumLiterals;
+
+			// Only the last sequence ends right after its literals.
+			if(In == InEnd)
+			{
+				return Out == OutEnd;
+			}
+
+			if(InEnd - In < 2)
+			{
+				return false;
+			}
+			const size_t Offset = (size_t)In[0] | ((size_t)In[1] << 8);
+			In += 2;
+
+			size_t MatchLength = Token & 15;
+			if(MatchLength == 15 && !ReadLengthBytes(In, InEnd, MatchLength))
+			{
+				return false;
+			}
+			MatchLength += MinMatch;
+
+			if(Offset == 0 || Offset > (size_t)(Out - OutStart) || MatchLength > (size_t)(OutEnd - Out))
+			{
+				return false;
+			}
+
+			// Matches may overlap their own output (runs), copying forward 8 bytes at a time is only
+			// safe when every 8 bytes read were written before this copy started.
+			const uint8* Match = Out - Offset;
+			size_t Copied = 0;
+			if(Offset >= sizeof(uint64))
+			{
+				for(; Copied + sizeof(uint64) <= MatchLength; Copied += sizeof(uint64))
+				{
+					std::memcpy(Out + Copied, Match + Copied, sizeof(uint64));
+				}
+			}
+			for(; Copied < MatchLength; Copied++)
+			{
+				Out[Copied] = Match[Copied];
+			}
+			Out += MatchLength;
+		}
+	}
+}
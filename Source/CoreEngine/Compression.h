@@ -0,0 +1,30 @@
+// Copyright Snaps 2022, All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+/*
+	Small LZ77 byte codec in the spirit of LZ4's block format, fast to decode
+	and good on the repetitive packed indices of chunk storage.
+
+	A block is a run of sequences, each a token byte (literal count in the
+	high nibble, match length - 4 in the low one, 15 meaning more length bytes
+	follow), the literals, then a 16 bit offset back into the output and any
+	extra match length bytes. The last sequence is literals only.
+*/
+namespace Compression
+{
+	// Worst case compressed size of SourceSize bytes, incompressible input grows a little.
+	inline size_t GetMaxCompressedSize(size_t SourceSize)
+	{
+		return SourceSize + SourceSize / 255 + 16;
+	}
+
+	// Returns the compressed size, or 0 if it wouldn't fit in DestCapacity.
+	size_t Compress(const void* Source, size_t SourceSize, void* Dest, size_t DestCapacity);
+
+	// Decompresses a block that must expand to exactly DestSize bytes. Returns false for malformed
+	// input, never reads or writes outside the given buffers.
+	bool Decompress(const void* Source, size_t SourceSize, void* Dest, size_t DestSize);
+}
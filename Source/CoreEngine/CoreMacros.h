@@ -1,3 +1,35 @@
 // Copyright Snaps 2022. All Rights Reserved.
 
-#pragma once
\ No newline at end of file
+#pragma once
+
+#define VOXEL_CONCAT_INNER(A, B) A##B
+#define VOXEL_CONCAT(A, B) VOXEL_CONCAT_INNER(A, B)
+
+// Builds with VOXEL_PROFILING=0 compile every profiling macro out entirely.
+#ifndef VOXEL_PROFILING
+#define VOXEL_PROFILING 1
+#endif
+
+#if VOXEL_PROFILING
+
+#include "Profiler.h"
+
+// Times the rest of the enclosing scope, Name must be a string literal. Each site keeps the
+// first name it sees, so don't pick one at runtime.
+#define PROFILE_SCOPE(Name) \
+	static FProfileZone VOXEL_CONCAT(ProfileZone_, __LINE__) = { Name }; \
+	FProfileScope VOXEL_CONCAT(ProfileScope_, __LINE__)(&VOXEL_CONCAT(ProfileZone_, __LINE__))
+
+// Times the rest of the enclosing function under the function's name.
+#define PROFILE_FUNCTION() PROFILE_SCOPE(__FUNCTION__)
+
+// Names the calling thread in captured traces.
+#define PROFILE_THREAD_NAME(Name) FProfiler::SetThreadName(Name)
+
+#else
+
+#define PROFILE_SCOPE(Name)
+#define PROFILE_FUNCTION()
+#define PROFILE_THREAD_NAME(Name)
+
+#endif
@@ -22,6 +22,10 @@ using int64 	= int64_t;
 #define WIN32_LEAN_AND_MEAN // Exclude rarely-used stuff from Windows headers.
 #endif
 
+#ifndef NOMINMAX
+#define NOMINMAX // Stop Windows headers defining min/max macros over std::min/std::max.
+#endif
+
 #include <string>
 #include <wrl.h>
 #include <shellapi.h>
\ No newline at end of file
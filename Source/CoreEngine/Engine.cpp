@@ -2,12 +2,47 @@
 
 #include "Engine.h"
 #include "Application.h"
+#include "ChunkStorage.h"
 #include "Renderer.h"
+#include "JobSystem.h"
+#include "CoreMacros.h"
+#include "FramePacer.h"
+#include "LightEngine.h"
+#include "SectionMeshes.h"
+#include "WorldGenerator.h"
 
 bool FEngine::Initialize()
 {
-	// Create renderer.
+	// Start job system workers, one per core. Main thread is worker 0.
+	JobSystem = std::make_shared<FJobSystem>();
+	JobSystem.get()->Initialize();
+
+	// World generation runs on the job system, kicked from Tick.
+	WorldGenerator = std::make_shared<FWorldGenerator>(JobSystem.get(), AppSettings::WorldSeed, AppSettings::ViewDistance);
+
+	// Chunk saves and loads go through async I/O, nothing on the main thread waits on the disk.
+	ChunkStorage = std::make_shared<FChunkStorage>(JobSystem.get(), AppSettings::SaveDirectory);
+
+	// Near field meshes of the generated chunks, split into sections so edits only remesh what they touch.
+	SectionMeshes = std::make_shared<FSectionMeshes>(JobSystem.get(), &WorldGenerator.get()->GetChunkMap());
+
+	// Sky and block light of the generated chunks, relit as they load and as blocks change.
+	LightEngine = std::make_shared<FLightEngine>(JobSystem.get(), &WorldGenerator.get()->GetChunkMap());
+
+	// Create renderer and bring up Vulkan.
 	Renderer = std::make_unique<FRenderer>();
+	Renderer.get()->Initialize();
+	Renderer.get()->SetSectionMeshes(SectionMeshes.get());
+
+	// Start above the tallest hills looking a little down, with the far plane past the generated world.
+	Camera.Y = WorldHeight / 2;
+	Camera.Pitch = -0.3f;
+	Camera.FarPlane = (float)(AppSettings::ViewDistance + 2) * ChunkSize * 2.f;
+
+	// Simulation starts at time zero once everything is up, so startup doesn't count as a hitch.
+	Timestep.Initialize(AppSettings::TickRate);
+	SimulationTime.Reset(0.0);
+	LastTickTime = std::chrono::steady_clock::now();
 	return true;
 }
 
@@ -15,12 +50,93 @@ void FEngine::Shutdown()
 {
 	// Shutdown renderer allowing graceful cleanup.
 	Renderer.get()->Shutdown();
+
+	// All wait for their jobs, which need the workers. Storage flushes every queued save first.
+	LightEngine.reset();
+	SectionMeshes.reset();
+	ChunkStorage.reset();
+	WorldGenerator.reset();
+
+	// Stop workers last, anything still queued gets flushed on the main thread.
+	JobSystem.get()->Shutdown();
+}
+
+void FEngine::WaitForFrameStart()
+{
+	Renderer.get()->GetFramePacer()->WaitForFrameStart();
 }
 
+// Systems kick their work onto the job system here and the main thread
+// carries on recording the frame while the workers chew through it.
 void FEngine::Tick()
 {
+	PROFILE_FUNCTION();
+
+	const std::chrono::steady_clock::time_point Now = std::chrono::steady_clock::now();
+	const double FrameSeconds = std::chrono::duration<double>(Now - LastTickTime).count();
+	LastTickTime = Now;
+
+	// Headless runs advance exactly one tick per frame, so a given frame always shows the same state.
+	const uint32 NumTicks = Timestep.Advance(FApp::Get()->IsHeadless() ? Timestep.GetTickSeconds() : FrameSeconds);
+	for(uint32 Tick = 0; Tick < NumTicks; Tick++)
+	{
+		FixedTick();
+	}
+
+	// Generation jobs run while the frame is recorded, whatever finished since last frame is published.
+	WorldGenerator.get()->Update(Camera.X, Camera.Z);
+
+	// Newly finished columns go to the near field and lighting, along with the columns that were dropped.
+	// FLodTerrain isn't fed from here, nothing draws its nodes yet and the world only generates out to
+	// the view distance.
+	const FChunkMap& ChunkMap = WorldGenerator.get()->GetChunkMap();
+	for(uint64 Key : WorldGenerator.get()->GetPublishedColumns())
+	{
+		int32 X, Y, Z;
+		FChunkMap::UnpackKey(Key, X, Y, Z);
+		for(int32 ChunkY = 0; ChunkY < WorldHeightChunks; ChunkY++)
+		{
+			if(ChunkMap.Find(X, ChunkY, Z))
+			{
+				SectionMeshes.get()->OnChunkLoaded(X, ChunkY, Z);
+				LightEngine.get()->OnChunkLoaded(X, ChunkY, Z);
+			}
+		}
+	}
+	for(uint64 Key : WorldGenerator.get()->GetUnloadedColumns())
+	{
+		int32 X, Y, Z;
+		FChunkMap::UnpackKey(Key, X, Y, Z);
+		for(int32 ChunkY = 0; ChunkY < WorldHeightChunks; ChunkY++)
+		{
+			SectionMeshes.get()->OnChunkUnloaded(X, ChunkY, Z);
+			LightEngine.get()->OnChunkUnloaded(X, ChunkY, Z);
+		}
+	}
+
+	// Applies this frame's block edits and remeshes the sections they touched before the frame is drawn.
+	SectionMeshes.get()->Update();
+
+	// Lights new chunks and relights around the edits, settled before the frame is drawn.
+	for(const FBlockEdit& Edit : SectionMeshes.get()->GetAppliedEdits())
+	{
+		LightEngine.get()->OnBlockChanged(Edit.X, Edit.Y, Edit.Z);
+	}
+	LightEngine.get()->Update();
+
+	// Hands finished saves and loads on and submits the next batch of I/O.
+	ChunkStorage.get()->Update();
+
 	if(Renderer.get()) // Draw the render texture.
 	{
-		Renderer.get()->Draw();
+		Renderer.get()->SetCamera(Camera);
+		Renderer.get()->Draw(SimulationTime.Get(Timestep.GetAlpha()));
 	}
+}
+
+void FEngine::FixedTick()
+{
+	PROFILE_FUNCTION();
+
+	SimulationTime.Push(SimulationTime.Current + Timestep.GetTickSeconds());
 }
\ No newline at end of file
@@ -3,8 +3,16 @@
 #pragma once
 
 #include "CoreMinimal.h"
+#include "Camera.h"
+#include "FixedTimestep.h"
+#include <chrono>
 
 class FRenderer;
+class FJobSystem;
+class FWorldGenerator;
+class FChunkStorage;
+class FSectionMeshes;
+class FLightEngine;
 
 /*
 	Engine is the base level object for the entire engine. This is the actual
@@ -16,9 +24,77 @@ public:
 
 	bool Initialize();
 	void Shutdown();
+
+	// Sleeps until the frame pacer wants the next frame started, call before polling input.
+	void WaitForFrameStart();
+
+	// Runs however many fixed simulation ticks are due, then renders once.
 	void Tick();
 
+	FJobSystem* GetJobSystem() const
+	{
+		return JobSystem.get();
+	}
+
+	FRenderer* GetRenderer() const
+	{
+		return Renderer.get();
+	}
+
+	FWorldGenerator* GetWorldGenerator() const
+	{
+		return WorldGenerator.get();
+	}
+
+	FChunkStorage* GetChunkStorage() const
+	{
+		return ChunkStorage.get();
+	}
+
+	// Block edits go through here, see FSectionMeshes::QueueEdit.
+	FSectionMeshes* GetSectionMeshes() const
+	{
+		return SectionMeshes.get();
+	}
+
+	FLightEngine* GetLightEngine() const
+	{
+		return LightEngine.get();
+	}
+
+	// What the frame is drawn from, the world is generated around its X and Z. Picked up on the next Tick.
+	FCamera& GetCamera()
+	{
+		return Camera;
+	}
+
+	// Moves the camera across the world, keeping its height and direction.
+	void SetViewerPosition(double X, double Z)
+	{
+		Camera.X = X;
+		Camera.Z = Z;
+	}
+
+	const FFixedTimestep& GetTimestep() const
+	{
+		return Timestep;
+	}
+
 private:
 
-	std::shared_ptr<FRenderer> Renderer;
+	// One simulation step of exactly Timestep.GetTickSeconds(), never depends on the frame rate.
+	void FixedTick();
+
+	std::shared_ptr<FRenderer> 			Renderer;
+	std::shared_ptr<FJobSystem> 		JobSystem;
+	std::shared_ptr<FWorldGenerator> 	WorldGenerator;
+	std::shared_ptr<FChunkStorage> 		ChunkStorage;
+	std::shared_ptr<FSectionMeshes> 	SectionMeshes;
+	std::shared_ptr<FLightEngine> 		LightEngine;
+
+	FCamera 								Camera;
+
+	FFixedTimestep 							Timestep;
+	std::chrono::steady_clock::time_point 	LastTickTime;
+	TInterpolated<double> 					SimulationTime;		// Seconds of simulation, what rendering animates by.
 };
\ No newline at end of file
@@ -0,0 +1,110 @@
+// Copyright Snaps 2022, All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+/*
+	Accumulator that turns variable frame times into a whole number of fixed
+	length simulation ticks. Each frame adds its real elapsed time and runs
+	however many ticks fit, the remainder carries over to the next frame and
+	is what the renderer interpolates by (GetAlpha).
+
+	A slow frame runs several ticks to catch up, so the simulation keeps real
+	time pace and render frames are what gets dropped. Catching up is capped
+	at MaxTicksPerFrame, time beyond that (a hitch, a debugger break) is thrown
+	away rather than snowballing into ever longer frames.
+*/
+class FFixedTimestep
+{
+public:
+
+	void Initialize(int32 TicksPerSecond, uint32 InMaxTicksPerFrame = 8)
+	{
+		TickSeconds = 1.0 / TicksPerSecond;
+		MaxTicksPerFrame = InMaxTicksPerFrame;
+		Accumulator = 0.0;
+		TickCount = 0;
+		DroppedSeconds = 0.0;
+	}
+
+	// Adds a frame's real elapsed time, returns how many ticks to run this frame.
+	uint32 Advance(double FrameSeconds)
+	{
+		Accumulator += FrameSeconds;
+
+		uint32 NumTicks = (uint32)(Accumulator / TickSeconds);
+		if(NumTicks > MaxTicksPerFrame)
+		{
+			// Keep the fraction of a tick so interpolation stays continuous, drop whole ticks only.
+			DroppedSeconds += (NumTicks - MaxTicksPerFrame) * TickSeconds;
+			NumTicks = MaxTicksPerFrame;
+		}
+
+		Accumulator -= (uint32)(Accumulator / TickSeconds) * TickSeconds;
+		TickCount += NumTicks;
+		return NumTicks;
+	}
+
+	// How far between the previous and the latest tick the frame being rendered is, 0 to 1.
+	float GetAlpha() const
+	{
+		return (float)(Accumulator / TickSeconds);
+	}
+
+	double GetTickSeconds() const
+	{
+		return TickSeconds;
+	}
+
+	// Ticks run since Initialize, tick N simulates up to time N * GetTickSeconds().
+	uint64 GetTickCount() const
+	{
+		return TickCount;
+	}
+
+	// Real time skipped because frames needed more than MaxTicksPerFrame to catch up.
+	double GetDroppedSeconds() const
+	{
+		return DroppedSeconds;
+	}
+
+private:
+
+	double 	TickSeconds 		= 1.0 / 60.0;
+	uint32 	MaxTicksPerFrame 	= 8;
+	double 	Accumulator 		= 0.0;
+	uint64 	TickCount 			= 0;
+	double 	DroppedSeconds 		= 0.0;
+};
+
+/*
+	Simulation state kept for the last two ticks, so rendering can blend
+	between them with FFixedTimestep::GetAlpha() instead of showing the state
+	jump once per tick. Type needs +, - and * float.
+*/
+template<typename Type>
+struct TInterpolated
+{
+	Type Previous {};
+	Type Current {};
+
+	// Call once per tick with the new state.
+	void Push(const Type& Value)
+	{
+		Previous = Current;
+		Current = Value;
+	}
+
+	// Snaps both states, for teleports and the first tick so nothing blends in from zero.
+	void Reset(const Type& Value)
+	{
+		Previous = Value;
+		Current = Value;
+	}
+
+	Type Get(float Alpha) const
+	{
+		return Previous + (Current - Previous) * Alpha;
+	}
+};
@@ -0,0 +1,156 @@
+// Copyright Snaps 2022, All Rights Reserved.
+
+#include "FramePacer.h"
+#include "CoreMacros.h"
+#include <algorithm>
+#include <chrono>
+#include <thread>
+
+// Blocking left in on purpose (fence path) or kept clear of the vblank (present wait path), absorbs frame time noise.
+static const double PacingMargin = 0.001;
+
+// Share of the measured back pressure moved in front of the frame per frame, the rest waits for more evidence.
+static const double FenceGain = 0.5;
+
+// Weight of the newest frame in the smoothed stats.
+static const double StatsSmoothing = 1.0 / 30.0;
+
+// Longest a present wait may block, long enough for any real refresh rate.
+static const uint64 PresentWaitTimeout = 100 * 1000 * 1000;
+
+static uint64 GetTimeNanoseconds()
+{
+	return (uint64)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+void FFramePacer::Initialize(VkDevice InDevice, bool bInUsePresentWait, double InRefreshSeconds)
+{
+	Device = InDevice;
+	RefreshSeconds = InRefreshSeconds;
+	PresentPacing.Initialize(RefreshSeconds, PacingMargin);
+
+	// Extension entry points aren't exported by the loader library, fetch it from the device.
+	WaitForPresent = bInUsePresentWait ? (PFN_vkWaitForPresentKHR)vkGetDeviceProcAddr(Device, "vkWaitForPresentKHR") : nullptr;
+	Stats.bPresentWait = WaitForPresent != nullptr;
+}
+
+void FFramePacer::SetSwapchain(VkSwapchainKHR InSwapchain)
+{
+	// Ids presented to the old swapchain will never show up on the new one, don't wait for them.
+	Swapchain = InSwapchain;
+	FirstSwapchainId = LastPresentId + 1;
+	LastDisplayTime = 0;
+}
+
+void FFramePacer::WaitForFrameStart()
+{
+	PROFILE_FUNCTION();
+
+	if(!Stats.bEnabled)
+	{
+		BlockedSeconds = 0.0;
+		return;
+	}
+
+	if(WaitForPresent && Swapchain != VK_NULL_HANDLE)
+	{
+		UpdatePresentWait();
+	}
+	else
+	{
+		UpdateFenceTiming();
+	}
+
+	PreciseSleep(DelaySeconds);
+	FrameStartTime = GetTimeNanoseconds();
+
+	Stats.DelayMs = DelaySeconds * 1000.0;
+	Stats.NumFrames++;
+}
+
+void FFramePacer::OnPresent(VkPresentInfoKHR& PresentInfo)
+{
+	PresentTime = GetTimeNanoseconds();
+	if(!Stats.bEnabled || !WaitForPresent)
+	{
+		return;
+	}
+
+	// Ids only have to increase per swapchain, one counter for the whole run does that.
+	LastPresentId++;
+	PresentIdInfo.sType = VK_STRUCTURE_TYPE_PRESENT_ID_KHR;
+	PresentIdInfo.pNext = PresentInfo.pNext;
+	PresentIdInfo.swapchainCount = 1;
+	PresentIdInfo.pPresentIds = &LastPresentId;
+	PresentInfo.pNext = &PresentIdInfo;
+}
+
+void FFramePacer::PreciseSleep(double Seconds)
+{
+	if(Seconds <= 0.0)
+	{
+		return;
+	}
+
+	const uint64 EndTime = GetTimeNanoseconds() + (uint64)(Seconds * 1e9);
+
+	// Windows sleeps round up to the scheduler tick, only hand the OS the part we can afford to overshoot.
+	static const double SpinSeconds = 0.002;
+	if(Seconds > SpinSeconds)
+	{
+		std::this_thread::sleep_for(std::chrono::duration<double>(Seconds - SpinSeconds));
+	}
+
+	while(GetTimeNanoseconds() < EndTime)
+	{
+		std::this_thread::yield();
+	}
+}
+
+void FFramePacer::UpdatePresentWait()
+{
+	Stats.BlockedMs += (BlockedSeconds * 1000.0 - Stats.BlockedMs) * StatsSmoothing;
+	BlockedSeconds = 0.0;
+
+	if(LastPresentId < FirstSwapchainId)
+	{
+		return;
+	}
+
+	// Returns once the last frame is on screen, which is as close to the vblank as we can get.
+	const VkResult Result = WaitForPresent(Device, Swapchain, LastPresentId, PresentWaitTimeout);
+	if(Result != VK_SUCCESS)
+	{
+		// Timed out or the swapchain is going away, no timing to learn from this frame.
+		LastDisplayTime = 0;
+		return;
+	}
+
+	const uint64 DisplayTime = GetTimeNanoseconds();
+	if(LastDisplayTime != 0)
+	{
+		const double Interval = (DisplayTime - LastDisplayTime) / 1e9;
+		Stats.PresentIntervalMs += (Interval * 1000.0 - Stats.PresentIntervalMs) * StatsSmoothing;
+
+		// Only learn from a frame that was presented after it started, skipped frames present nothing.
+		if(PresentTime >= FrameStartTime)
+		{
+			const double StartToDisplay = (DisplayTime - FrameStartTime) / 1e9;
+			const double Work = (PresentTime - FrameStartTime) / 1e9 + GpuSeconds;
+			Stats.NumMissedVblanks += PresentPacing.OnFrameDisplayed(StartToDisplay, Work, Interval) ? 1 : 0;
+			Stats.SlackMs += (PresentPacing.GetSlack() * 1000.0 - Stats.SlackMs) * StatsSmoothing;
+			DelaySeconds = PresentPacing.GetDelay();
+		}
+	}
+	LastDisplayTime = DisplayTime;
+}
+
+void FFramePacer::UpdateFenceTiming()
+{
+	Stats.BlockedMs += (BlockedSeconds * 1000.0 - Stats.BlockedMs) * StatsSmoothing;
+
+	// Time spent blocked is time the frame could have started later, settle where only the margin is left.
+	DelaySeconds += (BlockedSeconds - PacingMargin) * FenceGain;
+	DelaySeconds = std::max(0.0, std::min(DelaySeconds, RefreshSeconds));
+	BlockedSeconds = 0.0;
+}
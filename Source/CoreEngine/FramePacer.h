@@ -0,0 +1,98 @@
+// Copyright Snaps 2022, All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "PacingController.h"
+#include "vulkan.h"
+
+// What the pacer is doing, exported once a frame for overlays, logs and benchmarks.
+struct FFramePacingStats
+{
+	bool 	bEnabled 			= false;
+	bool 	bPresentWait 		= false;	// Timing from VK_KHR_present_wait, otherwise from fence back pressure.
+	double 	DelayMs 			= 0.0;		// Sleep before CPU work starts, what the pacer controls.
+	double 	BlockedMs 			= 0.0;		// Smoothed time the render thread still spent blocked on the GPU.
+	double 	PresentIntervalMs 	= 0.0;		// Smoothed time between displayed frames, present wait only.
+	double 	SlackMs 			= 0.0;		// Smoothed time finished frames waited for their vblank, present wait only.
+	uint64 	NumFrames 			= 0;
+	uint64 	NumMissedVblanks 	= 0;		// Frames displayed a refresh late, present wait only.
+};
+
+/*
+	Latency reduction for VSync. With FIFO presentation the CPU runs ahead until
+	back pressure (fences, acquire) stops it, so input is sampled up to a few
+	refreshes before the frame reaches the screen. The pacer instead delays the
+	start of each frame's CPU work so the frame finishes just in time for the
+	vblank it will be shown at.
+
+	With VK_KHR_present_id / present_wait it waits for the previous frame to be
+	displayed, which lines the start of a frame up with the vblank, then sleeps
+	for Delay. Delay follows the slack between a frame being ready and being
+	shown, see FPacingController. Without them it measures how long the render
+	thread was blocked on fences and acquire, and moves that time in front of
+	the frame as sleep, leaving a small margin of blocking.
+*/
+class FFramePacer
+{
+public:
+
+	void Initialize(VkDevice Device, bool bInUsePresentWait, double InRefreshSeconds);
+
+	// Swapchain presents are waited on, call again whenever it is recreated.
+	void SetSwapchain(VkSwapchainKHR InSwapchain);
+
+	void SetEnabled(bool bInEnabled)
+	{
+		Stats.bEnabled = bInEnabled;
+	}
+
+	// Sleeps until CPU work for the next frame should start, call before polling input.
+	void WaitForFrameStart();
+
+	// Time the render thread spent blocked on the GPU or swapchain this frame.
+	void AddBlockedTime(double Seconds)
+	{
+		BlockedSeconds += Seconds;
+	}
+
+	// GPU time of a recent frame, the frame's work is its CPU time up to the present plus this.
+	void SetGpuFrameTime(double Seconds)
+	{
+		GpuSeconds = Seconds;
+	}
+
+	// Chains a present id into PresentInfo when present wait is in use. PresentInfo must
+	// be submitted before the next call, the id struct lives in the pacer.
+	void OnPresent(VkPresentInfoKHR& PresentInfo);
+
+	const FFramePacingStats& GetStats() const
+	{
+		return Stats;
+	}
+
+private:
+
+	// Sleeps for most of Seconds and spins the rest, OS sleeps overshoot by up to a timer tick.
+	static void PreciseSleep(double Seconds);
+
+	void UpdatePresentWait();
+	void UpdateFenceTiming();
+
+	VkDevice 				Device 				= VK_NULL_HANDLE;
+	VkSwapchainKHR 			Swapchain 			= VK_NULL_HANDLE;
+	PFN_vkWaitForPresentKHR WaitForPresent 		= nullptr;
+	VkPresentIdKHR 			PresentIdInfo 		= {};
+	uint64 					LastPresentId 		= 0;
+	uint64 					FirstSwapchainId 	= 1;	// First id presented to the current swapchain.
+	uint64 					LastDisplayTime 	= 0;	// Nanoseconds on the steady clock.
+	uint64 					FrameStartTime 		= 0;	// When the last frame's CPU work started, after the delay.
+	uint64 					PresentTime 		= 0;	// When the last frame was handed to present.
+
+	FPacingController 		PresentPacing;
+	double 					RefreshSeconds 		= 1.0 / 60.0;
+	double 					DelaySeconds 		= 0.0;
+	double 					BlockedSeconds 		= 0.0;	// This frame so far.
+	double 					GpuSeconds 			= 0.0;
+	FFramePacingStats 		Stats;
+};
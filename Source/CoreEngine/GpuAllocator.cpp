@@ -0,0 +1,266 @@
+// Copyright Snaps 2022, All Rights Reserved.
+
+#include "GpuAllocator.h"
+#include <algorithm>
+
+void FGpuAllocator::Initialize(IGpuMemoryHeap* InHeap, uint64 InBlockSize, uint64 InGranularity)
+{
+	Heap = InHeap;
+	BlockSize = InBlockSize;
+	Granularity = InGranularity;
+}
+
+void FGpuAllocator::Shutdown()
+{
+	// Everything goes back to the heap, outstanding allocations included.
+	for(FBlock& Block : Blocks)
+	{
+		if(Block.bInUse)
+		{
+			Heap->FreeBlock(Block.Handle);
+		}
+	}
+	Blocks.clear();
+	PendingFrees.clear();
+	AllocatedBytes = 0;
+}
+
+bool FGpuAllocator::Allocate(uint64 Size, uint64 Alignment, FGpuAllocation& OutAllocation)
+{
+	// Blocks are tried in creation order, which keeps allocations packed into the oldest
+	// blocks and lets newer ones drain.
+	for(uint32 Block = 0; Block < Blocks.size(); Block++)
+	{
+		if(Blocks[Block].bInUse && AllocateFromBlock(Block, Size, Alignment, OutAllocation))
+		{
+			return true;
+		}
+	}
+
+	// Oversized requests get a block of their own.
+	const uint64 NewBlockSize = std::max(BlockSize, (Size + Alignment + Granularity - 1) & ~(Granularity - 1));
+	const uint32 Block = CreateBlock(NewBlockSize);
+	if(Block == FGpuAllocation::InvalidBlock)
+	{
+		return false;
+	}
+
+	return AllocateFromBlock(Block, Size, Alignment, OutAllocation);
+}
+
+void FGpuAllocator::Free(FGpuAllocation& Allocation)
+{
+	if(!Allocation.IsValid())
+	{
+		return;
+	}
+
+	FBlock& Block = Blocks[Allocation.Block];
+	AllocatedBytes -= Block.Ranges.GetSize(Allocation.Node);
+	Block.Ranges.Free(Allocation.Node);
+	Allocation = FGpuAllocation();
+
+	if(Block.Ranges.IsEmpty())
+	{
+		ReleaseEmptyBlocks(1);
+	}
+}
+
+uint32 FGpuAllocator::BeginDefragment(FGpuAllocation* const* Allocations, uint32 NumAllocations, uint64 MaxBytesToMove, std::vector<FGpuMove>& OutMoves)
+{
+	// Blocks ordered emptiest first. Sources are taken from the front and destinations
+	// from the back, so nothing ever moves into a block we're trying to empty.
+	std::vector<uint32> Order;
+	for(uint32 Block = 0; Block < Blocks.size(); Block++)
+	{
+		if(Blocks[Block].bInUse && !Blocks[Block].Ranges.IsEmpty())
+		{
+			Order.push_back(Block);
+		}
+	}
+
+	std::sort(Order.begin(), Order.end(), [this](uint32 A, uint32 B)
+	{
+		return Blocks[A].Ranges.GetAllocatedBytes() < Blocks[B].Ranges.GetAllocatedBytes();
+	});
+
+	// Movable allocations bucketed by block, biggest first so they get the pick of the free space.
+	std::vector<std::vector<FGpuAllocation*>> ByBlock(Blocks.size());
+	for(uint32 Index = 0; Index < NumAllocations; Index++)
+	{
+		if(Allocations[Index]->IsValid())
+		{
+			ByBlock[Allocations[Index]->Block].push_back(Allocations[Index]);
+		}
+	}
+
+	const uint32 FirstMove = (uint32)OutMoves.size();
+	uint64 BytesMoved = 0;
+	std::vector<bool> bReceivedMoves(Blocks.size(), false);
+
+	for(size_t Source = 0; Source + 1 < Order.size() && BytesMoved < MaxBytesToMove; Source++)
+	{
+		// Once we reach blocks that were filled up by this pass, everything left is a destination.
+		const uint32 SrcBlock = Order[Source];
+		if(bReceivedMoves[SrcBlock])
+		{
+			break;
+		}
+
+		std::vector<FGpuAllocation*>& Movable = ByBlock[SrcBlock];
+		std::sort(Movable.begin(), Movable.end(), [](const FGpuAllocation* A, const FGpuAllocation* B)
+		{
+			return A->Size > B->Size;
+		});
+
+		for(FGpuAllocation* Allocation : Movable)
+		{
+			if(BytesMoved + Allocation->Size > MaxBytesToMove)
+			{
+				break;
+			}
+
+			// Fill the fullest blocks first.
+			FGpuAllocation NewAllocation;
+			bool bPlaced = false;
+			for(size_t Destination = Order.size(); Destination-- > Source + 1 && !bPlaced;)
+			{
+				bPlaced = AllocateFromBlock(Order[Destination], Allocation->Size, Granularity, NewAllocation);
+			}
+
+			if(!bPlaced)
+			{
+				continue;
+			}
+
+			FGpuMove Move;
+			Move.SrcBlock = Allocation->Block;
+			Move.SrcOffset = Allocation->Offset;
+			Move.DstBlock = NewAllocation.Block;
+			Move.DstOffset = NewAllocation.Offset;
+			Move.Size = Allocation->Size;
+			OutMoves.push_back(Move);
+
+			// Old range stays reserved until the copy has run.
+			PendingFrees.push_back(*Allocation);
+			*Allocation = NewAllocation;
+			BytesMoved += Move.Size;
+			bReceivedMoves[Move.DstBlock] = true;
+		}
+	}
+
+	return (uint32)OutMoves.size() - FirstMove;
+}
+
+void FGpuAllocator::EndDefragment()
+{
+	for(FGpuAllocation& Allocation : PendingFrees)
+	{
+		AllocatedBytes -= Allocation.Size;
+		Blocks[Allocation.Block].Ranges.Free(Allocation.Node);
+	}
+	PendingFrees.clear();
+
+	ReleaseEmptyBlocks(1);
+}
+
+FGpuHeapStats FGpuAllocator::GetStats() const
+{
+	FGpuHeapStats Stats;
+	for(const FBlock& Block : Blocks)
+	{
+		if(!Block.bInUse)
+		{
+			continue;
+		}
+
+		Stats.NumBlocks++;
+		Stats.NumAllocations += Block.Ranges.GetNumAllocations();
+		Stats.ReservedBytes += Block.Ranges.GetCapacity();
+		Stats.AllocatedBytes += Block.Ranges.GetAllocatedBytes();
+		Stats.LargestFreeRange = std::max(Stats.LargestFreeRange, Block.Ranges.GetLargestFreeRange());
+	}
+
+	Stats.PeakAllocatedBytes = PeakAllocatedBytes;
+	Stats.TotalBlockAllocations = TotalBlockAllocations;
+	return Stats;
+}
+
+bool FGpuAllocator::Validate() const
+{
+	for(const FBlock& Block : Blocks)
+	{
+		if(Block.bInUse && !Block.Ranges.Validate())
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+bool FGpuAllocator::AllocateFromBlock(uint32 Block, uint64 Size, uint64 Alignment, FGpuAllocation& OutAllocation)
+{
+	uint64 Offset;
+	const uint32 Node = Blocks[Block].Ranges.Allocate(Size, Alignment, Offset);
+	if(Node == FTlsfAllocator::InvalidNode)
+	{
+		return false;
+	}
+
+	OutAllocation.Block = Block;
+	OutAllocation.Node = Node;
+	OutAllocation.Offset = Offset;
+	OutAllocation.Size = Blocks[Block].Ranges.GetSize(Node);
+
+	AllocatedBytes += OutAllocation.Size;
+	PeakAllocatedBytes = std::max(PeakAllocatedBytes, AllocatedBytes);
+	return true;
+}
+
+uint32 FGpuAllocator::CreateBlock(uint64 Size)
+{
+	uint64 Handle;
+	if(!Heap->AllocateBlock(Size, Handle))
+	{
+		return FGpuAllocation::InvalidBlock;
+	}
+	TotalBlockAllocations++;
+
+	// Reuse a released slot so block indices stay small and stable.
+	uint32 Block = 0;
+	while(Block < Blocks.size() && Blocks[Block].bInUse)
+	{
+		Block++;
+	}
+	if(Block == Blocks.size())
+	{
+		Blocks.push_back(FBlock());
+	}
+
+	Blocks[Block].Handle = Handle;
+	Blocks[Block].bInUse = true;
+	Blocks[Block].Ranges.Initialize(Size, Granularity);
+	return Block;
+}
+
+void FGpuAllocator::ReleaseEmptyBlocks(uint32 KeepEmpty)
+{
+	// Blocks with pending frees still have live ranges, so they never count as empty here.
+	uint32 NumEmpty = 0;
+	for(FBlock& Block : Blocks)
+	{
+		if(!Block.bInUse || !Block.Ranges.IsEmpty())
+		{
+			continue;
+		}
+
+		if(NumEmpty < KeepEmpty && Block.Ranges.GetCapacity() == BlockSize)
+		{
+			NumEmpty++;
+			continue;
+		}
+
+		Heap->FreeBlock(Block.Handle);
+		Block.bInUse = false;
+	}
+}
@@ -0,0 +1,145 @@
+// Copyright Snaps 2022, All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "TlsfAllocator.h"
+#include <vector>
+
+/*
+	Source of large memory blocks for FGpuAllocator. The renderer backs this with
+	vkAllocateMemory (FVulkanBufferHeap), tests and benchmarks can back it with
+	plain counters so the allocation logic runs without a GPU.
+*/
+class IGpuMemoryHeap
+{
+public:
+
+	virtual ~IGpuMemoryHeap() {}
+
+	// Reserves a new block of Size bytes. Returns false when the heap is out of memory.
+	virtual bool AllocateBlock(uint64 Size, uint64& OutHandle) = 0;
+	virtual void FreeBlock(uint64 Handle) = 0;
+};
+
+/*
+	A range inside one of an allocator's blocks.
+*/
+struct FGpuAllocation
+{
+	static const uint32 InvalidBlock = 0xFFFFFFFF;
+
+	uint32 	Block 	= InvalidBlock;
+	uint32 	Node 	= 0;
+	uint64 	Offset 	= 0;
+	uint64 	Size 	= 0;
+
+	bool IsValid() const
+	{
+		return Block != InvalidBlock;
+	}
+};
+
+/*
+	One copy the caller has to perform to carry out a defragmentation pass.
+*/
+struct FGpuMove
+{
+	uint32 	SrcBlock;
+	uint64 	SrcOffset;
+	uint32 	DstBlock;
+	uint64 	DstOffset;
+	uint64 	Size;
+};
+
+struct FGpuHeapStats
+{
+	uint32 	NumBlocks 				= 0;
+	uint32 	NumAllocations 			= 0;
+	uint64 	ReservedBytes 			= 0;	// Sum of all block sizes.
+	uint64 	AllocatedBytes 			= 0;
+	uint64 	PeakAllocatedBytes 		= 0;
+	uint64 	LargestFreeRange 		= 0;
+	uint64 	TotalBlockAllocations 	= 0;	// Blocks ever taken from the heap, i.e. real driver allocations.
+
+	// 0 when all free space is one range, towards 1 as it gets split into small pieces.
+	double GetFragmentation() const
+	{
+		const uint64 FreeBytes = ReservedBytes - AllocatedBytes;
+		return FreeBytes > 0 ? 1.0 - (double)LargestFreeRange / FreeBytes : 0.0;
+	}
+};
+
+/*
+	Sub-allocates ranges out of large blocks taken from an IGpuMemoryHeap, so
+	thousands of chunk meshes only cost a handful of real device allocations.
+	Each block is managed by a TLSF allocator, new blocks are taken from the
+	heap when no existing block fits and at most one empty block is kept around
+	to soak up churn. One allocator manages one heap / memory type, its stats
+	are that heap's stats.
+
+	Defragmentation moves allocations out of the emptiest blocks into the
+	fullest so the emptied blocks can go back to the heap. It's a two step
+	process because the GPU has to do the copies: BeginDefragment updates the
+	caller's allocations and returns the copies to record, EndDefragment frees
+	the old ranges once those copies (and any frame still reading the old
+	ranges) have finished. Moved allocations are only guaranteed Granularity
+	alignment.
+
+	Ranges must only be freed once the GPU is done with them (i.e. from a frame
+	deletion queue), freeing the last range of a block can hand it back to the
+	heap straight away. Not thread safe.
+*/
+class FGpuAllocator
+{
+public:
+
+	void Initialize(IGpuMemoryHeap* InHeap, uint64 InBlockSize, uint64 InGranularity = 16);
+	void Shutdown();
+
+	// Returns false only if the heap itself is out of memory.
+	bool Allocate(uint64 Size, uint64 Alignment, FGpuAllocation& OutAllocation);
+	void Free(FGpuAllocation& Allocation);
+
+	// Heap handle of one of the allocator's blocks, e.g. to look up the VkBuffer it belongs to.
+	uint64 GetBlockHandle(uint32 Block) const
+	{
+		return Blocks[Block].Handle;
+	}
+
+	// Moves at most MaxBytesToMove worth of the given allocations, updating them in place.
+	// Returns the number of moves added to OutMoves.
+	uint32 BeginDefragment(FGpuAllocation* const* Allocations, uint32 NumAllocations, uint64 MaxBytesToMove, std::vector<FGpuMove>& OutMoves);
+	void EndDefragment();
+
+	FGpuHeapStats GetStats() const;
+
+	// Validates every block, slow, for tests and debugging.
+	bool Validate() const;
+
+private:
+
+	struct FBlock
+	{
+		uint64 			Handle 	= 0;
+		bool 			bInUse 	= false;
+		FTlsfAllocator 	Ranges;
+	};
+
+	bool AllocateFromBlock(uint32 Block, uint64 Size, uint64 Alignment, FGpuAllocation& OutAllocation);
+	uint32 CreateBlock(uint64 Size);
+
+	// Gives empty blocks back to the heap, keeping KeepEmpty of them.
+	void ReleaseEmptyBlocks(uint32 KeepEmpty);
+
+	IGpuMemoryHeap* 			Heap 			= nullptr;
+	uint64 						BlockSize 		= 0;
+	uint64 						Granularity 	= 16;
+
+	std::vector<FBlock> 		Blocks;
+	std::vector<FGpuAllocation> PendingFrees;	// Old ranges of moved allocations, freed by EndDefragment.
+
+	uint64 						AllocatedBytes 			= 0;
+	uint64 						PeakAllocatedBytes 		= 0;
+	uint64 						TotalBlockAllocations 	= 0;
+};
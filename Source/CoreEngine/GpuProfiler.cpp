@@ -0,0 +1,156 @@
+// Copyright Snaps 2022, All Rights Reserved.
+
+#include "GpuProfiler.h"
+#include "Profiler.h"
+#include "VulkanHelpers.h"
+
+// Timestamps each frame slot can write, two per zone. Zones past this are dropped.
+static const uint32 MaxQueriesPerFrame = 128;
+
+void FGpuProfiler::Initialize(VkDevice InDevice, VkPhysicalDevice PhysicalDevice, uint32 QueueFamily, uint32 NumFrames)
+{
+	Device = InDevice;
+	Frames = std::vector<FFrameQueries>(NumFrames);
+	Results = std::vector<uint64>(MaxQueriesPerFrame);
+
+	VkPhysicalDeviceProperties Properties;
+	vkGetPhysicalDeviceProperties(PhysicalDevice, &Properties);
+
+	uint32 NumFamilies = 0;
+	vkGetPhysicalDeviceQueueFamilyProperties(PhysicalDevice, &NumFamilies, nullptr);
+	std::vector<VkQueueFamilyProperties> Families(NumFamilies);
+	vkGetPhysicalDeviceQueueFamilyProperties(PhysicalDevice, &NumFamilies, Families.data());
+
+	// Zero valid bits means the queue can't write timestamps at all, leave the profiler switched off.
+	const uint32 ValidBits = QueueFamily < NumFamilies ? Families[QueueFamily].timestampValidBits : 0;
+	if(ValidBits == 0 || Properties.limits.timestampPeriod <= 0.f)
+	{
+		SDL_Log("GPU timestamps not supported on queue family %u, GPU zones disabled", QueueFamily);
+		return;
+	}
+
+	NanosecondsPerTick = Properties.limits.timestampPeriod;
+	TimestampMask = ValidBits >= 64 ? ~0ull : (1ull << ValidBits) - 1;
+
+	VkQueryPoolCreateInfo QueryPoolInfo {};
+	QueryPoolInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+	QueryPoolInfo.queryType = VK_QUERY_TYPE_TIMESTAMP;
+	QueryPoolInfo.queryCount = MaxQueriesPerFrame * NumFrames;
+
+	VK_CHECK(vkCreateQueryPool(Device, &QueryPoolInfo, nullptr, &QueryPool));
+}
+
+void FGpuProfiler::Shutdown()
+{
+	if(QueryPool != VK_NULL_HANDLE)
+	{
+		vkDestroyQueryPool(Device, QueryPool, nullptr);
+		QueryPool = VK_NULL_HANDLE;
+	}
+	Frames.clear();
+}
+
+void FGpuProfiler::BeginFrame(uint32 FrameIndex, VkCommandBuffer CommandBuffer)
+{
+	if(!IsSupported())
+	{
+		return;
+	}
+
+	// The caller has waited on this slot's fence, so everything it wrote last time round is available.
+	CollectResults(FrameIndex);
+
+	CurrentFrame = FrameIndex;
+	FFrameQueries& Frame = Frames[FrameIndex];
+	Frame.Zones.clear();
+	Frame.NumQueries = 0;
+
+	vkCmdResetQueryPool(CommandBuffer, QueryPool, FrameIndex * MaxQueriesPerFrame, MaxQueriesPerFrame);
+
+	Frame.FrameZone = BeginZone(CommandBuffer, "Frame");
+}
+
+void FGpuProfiler::EndFrame(VkCommandBuffer CommandBuffer)
+{
+	if(!IsSupported())
+	{
+		return;
+	}
+
+	EndZone(CommandBuffer, Frames[CurrentFrame].FrameZone);
+	Frames[CurrentFrame].FrameZone = InvalidZone;
+}
+
+uint32 FGpuProfiler::BeginZone(VkCommandBuffer CommandBuffer, const char* Name)
+{
+	if(!IsSupported() || !FProfiler::IsEnabled())
+	{
+		return InvalidZone;
+	}
+
+	// Keep room for the end query of every zone that is still open.
+	FFrameQueries& Frame = Frames[CurrentFrame];
+	if(Frame.NumQueries + 2 > MaxQueriesPerFrame)
+	{
+		return InvalidZone;
+	}
+
+	FGpuZone Zone;
+	Zone.Name = Name;
+	Zone.BeginQuery = Frame.NumQueries++;
+	Zone.EndQuery = Frame.NumQueries++;
+	Frame.Zones.push_back(Zone);
+
+	vkCmdWriteTimestamp(CommandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, QueryPool, CurrentFrame * MaxQueriesPerFrame + Zone.BeginQuery);
+	return (uint32)Frame.Zones.size() - 1;
+}
+
+void FGpuProfiler::EndZone(VkCommandBuffer CommandBuffer, uint32 Zone)
+{
+	if(Zone == InvalidZone)
+	{
+		return;
+	}
+
+	const FGpuZone& GpuZone = Frames[CurrentFrame].Zones[Zone];
+	vkCmdWriteTimestamp(CommandBuffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, QueryPool, CurrentFrame * MaxQueriesPerFrame + GpuZone.EndQuery);
+}
+
+void FGpuProfiler::CollectResults(uint32 FrameIndex)
+{
+	const FFrameQueries& Frame = Frames[FrameIndex];
+	if(Frame.NumQueries == 0)
+	{
+		return;
+	}
+
+	// No wait flag, if the slot somehow isn't finished we skip its zones rather than stall.
+	const VkResult Result = vkGetQueryPoolResults(
+		Device,
+		QueryPool,
+		FrameIndex * MaxQueriesPerFrame,
+		Frame.NumQueries,
+		Frame.NumQueries * sizeof(uint64),
+		Results.data(),
+		sizeof(uint64),
+		VK_QUERY_RESULT_64_BIT
+	);
+
+	if(Result != VK_SUCCESS)
+	{
+		return;
+	}
+
+	for(const FGpuZone& Zone : Frame.Zones)
+	{
+		// Masking the difference keeps zones right when the counter wraps between the two writes.
+		const uint64 Ticks = (Results[Zone.EndQuery] - Results[Zone.BeginQuery]) & TimestampMask;
+		FProfiler::AddZoneTime(Zone.Name, Ticks * NanosecondsPerTick / 1000000.0, true);
+
+		// BeginFrame opens the frame zone before anything else.
+		if(&Zone == &Frame.Zones.front())
+		{
+			LastFrameSeconds = Ticks * NanosecondsPerTick / 1e9;
+		}
+	}
+}
@@ -0,0 +1,124 @@
+// Copyright Snaps 2022, All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "CoreMacros.h"
+#include "vulkan.h"
+#include <vector>
+
+/*
+	Times GPU work with timestamp queries and feeds the results into FProfiler's
+	zone stats next to the CPU zones. Every frame in flight owns its own range of
+	queries, which are only read back once that frame slot comes round again and
+	its fence has been waited on, so results arrive frames in flight late and
+	reading them never stalls the CPU.
+
+	Zones are opened and closed on a command buffer with BeginZone / EndZone or
+	PROFILE_GPU_SCOPE, and the whole command buffer is timed as the "Frame" zone
+	between BeginFrame and EndFrame. Devices whose graphics queue can't write
+	timestamps turn every call into a no-op.
+
+	Not thread safe, zones are recorded on the render thread.
+*/
+class FGpuProfiler
+{
+public:
+
+	static const uint32 InvalidZone = UINT32_MAX;
+
+	void Initialize(VkDevice Device, VkPhysicalDevice PhysicalDevice, uint32 QueueFamily, uint32 NumFrames);
+	void Shutdown();
+
+	// Collects the results FrameIndex's slot recorded last time round, then resets its queries and
+	// opens the frame zone. Call right after beginning the frame's command buffer, outside any render pass.
+	void BeginFrame(uint32 FrameIndex, VkCommandBuffer CommandBuffer);
+
+	// Closes the frame zone, call just before ending the command buffer.
+	void EndFrame(VkCommandBuffer CommandBuffer);
+
+	// Name must outlive the profiler, zone names are string literals. Returns the zone to end.
+	uint32 BeginZone(VkCommandBuffer CommandBuffer, const char* Name);
+	void EndZone(VkCommandBuffer CommandBuffer, uint32 Zone);
+
+	bool IsSupported() const
+	{
+		return QueryPool != VK_NULL_HANDLE;
+	}
+
+	// GPU time of the last frame whose results were collected, a ring of frames behind. 0 until there is one.
+	double GetLastFrameSeconds() const
+	{
+		return LastFrameSeconds;
+	}
+
+private:
+
+	struct FGpuZone
+	{
+		const char* Name;
+		uint32 		BeginQuery;
+		uint32 		EndQuery;
+	};
+
+	struct FFrameQueries
+	{
+		std::vector<FGpuZone> 	Zones;
+		uint32 					NumQueries = 0;		// Written this time round, relative to the slot's first query.
+		uint32 					FrameZone 	= InvalidZone;
+	};
+
+	// Reads back the slot's timestamps and hands each finished zone to FProfiler.
+	void CollectResults(uint32 FrameIndex);
+
+	VkDevice 					Device 			= VK_NULL_HANDLE;
+	VkQueryPool 				QueryPool 		= VK_NULL_HANDLE;
+	double 						NanosecondsPerTick = 1.0;
+	uint64 						TimestampMask 	= ~0ull;
+
+	std::vector<FFrameQueries> 	Frames;
+	std::vector<uint64> 		Results;
+	uint32 						CurrentFrame 	= 0;
+	double 						LastFrameSeconds = 0.0;
+};
+
+/*
+	Times the GPU commands recorded between construction and destruction as one zone.
+	Use through PROFILE_GPU_SCOPE.
+*/
+class FGpuProfileScope
+{
+public:
+
+	FGpuProfileScope(FGpuProfiler* InProfiler, VkCommandBuffer InCommandBuffer, const char* Name)
+		: Profiler(InProfiler)
+		, CommandBuffer(InCommandBuffer)
+		, Zone(InProfiler->BeginZone(InCommandBuffer, Name))
+	{
+	}
+
+	~FGpuProfileScope()
+	{
+		Profiler->EndZone(CommandBuffer, Zone);
+	}
+
+	FGpuProfileScope(const FGpuProfileScope&) = delete;
+	FGpuProfileScope& operator=(const FGpuProfileScope&) = delete;
+
+private:
+
+	FGpuProfiler* 	Profiler;
+	VkCommandBuffer CommandBuffer;
+	uint32 			Zone;
+};
+
+#if VOXEL_PROFILING
+
+// Times the commands recorded into CommandBuffer for the rest of the enclosing scope.
+#define PROFILE_GPU_SCOPE(Profiler, CommandBuffer, Name) FGpuProfileScope VOXEL_CONCAT(GpuProfileScope_, __LINE__)(Profiler, CommandBuffer, Name)
+
+#else
+
+#define PROFILE_GPU_SCOPE(Profiler, CommandBuffer, Name)
+
+#endif
@@ -0,0 +1,358 @@
+// Copyright Snaps 2022, All Rights Reserved.
+
+#include "JobSystem.h"
+#include "CoreMacros.h"
+
+// Per thread bookkeeping so Schedule() knows which deque belongs to the caller.
+static thread_local FJobSystem* GCurrentJobSystem 	= nullptr;
+static thread_local int32 		GCurrentThreadIndex = -1;
+static thread_local uint32 		GStealSeed 			= 0x9E3779B9u;
+
+// Capacity of each per-thread deque, must be a power of 2.
+static const uint32 JobQueueCapacity = 4096;
+
+// How many times an idle worker polls for work before it goes to sleep.
+static const int32 WorkerSpinCount = 64;
+
+FJobQueue::FJobQueue(uint32 Capacity)
+	: Top(0)
+	, Bottom(0)
+	, Jobs(Capacity)
+	, Mask((int64)Capacity - 1)
+{
+}
+
+bool FJobQueue::Push(const FJob& Job)
+{
+	const int64 CurrentBottom = Bottom.load(std::memory_order_relaxed);
+	const int64 CurrentTop = Top.load(std::memory_order_acquire);
+
+	// Deque is full, caller decides what to do with the job.
+	if(CurrentBottom - CurrentTop > Mask)
+	{
+		return false;
+	}
+
+	Jobs[CurrentBottom & Mask] = Job;
+
+	// Job must be visible before thieves can see the new bottom.
+	std::atomic_thread_fence(std::memory_order_release);
+	Bottom.store(CurrentBottom + 1, std::memory_order_relaxed);
+	return true;
+}
+
+bool FJobQueue::Pop(FJob& OutJob)
+{
+	const int64 NewBottom = Bottom.load(std::memory_order_relaxed) - 1;
+	Bottom.store(NewBottom, std::memory_order_relaxed);
+	std::atomic_thread_fence(std::memory_order_seq_cst);
+	int64 CurrentTop = Top.load(std::memory_order_relaxed);
+
+	// Empty, restore bottom.
+	if(CurrentTop > NewBottom)
+	{
+		Bottom.store(NewBottom + 1, std::memory_order_relaxed);
+		return false;
+	}
+
+	OutJob = Jobs[NewBottom & Mask];
+
+	// More than one job left, no thief can race us for this one.
+	if(CurrentTop != NewBottom)
+	{
+		return true;
+	}
+
+	// Last job in the deque, race any thieves for it.
+	const bool bWon = Top.compare_exchange_strong(
+		CurrentTop,
+		CurrentTop + 1,
+		std::memory_order_seq_cst,
+		std::memory_order_relaxed
+	);
+
+	Bottom.store(NewBottom + 1, std::memory_order_relaxed);
+	return bWon;
+}
+
+bool FJobQueue::Steal(FJob& OutJob)
+{
+	int64 CurrentTop = Top.load(std::memory_order_acquire);
+	std::atomic_thread_fence(std::memory_order_seq_cst);
+	const int64 CurrentBottom = Bottom.load(std::memory_order_acquire);
+
+	if(CurrentTop >= CurrentBottom)
+	{
+		return false;
+	}
+
+	// Copy first, only keep it if we actually claimed the slot.
+	const FJob Job = Jobs[CurrentTop & Mask];
+	if(!Top.compare_exchange_strong(
+		CurrentTop,
+		CurrentTop + 1,
+		std::memory_order_seq_cst,
+		std::memory_order_relaxed))
+	{
+		return false;
+	}
+
+	OutJob = Job;
+	return true;
+}
+
+FJobSystem::FJobSystem()
+	: NumExternalJobs(0)
+	, NumSleeping(0)
+	, NumPendingJobs(0)
+	, bRunning(false)
+{
+}
+
+FJobSystem::~FJobSystem()
+{
+	Shutdown();
+}
+
+void FJobSystem::Initialize(uint32 NumThreads)
+{
+	if(bRunning.load())
+	{
+		return;
+	}
+
+	// One worker per core. hardware_concurrency is allowed to return 0.
+	if(NumThreads == 0)
+	{
+		NumThreads = std::thread::hardware_concurrency();
+	}
+	NumThreads = NumThreads > 0 ? NumThreads : 1;
+
+	for(uint32 Index = 0; Index < NumThreads; Index++)
+	{
+		Queues.push_back(std::make_unique<FJobQueue>(JobQueueCapacity));
+	}
+
+	// The calling (main) thread owns queue 0.
+	GCurrentJobSystem = this;
+	GCurrentThreadIndex = 0;
+
+	bRunning.store(true);
+	for(uint32 Index = 1; Index < NumThreads; Index++)
+	{
+		Workers.emplace_back(&FJobSystem::WorkerMain, this, Index);
+	}
+}
+
+void FJobSystem::Shutdown()
+{
+	if(!bRunning.exchange(false))
+	{
+		return;
+	}
+
+	{
+		std::lock_guard<std::mutex> Lock(SleepMutex);
+		WakeCondition.notify_all();
+	}
+
+	for(std::thread& Worker : Workers)
+	{
+		Worker.join();
+	}
+	Workers.clear();
+
+	// Flush anything that was still queued so no counter is left waiting forever.
+	FJob Job;
+	while(TryGetJob(GetCurrentThreadIndex(), Job))
+	{
+		RunJob(Job);
+	}
+
+	Queues.clear();
+	if(GCurrentJobSystem == this)
+	{
+		GCurrentJobSystem = nullptr;
+		GCurrentThreadIndex = -1;
+	}
+}
+
+int32 FJobSystem::GetCurrentThreadIndex() const
+{
+	return GCurrentJobSystem == this ? GCurrentThreadIndex : -1;
+}
+
+void FJobSystem::Schedule(FJobFunction Function, void* Data, FJobCounter* Counter)
+{
+	FJob Job;
+	Job.Function = Function;
+	Job.Data = Data;
+	Job.Counter = Counter;
+
+	if(Counter)
+	{
+		Counter->Value.fetch_add(1, std::memory_order_relaxed);
+	}
+
+	// Not running, nobody would ever pick this up so just run it now.
+	if(!bRunning.load(std::memory_order_relaxed))
+	{
+		RunJob(Job);
+		return;
+	}
+
+	NumPendingJobs.fetch_add(1, std::memory_order_release);
+
+	const int32 ThreadIndex = GetCurrentThreadIndex();
+	if(ThreadIndex < 0)
+	{
+		std::lock_guard<std::mutex> Lock(ExternalMutex);
+		ExternalJobs.push_back(Job);
+		NumExternalJobs.fetch_add(1, std::memory_order_release);
+	}
+	else
+	{
+		// Our deque is full, help drain it until there is space again.
+		while(!Queues[ThreadIndex]->Push(Job))
+		{
+			TryRunJob(ThreadIndex);
+		}
+	}
+
+	WakeWorkers();
+}
+
+void FJobSystem::Wait(FJobCounter& Counter)
+{
+	const int32 ThreadIndex = GetCurrentThreadIndex();
+	while(!Counter.IsDone())
+	{
+		if(!TryRunJob(ThreadIndex))
+		{
+			std::this_thread::yield();
+		}
+	}
+}
+
+void FJobSystem::WorkerMain(uint32 ThreadIndex)
+{
+	GCurrentJobSystem = this;
+	GCurrentThreadIndex = (int32)ThreadIndex;
+	GStealSeed ^= ThreadIndex * 0x85EBCA6Bu;
+
+	const std::string ThreadName = "Worker " + std::to_string(ThreadIndex);
+	PROFILE_THREAD_NAME(ThreadName.c_str());
+
+	int32 SpinCount = 0;
+	while(bRunning.load(std::memory_order_relaxed))
+	{
+		if(TryRunJob((int32)ThreadIndex))
+		{
+			SpinCount = 0;
+			continue;
+		}
+
+		if(++SpinCount < WorkerSpinCount)
+		{
+			std::this_thread::yield();
+			continue;
+		}
+
+		// Nothing to do for a while, sleep until something gets scheduled.
+		// The timeout covers the small window where a wake can be missed.
+		std::unique_lock<std::mutex> Lock(SleepMutex);
+		NumSleeping.fetch_add(1);
+		WakeCondition.wait_for(Lock, std::chrono::milliseconds(1), [this]()
+		{
+			return !bRunning.load() || NumPendingJobs.load(std::memory_order_acquire) > 0;
+		});
+		NumSleeping.fetch_sub(1);
+		SpinCount = 0;
+	}
+
+	GCurrentJobSystem = nullptr;
+	GCurrentThreadIndex = -1;
+}
+
+bool FJobSystem::TryRunJob(int32 ThreadIndex)
+{
+	FJob Job;
+	if(!TryGetJob(ThreadIndex, Job))
+	{
+		return false;
+	}
+
+	RunJob(Job);
+	return true;
+}
+
+bool FJobSystem::TryGetJob(int32 ThreadIndex, FJob& OutJob)
+{
+	const int32 NumQueues = (int32)Queues.size();
+	if(NumQueues == 0)
+	{
+		return false;
+	}
+
+	// Own deque first, it's the hottest in cache.
+	bool bFound = ThreadIndex >= 0 && Queues[ThreadIndex]->Pop(OutJob);
+
+	// Only take the lock when something is actually waiting in the external queue.
+	if(!bFound && NumExternalJobs.load(std::memory_order_acquire) > 0)
+	{
+		std::lock_guard<std::mutex> Lock(ExternalMutex);
+		if(!ExternalJobs.empty())
+		{
+			OutJob = ExternalJobs.front();
+			ExternalJobs.pop_front();
+			NumExternalJobs.fetch_sub(1, std::memory_order_relaxed);
+			bFound = true;
+		}
+	}
+
+	// Steal from the other threads, starting at a random victim.
+	if(!bFound)
+	{
+		GStealSeed ^= GStealSeed << 13;
+		GStealSeed ^= GStealSeed >> 17;
+		GStealSeed ^= GStealSeed << 5;
+
+		const int32 FirstVictim = (int32)(GStealSeed % (uint32)NumQueues);
+		for(int32 Offset = 0; Offset < NumQueues && !bFound; Offset++)
+		{
+			const int32 Victim = (FirstVictim + Offset) % NumQueues;
+			if(Victim != ThreadIndex)
+			{
+				bFound = Queues[Victim]->Steal(OutJob);
+			}
+		}
+	}
+
+	if(bFound)
+	{
+		NumPendingJobs.fetch_sub(1, std::memory_order_relaxed);
+	}
+	return bFound;
+}
+
+void FJobSystem::RunJob(const FJob& Job)
+{
+	{
+		PROFILE_SCOPE("Job");
+		Job.Function(Job.Data);
+	}
+
+	if(Job.Counter)
+	{
+		Job.Counter->Value.fetch_sub(1, std::memory_order_release);
+	}
+}
+
+void FJobSystem::WakeWorkers()
+{
+	if(NumSleeping.load(std::memory_order_relaxed) > 0)
+	{
+		std::lock_guard<std::mutex> Lock(SleepMutex);
+		WakeCondition.notify_one();
+	}
+}
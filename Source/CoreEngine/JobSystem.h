@@ -0,0 +1,165 @@
+// Copyright Snaps 2022, All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+using FJobFunction = void(*)(void* Data);
+
+/*
+	Counter used to wait on a group of jobs. Every scheduled job increments
+	the counter and decrements it once it has finished running.
+*/
+struct FJobCounter
+{
+	std::atomic<int32> Value { 0 };
+
+	bool IsDone() const
+	{
+		return Value.load(std::memory_order_acquire) == 0;
+	}
+};
+
+/*
+	A single unit of work. Jobs are plain function pointers + user data so they
+	can be copied in and out of the deques without any allocations.
+*/
+struct FJob
+{
+	FJobFunction 	Function 	= nullptr;
+	void* 			Data 		= nullptr;
+	FJobCounter* 	Counter 	= nullptr;
+};
+
+/*
+	Fixed capacity Chase-Lev work-stealing deque. The owning thread pushes and
+	pops from the bottom, any other thread can steal from the top.
+*/
+class FJobQueue
+{
+public:
+
+	explicit FJobQueue(uint32 Capacity);
+
+	bool Push(const FJob& Job); 	// Owner thread only. Returns false when full.
+	bool Pop(FJob& OutJob); 		// Owner thread only.
+	bool Steal(FJob& OutJob); 		// Any thread.
+
+private:
+
+	alignas(64) std::atomic<int64> 	Top;
+	alignas(64) std::atomic<int64> 	Bottom;
+	std::vector<FJob> 				Jobs;
+	int64 							Mask;
+};
+
+/*
+	Work-stealing job system owned by FEngine. Runs one worker per core, the main
+	thread counts as worker 0 so it can schedule and help out while waiting.
+	Jobs scheduled from threads the job system doesn't own go through a locked
+	external queue instead of a deque.
+*/
+class FJobSystem
+{
+public:
+
+	FJobSystem();
+	~FJobSystem();
+
+	// Starts the workers. NumThreads of 0 will use one thread per hardware core.
+	void Initialize(uint32 NumThreads = 0);
+	void Shutdown();
+
+	// Queue a job, Counter is optional and can be waited on with Wait().
+	void Schedule(FJobFunction Function, void* Data, FJobCounter* Counter = nullptr);
+
+	// Runs other jobs on the calling thread until the counter reaches zero.
+	void Wait(FJobCounter& Counter);
+
+	// Run Body(Index) for every index in [0, Count), split into batches of BatchSize. Blocks until done.
+	template<typename FunctionType>
+	void ParallelFor(uint32 Count, uint32 BatchSize, const FunctionType& Body);
+
+	// Number of threads executing jobs, including the main thread.
+	uint32 GetNumThreads() const
+	{
+		return (uint32)Queues.size();
+	}
+
+	// Index of the calling thread in the job system, or -1 for foreign threads.
+	int32 GetCurrentThreadIndex() const;
+
+	bool IsRunning() const
+	{
+		return bRunning.load(std::memory_order_relaxed);
+	}
+
+private:
+
+	void WorkerMain(uint32 ThreadIndex);
+	bool TryRunJob(int32 ThreadIndex);
+	bool TryGetJob(int32 ThreadIndex, FJob& OutJob);
+	void RunJob(const FJob& Job);
+	void WakeWorkers();
+
+	std::vector<std::unique_ptr<FJobQueue>> Queues; 		// One per thread, index 0 is the main thread.
+	std::vector<std::thread> 				Workers;
+
+	std::mutex 								ExternalMutex;
+	std::deque<FJob> 						ExternalJobs; 	// Jobs scheduled by threads we don't own.
+	std::atomic<int32> 						NumExternalJobs;
+
+	std::mutex 								SleepMutex;
+	std::condition_variable 				WakeCondition;
+	std::atomic<int32> 						NumSleeping;
+	std::atomic<int32> 						NumPendingJobs;
+	std::atomic<bool> 						bRunning;
+};
+
+template<typename FunctionType>
+void FJobSystem::ParallelFor(uint32 Count, uint32 BatchSize, const FunctionType& Body)
+{
+	struct FBatch
+	{
+		const FunctionType* Body;
+		uint32 				Begin;
+		uint32 				End;
+	};
+
+	if(Count == 0)
+	{
+		return;
+	}
+
+	BatchSize = BatchSize > 0 ? BatchSize : 1;
+	const uint32 NumBatches = (Count + BatchSize - 1) / BatchSize;
+
+	// Batches live on this stack frame, which is safe because we wait below.
+	std::vector<FBatch> Batches(NumBatches);
+	FJobCounter Counter;
+
+	for(uint32 Index = 0; Index < NumBatches; Index++)
+	{
+		FBatch& Batch = Batches[Index];
+		Batch.Body = &Body;
+		Batch.Begin = Index * BatchSize;
+		Batch.End = Batch.Begin + BatchSize < Count ? Batch.Begin + BatchSize : Count;
+
+		Schedule([](void* Data)
+		{
+			const FBatch* Batch = static_cast<const FBatch*>(Data);
+			for(uint32 Item = Batch->Begin; Item < Batch->End; Item++)
+			{
+				(*Batch->Body)(Item);
+			}
+		}, &Batch, &Counter);
+	}
+
+	Wait(Counter);
+}
@@ -0,0 +1,641 @@
+// Copyright Snaps 2022, All Rights Reserved.
+
+#include "LightEngine.h"
+#include "CoreMacros.h"
+#include "VoxelChunk.h"
+#include <algorithm>
+
+/*
+	Sides of a voxel, X then Y then Z, negative side first so Direction ^ 1 is
+	the opposite one. Voxel indices are X | Z << 5 | Y << 10, so each axis is a
+	5 bit field at AxisShift.
+*/
+static const int32 DirectionDown = 2;
+static const int32 DirectionDelta[6][3] = { { -1, 0, 0 }, { 1, 0, 0 }, { 0, -1, 0 }, { 0, 1, 0 }, { 0, 0, -1 }, { 0, 0, 1 } };
+static const int32 AxisShift[3] = { 0, ChunkSizeLog2 * 2, ChunkSizeLog2 };
+
+// Index of the voxel next to Index on the Direction side. Returns false when that's in the neighbouring
+// chunk, OutIndex is then the voxel's index in there.
+static bool StepIndex(int32 Index, int32 Direction, int32& OutIndex)
+{
+	const int32 Shift = AxisShift[Direction >> 1];
+	const int32 Coord = (Index >> Shift) & (ChunkSize - 1);
+	if(Direction & 1)
+	{
+		if(Coord == ChunkSize - 1)
+		{
+			OutIndex = Index - ((ChunkSize - 1) << Shift);
+			return false;
+		}
+		OutIndex = Index + (1 << Shift);
+		return true;
+	}
+
+	if(Coord == 0)
+	{
+		OutIndex = Index + ((ChunkSize - 1) << Shift);
+		return false;
+	}
+	OutIndex = Index - (1 << Shift);
+	return true;
+}
+
+// Index of the voxel at A, B on the Direction side of the chunk, A and B along the other two axes in order.
+static int32 FaceIndex(int32 Direction, int32 A, int32 B)
+{
+	const int32 Axis = Direction >> 1;
+	int32 Coords[3];
+	Coords[Axis] = (Direction & 1) ? ChunkSize - 1 : 0;
+	Coords[Axis == 0 ? 1 : 0] = A;
+	Coords[Axis == 2 ? 1 : 2] = B;
+	return FVoxelChunk::ToIndex(Coords[0], Coords[1], Coords[2]);
+}
+
+static uint8 GetChannel(uint8 Light, bool bSky)
+{
+	return bSky ? GetSkyLight(Light) : GetBlockLight(Light);
+}
+
+static uint8 SetChannel(uint8 Light, bool bSky, uint8 Level)
+{
+	return bSky ? (uint8)((Light & 0xF) | (Level << 4)) : (uint8)((Light & 0xF0) | Level);
+}
+
+// Light Level passes on to the voxel on the Direction side.
+static uint8 SpreadLevel(uint8 Level, bool bSky, int32 Direction)
+{
+	return (bSky && Direction == DirectionDown && Level == MaxLightLevel) ? MaxLightLevel : Level - 1;
+}
+
+FLightEngine::FLightEngine(FJobSystem* InJobSystem, const FChunkMap* InChunkMap)
+	: JobSystem(InJobSystem)
+	, ChunkMap(InChunkMap)
+	, BlockInfo(1 << (sizeof(FBlockId) * 8), OpaqueBit)
+{
+	BlockInfo[BlockAir] = 0;
+}
+
+FLightEngine::~FLightEngine()
+{
+}
+
+void FLightEngine::SetBlockLight(FBlockId Block, uint8 Emission, bool bOpaque)
+{
+	BlockInfo[Block] = (uint8)(std::min(Emission, MaxLightLevel) | (bOpaque ? OpaqueBit : 0));
+}
+
+void FLightEngine::OnChunkLoaded(int32 X, int32 Y, int32 Z)
+{
+	LoadedChunks.push_back(FChunkMap::PackKey(X, Y, Z));
+}
+
+void FLightEngine::OnChunkUnloaded(int32 X, int32 Y, int32 Z)
+{
+	UnloadedChunks.push_back(FChunkMap::PackKey(X, Y, Z));
+}
+
+void FLightEngine::OnBlockChanged(int32 X, int32 Y, int32 Z)
+{
+	PendingEdits.push_back({ X, Y, Z });
+}
+
+void FLightEngine::Update()
+{
+	PROFILE_FUNCTION();
+
+	RelitChunks.clear();
+	ApplyChunkChanges();
+
+	if(!NewChunks.empty())
+	{
+		PROFILE_SCOPE("LightNewChunks");
+		JobSystem->ParallelFor((uint32)NewChunks.size(), 1, [this](uint32 Index)
+		{
+			LightChunk(*NewChunks[Index]);
+		});
+
+		// Chunks that were already lit spread into new neighbours once removals are done, whatever
+		// they still have by then.
+		for(FLightChunk* Entry : NewChunks)
+		{
+			if(!Entry->Additions.empty())
+			{
+				QueueAdditions(*Entry);
+			}
+
+			for(int32 Direction = 0; Direction < 6; Direction++)
+			{
+				FLightChunk* Neighbour = FindChunk(Entry->X + DirectionDelta[Direction][0], Entry->Y + DirectionDelta[Direction][1], Entry->Z + DirectionDelta[Direction][2]);
+				if(Neighbour && !Neighbour->bNew)
+				{
+					ReseedFace(*Neighbour, Direction ^ 1);
+				}
+			}
+		}
+
+		// Only chunks lit as open sky under a new one get anything, and that's removals.
+		DeliverOutboxes(NewChunks, true);
+	}
+
+	ApplyEdits();
+
+	{
+		PROFILE_SCOPE("LightRemovals");
+		RunPass(true);
+	}
+	{
+		PROFILE_SCOPE("LightAdditions");
+		RunPass(false);
+	}
+
+	for(FLightChunk* Entry : NewChunks)
+	{
+		Entry->bNew = false;
+		RelitChunks.push_back(FChunkMap::PackKey(Entry->X, Entry->Y, Entry->Z));
+	}
+	Stats.NumChunksLit += NewChunks.size();
+	NewChunks.clear();
+
+	std::sort(RelitChunks.begin(), RelitChunks.end());
+	RelitChunks.erase(std::unique(RelitChunks.begin(), RelitChunks.end()), RelitChunks.end());
+}
+
+FLightEngine::FLightChunk* FLightEngine::FindChunk(int32 X, int32 Y, int32 Z) const
+{
+	auto It = Chunks.find(FChunkMap::PackKey(X, Y, Z));
+	return It != Chunks.end() ? It->second.get() : nullptr;
+}
+
+void FLightEngine::ApplyChunkChanges()
+{
+	for(uint64 Key : UnloadedChunks)
+	{
+		Chunks.erase(Key);
+	}
+	UnloadedChunks.clear();
+
+	for(uint64 Key : LoadedChunks)
+	{
+		FVoxelChunk* Chunk = ChunkMap->FindKey(Key);
+		if(!Chunk)
+		{
+			continue;
+		}
+
+		std::unique_ptr<FLightChunk>& Entry = Chunks[Key];
+		if(Entry && Entry->bNew)
+		{
+			continue;
+		}
+		if(!Entry)
+		{
+			Entry.reset(new FLightChunk());
+			FChunkMap::UnpackKey(Key, Entry->X, Entry->Y, Entry->Z);
+		}
+		Entry->Chunk = Chunk;
+		Entry->bNew = true;
+		NewChunks.push_back(Entry.get());
+	}
+	LoadedChunks.clear();
+}
+
+void FLightEngine::ApplyEdits()
+{
+	PROFILE_FUNCTION();
+
+	for(const FBlockPosition& Edit : PendingEdits)
+	{
+		FLightChunk* Entry = FindChunk(Edit.X >> ChunkSizeLog2, Edit.Y >> ChunkSizeLog2, Edit.Z >> ChunkSizeLog2);
+		if(!Entry)
+		{
+			continue;
+		}
+
+		FVoxelChunk& Chunk = *Entry->Chunk;
+		const int32 LocalY = Edit.Y & (ChunkSize - 1);
+		const int32 Index = FVoxelChunk::ToIndex(Edit.X & (ChunkSize - 1), LocalY, Edit.Z & (ChunkSize - 1));
+		const FBlockId Block = Chunk.Get(Index);
+		const uint8 Emission = GetEmission(Block);
+		const bool bOpaque = IsOpaque(Block);
+		const uint8 OldLight = Chunk.GetLight(Index);
+		uint8 Light = OldLight;
+
+		// Block light starts over from the block's own emission, sky light goes if the block blocks it.
+		if(GetBlockLight(OldLight) > 0)
+		{
+			Light = SetChannel(Light, false, 0);
+			Entry->Removals.push_back({ (uint16)Index, GetBlockLight(OldLight), NodeExisting });
+		}
+		if(Emission > 0)
+		{
+			Light = SetChannel(Light, false, Emission);
+			Entry->Additions.push_back({ (uint16)Index, 0, NodeExisting });
+		}
+		if(bOpaque && GetSkyLight(OldLight) > 0)
+		{
+			Light = SetChannel(Light, true, 0);
+			Entry->Removals.push_back({ (uint16)Index, GetSkyLight(OldLight), NodeSky | NodeExisting });
+		}
+		Chunk.SetLight(Index, Light);
+
+		if(!Entry->Removals.empty())
+		{
+			QueueRemovals(*Entry);
+		}
+		if(!Entry->Additions.empty())
+		{
+			QueueAdditions(*Entry);
+		}
+
+		// Light can get in now, have every neighbour spread what it has again.
+		if(!bOpaque)
+		{
+			for(int32 Direction = 0; Direction < 6; Direction++)
+			{
+				int32 Neighbour;
+				FLightChunk* Target = StepIndex(Index, Direction, Neighbour) ? Entry
+					: FindChunk(Entry->X + DirectionDelta[Direction][0], Entry->Y + DirectionDelta[Direction][1], Entry->Z + DirectionDelta[Direction][2]);
+				if(Target)
+				{
+					Target->Additions.push_back({ (uint16)Neighbour, 0, NodeExisting });
+					Target->Additions.push_back({ (uint16)Neighbour, 0, NodeSky | NodeExisting });
+					QueueAdditions(*Target);
+				}
+			}
+
+			if(LocalY == ChunkSize - 1 && !FindChunk(Entry->X, Entry->Y + 1, Entry->Z))
+			{
+				Entry->Additions.push_back({ (uint16)Index, MaxLightLevel, NodeSky });
+			}
+		}
+
+		Stats.NumEdits++;
+	}
+	PendingEdits.clear();
+}
+
+void FLightEngine::LightChunk(FLightChunk& Entry) const
+{
+	FVoxelChunk& Chunk = *Entry.Chunk;
+	Entry.bRelit = true;
+
+	// Sky light falls straight down every column from the top until something stops it. Only voxels
+	// that can light something other than the rest of their column need to spread it.
+	Chunk.FillLight(0);
+	if(!FindChunk(Entry.X, Entry.Y + 1, Entry.Z))
+	{
+		int32 Heights[ChunkSize * ChunkSize];
+		if(Chunk.IsUniform() && !IsOpaque(Chunk.Get(0)))
+		{
+			Chunk.FillLight(MaxLightLevel << 4);
+			std::fill(Heights, Heights + ChunkSize * ChunkSize, 0);
+		}
+		else
+		{
+			for(int32 Z = 0; Z < ChunkSize; Z++)
+			for(int32 X = 0; X < ChunkSize; X++)
+			{
+				int32 Y = ChunkSize - 1;
+				for(; Y >= 0 && !IsOpaque(Chunk.Get(X, Y, Z)); Y--)
+				{
+					Chunk.SetLight(FVoxelChunk::ToIndex(X, Y, Z), MaxLightLevel << 4);
+				}
+				Heights[X + Z * ChunkSize] = Y + 1;
+			}
+		}
+
+		for(int32 Z = 0; Z < ChunkSize; Z++)
+		for(int32 X = 0; X < ChunkSize; X++)
+		{
+			const int32 Height = Heights[X + Z * ChunkSize];
+			int32 SeedTop = ChunkSize;
+			if(X > 0 && X < ChunkSize - 1 && Z > 0 && Z < ChunkSize - 1)
+			{
+				SeedTop = std::max(
+					std::max(Heights[X - 1 + Z * ChunkSize], Heights[X + 1 + Z * ChunkSize]),
+					std::max(Heights[X + (Z - 1) * ChunkSize], Heights[X + (Z + 1) * ChunkSize])
+				);
+			}
+
+			// Everything beside a lower neighbour column or on the chunk's side, and the bottom to light the chunk below.
+			for(int32 Y = Height; Y < SeedTop; Y++)
+			{
+				Entry.Additions.push_back({ (uint16)FVoxelChunk::ToIndex(X, Y, Z), 0, NodeSky | NodeExisting });
+			}
+			if(Height == 0 && SeedTop == 0)
+			{
+				Entry.Additions.push_back({ (uint16)FVoxelChunk::ToIndex(X, 0, Z), 0, NodeSky | NodeExisting });
+			}
+		}
+	}
+
+	// Block light sources, most chunks have none in their palette.
+	const std::vector<FBlockId>& Palette = Chunk.GetPalette();
+	bool bHasEmitters = Palette.empty();
+	for(FBlockId Block : Palette)
+	{
+		bHasEmitters |= GetEmission(Block) > 0;
+	}
+	if(bHasEmitters)
+	{
+		for(int32 Index = 0; Index < ChunkVolume; Index++)
+		{
+			const uint8 Emission = GetEmission(Chunk.Get(Index));
+			if(Emission > 0)
+			{
+				Chunk.SetLight(Index, SetChannel(Chunk.GetLight(Index), false, Emission));
+				Entry.Additions.push_back({ (uint16)Index, 0, NodeExisting });
+			}
+		}
+	}
+
+	// A chunk below that was already lit had open sky above it, which is us now. Only columns we
+	// don't let the sky straight through change.
+	const FLightChunk* Below = FindChunk(Entry.X, Entry.Y - 1, Entry.Z);
+	if(Below && !Below->bNew)
+	{
+		for(int32 Z = 0; Z < ChunkSize; Z++)
+		for(int32 X = 0; X < ChunkSize; X++)
+		{
+			if(GetSkyLight(Chunk.GetLight(FVoxelChunk::ToIndex(X, 0, Z))) != MaxLightLevel)
+			{
+				Entry.Outbox[DirectionDown].push_back({ (uint16)FVoxelChunk::ToIndex(X, ChunkSize - 1, Z), MaxLightLevel, NodeSky | NodeFromAbove });
+			}
+		}
+	}
+}
+
+void FLightEngine::ReseedFace(FLightChunk& Entry, int32 Direction)
+{
+	const FVoxelChunk& Chunk = *Entry.Chunk;
+	if(Chunk.IsLightUniform() && Chunk.GetLight(0) == 0)
+	{
+		return;
+	}
+
+	for(int32 B = 0; B < ChunkSize; B++)
+	for(int32 A = 0; A < ChunkSize; A++)
+	{
+		const int32 Index = FaceIndex(Direction, A, B);
+		const uint8 Light = Chunk.GetLight(Index);
+		if(GetSkyLight(Light) > 0)
+		{
+			Entry.Additions.push_back({ (uint16)Index, 0, NodeSky | NodeExisting });
+		}
+		if(GetBlockLight(Light) > 1)
+		{
+			Entry.Additions.push_back({ (uint16)Index, 0, NodeExisting });
+		}
+	}
+	QueueAdditions(Entry);
+}
+
+void FLightEngine::ProcessRemovals(FLightChunk& Entry) const
+{
+	static thread_local std::vector<FLightNode> Queue;
+
+	FVoxelChunk& Chunk = *Entry.Chunk;
+	uint32 NumSet = 0;
+	Queue.clear();
+
+	// Light below what went away came from it and goes too. Anything as bright or brighter has another
+	// source and spreads again once removals are done.
+	const auto Remove = [&](int32 Index, uint8 Level, uint8 Flags)
+	{
+		const bool bSky = (Flags & NodeSky) != 0;
+		const uint8 Light = Chunk.GetLight(Index);
+		const uint8 Current = GetChannel(Light, bSky);
+		if(Current == 0)
+		{
+			return;
+		}
+
+		const bool bDependent = Current < Level || (bSky && (Flags & NodeFromAbove) && Level == MaxLightLevel);
+		if(bDependent && (bSky || GetEmission(Chunk.Get(Index)) == 0))
+		{
+			Chunk.SetLight(Index, SetChannel(Light, bSky, 0));
+			Queue.push_back({ (uint16)Index, Current, (uint8)(Flags & NodeSky) });
+			NumSet++;
+		}
+		else
+		{
+			Entry.Additions.push_back({ (uint16)Index, 0, (uint8)((Flags & NodeSky) | NodeExisting) });
+		}
+	};
+
+	for(const FLightNode& Node : Entry.Removals)
+	{
+		if(Node.Flags & NodeExisting)
+		{
+			Queue.push_back({ Node.Index, Node.Level, (uint8)(Node.Flags & NodeSky) });
+		}
+		else
+		{
+			Remove(Node.Index, Node.Level, Node.Flags);
+		}
+	}
+	std::vector<FLightNode>().swap(Entry.Removals);
+
+	for(size_t Head = 0; Head < Queue.size(); Head++)
+	{
+		const FLightNode Node = Queue[Head];
+		for(int32 Direction = 0; Direction < 6; Direction++)
+		{
+			const uint8 Flags = Node.Flags | (Direction == DirectionDown ? NodeFromAbove : 0);
+			int32 Neighbour;
+			if(StepIndex(Node.Index, Direction, Neighbour))
+			{
+				Remove(Neighbour, Node.Level, Flags);
+			}
+			else
+			{
+				Entry.Outbox[Direction].push_back({ (uint16)Neighbour, Node.Level, Flags });
+			}
+		}
+	}
+
+	Entry.NumVoxelsSet += NumSet;
+	Entry.bRelit |= NumSet > 0;
+}
+
+void FLightEngine::ProcessAdditions(FLightChunk& Entry) const
+{
+	static thread_local std::vector<FLightNode> Queue;
+
+	FVoxelChunk& Chunk = *Entry.Chunk;
+	uint32 NumSet = 0;
+	Queue.clear();
+
+	// Emitters keep their own block light, opaque blocks stay dark.
+	const auto Add = [&](int32 Index, uint8 Level, uint8 Flags)
+	{
+		const bool bSky = (Flags & NodeSky) != 0;
+		const FBlockId Block = Chunk.Get(Index);
+		if(IsOpaque(Block) || (!bSky && GetEmission(Block) > 0))
+		{
+			return;
+		}
+
+		const uint8 Light = Chunk.GetLight(Index);
+		if(GetChannel(Light, bSky) >= Level)
+		{
+			return;
+		}
+
+		Chunk.SetLight(Index, SetChannel(Light, bSky, Level));
+		Queue.push_back({ (uint16)Index, 0, Flags });
+		NumSet++;
+	};
+
+	for(const FLightNode& Node : Entry.Additions)
+	{
+		if(Node.Flags & NodeExisting)
+		{
+			Queue.push_back({ Node.Index, 0, (uint8)(Node.Flags & NodeSky) });
+		}
+		else
+		{
+			Add(Node.Index, Node.Level, Node.Flags & NodeSky);
+		}
+	}
+	std::vector<FLightNode>().swap(Entry.Additions);
+
+	// Levels are read when a voxel comes up rather than queued, it may have been raised since.
+	for(size_t Head = 0; Head < Queue.size(); Head++)
+	{
+		const FLightNode Node = Queue[Head];
+		const bool bSky = (Node.Flags & NodeSky) != 0;
+		const uint8 Level = GetChannel(Chunk.GetLight(Node.Index), bSky);
+		if(Level == 0)
+		{
+			continue;
+		}
+
+		for(int32 Direction = 0; Direction < 6; Direction++)
+		{
+			const uint8 Spread = SpreadLevel(Level, bSky, Direction);
+			if(Spread == 0)
+			{
+				continue;
+			}
+
+			int32 Neighbour;
+			if(StepIndex(Node.Index, Direction, Neighbour))
+			{
+				Add(Neighbour, Spread, Node.Flags);
+			}
+			else
+			{
+				Entry.Outbox[Direction].push_back({ (uint16)Neighbour, Spread, Node.Flags });
+			}
+		}
+	}
+
+	Entry.NumVoxelsSet += NumSet;
+	Entry.bRelit |= NumSet > 0;
+}
+
+void FLightEngine::RunPass(bool bRemovals)
+{
+	std::vector<FLightChunk*>& Pending = bRemovals ? PendingRemovals : PendingAdditions;
+	std::vector<FLightChunk*> Wave;
+	while(!Pending.empty())
+	{
+		Wave.swap(Pending);
+		Pending.clear();
+		for(FLightChunk* Entry : Wave)
+		{
+			(bRemovals ? Entry->bRemovalsQueued : Entry->bAdditionsQueued) = false;
+		}
+
+		JobSystem->ParallelFor((uint32)Wave.size(), 1, [this, &Wave, bRemovals](uint32 Index)
+		{
+			if(bRemovals)
+			{
+				ProcessRemovals(*Wave[Index]);
+			}
+			else
+			{
+				ProcessAdditions(*Wave[Index]);
+			}
+		});
+		Stats.NumWaves++;
+
+		for(FLightChunk* Entry : Wave)
+		{
+			Stats.NumVoxelsSet += Entry->NumVoxelsSet;
+			Entry->NumVoxelsSet = 0;
+			if(Entry->bRelit)
+			{
+				RelitChunks.push_back(FChunkMap::PackKey(Entry->X, Entry->Y, Entry->Z));
+				Entry->bRelit = false;
+			}
+
+			// What removals found still lit.
+			if(!Entry->Additions.empty())
+			{
+				QueueAdditions(*Entry);
+			}
+		}
+
+		DeliverOutboxes(Wave, bRemovals);
+	}
+}
+
+void FLightEngine::DeliverOutboxes(const std::vector<FLightChunk*>& Entries, bool bRemovals)
+{
+	for(FLightChunk* Entry : Entries)
+	{
+		for(int32 Direction = 0; Direction < 6; Direction++)
+		{
+			std::vector<FLightNode>& Outbox = Entry->Outbox[Direction];
+			if(Outbox.empty())
+			{
+				continue;
+			}
+
+			// Light going out of the loaded world is dropped.
+			FLightChunk* Neighbour = FindChunk(Entry->X + DirectionDelta[Direction][0], Entry->Y + DirectionDelta[Direction][1], Entry->Z + DirectionDelta[Direction][2]);
+			if(Neighbour)
+			{
+				std::vector<FLightNode>& Inbox = bRemovals ? Neighbour->Removals : Neighbour->Additions;
+				if(Inbox.empty())
+				{
+					Inbox.swap(Outbox);
+				}
+				else
+				{
+					Inbox.insert(Inbox.end(), Outbox.begin(), Outbox.end());
+				}
+
+				if(bRemovals)
+				{
+					QueueRemovals(*Neighbour);
+				}
+				else
+				{
+					QueueAdditions(*Neighbour);
+				}
+			}
+			std::vector<FLightNode>().swap(Outbox);
+		}
+	}
+}
+
+void FLightEngine::QueueRemovals(FLightChunk& Entry)
+{
+	if(!Entry.bRemovalsQueued)
+	{
+		Entry.bRemovalsQueued = true;
+		PendingRemovals.push_back(&Entry);
+	}
+}
+
+void FLightEngine::QueueAdditions(FLightChunk& Entry)
+{
+	if(!Entry.bAdditionsQueued)
+	{
+		Entry.bAdditionsQueued = true;
+		PendingAdditions.push_back(&Entry);
+	}
+}
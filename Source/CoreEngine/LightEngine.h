@@ -0,0 +1,195 @@
+// Copyright Snaps 2022, All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "ChunkMap.h"
+#include "JobSystem.h"
+#include "VoxelTypes.h"
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+static const uint8 MaxLightLevel = 15;
+
+// A voxel's light byte, as stored by FVoxelChunk.
+inline uint8 GetSkyLight(uint8 Light)
+{
+	return Light >> 4;
+}
+
+inline uint8 GetBlockLight(uint8 Light)
+{
+	return Light & 0xF;
+}
+
+struct FLightStats
+{
+	uint64 	NumChunksLit 	= 0; 	// Full relights of loaded chunks.
+	uint64 	NumEdits 		= 0;
+	uint64 	NumVoxelsSet 	= 0; 	// Light writes by the flood fills, the work done.
+	uint64 	NumWaves 		= 0; 	// Rounds of chunk jobs, see FLightEngine.
+};
+
+/*
+	Flood fill sky and block light over the chunks in a chunk map. Light levels
+	go from 0 to 15 and drop by one per voxel, except sky light at 15, which
+	goes straight down without losing any. Opaque blocks stop light, emitting
+	blocks always have exactly their emission as block light. Anything above
+	the loaded chunks is open sky.
+
+	Changes go through the usual two queues: a removal pass clears the light
+	that came from whatever went away, collecting the still lit voxels along
+	its edge, then an addition pass spreads light from those and from new
+	sources. Each pass runs in waves on the job system, one job per chunk with
+	work queued. A job only touches its own chunk, light that crosses a border
+	is queued for the neighbour and picked up by the next wave, so chunks never
+	need locking. Block light reaches at most two chunks over, sky light falls
+	one chunk per wave.
+
+	Loaded chunks are lit from scratch, and the lit chunks around them spread
+	their light across again. Chunks coming in under a chunk lit as open sky take
+	its sky away. Light that came from a chunk that's unloaded stays until
+	something relights the area.
+
+	Writes chunk light in place, nothing else may write it. Blocks are only
+	read, and only while Update runs. Everything is main thread only.
+*/
+class FLightEngine
+{
+public:
+
+	FLightEngine(FJobSystem* InJobSystem, const FChunkMap* InChunkMap);
+	~FLightEngine();
+
+	FLightEngine(const FLightEngine&) = delete;
+	FLightEngine& operator=(const FLightEngine&) = delete;
+
+	// Every block is opaque and dark except air until told otherwise.
+	void SetBlockLight(FBlockId Block, uint8 Emission, bool bOpaque);
+
+	uint8 GetEmission(FBlockId Block) const
+	{
+		return BlockInfo[Block] & EmissionMask;
+	}
+
+	bool IsOpaque(FBlockId Block) const
+	{
+		return (BlockInfo[Block] & OpaqueBit) != 0;
+	}
+
+	// The chunk is in the chunk map now, or about to leave it. Picked up by the next Update.
+	void OnChunkLoaded(int32 X, int32 Y, int32 Z);
+	void OnChunkUnloaded(int32 X, int32 Y, int32 Z);
+
+	// The block at X, Y, Z in world voxel coordinates has been changed in its chunk, relit on the next Update.
+	void OnBlockChanged(int32 X, int32 Y, int32 Z);
+
+	// Lights new chunks and applies edits, blocking until light has settled. Workers and the main thread
+	// share the flood fills.
+	void Update();
+
+	// Chunks whose light the last Update changed, as FChunkMap::PackKey.
+	const std::vector<uint64>& GetRelitChunks() const
+	{
+		return RelitChunks;
+	}
+
+	uint32 GetNumChunks() const
+	{
+		return (uint32)Chunks.size();
+	}
+
+	const FLightStats& GetStats() const
+	{
+		return Stats;
+	}
+
+private:
+
+	enum EBlockLightBits : uint8
+	{
+		EmissionMask 	= 0xF,
+		OpaqueBit 		= 0x10
+	};
+
+	/*
+		One queued step of a flood fill. For additions, Index may be lit to
+		Level. For removals, a neighbour of Index lost Level. Existing means
+		Index itself is the start, with its own light for additions and already
+		cleared of Level for removals.
+	*/
+	struct FLightNode
+	{
+		uint16 	Index;
+		uint8 	Level;
+		uint8 	Flags;
+	};
+
+	enum ELightNodeFlags : uint8
+	{
+		NodeSky 		= 1 << 0, 	// Sky light, block light otherwise.
+		NodeFromAbove 	= 1 << 1, 	// Came down from the voxel above.
+		NodeExisting 	= 1 << 2
+	};
+
+	struct FLightChunk
+	{
+		int32 						X, Y, Z;
+		FVoxelChunk* 				Chunk;
+		bool 						bNew 				= true; 	// Lit from scratch this Update.
+		bool 						bRemovalsQueued 	= false;
+		bool 						bAdditionsQueued 	= false;
+		bool 						bRelit 				= false;
+		uint32 						NumVoxelsSet 		= 0;
+
+		std::vector<FLightNode> 	Removals;
+		std::vector<FLightNode> 	Additions;
+		std::vector<FLightNode> 	Outbox[6]; 		// Crossing into the neighbour on each side, -X, +X, -Y, +Y, -Z, +Z.
+	};
+
+	FLightChunk* FindChunk(int32 X, int32 Y, int32 Z) const;
+
+	void ApplyChunkChanges();
+	void ApplyEdits();
+
+	// Job side. Sets the chunk's starting light and queues what it spreads.
+	void LightChunk(FLightChunk& Entry) const;
+	void ProcessRemovals(FLightChunk& Entry) const;
+	void ProcessAdditions(FLightChunk& Entry) const;
+
+	// Has the voxels on the Direction side of the chunk spread their light again.
+	void ReseedFace(FLightChunk& Entry, int32 Direction);
+
+	// Runs waves of removals or additions until nothing is queued.
+	void RunPass(bool bRemovals);
+
+	// Hands the outboxes of Entries to their neighbours and queues whatever got work.
+	void DeliverOutboxes(const std::vector<FLightChunk*>& Entries, bool bRemovals);
+
+	void QueueRemovals(FLightChunk& Entry);
+	void QueueAdditions(FLightChunk& Entry);
+
+	FJobSystem* 		JobSystem;
+	const FChunkMap* 	ChunkMap;
+
+	std::vector<uint8> 	BlockInfo; 		// Emission and opacity, indexed by block id.
+
+	std::unordered_map<uint64, std::unique_ptr<FLightChunk>> Chunks;
+
+	std::vector<uint64> 		LoadedChunks;
+	std::vector<uint64> 		UnloadedChunks;
+	std::vector<FLightChunk*> 	NewChunks;
+
+	struct FBlockPosition
+	{
+		int32 X, Y, Z;
+	};
+	std::vector<FBlockPosition> PendingEdits;
+
+	std::vector<FLightChunk*> 	PendingRemovals;
+	std::vector<FLightChunk*> 	PendingAdditions;
+
+	std::vector<uint64> 		RelitChunks;
+	FLightStats 				Stats;
+};
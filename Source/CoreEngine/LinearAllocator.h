@@ -0,0 +1,62 @@
+// Copyright Snaps 2022, All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+/*
+	Bump allocator over a single fixed block. Allocations are never freed on
+	their own, the whole block is recycled at once with Reset(). Used for
+	scratch memory that only has to live for a frame.
+*/
+class FLinearAllocator
+{
+public:
+
+	void Initialize(size_t InCapacity)
+	{
+		Memory = std::make_unique<uint8[]>(InCapacity);
+		Capacity = InCapacity;
+		Offset = 0;
+	}
+
+	// Returns nullptr when the block is exhausted.
+	void* Allocate(size_t Size, size_t Alignment = 16)
+	{
+		const size_t AlignedOffset = (Offset + Alignment - 1) & ~(Alignment - 1);
+		if(AlignedOffset + Size > Capacity)
+		{
+			return nullptr;
+		}
+
+		Offset = AlignedOffset + Size;
+		return Memory.get() + AlignedOffset;
+	}
+
+	template<typename Type>
+	Type* Allocate(size_t Count = 1)
+	{
+		return static_cast<Type*>(Allocate(sizeof(Type) * Count, alignof(Type)));
+	}
+
+	void Reset()
+	{
+		Offset = 0;
+	}
+
+	size_t GetUsedBytes() const
+	{
+		return Offset;
+	}
+
+	size_t GetCapacity() const
+	{
+		return Capacity;
+	}
+
+private:
+
+	std::unique_ptr<uint8[]> 	Memory;
+	size_t 						Capacity 	= 0;
+	size_t 						Offset 		= 0;
+};
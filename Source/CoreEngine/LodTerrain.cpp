@@ -0,0 +1,368 @@
+// Copyright Snaps 2022, All Rights Reserved.
+
+#include "LodTerrain.h"
+#include "CoreMacros.h"
+#include "LodMesher.h"
+#include <algorithm>
+#include <cmath>
+#include <unordered_set>
+
+// Mesh jobs in flight per worker, enough to keep every worker busy for a frame.
+static const uint32 MeshJobsPerThread = 8;
+
+// Per worker scratch for mesh jobs.
+static thread_local FLodMesher GLodMesher;
+static thread_local FMeshVolume GLodVolume;
+
+FLodTerrain::FLodTerrain(FJobSystem* InJobSystem, const FLodSettings& InSettings)
+	: JobSystem(InJobSystem)
+	, Settings(InSettings)
+	, BrickMap(InSettings.BrickMapBudget, InSettings.WidthChunksLog2, InSettings.HeightChunksLog2)
+	, MaxMeshJobsInFlight(InJobSystem->GetNumThreads() * MeshJobsPerThread)
+	, NumBuilding(0)
+{
+	Settings.MaxLod = std::min(std::max(Settings.MaxLod, 0), FLodMesher::MaxLod);
+}
+
+FLodTerrain::~FLodTerrain()
+{
+	// Jobs point into the pools and nodes.
+	JobSystem->Wait(BuildJobs);
+	JobSystem->Wait(MeshJobs);
+}
+
+void FLodTerrain::QueueChunk(int32 X, int32 Y, int32 Z, const FVoxelChunk& Chunk)
+{
+	if(FreeBuilds.empty())
+	{
+		BuildPool.emplace_back(new FBuildRequest());
+		FreeBuilds.push_back(BuildPool.back().get());
+	}
+
+	FBuildRequest* Request = FreeBuilds.back();
+	FreeBuilds.pop_back();
+	Request->Terrain = this;
+	Request->X = X;
+	Request->Y = Y;
+	Request->Z = Z;
+	Request->Chunk = Chunk;
+
+	NumBuilding++;
+	JobSystem->Schedule(&FLodTerrain::BuildJob, Request, &BuildJobs);
+}
+
+void FLodTerrain::Update(double ViewerX, double ViewerZ)
+{
+	PROFILE_FUNCTION();
+
+	std::vector<FNodeEntry*> Meshed;
+	bool bChunksWaiting;
+	{
+		std::lock_guard<std::mutex> Lock(DoneMutex);
+		Meshed.swap(MeshedNodes);
+		bChunksWaiting = !BuiltChunks.empty();
+	}
+
+	for(FNodeEntry* Entry : Meshed)
+	{
+		std::swap(Entry->Node.Mesh, Entry->NewMesh);
+		Entry->bMeshed = true;
+		Entry->bBusy = false;
+		NumMeshed++;
+	}
+	bVisibleDirty |= !Meshed.empty();
+
+	// The brick map can only change while no mesh job reads it.
+	if(bChunksWaiting && MeshJobs.IsDone())
+	{
+		ApplyBuiltChunks();
+		bChunksWaiting = false;
+	}
+
+	const int32 NewViewerChunkX = (int32)std::floor(ViewerX / ChunkSize);
+	const int32 NewViewerChunkZ = (int32)std::floor(ViewerZ / ChunkSize);
+	if(!bHasViewer || NewViewerChunkX != ViewerChunkX || NewViewerChunkZ != ViewerChunkZ)
+	{
+		bHasViewer = true;
+		ViewerChunkX = NewViewerChunkX;
+		ViewerChunkZ = NewViewerChunkZ;
+		Select();
+	}
+
+	// Chunks waiting on the jobs in flight go first, so a moving viewer can't hold them off forever.
+	if(!bChunksWaiting)
+	{
+		for(FNodeEntry* Entry : Selected)
+		{
+			if((uint32)MeshJobs.Value.load(std::memory_order_relaxed) >= MaxMeshJobsInFlight)
+			{
+				break;
+			}
+			if(!Entry->bBusy && (!Entry->bMeshed || Entry->bStale))
+			{
+				Entry->bBusy = true;
+				Entry->bStale = false;
+				JobSystem->Schedule(&FLodTerrain::MeshJob, Entry, &MeshJobs);
+			}
+		}
+	}
+
+	if(bVisibleDirty && IsSelectionMeshed())
+	{
+		bVisibleDirty = false;
+		VisibleNodes.clear();
+		for(FNodeEntry* Entry : Selected)
+		{
+			VisibleNodes.push_back(&Entry->Node);
+		}
+
+		// Whatever isn't selected is no longer drawn either.
+		std::unordered_set<const FNodeEntry*> Keep(Selected.begin(), Selected.end());
+		for(auto It = Nodes.begin(); It != Nodes.end();)
+		{
+			if(!It->second->bBusy && !Keep.count(It->second.get()))
+			{
+				It = Nodes.erase(It);
+			}
+			else
+			{
+				++It;
+			}
+		}
+	}
+}
+
+void FLodTerrain::Flush()
+{
+	PROFILE_FUNCTION();
+
+	for(;;)
+	{
+		JobSystem->Wait(BuildJobs);
+		JobSystem->Wait(MeshJobs);
+		if(!bHasViewer)
+		{
+			ApplyBuiltChunks();
+			break;
+		}
+
+		Update((ViewerChunkX + 0.5) * ChunkSize, (ViewerChunkZ + 0.5) * ChunkSize);
+
+		bool bClean = NumBuilding == 0 && MeshJobs.IsDone() && !bVisibleDirty;
+		for(const FNodeEntry* Entry : Selected)
+		{
+			bClean &= Entry->bMeshed && !Entry->bStale;
+		}
+		if(bClean)
+		{
+			break;
+		}
+	}
+}
+
+FLodTerrainStats FLodTerrain::GetStats() const
+{
+	FLodTerrainStats Stats;
+	for(const FLodNode* Node : VisibleNodes)
+	{
+		Stats.NumNodes[Node->Lod]++;
+		Stats.NumTriangles[Node->Lod] += Node->Mesh.GetNumQuads() * 2;
+	}
+	Stats.NumMeshed = NumMeshed;
+	return Stats;
+}
+
+uint64 FLodTerrain::PackNodeKey(int32 Lod, int32 X, int32 Y, int32 Z, uint8 WalledSides)
+{
+	return ((uint64)(uint32)X & 0xFFFFFF)
+		| (((uint64)(uint32)Z & 0xFFFFFF) << 24)
+		| ((uint64)(Y & 0x3F) << 48)
+		| ((uint64)Lod << 54)
+		| ((uint64)WalledSides << 56);
+}
+
+void FLodTerrain::Select()
+{
+	PROFILE_FUNCTION();
+
+	// Quadtree over columns, from the coarsest LOD down.
+	SelectedColumns.clear();
+	const int32 TopLod = Settings.MaxLod;
+	for(int32 Z = (ViewerChunkZ - Settings.ViewDistance) >> TopLod; Z <= (ViewerChunkZ + Settings.ViewDistance) >> TopLod; Z++)
+	for(int32 X = (ViewerChunkX - Settings.ViewDistance) >> TopLod; X <= (ViewerChunkX + Settings.ViewDistance) >> TopLod; X++)
+	{
+		SelectColumn(TopLod, X, Z);
+	}
+
+	// LOD of every chunk column around the viewer, -1 where nothing is selected.
+	const int32 Radius = Settings.ViewDistance + (1 << TopLod);
+	const int32 Side = Radius * 2 + 1;
+	ColumnLods.assign((size_t)Side * Side, -1);
+	const auto ColumnLod = [&](int32 ChunkX, int32 ChunkZ) -> int32
+	{
+		const int32 LocalX = ChunkX - ViewerChunkX + Radius;
+		const int32 LocalZ = ChunkZ - ViewerChunkZ + Radius;
+		return LocalX >= 0 && LocalX < Side && LocalZ >= 0 && LocalZ < Side ? ColumnLods[LocalX + LocalZ * Side] : -1;
+	};
+	for(const FSelectedColumn& Column : SelectedColumns)
+	{
+		const int32 Size = 1 << Column.Lod;
+		for(int32 Z = Column.Z * Size; Z < (Column.Z + 1) * Size; Z++)
+		for(int32 X = Column.X * Size; X < (Column.X + 1) * Size; X++)
+		{
+			ColumnLods[(X - ViewerChunkX + Radius) + (Z - ViewerChunkZ + Radius) * Side] = (int8)Column.Lod;
+		}
+	}
+
+	std::sort(SelectedColumns.begin(), SelectedColumns.end(), [](const FSelectedColumn& A, const FSelectedColumn& B)
+	{
+		return A.DistanceSquared < B.DistanceSquared;
+	});
+
+	Selected.clear();
+	const int32 HeightChunks = 1 << Settings.HeightChunksLog2;
+	for(const FSelectedColumn& Column : SelectedColumns)
+	{
+		// Wall off every side where any neighbouring column is at another LOD or not drawn.
+		const int32 Size = 1 << Column.Lod;
+		const int32 MinX = Column.X * Size;
+		const int32 MinZ = Column.Z * Size;
+		uint8 WalledSides = 0;
+		for(int32 Offset = 0; Offset < Size; Offset++)
+		{
+			WalledSides |= ColumnLod(MinX + Size, MinZ + Offset) != Column.Lod ? FLodMesher::GetSideBit(EBlockFace::PosX) : 0;
+			WalledSides |= ColumnLod(MinX - 1, MinZ + Offset) != Column.Lod ? FLodMesher::GetSideBit(EBlockFace::NegX) : 0;
+			WalledSides |= ColumnLod(MinX + Offset, MinZ + Size) != Column.Lod ? FLodMesher::GetSideBit(EBlockFace::PosZ) : 0;
+			WalledSides |= ColumnLod(MinX + Offset, MinZ - 1) != Column.Lod ? FLodMesher::GetSideBit(EBlockFace::NegZ) : 0;
+		}
+
+		for(int32 Y = 0; Y < std::max(HeightChunks >> Column.Lod, 1); Y++)
+		{
+			std::unique_ptr<FNodeEntry>& Entry = Nodes[PackNodeKey(Column.Lod, Column.X, Y, Column.Z, WalledSides)];
+			if(!Entry)
+			{
+				Entry.reset(new FNodeEntry());
+				Entry->Terrain = this;
+				Entry->Node.Lod = Column.Lod;
+				Entry->Node.X = Column.X;
+				Entry->Node.Y = Y;
+				Entry->Node.Z = Column.Z;
+				Entry->Node.WalledSides = WalledSides;
+			}
+			Selected.push_back(Entry.get());
+		}
+	}
+
+	// Chunks still in view are the last the brick map should evict, farthest first so the nearest end up most recent.
+	for(auto Column = SelectedColumns.rbegin(); Column != SelectedColumns.rend(); ++Column)
+	{
+		const int32 Size = 1 << Column->Lod;
+		for(int32 Z = Column->Z * Size; Z < (Column->Z + 1) * Size; Z++)
+		for(int32 X = Column->X * Size; X < (Column->X + 1) * Size; X++)
+		{
+			for(int32 Y = 0; Y < HeightChunks; Y++)
+			{
+				BrickMap.Touch(X, Y, Z);
+			}
+		}
+	}
+	bVisibleDirty = true;
+}
+
+void FLodTerrain::SelectColumn(int32 Lod, int32 X, int32 Z)
+{
+	// Distance in chunks from the viewer's chunk to the nearest chunk of the column.
+	const int32 Size = 1 << Lod;
+	const int32 DeltaX = std::max(std::max(X * Size - ViewerChunkX, ViewerChunkX - (X * Size + Size - 1)), 0);
+	const int32 DeltaZ = std::max(std::max(Z * Size - ViewerChunkZ, ViewerChunkZ - (Z * Size + Size - 1)), 0);
+	const int32 DistanceSquared = DeltaX * DeltaX + DeltaZ * DeltaZ;
+	if(DistanceSquared > Settings.ViewDistance * Settings.ViewDistance)
+	{
+		return;
+	}
+
+	// Each LOD takes over where the distance doubles, split while too close for this one.
+	const int32 SplitDistance = Lod > 0 ? Settings.FullDetailDistance << (Lod - 1) : 0;
+	if(DistanceSquared < SplitDistance * SplitDistance)
+	{
+		for(int32 Child = 0; Child < 4; Child++)
+		{
+			SelectColumn(Lod - 1, X * 2 + (Child & 1), Z * 2 + (Child >> 1));
+		}
+		return;
+	}
+
+	SelectedColumns.push_back({ Lod, X, Z, DistanceSquared });
+}
+
+bool FLodTerrain::IsSelectionMeshed() const
+{
+	for(const FNodeEntry* Entry : Selected)
+	{
+		if(!Entry->bMeshed)
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+void FLodTerrain::ApplyBuiltChunks()
+{
+	PROFILE_FUNCTION();
+
+	std::vector<FBuildRequest*> Built;
+	{
+		std::lock_guard<std::mutex> Lock(DoneMutex);
+		Built.swap(BuiltChunks);
+	}
+
+	// Every node that contains the chunk or has it in its one cell border, at every LOD.
+	std::unordered_set<uint64> StaleNodes;
+	for(FBuildRequest* Request : Built)
+	{
+		BrickMap.AddChunk(Request->X, Request->Y, Request->Z, Request->Bricks);
+
+		for(int32 Lod = 0; Lod <= Settings.MaxLod; Lod++)
+		for(int32 DeltaY = -1; DeltaY <= 1; DeltaY++)
+		for(int32 DeltaZ = -1; DeltaZ <= 1; DeltaZ++)
+		for(int32 DeltaX = -1; DeltaX <= 1; DeltaX++)
+		{
+			StaleNodes.insert(PackNodeKey(Lod, (Request->X + DeltaX) >> Lod, (Request->Y + DeltaY) >> Lod, (Request->Z + DeltaZ) >> Lod, 0));
+		}
+
+		FreeBuilds.push_back(Request);
+		NumBuilding--;
+	}
+
+	for(auto& Pair : Nodes)
+	{
+		if(Pair.second->bMeshed && StaleNodes.count(StripSides(Pair.first)))
+		{
+			Pair.second->bStale = true;
+		}
+	}
+}
+
+void FLodTerrain::BuildJob(void* Data)
+{
+	FBuildRequest* Request = static_cast<FBuildRequest*>(Data);
+	FBrickMap::BuildChunk(Request->Chunk, Request->Bricks);
+
+	std::lock_guard<std::mutex> Lock(Request->Terrain->DoneMutex);
+	Request->Terrain->BuiltChunks.push_back(Request);
+}
+
+void FLodTerrain::MeshJob(void* Data)
+{
+	FNodeEntry* Entry = static_cast<FNodeEntry*>(Data);
+	const FLodNode& Node = Entry->Node;
+
+	// The node's cells plus a one cell border, which is what the mesh volume's padding holds.
+	const int32 Size = GLodVolume.Size;
+	Entry->Terrain->BrickMap.SampleLod(Node.X * Size - 1, Node.Y * Size - 1, Node.Z * Size - 1, Size + 2, Size + 2, Size + 2, Node.Lod, GLodVolume.Blocks.data());
+	GLodMesher.Mesh(GLodVolume, Node.Lod, Node.WalledSides, Entry->NewMesh);
+
+	std::lock_guard<std::mutex> Lock(Entry->Terrain->DoneMutex);
+	Entry->Terrain->MeshedNodes.push_back(Entry);
+}
@@ -0,0 +1,175 @@
+// Copyright Snaps 2022, All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "BrickMap.h"
+#include "JobSystem.h"
+#include "MeshTypes.h"
+#include "VoxelChunk.h"
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+struct FLodSettings
+{
+	int32 	FullDetailDistance 	= 6; 			// Chunks closer than this are meshed at full resolution.
+	int32 	ViewDistance 		= 60; 			// Chunks, nothing further than this is meshed.
+	int32 	MaxLod 				= 3; 			// Coarsest level, at most FLodMesher::MaxLod.
+	int32 	HeightChunksLog2 	= 3; 			// World height, in chunks.
+	int32 	WidthChunksLog2 	= 7; 			// Brick map grid width, in chunks. Must cover ViewDistance both ways.
+	uint64 	BrickMapBudget 		= 192ull << 20;
+};
+
+/*
+	A mesh covering 2^Lod chunks along each axis, meshed from cells of 2^Lod
+	voxels. X, Y, Z are in nodes of this LOD, so the node's first chunk is at
+	X << Lod. The mesh is in voxels relative to GetOrigin.
+*/
+struct FLodNode
+{
+	int32 		Lod;
+	int32 		X, Y, Z;
+	uint8 		WalledSides; 	// See FLodMesher.
+	FChunkMesh 	Mesh;
+
+	void GetOrigin(int32 OutOrigin[3]) const
+	{
+		OutOrigin[0] = (X << Lod) * ChunkSize;
+		OutOrigin[1] = (Y << Lod) * ChunkSize;
+		OutOrigin[2] = (Z << Lod) * ChunkSize;
+	}
+};
+
+struct FLodTerrainStats
+{
+	uint32 	NumNodes[4] 		= {};
+	uint64 	NumTriangles[4] 	= {};
+	uint64 	NumMeshed 			= 0; 	// Node meshes built so far, including rebuilds.
+};
+
+/*
+	Far field terrain. Chunks are converted into a brick map as they arrive, and
+	each Update picks a LOD for every column of chunks around the viewer from its
+	distance, full detail close up and one level coarser every time the distance
+	doubles, so every ring costs about as many triangles as the one inside it.
+	Nodes whose LOD or neighbours changed, or whose chunks did, are remeshed on
+	the job system. Sides against a different LOD are walled off (see
+	FLodMesher) so there are no cracks.
+
+	The visible set only switches over once every node of a new selection has a
+	mesh, until then the last complete one stays up, so moving never opens
+	holes. Node meshes read the brick map from jobs, so new chunks go in between
+	batches of mesh jobs. Everything is main thread only.
+*/
+class FLodTerrain
+{
+public:
+
+	FLodTerrain(FJobSystem* InJobSystem, const FLodSettings& InSettings = FLodSettings());
+	~FLodTerrain();
+
+	FLodTerrain(const FLodTerrain&) = delete;
+	FLodTerrain& operator=(const FLodTerrain&) = delete;
+
+	// Copies the chunk, it's converted to bricks on a job and goes into the brick map in a later Update.
+	void QueueChunk(int32 X, int32 Y, int32 Z, const FVoxelChunk& Chunk);
+
+	// Once a frame with the viewer's position in world units. Picks LODs and schedules remeshing, never waits.
+	void Update(double ViewerX, double ViewerZ);
+
+	// Blocks until every queued chunk is in and every node around the last viewer position is meshed.
+	// Before the first Update there's no viewer, and this only fills the brick map.
+	void Flush();
+
+	// The last complete selection, what should be drawn.
+	const std::vector<FLodNode*>& GetVisibleNodes() const
+	{
+		return VisibleNodes;
+	}
+
+	const FBrickMap& GetBrickMap() const
+	{
+		return BrickMap;
+	}
+
+	FLodTerrainStats GetStats() const;
+
+private:
+
+	struct FNodeEntry
+	{
+		FLodTerrain* 	Terrain;
+		FLodNode 		Node;
+		FChunkMesh 		NewMesh; 		// Written by the mesh job, swapped in on the main thread.
+		bool 			bMeshed 	= false;
+		bool 			bStale 		= false; 	// Chunks changed since the mesh was built.
+		bool 			bBusy 		= false;
+	};
+
+	struct FBuildRequest
+	{
+		FLodTerrain* 	Terrain;
+		int32 			X, Y, Z;
+		FVoxelChunk 	Chunk;
+		FBrickMapChunk 	Bricks;
+	};
+
+	struct FSelectedColumn
+	{
+		int32 			Lod;
+		int32 			X, Z; 			// In nodes of Lod.
+		int32 			DistanceSquared;
+	};
+
+	// Node position and walled sides, the sides are part of the key since they change the mesh.
+	static uint64 PackNodeKey(int32 Lod, int32 X, int32 Y, int32 Z, uint8 WalledSides);
+
+	static uint64 StripSides(uint64 Key)
+	{
+		return Key & ~(0xFFull << 56);
+	}
+
+	// Picks the nodes around ViewerChunkX, ViewerChunkZ.
+	void Select();
+	void SelectColumn(int32 Lod, int32 X, int32 Z);
+
+	// Every selected node has a mesh, even if it's being rebuilt.
+	bool IsSelectionMeshed() const;
+
+	// Puts the chunks that finished converting into the brick map, marking the nodes over them stale.
+	void ApplyBuiltChunks();
+
+	static void BuildJob(void* Data);
+	static void MeshJob(void* Data);
+
+	FJobSystem* 									JobSystem;
+	FLodSettings 									Settings;
+	FBrickMap 										BrickMap;
+
+	FJobCounter 									BuildJobs;
+	FJobCounter 									MeshJobs;
+	uint32 											MaxMeshJobsInFlight;
+
+	std::vector<std::unique_ptr<FBuildRequest>> 	BuildPool;
+	std::vector<FBuildRequest*> 					FreeBuilds;
+	uint32 											NumBuilding;
+
+	// Handed back from jobs, picked up by Update.
+	std::mutex 										DoneMutex;
+	std::vector<FBuildRequest*> 					BuiltChunks;
+	std::vector<FNodeEntry*> 						MeshedNodes;
+
+	std::unordered_map<uint64, std::unique_ptr<FNodeEntry>> Nodes;
+	std::vector<FNodeEntry*> 						Selected; 		// Nearest first.
+	std::vector<FLodNode*> 							VisibleNodes;
+	std::vector<int8> 								ColumnLods; 	// Scratch for finding LOD borders.
+	std::vector<FSelectedColumn> 					SelectedColumns;
+
+	bool 											bHasViewer 		= false;
+	bool 											bVisibleDirty 	= false;
+	int32 											ViewerChunkX 	= 0;
+	int32 											ViewerChunkZ 	= 0;
+	uint64 											NumMeshed 		= 0;
+};
@@ -9,7 +9,7 @@
 */
 
 _Use_decl_annotations_
-int WINAPI WinMain(HINSTANCE hInstance, HINSTANCE, LPSTR, int nCmdShow)
+int WINAPI WinMain(HINSTANCE hInstance, HINSTANCE, LPSTR lpCmdLine, int nCmdShow)
 {
-	return FApp::Initialize(hInstance, nCmdShow);
+	return FApp::Initialize(hInstance, lpCmdLine, nCmdShow);
 }
\ No newline at end of file
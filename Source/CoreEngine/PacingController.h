@@ -0,0 +1,101 @@
+// Copyright Snaps 2022, All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include <algorithm>
+#include <cmath>
+
+/*
+	Start delay for present wait frame pacing, kept apart from FFramePacer so it
+	runs without a device (the FramePacing benchmark drives it with a simulated
+	display). Each displayed frame reports how long it took from the start of its
+	CPU work to being on screen and how much of that was CPU and GPU work, what
+	is left over is slack the finished frame spent waiting for its vblank.
+
+	The delay takes up slack beyond the margin and gives it back when slack
+	drops under it, so it settles with the margin to spare rather than probing
+	until a frame misses. The margin grows with how much frame work jitters, a
+	noisy frame needs more room than a steady one. A missed vblank still backs
+	off straight away.
+*/
+class FPacingController
+{
+public:
+
+	void Initialize(double InRefreshSeconds, double InMinMarginSeconds)
+	{
+		RefreshSeconds = InRefreshSeconds;
+		MinMarginSeconds = InMinMarginSeconds;
+		DelaySeconds = 0.0;
+		SlackSeconds = 0.0;
+		AverageWorkSeconds = -1.0;
+		WorkJitterSeconds = 0.0;
+	}
+
+	// One frame made it to the screen. Interval is the time since the previous frame was shown.
+	// Returns true if the frame missed its vblank.
+	bool OnFrameDisplayed(double StartToDisplaySeconds, double WorkSeconds, double IntervalSeconds)
+	{
+		if(AverageWorkSeconds < 0.0)
+		{
+			AverageWorkSeconds = WorkSeconds;
+		}
+		WorkJitterSeconds += (std::abs(WorkSeconds - AverageWorkSeconds) - WorkJitterSeconds) * JitterSmoothing;
+		AverageWorkSeconds += (WorkSeconds - AverageWorkSeconds) * JitterSmoothing;
+
+		SlackSeconds = StartToDisplaySeconds - WorkSeconds;
+
+		if(IntervalSeconds > RefreshSeconds * MissedVblankThreshold)
+		{
+			DelaySeconds = std::max(0.0, DelaySeconds - RefreshSeconds * MissBackoff);
+			return true;
+		}
+
+		// Starting later by some amount takes the same amount off the next frame's slack.
+		DelaySeconds += (SlackSeconds - GetMargin()) * Gain;
+		DelaySeconds = std::max(0.0, std::min(DelaySeconds, RefreshSeconds - MinMarginSeconds));
+		return false;
+	}
+
+	// Slack the delay aims to leave, never less than the minimum margin.
+	double GetMargin() const
+	{
+		return MinMarginSeconds + WorkJitterSeconds * JitterMargin;
+	}
+
+	double GetDelay() const
+	{
+		return DelaySeconds;
+	}
+
+	// Of the last displayed frame.
+	double GetSlack() const
+	{
+		return SlackSeconds;
+	}
+
+private:
+
+	// Share of the slack error corrected per frame, the rest waits for more frames to confirm it.
+	static constexpr double Gain = 0.5;
+
+	// Fraction of a refresh given back when a frame misses anyway.
+	static constexpr double MissBackoff = 0.25;
+
+	// A frame shown this many refreshes after the previous one missed its vblank.
+	static constexpr double MissedVblankThreshold = 1.5;
+
+	// Mean absolute deviations of frame work kept as margin on top of the minimum.
+	static constexpr double JitterMargin = 4.0;
+
+	// Weight of the newest frame in the work average and jitter.
+	static constexpr double JitterSmoothing = 1.0 / 30.0;
+
+	double RefreshSeconds 		= 1.0 / 60.0;
+	double MinMarginSeconds 	= 0.001;
+	double DelaySeconds 		= 0.0;
+	double SlackSeconds 		= 0.0;
+	double AverageWorkSeconds 	= -1.0;
+	double WorkJitterSeconds 	= 0.0;
+};
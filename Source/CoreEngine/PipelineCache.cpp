@@ -0,0 +1,133 @@
+// Copyright Snaps 2022, All Rights Reserved.
+
+#include "PipelineCache.h"
+#include "VulkanHelpers.h"
+#include <cstdio>
+#include <cstring>
+
+// Layout of VK_PIPELINE_CACHE_HEADER_VERSION_ONE, every field is little endian.
+static const size_t HeaderSize = 16 + VK_UUID_SIZE;
+
+static uint32 ReadUint32(const uint8* Data)
+{
+	return (uint32)Data[0] | ((uint32)Data[1] << 8) | ((uint32)Data[2] << 16) | ((uint32)Data[3] << 24);
+}
+
+static bool ReadFile(const std::string& Path, std::vector<uint8>& OutData)
+{
+	FILE* File = std::fopen(Path.c_str(), "rb");
+	if(!File)
+	{
+		return false;
+	}
+
+	std::fseek(File, 0, SEEK_END);
+	const long Size = std::ftell(File);
+	std::fseek(File, 0, SEEK_SET);
+
+	OutData.resize(Size > 0 ? (size_t)Size : 0);
+	const bool bRead = Size > 0 && std::fread(OutData.data(), 1, OutData.size(), File) == OutData.size();
+	std::fclose(File);
+	return bRead;
+}
+
+void FPipelineCache::Initialize(VkDevice InDevice, VkPhysicalDevice PhysicalDevice, const char* InPath)
+{
+	Device = InDevice;
+	Path = InPath;
+
+	VkPhysicalDeviceProperties Properties;
+	vkGetPhysicalDeviceProperties(PhysicalDevice, &Properties);
+
+	std::vector<uint8> Data;
+	if(ReadFile(Path, Data))
+	{
+		bWarm = IsCompatible(Data, Properties);
+		if(!bWarm)
+		{
+			SDL_Log("Pipeline cache %s was written by another device or driver, starting cold", Path.c_str());
+			Data.clear();
+		}
+	}
+
+	VkPipelineCacheCreateInfo CacheInfo {};
+	CacheInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
+	CacheInfo.initialDataSize = Data.size();
+	CacheInfo.pInitialData = Data.empty() ? nullptr : Data.data();
+
+	// Drivers are allowed to reject a blob that still got through the header check, retry empty if so.
+	if(vkCreatePipelineCache(Device, &CacheInfo, nullptr, &Cache) != VK_SUCCESS)
+	{
+		bWarm = false;
+		CacheInfo.initialDataSize = 0;
+		CacheInfo.pInitialData = nullptr;
+		VK_CHECK(vkCreatePipelineCache(Device, &CacheInfo, nullptr, &Cache));
+	}
+
+	SDL_Log("Pipeline cache %s (%zu bytes)", bWarm ? "loaded" : "empty", Data.size());
+}
+
+void FPipelineCache::Shutdown()
+{
+	size_t Size = 0;
+	std::vector<uint8> Data;
+	if(vkGetPipelineCacheData(Device, Cache, &Size, nullptr) == VK_SUCCESS && Size > 0)
+	{
+		Data.resize(Size);
+		if(vkGetPipelineCacheData(Device, Cache, &Size, Data.data()) != VK_SUCCESS)
+		{
+			Data.clear();
+		}
+	}
+
+	vkDestroyPipelineCache(Device, Cache, nullptr);
+	Cache = VK_NULL_HANDLE;
+
+	if(Data.empty())
+	{
+		return;
+	}
+
+	// Write next to the old blob and swap it in, so a crash mid write can't leave a torn cache behind.
+	const std::string TempPath = Path + ".tmp";
+	FILE* File = std::fopen(TempPath.c_str(), "wb");
+	if(!File)
+	{
+		SDL_Log("Couldn't write pipeline cache %s", TempPath.c_str());
+		return;
+	}
+
+	const bool bWritten = std::fwrite(Data.data(), 1, Size, File) == Size;
+	if(std::fclose(File) != 0 || !bWritten)
+	{
+		std::remove(TempPath.c_str());
+		return;
+	}
+
+	// Windows won't rename over an existing file.
+	std::remove(Path.c_str());
+	if(std::rename(TempPath.c_str(), Path.c_str()) != 0)
+	{
+		SDL_Log("Couldn't replace pipeline cache %s", Path.c_str());
+	}
+}
+
+bool FPipelineCache::IsCompatible(const std::vector<uint8>& Data, const VkPhysicalDeviceProperties& Properties)
+{
+	if(Data.size() < HeaderSize)
+	{
+		return false;
+	}
+
+	const uint32 HeaderLength = ReadUint32(&Data[0]);
+	const uint32 HeaderVersion = ReadUint32(&Data[4]);
+	const uint32 VendorId = ReadUint32(&Data[8]);
+	const uint32 DeviceId = ReadUint32(&Data[12]);
+
+	return HeaderLength >= HeaderSize
+		&& HeaderLength <= Data.size()
+		&& HeaderVersion == VK_PIPELINE_CACHE_HEADER_VERSION_ONE
+		&& VendorId == Properties.vendorID
+		&& DeviceId == Properties.deviceID
+		&& std::memcmp(&Data[16], Properties.pipelineCacheUUID, VK_UUID_SIZE) == 0;
+}
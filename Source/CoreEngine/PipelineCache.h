@@ -0,0 +1,50 @@
+// Copyright Snaps 2022, All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "vulkan.h"
+#include <string>
+#include <vector>
+
+/*
+	VkPipelineCache that survives restarts. The blob saved by the last run is
+	loaded on startup and handed to the driver, so pipelines it has already
+	compiled come straight out of the cache instead of going through shader
+	compilation again. Every pipeline should be created with Get().
+
+	Blobs are only valid for the exact device and driver that wrote them. The
+	header is checked against this device's vendor, device id and cache UUID
+	(which drivers change with every version) and a blob that doesn't match is
+	dropped and replaced with a fresh cache.
+*/
+class FPipelineCache
+{
+public:
+
+	void Initialize(VkDevice Device, VkPhysicalDevice PhysicalDevice, const char* Path);
+
+	// Writes the cache back to disk and destroys it, call before the device is destroyed.
+	void Shutdown();
+
+	VkPipelineCache Get() const
+	{
+		return Cache;
+	}
+
+	// True if a valid blob from an earlier run was loaded.
+	bool IsWarm() const
+	{
+		return bWarm;
+	}
+
+	// True if Data starts with a pipeline cache header written by this exact device and driver.
+	static bool IsCompatible(const std::vector<uint8>& Data, const VkPhysicalDeviceProperties& Properties);
+
+private:
+
+	VkDevice 		Device 	= VK_NULL_HANDLE;
+	VkPipelineCache Cache 	= VK_NULL_HANDLE;
+	std::string 	Path;
+	bool 			bWarm 	= false;
+};
@@ -0,0 +1,328 @@
+// Copyright Snaps 2022, All Rights Reserved.
+
+#include "Profiler.h"
+#include <algorithm>
+#include <cstdio>
+#include <mutex>
+
+// Zones each thread keeps around, must be a power of 2. At 24 bytes a zone that's 1.5 MB per thread.
+static const uint64 ZoneRingCapacity = 1 << 16;
+
+// Weight of the newest frame in FProfileZoneStats::AverageMs.
+static const double StatsSmoothing = 1.0 / 30.0;
+
+// Fields are relaxed atomics so the main thread can read a ring while its owner writes to it.
+struct FZoneRecord
+{
+	std::atomic<FProfileZone*> 	Zone;
+	std::atomic<uint64> 		StartTime;
+	std::atomic<uint64> 		EndTime;
+};
+
+// Plain copy of a zone taken out of a ring.
+struct FZoneSample
+{
+	FProfileZone* 	Zone;
+	uint64 			StartTime;
+	uint64 			EndTime;
+};
+
+/*
+	Single producer ring of zones owned by one thread. Only the owner writes,
+	readers copy a range out and then re-check the write index to throw away
+	anything the owner may have lapped while they were copying.
+*/
+struct FThreadZoneRing
+{
+	std::atomic<uint64> 			WriteIndex { 0 };
+	std::unique_ptr<FZoneRecord[]> 	Zones;
+	uint64 							StatsCursor = 0;	// Main thread only, first zone EndFrame hasn't seen.
+	uint32 							ThreadId 	= 0;
+	std::string 					Name;
+
+	// Appends zones in [FromIndex, WriteIndex) that are still intact to OutSamples, returns the new cursor.
+	uint64 Read(uint64 FromIndex, std::vector<FZoneSample>& OutSamples) const
+	{
+		const uint64 EndIndex = WriteIndex.load(std::memory_order_acquire);
+		const uint64 FirstIndex = std::max(FromIndex, EndIndex > ZoneRingCapacity ? EndIndex - ZoneRingCapacity : 0);
+
+		const size_t FirstSample = OutSamples.size();
+		for(uint64 Index = FirstIndex; Index < EndIndex; Index++)
+		{
+			const FZoneRecord& Zone = Zones[Index & (ZoneRingCapacity - 1)];
+			OutSamples.push_back({
+				Zone.Zone.load(std::memory_order_relaxed),
+				Zone.StartTime.load(std::memory_order_relaxed),
+				Zone.EndTime.load(std::memory_order_relaxed)
+			});
+		}
+
+		// A slot is only safe if the owner can't have started reusing it, i.e. it's a whole ring behind.
+		std::atomic_thread_fence(std::memory_order_acquire);
+		const uint64 LatestIndex = WriteIndex.load(std::memory_order_relaxed);
+		if(LatestIndex >= FirstIndex + ZoneRingCapacity)
+		{
+			const uint64 NumLost = std::min<uint64>(LatestIndex - ZoneRingCapacity + 1 - FirstIndex, EndIndex - FirstIndex);
+			OutSamples.erase(OutSamples.begin() + FirstSample, OutSamples.begin() + FirstSample + (size_t)NumLost);
+		}
+		return EndIndex;
+	}
+};
+
+std::atomic<bool> FProfiler::bEnabled { false };
+
+static std::mutex 										GRingsMutex;
+static std::vector<std::unique_ptr<FThreadZoneRing>> 	GRings;
+static thread_local FThreadZoneRing* 					GThreadRing = nullptr;
+
+static uint64 	GStartTime 				= 0;
+static double 	GTicksPerMicrosecond 	= 1000.0;
+
+// Zone stats and this frame's running totals, main thread only. The generation
+// goes up whenever the stats are cleared, so zones know their cached index is gone.
+static std::vector<FProfileZoneStats> 	GZoneStats;
+static std::vector<double> 				GFrameMs;
+static std::vector<uint32> 				GFrameCalls;
+static uint32 							GStatsGeneration = 1;
+static std::vector<FZoneSample> 		GSamples;
+
+static FThreadZoneRing* RegisterThread()
+{
+	std::lock_guard<std::mutex> Lock(GRingsMutex);
+
+	std::unique_ptr<FThreadZoneRing> Ring(new FThreadZoneRing());
+	Ring->Zones.reset(new FZoneRecord[ZoneRingCapacity]);
+	Ring->ThreadId = (uint32)GRings.size();
+	Ring->Name = "Thread " + std::to_string(Ring->ThreadId);
+
+	GThreadRing = Ring.get();
+	GRings.push_back(std::move(Ring));
+	return GThreadRing;
+}
+
+static double TicksToMicroseconds(uint64 Ticks)
+{
+	return (double)Ticks / GTicksPerMicrosecond;
+}
+
+// Index into GZoneStats for a zone name. Zones with the same name share stats, even across sites.
+static uint32 FindOrAddZone(const char* Name, bool bGpu)
+{
+	uint32 Index = 0;
+	while(Index < GZoneStats.size() && (GZoneStats[Index].bGpu != bGpu || GZoneStats[Index].Name != Name))
+	{
+		Index++;
+	}
+
+	if(Index == GZoneStats.size())
+	{
+		FProfileZoneStats Stats;
+		Stats.Name = Name;
+		Stats.bGpu = bGpu;
+		GZoneStats.push_back(Stats);
+		GFrameMs.push_back(0.0);
+		GFrameCalls.push_back(0);
+	}
+	return Index;
+}
+
+// Same for a recorded zone, only searches by name the first time a site shows up.
+static uint32 FindOrAddZone(FProfileZone* Zone)
+{
+	if(Zone->StatsGeneration != GStatsGeneration)
+	{
+		Zone->StatsIndex = FindOrAddZone(Zone->Name, false);
+		Zone->StatsGeneration = GStatsGeneration;
+	}
+	return Zone->StatsIndex;
+}
+
+static void WriteJsonString(FILE* File, const char* Text)
+{
+	std::fputc('"', File);
+	for(; *Text; Text++)
+	{
+		if(*Text == '"' || *Text == '\\')
+		{
+			std::fputc('\\', File);
+		}
+		std::fputc(*Text, File);
+	}
+	std::fputc('"', File);
+}
+
+void FProfiler::Initialize()
+{
+	// Work out the tick rate against the steady clock, ~10ms is plenty for 3-4 significant digits.
+	const std::chrono::steady_clock::time_point ClockStart = std::chrono::steady_clock::now();
+	GStartTime = GetTimestamp();
+
+#if VOXEL_PROFILER_RDTSC
+	std::chrono::steady_clock::time_point ClockEnd;
+	do
+	{
+		ClockEnd = std::chrono::steady_clock::now();
+	}
+	while(ClockEnd - ClockStart < std::chrono::milliseconds(10));
+
+	const double ElapsedMicroseconds = std::chrono::duration<double, std::micro>(ClockEnd - ClockStart).count();
+	GTicksPerMicrosecond = (double)(GetTimestamp() - GStartTime) / ElapsedMicroseconds;
+#else
+	GTicksPerMicrosecond = 1000.0;
+#endif
+
+	SetThreadName("Main");
+	SetEnabled(true);
+}
+
+void FProfiler::Shutdown()
+{
+	// Rings are left alone, threads that are still around may hold on to theirs.
+	SetEnabled(false);
+	GZoneStats.clear();
+	GFrameMs.clear();
+	GFrameCalls.clear();
+	GStatsGeneration++;
+}
+
+void FProfiler::SetEnabled(bool bInEnabled)
+{
+	bEnabled.store(bInEnabled, std::memory_order_relaxed);
+}
+
+void FProfiler::RecordZone(FProfileZone* Zone, uint64 StartTime, uint64 EndTime)
+{
+	FThreadZoneRing* Ring = GThreadRing;
+	if(!Ring)
+	{
+		Ring = RegisterThread();
+	}
+
+	const uint64 Index = Ring->WriteIndex.load(std::memory_order_relaxed);
+	FZoneRecord& Record = Ring->Zones[Index & (ZoneRingCapacity - 1)];
+	Record.Zone.store(Zone, std::memory_order_relaxed);
+	Record.StartTime.store(StartTime, std::memory_order_relaxed);
+	Record.EndTime.store(EndTime, std::memory_order_relaxed);
+	Ring->WriteIndex.store(Index + 1, std::memory_order_release);
+}
+
+void FProfiler::SetThreadName(const char* Name)
+{
+	FThreadZoneRing* Ring = GThreadRing ? GThreadRing : RegisterThread();
+
+	std::lock_guard<std::mutex> Lock(GRingsMutex);
+	Ring->Name = Name;
+}
+
+void FProfiler::EndFrame()
+{
+	{
+		std::lock_guard<std::mutex> Lock(GRingsMutex);
+		for(const std::unique_ptr<FThreadZoneRing>& Ring : GRings)
+		{
+			GSamples.clear();
+			Ring->StatsCursor = Ring->Read(Ring->StatsCursor, GSamples);
+
+			for(const FZoneSample& Sample : GSamples)
+			{
+				const uint32 Zone = FindOrAddZone(Sample.Zone);
+				GFrameMs[Zone] += TicksToMicroseconds(Sample.EndTime - Sample.StartTime) / 1000.0;
+				GFrameCalls[Zone]++;
+			}
+		}
+	}
+
+	for(size_t Zone = 0; Zone < GZoneStats.size(); Zone++)
+	{
+		FProfileZoneStats& Stats = GZoneStats[Zone];
+		Stats.LastMs = GFrameMs[Zone];
+		Stats.LastCalls = GFrameCalls[Zone];
+		Stats.AverageMs += (Stats.LastMs - Stats.AverageMs) * StatsSmoothing;
+		Stats.MaxMs = std::max(Stats.MaxMs, Stats.LastMs);
+
+		GFrameMs[Zone] = 0.0;
+		GFrameCalls[Zone] = 0;
+	}
+}
+
+void FProfiler::AddZoneTime(const char* Name, double Milliseconds, bool bGpu)
+{
+	const uint32 Zone = FindOrAddZone(Name, bGpu);
+	GFrameMs[Zone] += Milliseconds;
+	GFrameCalls[Zone]++;
+}
+
+const std::vector<FProfileZoneStats>& FProfiler::GetZoneStats()
+{
+	return GZoneStats;
+}
+
+bool FProfiler::WriteChromeTrace(const char* Path)
+{
+	FILE* File = std::fopen(Path, "w");
+	if(!File)
+	{
+		return false;
+	}
+
+	std::fprintf(File, "{\"traceEvents\":[\n");
+	bool bFirst = true;
+
+	std::lock_guard<std::mutex> Lock(GRingsMutex);
+	for(const std::unique_ptr<FThreadZoneRing>& Ring : GRings)
+	{
+		// Thread names show up as track titles.
+		std::fprintf(File, "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%u,\"args\":{\"name\":", bFirst ? "" : ",\n", Ring->ThreadId);
+		WriteJsonString(File, Ring->Name.c_str());
+		std::fprintf(File, "}}");
+		bFirst = false;
+
+		GSamples.clear();
+		Ring->Read(0, GSamples);
+
+		// Complete events, the viewer rebuilds the hierarchy from how they nest.
+		for(const FZoneSample& Sample : GSamples)
+		{
+			std::fprintf(File, ",\n{\"name\":");
+			WriteJsonString(File, Sample.Zone->Name);
+			std::fprintf(File, ",\"ph\":\"X\",\"pid\":1,\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f}",
+				Ring->ThreadId,
+				TicksToMicroseconds(Sample.StartTime - GStartTime),
+				TicksToMicroseconds(Sample.EndTime - Sample.StartTime)
+			);
+		}
+	}
+
+	std::fprintf(File, "\n],\"displayTimeUnit\":\"ms\"}\n");
+	return std::fclose(File) == 0;
+}
+
+std::string FProfiler::FormatZoneStats()
+{
+	std::vector<const FProfileZoneStats*> Sorted;
+	for(const FProfileZoneStats& Stats : GZoneStats)
+	{
+		Sorted.push_back(&Stats);
+	}
+
+	std::sort(Sorted.begin(), Sorted.end(), [](const FProfileZoneStats* A, const FProfileZoneStats* B)
+	{
+		return A->AverageMs > B->AverageMs;
+	});
+
+	std::string Table;
+	char Line[256];
+	for(const FProfileZoneStats* Stats : Sorted)
+	{
+		std::snprintf(Line, sizeof(Line), "%s %-40s %8.3f ms avg %8.3f ms last %8.3f ms max %6u calls\n",
+			Stats->bGpu ? "GPU" : "CPU",
+			Stats->Name.c_str(),
+			Stats->AverageMs,
+			Stats->LastMs,
+			Stats->MaxMs,
+			Stats->LastCalls
+		);
+		Table += Line;
+	}
+	return Table;
+}
@@ -0,0 +1,137 @@
+// Copyright Snaps 2022, All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <vector>
+
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#include <intrin.h>
+#define VOXEL_PROFILER_RDTSC 1
+#elif defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define VOXEL_PROFILER_RDTSC 1
+#endif
+
+/*
+	Aggregated timings of one named zone, updated once per frame by EndFrame().
+	GPU zones come from the renderer's timestamp queries instead of scopes.
+*/
+struct FProfileZoneStats
+{
+	std::string Name;
+	bool 		bGpu 		= false;
+	uint32 		LastCalls 	= 0;		// Times the zone ran last frame.
+	double 		LastMs 		= 0.0;		// Total inclusive time last frame.
+	double 		AverageMs 	= 0.0;		// Smoothed over roughly the last 30 frames.
+	double 		MaxMs 		= 0.0;
+};
+
+/*
+	Static description of one zone site, made by the PROFILE_* macros. Scopes only
+	record a pointer to it, the name isn't looked at until the rings are collected.
+*/
+struct FProfileZone
+{
+	const char* Name;
+
+	// Main thread only, where EndFrame keeps this zone's stats. Stale once the generation changes.
+	uint32 		StatsIndex 		= 0;
+	uint32 		StatsGeneration = 0;
+};
+
+/*
+	Instrumenting CPU profiler. Zones are recorded with the PROFILE_* macros from
+	CoreMacros.h into a ring buffer owned by the recording thread, so recording
+	never takes a lock or touches another thread's cache lines. The main thread
+	drains the rings once a frame to build per zone stats, and the last few
+	frames worth of zones can be written out as Chrome trace JSON, which loads
+	in chrome://tracing and ui.perfetto.dev.
+
+	Timestamps are raw TSC ticks on x86 (converted when read) and steady_clock
+	nanoseconds elsewhere. Zones are only recorded while enabled, a disabled
+	zone is one relaxed load and a branch. An enabled zone is two timestamps
+	and four stores, names are resolved through the zone's FProfileZone when
+	the rings are drained.
+*/
+class FProfiler
+{
+public:
+
+	static void Initialize();
+	static void Shutdown();
+
+	static bool IsEnabled()
+	{
+		return bEnabled.load(std::memory_order_relaxed);
+	}
+
+	static void SetEnabled(bool bInEnabled);
+
+	static uint64 GetTimestamp()
+	{
+#if VOXEL_PROFILER_RDTSC
+		return __rdtsc();
+#else
+		return (uint64)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+	}
+
+	// Zone must outlive the profiler, the macros make it a static.
+	static void RecordZone(FProfileZone* Zone, uint64 StartTime, uint64 EndTime);
+
+	// Names the calling thread in traces, copied.
+	static void SetThreadName(const char* Name);
+
+	// Folds everything recorded since the last call into the zone stats, main thread only.
+	static void EndFrame();
+
+	// Feeds a zone measured elsewhere (e.g. GPU timestamps) into this frame's stats.
+	static void AddZoneTime(const char* Name, double Milliseconds, bool bGpu);
+
+	static const std::vector<FProfileZoneStats>& GetZoneStats();
+
+	// Writes every zone still held in the thread rings, main thread only.
+	static bool WriteChromeTrace(const char* Path);
+
+	// Zone stats as a printable table, slowest zones first.
+	static std::string FormatZoneStats();
+
+private:
+
+	static std::atomic<bool> bEnabled;
+};
+
+/*
+	Records the time between construction and destruction as one zone.
+	Use through PROFILE_SCOPE / PROFILE_FUNCTION.
+*/
+class FProfileScope
+{
+public:
+
+	explicit FProfileScope(FProfileZone* InZone)
+		: Zone(FProfiler::IsEnabled() ? InZone : nullptr)
+		, StartTime(Zone ? FProfiler::GetTimestamp() : 0)
+	{
+	}
+
+	~FProfileScope()
+	{
+		if(Zone)
+		{
+			FProfiler::RecordZone(Zone, StartTime, FProfiler::GetTimestamp());
+		}
+	}
+
+	FProfileScope(const FProfileScope&) = delete;
+	FProfileScope& operator=(const FProfileScope&) = delete;
+
+private:
+
+	FProfileZone* 	Zone;
+	uint64 			StartTime;
+};
@@ -0,0 +1,714 @@
+// Copyright Snaps 2022, All Rights Reserved.
+
+#include "RegionFile.h"
+#include "Compression.h"
+#include "VoxelChunk.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+
+#if defined(_WIN32)
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+static const uint32 RegionMagic 	= 0x47525856; 	// "VXRG"
+static const uint32 RegionVersion 	= 1;
+
+// Sector 0 is the header, the table follows in whole sectors.
+static const uint32 TableSectors 	= FRegionFile::NumRegionChunks * sizeof(uint32) / FRegionFile::SectorSize;
+static const uint32 HeaderSectors 	= 1 + TableSectors;
+static const uint32 MaxRecordSectors = 255;
+
+struct FRegionHeader
+{
+	uint32 	Magic;
+	uint32 	Version;
+	uint32 	RegionSize;
+	uint32 	RegionHeight;
+};
+
+// Followed by the palette, the palette counts and the (compressed) packed indices. Little endian.
+struct FChunkRecordHeader
+{
+	uint32 	Size; 			// Bytes after this header.
+	uint32 	Checksum; 		// Of those bytes and the fields below.
+	uint8 	BitsPerIndex;
+	uint8 	bCompressed; 	// Indices are a Compression block, otherwise the raw words.
+	uint16 	PaletteSize;
+	uint32 	DataSize; 		// Stored bytes of indices.
+};
+
+static const intptr_t InvalidFile = -1;
+
+// Word at a time multiply-xorshift hash, catches torn writes and bit rot, not tampering.
+static uint32 ComputeChecksum(const FChunkRecordHeader& Header, const uint8* Bytes, size_t Size)
+{
+	uint64 Hash = (uint64)Header.BitsPerIndex | ((uint64)Header.bCompressed << 8) | ((uint64)Header.PaletteSize << 16) | ((uint64)Header.DataSize << 32);
+	Hash ^= Size * 0x9E3779B97F4A7C15ull;
+
+	size_t Offset = 0;
+	for(; Offset + sizeof(uint64) <= Size; Offset += sizeof(uint64))
+	{
+		uint64 Word;
+		std::memcpy(&Word, Bytes + Offset, sizeof(Word));
+		Hash = (Hash ^ Word) * 0xFF51AFD7ED558CCDull;
+		Hash ^= Hash >> 29;
+	}
+	for(; Offset < Size; Offset++)
+	{
+		Hash = (Hash ^ Bytes[Offset]) * 0xC4CEB9FE1A85EC53ull;
+	}
+
+	Hash ^= Hash >> 33;
+	Hash *= 0xC4CEB9FE1A85EC53ull;
+	Hash ^= Hash >> 33;
+	return (uint32)Hash;
+}
+
+static uint32 GetSectorCount(uint64 Bytes)
+{
+	return (uint32)((Bytes + FRegionFile::SectorSize - 1) / FRegionFile::SectorSize);
+}
+
+#if defined(_WIN32)
+
+static intptr_t OpenRegionFile(const std::string& Path, bool bCreate)
+{
+	const HANDLE Handle = CreateFileA(Path.c_str(), GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ, nullptr,
+		bCreate ? OPEN_ALWAYS : OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+	return Handle == INVALID_HANDLE_VALUE ? InvalidFile : (intptr_t)Handle;
+}
+
+static void CloseFile(intptr_t File)
+{
+	CloseHandle((HANDLE)File);
+}
+
+static uint64 GetFileLength(intptr_t File)
+{
+	LARGE_INTEGER Size;
+	return GetFileSizeEx((HANDLE)File, &Size) ? (uint64)Size.QuadPart : 0;
+}
+
+static bool WriteAt(intptr_t File, uint64 Offset, const void* Data, size_t Size)
+{
+	const uint8* Bytes = static_cast<const uint8*>(Data);
+	while(Size > 0)
+	{
+		OVERLAPPED Overlapped = {};
+		Overlapped.Offset = (DWORD)Offset;
+		Overlapped.OffsetHigh = (DWORD)(Offset >> 32);
+
+		DWORD Written = 0;
+		const DWORD ToWrite = Size > 0x40000000 ? 0x40000000 : (DWORD)Size;
+		if(!WriteFile((HANDLE)File, Bytes, ToWrite, &Written, &Overlapped) || Written == 0)
+		{
+			return false;
+		}
+		Bytes += Written;
+		Offset += Written;
+		Size -= Written;
+	}
+	return true;
+}
+
+static bool FlushFile(intptr_t File)
+{
+	return FlushFileBuffers((HANDLE)File) != 0;
+}
+
+static const uint8* MapFile(intptr_t File, uint64 Size)
+{
+	// The view keeps the mapping object alive, its handle isn't needed past this.
+	const HANDLE MappingHandle = CreateFileMappingA((HANDLE)File, nullptr, PAGE_READONLY, (DWORD)(Size >> 32), (DWORD)Size, nullptr);
+	if(!MappingHandle)
+	{
+		return nullptr;
+	}
+
+	const void* View = MapViewOfFile(MappingHandle, FILE_MAP_READ, 0, 0, (SIZE_T)Size);
+	CloseHandle(MappingHandle);
+	return static_cast<const uint8*>(View);
+}
+
+static void UnmapFile(const uint8* Mapping, uint64)
+{
+	UnmapViewOfFile(Mapping);
+}
+
+static bool ReplaceWithFile(const std::string& From, const std::string& To)
+{
+	return MoveFileExA(From.c_str(), To.c_str(), MOVEFILE_REPLACE_EXISTING) != 0;
+}
+
+#else
+
+static intptr_t OpenRegionFile(const std::string& Path, bool bCreate)
+{
+	const int Descriptor = open(Path.c_str(), O_RDWR | (bCreate ? O_CREAT : 0), 0644);
+	return Descriptor < 0 ? InvalidFile : (intptr_t)Descriptor;
+}
+
+static void CloseFile(intptr_t File)
+{
+	close((int)File);
+}
+
+static uint64 GetFileLength(intptr_t File)
+{
+	struct stat Stat;
+	return fstat((int)File, &Stat) == 0 ? (uint64)Stat.st_size : 0;
+}
+
+static bool WriteAt(intptr_t File, uint64 Offset, const void* Data, size_t Size)
+{
+	const uint8* Bytes = static_cast<const uint8*>(Data);
+	while(Size > 0)
+	{
+		const ssize_t Written = pwrite((int)File, Bytes, Size, (off_t)Offset);
+		if(Written <= 0)
+		{
+			return false;
+		}
+		Bytes += Written;
+		Offset += (uint64)Written;
+		Size -= (size_t)Written;
+	}
+	return true;
+}
+
+static bool FlushFile(intptr_t File)
+{
+	return fsync((int)File) == 0;
+}
+
+static const uint8* MapFile(intptr_t File, uint64 Size)
+{
+	void* View = mmap(nullptr, (size_t)Size, PROT_READ, MAP_SHARED, (int)File, 0);
+	return View == MAP_FAILED ? nullptr : static_cast<const uint8*>(View);
+}
+
+static void UnmapFile(const uint8* Mapping, uint64 Size)
+{
+	munmap(const_cast<uint8*>(Mapping), (size_t)Size);
+}
+
+static bool ReplaceWithFile(const std::string& From, const std::string& To)
+{
+	return rename(From.c_str(), To.c_str()) == 0;
+}
+
+#endif
+
+FRegionFile::FRegionFile()
+	: File(InvalidFile)
+	, Mapping(nullptr)
+	, MappedSize(0)
+	, Table(NumRegionChunks, 0)
+	, NumFreeSectors(0)
+	, NumChunks(0)
+{
+}
+
+FRegionFile::~FRegionFile()
+{
+	Close();
+}
+
+bool FRegionFile::Open(const std::string& InPath, bool bCreate)
+{
+	Close();
+
+	File = OpenRegionFile(InPath, bCreate);
+	if(File == InvalidFile)
+	{
+		return false;
+	}
+	Path = InPath;
+
+	// New file, header and an empty table.
+	uint64 FileSize = GetFileLength(File);
+	if(FileSize == 0 && bCreate)
+	{
+		std::vector<uint8> Empty(HeaderSectors * SectorSize, 0);
+		const FRegionHeader Header = { RegionMagic, RegionVersion, (uint32)RegionSize, (uint32)RegionHeight };
+		std::memcpy(Empty.data(), &Header, sizeof(Header));
+
+		if(!WriteAt(File, 0, Empty.data(), Empty.size()))
+		{
+			Close();
+			return false;
+		}
+		FileSize = Empty.size();
+	}
+
+	FRegionHeader Header;
+	if(FileSize < HeaderSectors * SectorSize || !Remap()
+		|| (std::memcpy(&Header, Mapping, sizeof(Header)), Header.Magic != RegionMagic)
+		|| Header.Version != RegionVersion || Header.RegionSize != RegionSize || Header.RegionHeight != RegionHeight)
+	{
+		Close();
+		return false;
+	}
+
+	std::memcpy(Table.data(), Mapping + SectorSize, NumRegionChunks * sizeof(uint32));
+
+	// A trailing partial sector can only come from an interrupted append, nothing in it is referenced.
+	UsedSectors.assign((size_t)(FileSize / SectorSize), false);
+	for(uint32 Sector = 0; Sector < HeaderSectors; Sector++)
+	{
+		UsedSectors[Sector] = true;
+	}
+
+	// Entries pointing outside the file or at sectors already taken can't be trusted, treat them as missing.
+	NumChunks = 0;
+	for(uint32& Entry : Table)
+	{
+		const uint32 First = Entry >> 8;
+		const uint32 Count = Entry & 0xFF;
+		bool bValid = Entry != 0 && Count > 0 && First >= HeaderSectors && (uint64)First + Count <= UsedSectors.size();
+
+		for(uint32 Sector = First; bValid && Sector < First + Count; Sector++)
+		{
+			bValid = !UsedSectors[Sector];
+		}
+
+		if(!bValid)
+		{
+			Entry = 0;
+			continue;
+		}
+
+		for(uint32 Sector = First; Sector < First + Count; Sector++)
+		{
+			UsedSectors[Sector] = true;
+		}
+		NumChunks++;
+	}
+
+	NumFreeSectors = 0;
+	for(bool bUsed : UsedSectors)
+	{
+		NumFreeSectors += bUsed ? 0 : 1;
+	}
+	return true;
+}
+
+void FRegionFile::Close()
+{
+	if(Mapping)
+	{
+		UnmapFile(Mapping, MappedSize);
+		Mapping = nullptr;
+		MappedSize = 0;
+	}
+
+	if(File != InvalidFile)
+	{
+		CloseFile(File);
+		File = InvalidFile;
+	}
+
+	std::fill(Table.begin(), Table.end(), 0);
+	UsedSectors.clear();
+	NumFreeSectors = 0;
+	NumChunks = 0;
+	Path.clear();
+}
+
+bool FRegionFile::LoadChunk(int32 X, int32 Y, int32 Z, FVoxelChunk& OutChunk)
+{
+	const uint32 Entry = Table[ToIndex(X, Y, Z)];
+	if(Entry == 0)
+	{
+		return false;
+	}
+
+	// Saves write past the end of the mapping, catch up before reading a record they put there.
+	const uint64 Offset = (uint64)(Entry >> 8) * SectorSize;
+	const uint64 Capacity = (uint64)(Entry & 0xFF) * SectorSize;
+	if(Offset + Capacity > MappedSize && (!Remap() || Offset + Capacity > MappedSize))
+	{
+		return false;
+	}
+
+	return DecodeRecord(Mapping + Offset, Capacity, OutChunk);
+}
+
+bool FRegionFile::DecodeRecord(const uint8* Record, uint64 Capacity, FVoxelChunk& OutChunk)
+{
+	FChunkRecordHeader Header;
+	if(Capacity < sizeof(Header))
+	{
+		return false;
+	}
+	std::memcpy(&Header, Record, sizeof(Header));
+
+	const uint32 PaletteBytes = Header.PaletteSize * (uint32)sizeof(FBlockId);
+	const uint32 CountBytes = Header.PaletteSize * (uint32)sizeof(uint16);
+	if(sizeof(Header) + (uint64)Header.Size > Capacity || Header.Size != (uint64)PaletteBytes + CountBytes + Header.DataSize)
+	{
+		return false;
+	}
+
+	const uint8* Payload = Record + sizeof(Header);
+	if(ComputeChecksum(Header, Payload, Header.Size) != Header.Checksum)
+	{
+		return false;
+	}
+
+	// Counts have to add up to the whole chunk or later edits would corrupt it.
+	uint32 TotalCount = 0;
+	for(uint32 PaletteIndex = 0; PaletteIndex < Header.PaletteSize; PaletteIndex++)
+	{
+		uint16 Count;
+		std::memcpy(&Count, Payload + PaletteBytes + PaletteIndex * sizeof(uint16), sizeof(Count));
+		TotalCount += Count;
+	}
+
+	const uint32 DataBytes = (uint32)ChunkVolume * Header.BitsPerIndex / 8;
+	if((Header.PaletteSize > 0 && TotalCount != (uint32)ChunkVolume) || (!Header.bCompressed && Header.DataSize != DataBytes))
+	{
+		return false;
+	}
+
+	// Everything checked, from here on the chunk is overwritten.
+	FBlockId* Palette;
+	uint16* PaletteCounts;
+	uint64* Data;
+	if(!OutChunk.ResetStorage(Header.BitsPerIndex, Header.PaletteSize, Palette, PaletteCounts, Data))
+	{
+		return false;
+	}
+
+	std::memcpy(Palette, Payload, PaletteBytes);
+	std::memcpy(PaletteCounts, Payload + PaletteBytes, CountBytes);
+
+	// Uniform chunks have no indices at all.
+	const uint8* StoredData = Payload + PaletteBytes + CountBytes;
+	if(Header.bCompressed)
+	{
+		if(!Compression::Decompress(StoredData, Header.DataSize, Data, DataBytes))
+		{
+			// Passed the checksum but doesn't decode, only possible for a file written by a broken build.
+			OutChunk.Fill(BlockAir);
+			return false;
+		}
+	}
+	else if(DataBytes > 0)
+	{
+		std::memcpy(Data, StoredData, DataBytes);
+	}
+	return true;
+}
+
+uint32 FRegionFile::EncodeRecord(const FVoxelChunk& Chunk, std::vector<uint8>& OutRecord)
+{
+	const std::vector<FBlockId>& Palette = Chunk.GetPalette();
+	const std::vector<uint16>& PaletteCounts = Chunk.GetPaletteCounts();
+	const std::vector<uint64>& Data = Chunk.GetData();
+
+	const uint32 PaletteBytes = (uint32)(Palette.size() * sizeof(FBlockId));
+	const uint32 CountBytes = (uint32)(PaletteCounts.size() * sizeof(uint16));
+	const uint32 DataBytes = (uint32)(Data.size() * sizeof(uint64));
+
+	// Whole sectors, so the file always ends on a sector boundary and the padding is zeroed.
+	const size_t MaxRecordBytes = sizeof(FChunkRecordHeader) + PaletteBytes + CountBytes + Compression::GetMaxCompressedSize(DataBytes);
+	OutRecord.assign((size_t)GetSectorCount(MaxRecordBytes) * SectorSize, 0);
+
+	uint8* Payload = OutRecord.data() + sizeof(FChunkRecordHeader);
+	std::memcpy(Payload, Palette.data(), PaletteBytes);
+	std::memcpy(Payload + PaletteBytes, PaletteCounts.data(), CountBytes);
+
+	// Indices that don't compress are stored as they are.
+	uint8* StoredData = Payload + PaletteBytes + CountBytes;
+	uint32 StoredBytes = 0;
+	bool bCompressed = false;
+	if(DataBytes > 0)
+	{
+		StoredBytes = (uint32)Compression::Compress(Data.data(), DataBytes, StoredData, Compression::GetMaxCompressedSize(DataBytes));
+		bCompressed = StoredBytes > 0 && StoredBytes < DataBytes;
+		if(!bCompressed)
+		{
+			std::memcpy(StoredData, Data.data(), DataBytes);
+			StoredBytes = DataBytes;
+		}
+	}
+
+	// A discarded compressed copy can reach past what is stored, the padding has to be zero.
+	std::memset(StoredData + StoredBytes, 0, OutRecord.size() - (size_t)(StoredData + StoredBytes - OutRecord.data()));
+
+	FChunkRecordHeader Header;
+	Header.Size = PaletteBytes + CountBytes + StoredBytes;
+	Header.BitsPerIndex = (uint8)Chunk.GetBitsPerIndex();
+	Header.bCompressed = bCompressed ? 1 : 0;
+	Header.PaletteSize = (uint16)Palette.size();
+	Header.DataSize = StoredBytes;
+	Header.Checksum = ComputeChecksum(Header, Payload, Header.Size);
+	std::memcpy(OutRecord.data(), &Header, sizeof(Header));
+
+	// Too big for a table entry, can't happen for chunks that went through the palette.
+	const uint32 NumSectors = GetSectorCount(sizeof(Header) + Header.Size);
+	return NumSectors <= MaxRecordSectors ? NumSectors : 0;
+}
+
+bool FRegionFile::SaveChunk(int32 X, int32 Y, int32 Z, const FVoxelChunk& Chunk)
+{
+	if(!IsOpen())
+	{
+		return false;
+	}
+
+	const uint32 NumSectors = EncodeRecord(Chunk, WriteBuffer);
+	if(NumSectors == 0)
+	{
+		return false;
+	}
+
+	// New copy first, the table only points at it once it's all written.
+	const uint32 First = AllocateSectors(NumSectors);
+	if(!WriteAt(File, (uint64)First * SectorSize, WriteBuffer.data(), (size_t)NumSectors * SectorSize))
+	{
+		FreeSectors(First, NumSectors);
+		return false;
+	}
+
+	const uint32 Index = ToIndex(X, Y, Z);
+	const uint32 OldEntry = Table[Index];
+	if(!WriteTableEntry(Index, (First << 8) | NumSectors))
+	{
+		FreeSectors(First, NumSectors);
+		return false;
+	}
+
+	if(OldEntry != 0)
+	{
+		FreeSectors(OldEntry >> 8, OldEntry & 0xFF);
+	}
+	else
+	{
+		NumChunks++;
+	}
+	return true;
+}
+
+bool FRegionFile::RemoveChunk(int32 X, int32 Y, int32 Z)
+{
+	const uint32 Index = ToIndex(X, Y, Z);
+	const uint32 OldEntry = Table[Index];
+	if(OldEntry == 0 || !WriteTableEntry(Index, 0))
+	{
+		return false;
+	}
+
+	FreeSectors(OldEntry >> 8, OldEntry & 0xFF);
+	NumChunks--;
+	return true;
+}
+
+bool FRegionFile::Flush()
+{
+	return IsOpen() && FlushFile(File);
+}
+
+bool FRegionFile::Compact(const std::string& Path, uint64* OutBytesBefore, uint64* OutBytesAfter)
+{
+	FRegionFile Source;
+	if(!Source.Open(Path, false))
+	{
+		return false;
+	}
+
+	const std::string TempPath = Path + ".compact";
+	std::remove(TempPath.c_str());
+
+	const intptr_t Target = OpenRegionFile(TempPath, true);
+	if(Target == InvalidFile)
+	{
+		return false;
+	}
+
+	// Records are copied as they are, trimmed to the sectors they actually use.
+	std::vector<uint32> NewTable(NumRegionChunks, 0);
+	uint32 NextSector = HeaderSectors;
+	bool bWritten = true;
+
+	for(uint32 Index = 0; Index < (uint32)NumRegionChunks && bWritten; Index++)
+	{
+		const uint32 Entry = Source.Table[Index];
+		if(Entry == 0)
+		{
+			continue;
+		}
+
+		const uint8* Record = Source.Mapping + (uint64)(Entry >> 8) * SectorSize;
+		FChunkRecordHeader Header;
+		std::memcpy(&Header, Record, sizeof(Header));
+
+		const uint32 NumSectors = GetSectorCount(sizeof(Header) + (uint64)Header.Size);
+		if(NumSectors == 0 || NumSectors > (Entry & 0xFF))
+		{
+			continue;
+		}
+
+		bWritten = WriteAt(Target, (uint64)NextSector * SectorSize, Record, (size_t)NumSectors * SectorSize);
+		NewTable[Index] = (NextSector << 8) | NumSectors;
+		NextSector += NumSectors;
+	}
+
+	std::vector<uint8> HeaderBytes(HeaderSectors * SectorSize, 0);
+	const FRegionHeader Header = { RegionMagic, RegionVersion, (uint32)RegionSize, (uint32)RegionHeight };
+	std::memcpy(HeaderBytes.data(), &Header, sizeof(Header));
+	std::memcpy(HeaderBytes.data() + SectorSize, NewTable.data(), NewTable.size() * sizeof(uint32));
+
+	bWritten = bWritten && WriteAt(Target, 0, HeaderBytes.data(), HeaderBytes.size()) && FlushFile(Target);
+	const uint64 BytesAfter = GetFileLength(Target);
+	CloseFile(Target);
+
+	const uint64 BytesBefore = (uint64)Source.GetNumSectors() * SectorSize;
+	Source.Close();
+
+	if(!bWritten || !ReplaceWithFile(TempPath, Path))
+	{
+		std::remove(TempPath.c_str());
+		return false;
+	}
+
+	if(OutBytesBefore)
+	{
+		*OutBytesBefore = BytesBefore;
+	}
+	if(OutBytesAfter)
+	{
+		*OutBytesAfter = BytesAfter;
+	}
+	return true;
+}
+
+std::string FRegionFile::GetFileName(int32 RegionX, int32 RegionY, int32 RegionZ)
+{
+	char Name[64];
+	std::snprintf(Name, sizeof(Name), "r.%d.%d.%d.region", RegionX, RegionY, RegionZ);
+	return Name;
+}
+
+bool FRegionFile::EvictFromPageCache(const std::string& Path)
+{
+#if defined(_WIN32)
+	// Opening without buffering makes the cache manager flush and purge the file.
+	const HANDLE Handle = CreateFileA(Path.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE, nullptr,
+		OPEN_EXISTING, FILE_FLAG_NO_BUFFERING, nullptr);
+	if(Handle == INVALID_HANDLE_VALUE)
+	{
+		return false;
+	}
+	CloseHandle(Handle);
+	return true;
+#else
+	const int Descriptor = open(Path.c_str(), O_RDONLY);
+	if(Descriptor < 0)
+	{
+		return false;
+	}
+
+	// Dirty pages can't be dropped, write them out first.
+	const bool bEvicted = fdatasync(Descriptor) == 0 && posix_fadvise(Descriptor, 0, 0, POSIX_FADV_DONTNEED) == 0;
+	close(Descriptor);
+	return bEvicted;
+#endif
+}
+
+bool FRegionFile::Remap()
+{
+	if(Mapping)
+	{
+		UnmapFile(Mapping, MappedSize);
+		Mapping = nullptr;
+		MappedSize = 0;
+	}
+
+	const uint64 FileSize = GetFileLength(File);
+	Mapping = FileSize > 0 ? MapFile(File, FileSize) : nullptr;
+	MappedSize = Mapping ? FileSize : 0;
+	return Mapping != nullptr;
+}
+
+uint32 FRegionFile::AllocateSectors(uint32 Count)
+{
+	// Nothing to reuse, skip the scan. Bulk saves into a fresh file all end up here.
+	if(NumFreeSectors == 0)
+	{
+		const uint32 First = (uint32)UsedSectors.size();
+		UsedSectors.resize(First + Count, true);
+		return First;
+	}
+
+	uint32 RunStart = 0;
+	uint32 RunLength = 0;
+	for(uint32 Sector = HeaderSectors; Sector < (uint32)UsedSectors.size(); Sector++)
+	{
+		if(UsedSectors[Sector])
+		{
+			RunLength = 0;
+			continue;
+		}
+
+		if(RunLength++ == 0)
+		{
+			RunStart = Sector;
+		}
+
+		if(RunLength == Count)
+		{
+			break;
+		}
+	}
+
+	// Free sectors at the very end are extended rather than skipped.
+	const uint32 First = RunLength > 0 ? RunStart : (uint32)UsedSectors.size();
+	const uint32 Reused = RunLength < Count ? RunLength : Count;
+	if(First + Count > UsedSectors.size())
+	{
+		UsedSectors.resize(First + Count, false);
+	}
+
+	for(uint32 Sector = First; Sector < First + Count; Sector++)
+	{
+		UsedSectors[Sector] = true;
+	}
+	NumFreeSectors -= Reused;
+	return First;
+}
+
+void FRegionFile::FreeSectors(uint32 First, uint32 Count)
+{
+	for(uint32 Sector = First; Sector < First + Count; Sector++)
+	{
+		UsedSectors[Sector] = false;
+	}
+	NumFreeSectors += Count;
+}
+
+uint32 FRegionFile::SetEntry(int32 X, int32 Y, int32 Z, uint32 Entry)
+{
+	const uint32 Index = ToIndex(X, Y, Z);
+	const uint32 OldEntry = Table[Index];
+	Table[Index] = Entry;
+	NumChunks += (Entry != 0 ? 1 : 0) - (OldEntry != 0 ? 1 : 0);
+	return OldEntry;
+}
+
+bool FRegionFile::WriteTableEntry(uint32 Index, uint32 Entry)
+{
+	if(!WriteAt(File, GetTableOffset(Index), &Entry, sizeof(Entry)))
+	{
+		return false;
+	}
+	Table[Index] = Entry;
+	return true;
+}
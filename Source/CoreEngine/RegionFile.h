@@ -0,0 +1,172 @@
+// Copyright Snaps 2022, All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include <string>
+#include <vector>
+
+class FVoxelChunk;
+
+/*
+	On disk storage for a 32x32 area of chunk columns, 8 chunks tall, one file
+	per region. The file is 512 byte sectors: a header sector, a table with one
+	entry per chunk (first sector and sector count), then chunk records. Each
+	record is the chunk's own palette storage with its packed indices
+	compressed on their own, so any chunk can be read without touching others.
+	Sectors are small because most chunks compress to well under a page.
+
+	Reads go through a read only mapping of the file and decompress straight
+	into the chunk's storage, there is no read buffer in between. Saves write
+	the new record to free sectors, reusing ones freed by earlier saves before
+	growing the file, and only then repoint the table and free the old record,
+	so an interrupted save leaves the previous version readable. Freed space
+	is only given back to the file system by Compact.
+
+	Not thread safe, callers serialize access to a region file.
+*/
+class FRegionFile
+{
+public:
+
+	// Columns along X and Z, chunks along Y.
+	static const int32 RegionSizeLog2 	= 5;
+	static const int32 RegionSize 		= 1 << RegionSizeLog2;
+	static const int32 RegionHeightLog2 = 3;
+	static const int32 RegionHeight 	= 1 << RegionHeightLog2;
+	static const int32 NumRegionChunks 	= RegionSize * RegionSize * RegionHeight;
+
+	static const uint32 SectorSize 		= 512;
+
+	FRegionFile();
+	~FRegionFile();
+
+	FRegionFile(const FRegionFile&) = delete;
+	FRegionFile& operator=(const FRegionFile&) = delete;
+
+	// Opens a region file, creating an empty one first if bCreate and there is none. Fails if the file
+	// can't be opened or isn't a region file.
+	bool Open(const std::string& Path, bool bCreate);
+	void Close();
+
+	bool IsOpen() const
+	{
+		return Mapping != nullptr;
+	}
+
+	// Chunk coordinates are local to the region, X and Z in [0, RegionSize) and Y in [0, RegionHeight).
+	bool HasChunk(int32 X, int32 Y, int32 Z) const
+	{
+		return Table[ToIndex(X, Y, Z)] != 0;
+	}
+
+	// Returns false, leaving OutChunk alone, if no chunk is stored there or its record fails its checksum.
+	bool LoadChunk(int32 X, int32 Y, int32 Z, FVoxelChunk& OutChunk);
+
+	bool SaveChunk(int32 X, int32 Y, int32 Z, const FVoxelChunk& Chunk);
+	bool RemoveChunk(int32 X, int32 Y, int32 Z);
+
+	// Makes every save so far durable. Saves are ordered but not flushed on their own.
+	bool Flush();
+
+	uint32 GetNumChunks() const
+	{
+		return NumChunks;
+	}
+
+	// File size in sectors, and how many of them no record uses.
+	uint32 GetNumSectors() const
+	{
+		return (uint32)UsedSectors.size();
+	}
+
+	uint32 GetNumFreeSectors() const
+	{
+		return NumFreeSectors;
+	}
+
+	// Rewrites the region file at Path with its records back to back in table order, dropping free
+	// sectors. Writes a new file next to it and swaps it in, the original stays intact until then.
+	static bool Compact(const std::string& Path, uint64* OutBytesBefore = nullptr, uint64* OutBytesAfter = nullptr);
+
+	// Building blocks for callers doing the file I/O themselves (FChunkStorage). They still own the
+	// table and sectors through this object, only the reads and writes happen elsewhere.
+
+	// Serializes Chunk into OutRecord, zero padded to whole sectors. Returns the sector count, 0 if
+	// it's too big for one record. Touches no region state, safe from any thread.
+	static uint32 EncodeRecord(const FVoxelChunk& Chunk, std::vector<uint8>& OutRecord);
+
+	// Checks and unpacks a record read from Capacity bytes at Record. Safe from any thread.
+	static bool DecodeRecord(const uint8* Record, uint64 Capacity, FVoxelChunk& OutChunk);
+
+	uint32 GetEntry(int32 X, int32 Y, int32 Z) const
+	{
+		return Table[ToIndex(X, Y, Z)];
+	}
+
+	// Repoints the in memory table only, returns the previous entry. The caller writes the entry to
+	// GetTableOffset and frees the old sectors once that is done.
+	uint32 SetEntry(int32 X, int32 Y, int32 Z, uint32 Entry);
+
+	// First run of Count free sectors, or the end of the file.
+	uint32 AllocateSectors(uint32 Count);
+	void FreeSectors(uint32 First, uint32 Count);
+
+	const uint32* GetTable() const
+	{
+		return Table.data();
+	}
+
+	intptr_t GetFileHandle() const
+	{
+		return File;
+	}
+
+	// A column's chunks are next to each other in the table, and after compaction on disk.
+	static uint32 ToIndex(int32 X, int32 Y, int32 Z)
+	{
+		return (uint32)(Y + ((X + Z * RegionSize) << RegionHeightLog2));
+	}
+
+	// Where table entry Index lives in the file.
+	static uint64 GetTableOffset(uint32 Index)
+	{
+		return SectorSize + (uint64)Index * sizeof(uint32);
+	}
+
+	// Splits a world chunk coordinate into the region it is in and its coordinate inside that region.
+	static void ToRegionCoords(int32 ChunkX, int32 ChunkY, int32 ChunkZ, int32 OutRegion[3], int32 OutLocal[3])
+	{
+		OutRegion[0] = ChunkX >> RegionSizeLog2;
+		OutRegion[1] = ChunkY >> RegionHeightLog2;
+		OutRegion[2] = ChunkZ >> RegionSizeLog2;
+		OutLocal[0] = ChunkX & (RegionSize - 1);
+		OutLocal[1] = ChunkY & (RegionHeight - 1);
+		OutLocal[2] = ChunkZ & (RegionSize - 1);
+	}
+
+	static std::string GetFileName(int32 RegionX, int32 RegionY, int32 RegionZ);
+
+	// Best effort, drops the file's cached pages so the next reads come from disk. For benchmarks.
+	static bool EvictFromPageCache(const std::string& Path);
+
+private:
+
+	// Remaps the whole file, after it has grown past the current mapping.
+	bool Remap();
+
+	bool WriteTableEntry(uint32 Index, uint32 Entry);
+
+	std::string 			Path;
+	intptr_t 				File;
+	const uint8* 			Mapping;
+	uint64 					MappedSize;
+
+	// Entries are first sector << 8 | sector count, 0 when there is no chunk.
+	std::vector<uint32> 	Table;
+	std::vector<bool> 		UsedSectors;
+	uint32 					NumFreeSectors;
+	uint32 					NumChunks;
+
+	std::vector<uint8> 		WriteBuffer; 	// Record being saved, reused between saves.
+};
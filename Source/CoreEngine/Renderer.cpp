@@ -2,33 +2,122 @@
 
 #include "Renderer.h"
 #include "Application.h"
+#include "CoreMacros.h"
+#include "GpuAllocator.h"
+#include "FramePacer.h"
+#include "GpuProfiler.h"
+#include "PipelineCache.h"
+#include "SectionMeshes.h"
+#include "UploadManager.h"
+#include "VulkanBufferHeap.h"
+#include "VulkanHelpers.h"
 #include "SDL.h"
 #include "SDL_vulkan.h"
 #include "VkBootstrap.h" // Bootstrap simplifies vk init.
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <string>
 
-#define VK_CHECK(x)                                                 \
-do                                                              	\
-{                                                               	\
-	VkResult err = x;                                           	\
-	if (err)                                                    	\
-	{                                                           	\
-		SDL_Log("Detected Vulkan error: ", err); 					\
-		abort();                                                	\
-	}                                                           	\
-} while (0)
+
+// Upper bound for AppSettings::FramesInFlight, more than this just adds latency.
+static const int32 MaxFramesInFlight = 4;
+
+// Per frame CPU scratch memory handed out by FFrameData::TransientAllocator.
+static const size_t FrameTransientMemorySize = 1024 * 1024;
+
+// Size of the staging ring mesh uploads stream through.
+static const VkDeviceSize UploadStagingSize = 32 * 1024 * 1024;
+
+// Chunk meshes are sub-allocated out of device memory blocks this big.
+static const uint64 MeshBlockSize = 64 * 1024 * 1024;
+
+// Quads the shared 16 bit quad index buffer covers, as many as 16 bit indices can reach. A section
+// tops out around 13000 quads (half its voxels solid in a checkerboard, plus faces onto its border).
+static const uint32 MaxQuadsPerDraw = 65536 / 4;
+
+// Pipeline cache blob kept between runs, relative to the working directory.
+static const char* PipelineCachePath = "VoxelEngine.pipelinecache";
+
+// SPIR-V built from Source/CoreEngine/Shaders, relative to the executable.
+static const char* ChunkVertexShaderPath = "Shaders/Chunk.vert.spv";
+static const char* ChunkFragmentShaderPath = "Shaders/Chunk.frag.spv";
+
+// Headless runs render into their own images instead of a swapchain, one per frame that can be in flight.
+static const uint32 HeadlessImageCount = MaxFramesInFlight;
+static const VkFormat HeadlessImageFormat = VK_FORMAT_B8G8R8A8_SRGB;	// What the default swapchain format selection picks.
+
+// Depth buffer of the main pass, every implementation supports it as an attachment.
+static const VkFormat DepthImageFormat = VK_FORMAT_D32_SFLOAT;
+
+/*
+	Per draw constants of the chunk pipeline, matching Chunk.vert.
+*/
+struct FChunkPushConstants
+{
+	float 	ViewProjection[16];
+	float 	Origin[4];
+};
+
+// Null if the file is missing or not SPIR-V.
+static VkShaderModule LoadShaderModule(VkDevice Device, const char* RelativePath)
+{
+	char* BasePath = SDL_GetBasePath();
+	const std::string Path = std::string(BasePath ? BasePath : "") + RelativePath;
+	SDL_free(BasePath);
+
+	FILE* File = std::fopen(Path.c_str(), "rb");
+	if(!File)
+	{
+		return VK_NULL_HANDLE;
+	}
+
+	std::fseek(File, 0, SEEK_END);
+	const long Size = std::ftell(File);
+	std::fseek(File, 0, SEEK_SET);
+
+	// SPIR-V is a stream of 32 bit words.
+	std::vector<uint32> Code(Size > 0 ? (size_t)Size / sizeof(uint32) : 0);
+	const bool bRead = !Code.empty() && Size % sizeof(uint32) == 0 && std::fread(Code.data(), sizeof(uint32), Code.size(), File) == Code.size();
+	std::fclose(File);
+	if(!bRead)
+	{
+		return VK_NULL_HANDLE;
+	}
+
+	VkShaderModuleCreateInfo ModuleInfo {};
+	ModuleInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
+	ModuleInfo.codeSize = Code.size() * sizeof(uint32);
+	ModuleInfo.pCode = Code.data();
+
+	VkShaderModule Module = VK_NULL_HANDLE;
+	VK_CHECK(vkCreateShaderModule(Device, &ModuleInfo, nullptr, &Module));
+	return Module;
+}
 
 FRenderer::FRenderer()
 {
 	VulkanFrameNumber = 0;
+	VulkanSwapchain = VK_NULL_HANDLE;
+	VulkanSwapchainExtent = { 0, 0 };
 }
 
 void FRenderer::Initialize()
 {
+	// Headless runs have no window, so no surface, swapchain or presenting.
+	bHeadless = FApp::Get()->IsHeadless();
+
 	// Initialize Vulkan.
 	SetupVulkan();
+	SetupUploads();
+	SetupMeshMemory();
 	SetupSwapchain();
+	SetupFramePacing();
 	SetupCommands();
+	SetupGpuProfiler();
 	SetupRenderPass();
+	SetupChunkPipeline();
+	SetupDepthTargets();
 	SetupFrameBuffers();
 	SetupSyncStructures();
 
@@ -44,19 +133,49 @@ void FRenderer::Shutdown()
 	// Make sure the GPU has stopped doing it's tasks.
 	vkDeviceWaitIdle(VulkanCurrentDevice);
 
-	vkDestroyCommandPool(VulkanCurrentDevice, VulkanCommandPool, nullptr);
+	// Destroy per frame resources, anything deferred goes first.
+	FlushRetiredSwapchains(true);
+	for(FFrameData& Frame : Frames)
+	{
+		Frame.DeletionQueue.Flush();
+
+		vkDestroyCommandPool(VulkanCurrentDevice, Frame.CommandPool, nullptr);
+
+		// Destroy sync objects
+		vkDestroyFence(VulkanCurrentDevice, Frame.RenderFence, nullptr);
+		vkDestroySemaphore(VulkanCurrentDevice, Frame.RenderSemaphore, nullptr);
+		vkDestroySemaphore(VulkanCurrentDevice, Frame.PresentSemaphore, nullptr);
+	}
+	Frames.clear();
+
+	GpuProfiler.get()->Shutdown();
+
+	if(QuadIndexRange.IsValid())
+	{
+		MeshAllocator.get()->Free(QuadIndexRange);
+	}
+
+	const FGpuHeapStats MeshStats = MeshAllocator.get()->GetStats();
+	SDL_Log("Mesh memory: peak %llu KB in %llu block allocations",
+		(unsigned long long)(MeshStats.PeakAllocatedBytes / 1024),
+		(unsigned long long)MeshStats.TotalBlockAllocations
+	);
 
-	// Destroy sync objects
-	vkDestroyFence(VulkanCurrentDevice, VulkanRenderFence, nullptr);
-	vkDestroySemaphore(VulkanCurrentDevice, VulkanRenderSemaphore, nullptr);
-	vkDestroySemaphore(VulkanCurrentDevice, VulkanPresentSemaphore, nullptr);
+	MeshAllocator.get()->Shutdown();
+	MeshHeap.get()->Shutdown();
+	UploadManager.get()->Shutdown();
 
-	vkDestroySwapchainKHR(VulkanCurrentDevice, VulkanSwapchain, nullptr);
+	if(!bHeadless)
+	{
+		vkDestroySwapchainKHR(VulkanCurrentDevice, VulkanSwapchain, nullptr);
+	}
 
+	vkDestroyPipeline(VulkanCurrentDevice, VulkanChunkPipeline, nullptr);
+	vkDestroyPipelineLayout(VulkanCurrentDevice, VulkanChunkPipelineLayout, nullptr);
 	vkDestroyRenderPass(VulkanCurrentDevice, VulkanRenderPass, nullptr);
 
 	// Destroy swapchain resources.
-	for(int32 Index = 0; Index < VulkanFrameBuffers.size(); Index++)
+	for(uint32 Index = 0; Index < VulkanFrameBuffers.size(); Index++)
 	{
 		vkDestroyFramebuffer(
 			VulkanCurrentDevice,
@@ -71,7 +190,27 @@ void FRenderer::Shutdown()
 		);
 	}
 
-	vkDestroySurfaceKHR(VulkanInstance, VulkanWindowSurface, nullptr);
+	// Offscreen images are ours to free, swapchain images went with the swapchain.
+	for(uint32 Index = 0; Index < VulkanOffscreenMemory.size(); Index++)
+	{
+		vkDestroyImage(VulkanCurrentDevice, VulkanSwapchainImages[Index], nullptr);
+		vkFreeMemory(VulkanCurrentDevice, VulkanOffscreenMemory[Index], nullptr);
+	}
+
+	for(uint32 Index = 0; Index < VulkanDepthImages.size(); Index++)
+	{
+		vkDestroyImageView(VulkanCurrentDevice, VulkanDepthImageViews[Index], nullptr);
+		vkDestroyImage(VulkanCurrentDevice, VulkanDepthImages[Index], nullptr);
+		vkFreeMemory(VulkanCurrentDevice, VulkanDepthMemory[Index], nullptr);
+	}
+
+	if(!bHeadless)
+	{
+		vkDestroySurfaceKHR(VulkanInstance, VulkanWindowSurface, nullptr);
+	}
+
+	// Save everything compiled this run so the next start is warm.
+	PipelineCache.get()->Shutdown();
 
 	vkDestroyDevice(VulkanCurrentDevice, nullptr);
 	vkb::destroy_debug_utils_messenger(VulkanInstance, VulkanDebugMessenger);
@@ -86,8 +225,9 @@ void FRenderer::SetupVulkan()
 	vkb::Result<vkb::Instance> InstanceBuilder = VkBuilder
 		.set_app_name("Voxel Engine")
 		.request_validation_layers(true)
-		.require_api_version(1, 1, 0)
+		.require_api_version(1, 2, 0)
 		.use_default_debug_messenger()
+		.set_headless(bHeadless)	// Skips the surface extensions, software ICDs run with no display at all.
 		.build();
 
 	vkb::Instance NewInstance = InstanceBuilder.value();
@@ -95,22 +235,67 @@ void FRenderer::SetupVulkan()
 	VulkanDebugMessenger = NewInstance.debug_messenger;
 
 	// Get surface of our main app window
-	SDL_Vulkan_CreateSurface(
-	    FApp::Get()->Window,
-	    VulkanInstance, 
-	    &VulkanWindowSurface
-	);
+	VulkanWindowSurface = VK_NULL_HANDLE;
+	if(!bHeadless)
+	{
+		SDL_Vulkan_CreateSurface(
+		    FApp::Get()->Window,
+		    VulkanInstance, 
+		    &VulkanWindowSurface
+		);
+	}
+
+	// Timeline semaphores hand finished uploads over to the graphics queue.
+	VkPhysicalDeviceVulkan12Features Features12 {};
+	Features12.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
+	Features12.timelineSemaphore = VK_TRUE;
 
-	// Select GPU that can write to SDL surfaces and supports Vk 1.1
+	// Select GPU that can write to SDL surfaces and supports Vk 1.2. A headless instance drops the present
+	// requirement, and since discrete GPUs are only preferred a lone CPU device (lavapipe, SwiftShader) still gets picked.
 	vkb::PhysicalDeviceSelector Selector { NewInstance };
+	// Present id / wait let the frame pacer see when frames actually reach the screen, enabled if available.
+	if(!bHeadless)
+	{
+		Selector.add_desired_extension(VK_KHR_PRESENT_ID_EXTENSION_NAME);
+		Selector.add_desired_extension(VK_KHR_PRESENT_WAIT_EXTENSION_NAME);
+	}
+
 	vkb::PhysicalDevice NewPhysicalDevice = Selector
-		.set_minimum_version(1, 1)
+		.set_minimum_version(1, 2)
+		.set_required_features_12(Features12)
 		.set_surface(VulkanWindowSurface)
 		.select()
 		.value();
 
+	// The extensions alone aren't enough, their features have to be supported and switched on too.
+	VkPhysicalDevicePresentWaitFeaturesKHR PresentWaitFeatures {};
+	PresentWaitFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PRESENT_WAIT_FEATURES_KHR;
+
+	VkPhysicalDevicePresentIdFeaturesKHR PresentIdFeatures {};
+	PresentIdFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PRESENT_ID_FEATURES_KHR;
+	PresentIdFeatures.pNext = &PresentWaitFeatures;
+
+	const std::vector<std::string> EnabledExtensions = NewPhysicalDevice.get_extensions();
+	const bool bHasPresentExtensions =
+		std::find(EnabledExtensions.begin(), EnabledExtensions.end(), VK_KHR_PRESENT_ID_EXTENSION_NAME) != EnabledExtensions.end() &&
+		std::find(EnabledExtensions.begin(), EnabledExtensions.end(), VK_KHR_PRESENT_WAIT_EXTENSION_NAME) != EnabledExtensions.end();
+
+	if(bHasPresentExtensions)
+	{
+		VkPhysicalDeviceFeatures2 Features2 {};
+		Features2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+		Features2.pNext = &PresentIdFeatures;
+		vkGetPhysicalDeviceFeatures2(NewPhysicalDevice.physical_device, &Features2);
+	}
+	bPresentWaitSupported = bHasPresentExtensions && PresentIdFeatures.presentId && PresentWaitFeatures.presentWait;
+
 	// Create the final Vulkan Device
 	vkb::DeviceBuilder DeviceBuilder { NewPhysicalDevice };
+	if(bPresentWaitSupported)
+	{
+		DeviceBuilder.add_pNext(&PresentIdFeatures);
+		DeviceBuilder.add_pNext(&PresentWaitFeatures);
+	}
 	vkb::Device NewDevice = DeviceBuilder.build().value();
 	VulkanCurrentDevice = NewDevice.device;
 	VulkanCurrentGPU = NewPhysicalDevice.physical_device;
@@ -118,24 +303,116 @@ void FRenderer::SetupVulkan()
 	// Get the graphics queue via Vulkan bootstrap.
 	VulkanGraphicsQueue = NewDevice.get_queue(vkb::QueueType::graphics).value();
 	VulkanGraphicsQueueFamily = NewDevice.get_queue_index(vkb::QueueType::graphics).value();
+
+	// Uploads prefer a transfer only family (DMA engine), then any family without graphics,
+	// and share the graphics queue when the device has nothing else (lavapipe, most iGPUs).
+	vkb::Result<uint32_t> DedicatedFamily = NewDevice.get_dedicated_queue_index(vkb::QueueType::transfer);
+	vkb::Result<uint32_t> SeparateFamily = NewDevice.get_queue_index(vkb::QueueType::transfer);
+
+	if(DedicatedFamily.has_value() || SeparateFamily.has_value())
+	{
+		VulkanTransferQueueFamily = DedicatedFamily.has_value() ? DedicatedFamily.value() : SeparateFamily.value();
+		vkGetDeviceQueue(VulkanCurrentDevice, VulkanTransferQueueFamily, 0, &VulkanTransferQueue);
+	}
+	else
+	{
+		VulkanTransferQueueFamily = VulkanGraphicsQueueFamily;
+		VulkanTransferQueue = VulkanGraphicsQueue;
+	}
+
+	// Load pipelines compiled by earlier runs, a blob from another device or driver is thrown away.
+	PipelineCache = std::make_shared<FPipelineCache>();
+	PipelineCache.get()->Initialize(VulkanCurrentDevice, VulkanCurrentGPU, PipelineCachePath);
+}
+
+VkPipelineCache FRenderer::GetPipelineCache() const
+{
+	return PipelineCache.get()->Get();
+}
+
+void FRenderer::SetupUploads()
+{
+	UploadManager = std::make_shared<FUploadManager>();
+	UploadManager.get()->Initialize(
+		VulkanCurrentDevice,
+		VulkanCurrentGPU,
+		VulkanTransferQueue,
+		VulkanTransferQueueFamily,
+		VulkanGraphicsQueueFamily,
+		UploadStagingSize
+	);
+
+	SDL_Log("Uploads use %s queue family %u",
+		UploadManager.get()->HasSeparateTransferQueue() ? "transfer" : "graphics",
+		VulkanTransferQueueFamily
+	);
+}
+
+void FRenderer::SetupMeshMemory()
+{
+	// Vertex and index data share blocks, uploads write them through the transfer queue.
+	MeshHeap = std::make_shared<FVulkanBufferHeap>();
+	MeshHeap.get()->Initialize(
+		VulkanCurrentDevice,
+		VulkanCurrentGPU,
+		VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+		VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+		UploadManager.get()
+	);
+
+	MeshAllocator = std::make_shared<FGpuAllocator>();
+	MeshAllocator.get()->Initialize(MeshHeap.get(), MeshBlockSize);
+
+	// Meshes only upload vertices, every draw reads its indices from this one buffer. The first frame's
+	// submit waits for the upload like it would for any mesh.
+	std::vector<uint16> QuadIndices(MaxQuadsPerDraw * 6);
+	for(uint32 Index = 0; Index < QuadIndices.size(); Index++)
+	{
+		QuadIndices[Index] = (uint16)(Index / 6 * 4 + QuadIndexPattern[Index % 6]);
+	}
+
+	const VkDeviceSize IndexBytes = QuadIndices.size() * sizeof(uint16);
+	FGpuAllocator* Allocator = MeshAllocator.get();
+	if(!Allocator->Allocate(IndexBytes, 16, QuadIndexRange)
+		|| !UploadManager.get()->UploadBuffer(MeshHeap.get()->GetBuffer(Allocator->GetBlockHandle(QuadIndexRange.Block)), QuadIndexRange.Offset, QuadIndices.data(), IndexBytes))
+	{
+		SDL_Log("Couldn't upload the quad index buffer, section meshes won't be drawn");
+		if(QuadIndexRange.IsValid())
+		{
+			Allocator->Free(QuadIndexRange);
+		}
+	}
 }
 
 void FRenderer::SetupSwapchain()
 {
+	if(bHeadless)
+	{
+		SetupOffscreenTargets();
+		return;
+	}
+
 	vkb::SwapchainBuilder SwapchainBuilder { 
 		VulkanCurrentGPU, 
 		VulkanCurrentDevice, 
 		VulkanWindowSurface 
 	};
 
-	// Create swapchain with Vulkan bootstrap library.
+	// Size to the window as it is now, which after a resize isn't AppSettings' size anymore.
+	int32 DrawableWidth = 0;
+	int32 DrawableHeight = 0;
+	SDL_Vulkan_GetDrawableSize(FApp::Get()->Window, &DrawableWidth, &DrawableHeight);
+
+	// Create swapchain with Vulkan bootstrap library. Passing the current swapchain (if any) as the
+	// old one lets the driver hand its resources over and keeps frames already queued on it presentable.
 	vkb::Swapchain NewSwapchain = SwapchainBuilder
 		.use_default_format_selection()
 		.set_desired_present_mode(AppSettings::VSync ? 
 		    VK_PRESENT_MODE_FIFO_KHR : 		// Buffered Mode
 		    VK_PRESENT_MODE_IMMEDIATE_KHR	// Immediate Display (Screen tearing)
 		)
-		.set_desired_extent(AppSettings::WindowWidth, AppSettings::WindowHeight)
+		.set_desired_extent(DrawableWidth, DrawableHeight)
+		.set_old_swapchain(VulkanSwapchain)
 		.build()
 		.value();
 
@@ -143,43 +420,285 @@ void FRenderer::SetupSwapchain()
 	VulkanSwapchainImages = NewSwapchain.get_images().value();
 	VulkanSwapchainImageViews = NewSwapchain.get_image_views().value();
 	VulkanSwapchainImageFormat = NewSwapchain.image_format;
+	VulkanSwapchainExtent = NewSwapchain.extent;
+}
+
+void FRenderer::RecreateSwapchain()
+{
+	PROFILE_FUNCTION();
+
+	// Nothing to present to while minimized, try again once the window has a size.
+	int32 DrawableWidth = 0;
+	int32 DrawableHeight = 0;
+	SDL_Vulkan_GetDrawableSize(FApp::Get()->Window, &DrawableWidth, &DrawableHeight);
+	if(DrawableWidth == 0 || DrawableHeight == 0)
+	{
+		return;
+	}
+
+	const std::chrono::steady_clock::time_point StartTime = std::chrono::steady_clock::now();
+
+	// Frames in flight may still be rendering to or presenting the old images, so nothing is destroyed
+	// here and nothing waits for the device. The old objects are retired and freed a ring of frames later.
+	FRetiredSwapchain Retired;
+	Retired.RetiredFrame = VulkanFrameNumber;
+
+	const VkDevice Device = VulkanCurrentDevice;
+	const VkSwapchainKHR OldSwapchain = VulkanSwapchain;
+	const std::vector<VkImageView> OldImageViews = VulkanSwapchainImageViews;
+	const std::vector<VkFramebuffer> OldFrameBuffers = VulkanFrameBuffers;
+	const std::vector<VkImage> OldDepthImages = VulkanDepthImages;
+	const std::vector<VkImageView> OldDepthImageViews = VulkanDepthImageViews;
+	const std::vector<VkDeviceMemory> OldDepthMemory = VulkanDepthMemory;
+	const VkFormat OldFormat = VulkanSwapchainImageFormat;
+
+	Retired.Resources.Push([=]()
+	{
+		vkDestroySwapchainKHR(Device, OldSwapchain, nullptr);
+	});
+
+	Retired.Resources.Push([=]()
+	{
+		for(uint32 Index = 0; Index < OldFrameBuffers.size(); Index++)
+		{
+			vkDestroyFramebuffer(Device, OldFrameBuffers[Index], nullptr);
+			vkDestroyImageView(Device, OldImageViews[Index], nullptr);
+		}
+
+		for(uint32 Index = 0; Index < OldDepthImages.size(); Index++)
+		{
+			vkDestroyImageView(Device, OldDepthImageViews[Index], nullptr);
+			vkDestroyImage(Device, OldDepthImages[Index], nullptr);
+			vkFreeMemory(Device, OldDepthMemory[Index], nullptr);
+		}
+	});
+
+	SetupSwapchain();
+
+	// The render pass only depends on the format, which almost never changes with a resize.
+	// Pipelines are built against the render pass, so they go with it.
+	if(VulkanSwapchainImageFormat != OldFormat)
+	{
+		const VkRenderPass OldRenderPass = VulkanRenderPass;
+		const VkPipeline OldChunkPipeline = VulkanChunkPipeline;
+		Retired.Resources.Push([=]()
+		{
+			vkDestroyPipeline(Device, OldChunkPipeline, nullptr);
+			vkDestroyRenderPass(Device, OldRenderPass, nullptr);
+		});
+		SetupRenderPass();
+		SetupChunkPipeline();
+	}
+
+	SetupDepthTargets();
+	SetupFrameBuffers();
+
+	// None of the new images are used by a frame yet.
+	VulkanImagesInFlight = std::vector<VkFence>(VulkanSwapchainImages.size(), VK_NULL_HANDLE);
+	FramePacer.get()->SetSwapchain(VulkanSwapchain);
+
+	RetiredSwapchains.push_back(std::move(Retired));
+	bSwapchainDirty = false;
+
+	SDL_Log("Swapchain recreated at %ux%u in %.2f ms",
+		VulkanSwapchainExtent.width,
+		VulkanSwapchainExtent.height,
+		std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - StartTime).count()
+	);
+}
+
+void FRenderer::FlushRetiredSwapchains(bool bForce)
+{
+	// At frame N the fence of frame N - FramesInFlight has been waited on, once that frame is the
+	// retiring one or later every frame that could have touched the old objects has finished.
+	const uint64 NumFrames = Frames.size();
+	while(!RetiredSwapchains.empty() && (bForce || VulkanFrameNumber >= RetiredSwapchains.front().RetiredFrame + NumFrames))
+	{
+		RetiredSwapchains.front().Resources.Flush();
+		RetiredSwapchains.erase(RetiredSwapchains.begin());
+	}
+}
+
+void FRenderer::SetupOffscreenTargets()
+{
+	// Stand ins for swapchain images, rendered to and then read back instead of presented.
+	VkImageCreateInfo ImageInfo {};
+	ImageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+	ImageInfo.imageType = VK_IMAGE_TYPE_2D;
+	ImageInfo.format = HeadlessImageFormat;
+	ImageInfo.extent = { (uint32)AppSettings::WindowWidth, (uint32)AppSettings::WindowHeight, 1 };
+	VulkanSwapchainExtent = { ImageInfo.extent.width, ImageInfo.extent.height };
+	ImageInfo.mipLevels = 1;
+	ImageInfo.arrayLayers = 1;
+	ImageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+	ImageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+	ImageInfo.usage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
+	ImageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+	ImageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+
+	VulkanSwapchainImages = std::vector<VkImage>(HeadlessImageCount);
+	VulkanSwapchainImageViews = std::vector<VkImageView>(HeadlessImageCount);
+	VulkanOffscreenMemory = std::vector<VkDeviceMemory>(HeadlessImageCount);
+	VulkanSwapchainImageFormat = HeadlessImageFormat;
+	VulkanSwapchain = VK_NULL_HANDLE;
+
+	for(uint32 Index = 0; Index < HeadlessImageCount; Index++)
+	{
+		VK_CHECK(vkCreateImage(VulkanCurrentDevice, &ImageInfo, nullptr, &VulkanSwapchainImages[Index]));
+
+		VkMemoryRequirements Requirements;
+		vkGetImageMemoryRequirements(VulkanCurrentDevice, VulkanSwapchainImages[Index], &Requirements);
+
+		VkMemoryAllocateInfo AllocInfo {};
+		AllocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+		AllocInfo.allocationSize = Requirements.size;
+		AllocInfo.memoryTypeIndex = VulkanHelpers::FindMemoryType(VulkanCurrentGPU, Requirements.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+
+		VK_CHECK(vkAllocateMemory(VulkanCurrentDevice, &AllocInfo, nullptr, &VulkanOffscreenMemory[Index]));
+		VK_CHECK(vkBindImageMemory(VulkanCurrentDevice, VulkanSwapchainImages[Index], VulkanOffscreenMemory[Index], 0));
+
+		VkImageViewCreateInfo ViewInfo {};
+		ViewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+		ViewInfo.image = VulkanSwapchainImages[Index];
+		ViewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+		ViewInfo.format = HeadlessImageFormat;
+		ViewInfo.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+		ViewInfo.subresourceRange.levelCount = 1;
+		ViewInfo.subresourceRange.layerCount = 1;
+
+		VK_CHECK(vkCreateImageView(VulkanCurrentDevice, &ViewInfo, nullptr, &VulkanSwapchainImageViews[Index]));
+	}
+}
+
+void FRenderer::SetupDepthTargets()
+{
+	// Only ever touched inside the main pass, which clears it on load and throws it away on store.
+	VkImageCreateInfo ImageInfo {};
+	ImageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+	ImageInfo.imageType = VK_IMAGE_TYPE_2D;
+	ImageInfo.format = DepthImageFormat;
+	ImageInfo.extent = { VulkanSwapchainExtent.width, VulkanSwapchainExtent.height, 1 };
+	ImageInfo.mipLevels = 1;
+	ImageInfo.arrayLayers = 1;
+	ImageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+	ImageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+	ImageInfo.usage = VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT;
+	ImageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+	ImageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+
+	const uint32 DepthImageCount = VulkanSwapchainImages.size();
+	VulkanDepthImages = std::vector<VkImage>(DepthImageCount);
+	VulkanDepthImageViews = std::vector<VkImageView>(DepthImageCount);
+	VulkanDepthMemory = std::vector<VkDeviceMemory>(DepthImageCount);
+
+	for(uint32 Index = 0; Index < DepthImageCount; Index++)
+	{
+		VK_CHECK(vkCreateImage(VulkanCurrentDevice, &ImageInfo, nullptr, &VulkanDepthImages[Index]));
+
+		VkMemoryRequirements Requirements;
+		vkGetImageMemoryRequirements(VulkanCurrentDevice, VulkanDepthImages[Index], &Requirements);
+
+		VkMemoryAllocateInfo AllocInfo {};
+		AllocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+		AllocInfo.allocationSize = Requirements.size;
+		AllocInfo.memoryTypeIndex = VulkanHelpers::FindMemoryType(VulkanCurrentGPU, Requirements.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+
+		VK_CHECK(vkAllocateMemory(VulkanCurrentDevice, &AllocInfo, nullptr, &VulkanDepthMemory[Index]));
+		VK_CHECK(vkBindImageMemory(VulkanCurrentDevice, VulkanDepthImages[Index], VulkanDepthMemory[Index], 0));
+
+		VkImageViewCreateInfo ViewInfo {};
+		ViewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+		ViewInfo.image = VulkanDepthImages[Index];
+		ViewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+		ViewInfo.format = DepthImageFormat;
+		ViewInfo.subresourceRange.aspectMask = VK_IMAGE_ASPECT_DEPTH_BIT;
+		ViewInfo.subresourceRange.levelCount = 1;
+		ViewInfo.subresourceRange.layerCount = 1;
+
+		VK_CHECK(vkCreateImageView(VulkanCurrentDevice, &ViewInfo, nullptr, &VulkanDepthImageViews[Index]));
+	}
+}
+
+void FRenderer::SetupFramePacing()
+{
+	// Pacing is against the display's refresh, fall back to 60Hz if SDL can't tell.
+	double RefreshSeconds = 1.0 / 60.0;
+	SDL_DisplayMode DisplayMode;
+	if(!bHeadless && SDL_GetWindowDisplayMode(FApp::Get()->Window, &DisplayMode) == 0 && DisplayMode.refresh_rate > 0)
+	{
+		RefreshSeconds = 1.0 / DisplayMode.refresh_rate;
+	}
+
+	FramePacer = std::make_shared<FFramePacer>();
+	FramePacer.get()->Initialize(VulkanCurrentDevice, bPresentWaitSupported, RefreshSeconds);
+	FramePacer.get()->SetSwapchain(VulkanSwapchain);
+
+	// Only FIFO has vblanks to pace against, without them there's no back pressure to trade for sleep.
+	FramePacer.get()->SetEnabled(AppSettings::FramePacing && AppSettings::VSync && !bHeadless);
+
+	SDL_Log("Frame pacing %s, timing from %s at %.1f Hz",
+		FramePacer.get()->GetStats().bEnabled ? "on" : "off",
+		bPresentWaitSupported ? "present wait" : "fences",
+		1.0 / RefreshSeconds
+	);
 }
 
 void FRenderer::SetupCommands()
 {
-	// Create a command pool for commands submitted to the graphics queue.
-	VkCommandPoolCreateInfo CommandPoolInfo {};
-	CommandPoolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
-	CommandPoolInfo.pNext = nullptr;
+	// Create the ring of frames in flight, each frame gets its own pool, buffer and scratch memory.
+	const int32 NumFrames = std::max(1, std::min(AppSettings::FramesInFlight, MaxFramesInFlight));
+	Frames = std::vector<FFrameData>(NumFrames);
 
-	// This command pool can submit our graphics commands.
-	CommandPoolInfo.queueFamilyIndex = VulkanGraphicsQueueFamily;
+	for(FFrameData& Frame : Frames)
+	{
+		// Create a command pool for commands submitted to the graphics queue.
+		VkCommandPoolCreateInfo CommandPoolInfo {};
+		CommandPoolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+		CommandPoolInfo.pNext = nullptr;
 
-	// Allow command pool to allow resetting of individual command buffers.
-	CommandPoolInfo.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
+		// This command pool can submit our graphics commands.
+		CommandPoolInfo.queueFamilyIndex = VulkanGraphicsQueueFamily;
 
-	VK_CHECK(vkCreateCommandPool(
-		VulkanCurrentDevice, 
-		&CommandPoolInfo,
-		nullptr,
-		&VulkanCommandPool
-	));
+		// Pool is reset as a whole once per frame, no need for individual resets.
+		CommandPoolInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
 
-	// Allocate the default command buffer for rendering.
-	VkCommandBufferAllocateInfo CommandAllocInfo {};
-	CommandAllocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
-	CommandAllocInfo.pNext = nullptr;
+		VK_CHECK(vkCreateCommandPool(
+			VulkanCurrentDevice, 
+			&CommandPoolInfo,
+			nullptr,
+			&Frame.CommandPool
+		));
 
-	// Commands will be made from our VulkanCommandPool.
-	CommandAllocInfo.commandPool = VulkanCommandPool;
-	CommandAllocInfo.commandBufferCount = 1;
-	CommandAllocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+		// Allocate the default command buffer for rendering.
+		VkCommandBufferAllocateInfo CommandAllocInfo {};
+		CommandAllocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+		CommandAllocInfo.pNext = nullptr;
+
+		// Commands will be made from this frame's command pool.
+		CommandAllocInfo.commandPool = Frame.CommandPool;
+		CommandAllocInfo.commandBufferCount = 1;
+		CommandAllocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
 
-	VK_CHECK(vkAllocateCommandBuffers(
+		VK_CHECK(vkAllocateCommandBuffers(
+			VulkanCurrentDevice,
+			&CommandAllocInfo,
+			&Frame.MainCommandBuffer
+		));
+
+		Frame.TransientAllocator.Initialize(FrameTransientMemorySize);
+	}
+}
+
+void FRenderer::SetupGpuProfiler()
+{
+	// One range of queries per frame in flight, read back when the slot's fence comes round again.
+	GpuProfiler = std::make_shared<FGpuProfiler>();
+	GpuProfiler.get()->Initialize(
 		VulkanCurrentDevice,
-		&CommandAllocInfo,
-		&VulkanMainCommandBuffer
-	));
+		VulkanCurrentGPU,
+		VulkanGraphicsQueueFamily,
+		(uint32)Frames.size()
+	);
 }
 
 void FRenderer::SetupRenderPass()
@@ -195,15 +714,37 @@ void FRenderer::SetupRenderPass()
 	ColorAttachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;			// We don't know or care about attachment initial layout.
 	ColorAttachment.finalLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;		// After renderpass ends, image must be on layout ready for display.
 
+	// Headless images are never displayed, leave them ready to be copied out instead.
+	if(bHeadless)
+	{
+		ColorAttachment.finalLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+	}
+
 	VkAttachmentReference ColorAttachmentRef {};
 	ColorAttachmentRef.attachment = 0;									// Attachment index for pAttachments array in parent renderpass.
 	ColorAttachmentRef.layout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
 
+	// Depth is cleared every frame and nothing reads it after the pass.
+	VkAttachmentDescription DepthAttachment {};
+	DepthAttachment.format = DepthImageFormat;
+	DepthAttachment.samples = VK_SAMPLE_COUNT_1_BIT;
+	DepthAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+	DepthAttachment.storeOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+	DepthAttachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+	DepthAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+	DepthAttachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+	DepthAttachment.finalLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+
+	VkAttachmentReference DepthAttachmentRef {};
+	DepthAttachmentRef.attachment = 1;
+	DepthAttachmentRef.layout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+
 	// Create 1 subpass which is the minimum you can do.
 	VkSubpassDescription SubPass {};
 	SubPass.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
 	SubPass.colorAttachmentCount = 1;
 	SubPass.pColorAttachments = &ColorAttachmentRef;
+	SubPass.pDepthStencilAttachment = &DepthAttachmentRef;
 
 	// 1 Dependency, which is from the "outside" into the subpass. And we can read or write color
 	VkSubpassDependency Dependency {};
@@ -214,14 +755,26 @@ void FRenderer::SetupRenderPass()
 	Dependency.dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
 	Dependency.dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
 
+	// Same for depth, the clear mustn't start before the last pass on the image is done testing against it.
+	VkSubpassDependency DepthDependency {};
+	DepthDependency.srcSubpass = VK_SUBPASS_EXTERNAL;
+	DepthDependency.dstSubpass = 0;
+	DepthDependency.srcStageMask = VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+	DepthDependency.srcAccessMask = 0;
+	DepthDependency.dstStageMask = VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+	DepthDependency.dstAccessMask = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+
+	const VkAttachmentDescription Attachments[2] = { ColorAttachment, DepthAttachment };
+	const VkSubpassDependency Dependencies[2] = { Dependency, DepthDependency };
+
 	VkRenderPassCreateInfo RenderPassInfo {};
 	RenderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
-	RenderPassInfo.attachmentCount = 1;					// Connect the color attachment to the info.
-	RenderPassInfo.pAttachments = &ColorAttachment;
+	RenderPassInfo.attachmentCount = 2;					// Connect the color and depth attachments to the info.
+	RenderPassInfo.pAttachments = Attachments;
 	RenderPassInfo.subpassCount = 1;					// Connect the subpass to the info.
 	RenderPassInfo.pSubpasses = &SubPass;
-	RenderPassInfo.dependencyCount = 1;
-	RenderPassInfo.pDependencies = &Dependency;
+	RenderPassInfo.dependencyCount = 2;
+	RenderPassInfo.pDependencies = Dependencies;
 
 	VK_CHECK(vkCreateRenderPass(
 		VulkanCurrentDevice, 
@@ -231,6 +784,143 @@ void FRenderer::SetupRenderPass()
 	));
 }
 
+void FRenderer::SetupChunkPipeline()
+{
+	VulkanChunkPipeline = VK_NULL_HANDLE;
+
+	// Section meshes are drawn with per section push constants and nothing else bound.
+	if(VulkanChunkPipelineLayout == VK_NULL_HANDLE)
+	{
+		VkPushConstantRange PushConstantRange {};
+		PushConstantRange.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
+		PushConstantRange.offset = 0;
+		PushConstantRange.size = sizeof(FChunkPushConstants);
+
+		VkPipelineLayoutCreateInfo LayoutInfo {};
+		LayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+		LayoutInfo.pushConstantRangeCount = 1;
+		LayoutInfo.pPushConstantRanges = &PushConstantRange;
+
+		VK_CHECK(vkCreatePipelineLayout(
+			VulkanCurrentDevice,
+			&LayoutInfo,
+			nullptr,
+			&VulkanChunkPipelineLayout
+		));
+	}
+
+	// Shaders are built by the CMake project when glslc is around, run without them rather than fail.
+	const VkShaderModule VertexShader = LoadShaderModule(VulkanCurrentDevice, ChunkVertexShaderPath);
+	const VkShaderModule FragmentShader = LoadShaderModule(VulkanCurrentDevice, ChunkFragmentShaderPath);
+	if(VertexShader == VK_NULL_HANDLE || FragmentShader == VK_NULL_HANDLE)
+	{
+		SDL_Log("Chunk shaders not found next to the executable, section meshes won't be drawn");
+		vkDestroyShaderModule(VulkanCurrentDevice, VertexShader, nullptr);
+		vkDestroyShaderModule(VulkanCurrentDevice, FragmentShader, nullptr);
+		return;
+	}
+
+	VkPipelineShaderStageCreateInfo Stages[2] {};
+	Stages[0].sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+	Stages[0].stage = VK_SHADER_STAGE_VERTEX_BIT;
+	Stages[0].module = VertexShader;
+	Stages[0].pName = "main";
+	Stages[1].sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+	Stages[1].stage = VK_SHADER_STAGE_FRAGMENT_BIT;
+	Stages[1].module = FragmentShader;
+	Stages[1].pName = "main";
+
+	// FMeshVertex goes in as two raw words, the vertex shader unpacks them.
+	VkVertexInputBindingDescription VertexBinding {};
+	VertexBinding.binding = 0;
+	VertexBinding.stride = sizeof(FMeshVertex);
+	VertexBinding.inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
+
+	VkVertexInputAttributeDescription VertexAttribute {};
+	VertexAttribute.location = 0;
+	VertexAttribute.binding = 0;
+	VertexAttribute.format = VK_FORMAT_R32G32_UINT;
+	VertexAttribute.offset = 0;
+
+	VkPipelineVertexInputStateCreateInfo VertexInput {};
+	VertexInput.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
+	VertexInput.vertexBindingDescriptionCount = 1;
+	VertexInput.pVertexBindingDescriptions = &VertexBinding;
+	VertexInput.vertexAttributeDescriptionCount = 1;
+	VertexInput.pVertexAttributeDescriptions = &VertexAttribute;
+
+	VkPipelineInputAssemblyStateCreateInfo InputAssembly {};
+	InputAssembly.sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
+	InputAssembly.topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
+
+	// Viewport and scissor are set when drawing, so a resize doesn't need a new pipeline.
+	VkPipelineViewportStateCreateInfo ViewportState {};
+	ViewportState.sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
+	ViewportState.viewportCount = 1;
+	ViewportState.scissorCount = 1;
+
+	// Meshers wind faces counter clockwise seen from outside.
+	VkPipelineRasterizationStateCreateInfo Rasterizer {};
+	Rasterizer.sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO;
+	Rasterizer.polygonMode = VK_POLYGON_MODE_FILL;
+	Rasterizer.cullMode = VK_CULL_MODE_BACK_BIT;
+	Rasterizer.frontFace = VK_FRONT_FACE_COUNTER_CLOCKWISE;
+	Rasterizer.lineWidth = 1.f;
+
+	VkPipelineMultisampleStateCreateInfo Multisample {};
+	Multisample.sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO;
+	Multisample.rasterizationSamples = VK_SAMPLE_COUNT_1_BIT;
+
+	VkPipelineColorBlendAttachmentState BlendAttachment {};
+	BlendAttachment.colorWriteMask = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT;
+
+	VkPipelineColorBlendStateCreateInfo ColorBlend {};
+	ColorBlend.sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO;
+	ColorBlend.attachmentCount = 1;
+	ColorBlend.pAttachments = &BlendAttachment;
+
+	const VkDynamicState DynamicStates[2] = { VK_DYNAMIC_STATE_VIEWPORT, VK_DYNAMIC_STATE_SCISSOR };
+	VkPipelineDynamicStateCreateInfo DynamicState {};
+	DynamicState.sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO;
+	DynamicState.dynamicStateCount = 2;
+	DynamicState.pDynamicStates = DynamicStates;
+
+	// Nearest surface wins, sections can be drawn in any order.
+	VkPipelineDepthStencilStateCreateInfo DepthStencil {};
+	DepthStencil.sType = VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO;
+	DepthStencil.depthTestEnable = VK_TRUE;
+	DepthStencil.depthWriteEnable = VK_TRUE;
+	DepthStencil.depthCompareOp = VK_COMPARE_OP_LESS;
+
+	VkGraphicsPipelineCreateInfo PipelineInfo {};
+	PipelineInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
+	PipelineInfo.stageCount = 2;
+	PipelineInfo.pStages = Stages;
+	PipelineInfo.pVertexInputState = &VertexInput;
+	PipelineInfo.pInputAssemblyState = &InputAssembly;
+	PipelineInfo.pViewportState = &ViewportState;
+	PipelineInfo.pRasterizationState = &Rasterizer;
+	PipelineInfo.pMultisampleState = &Multisample;
+	PipelineInfo.pDepthStencilState = &DepthStencil;
+	PipelineInfo.pColorBlendState = &ColorBlend;
+	PipelineInfo.pDynamicState = &DynamicState;
+	PipelineInfo.layout = VulkanChunkPipelineLayout;
+	PipelineInfo.renderPass = VulkanRenderPass;
+	PipelineInfo.subpass = 0;
+
+	VK_CHECK(vkCreateGraphicsPipelines(
+		VulkanCurrentDevice,
+		GetPipelineCache(),
+		1,
+		&PipelineInfo,
+		nullptr,
+		&VulkanChunkPipeline
+	));
+
+	vkDestroyShaderModule(VulkanCurrentDevice, VertexShader, nullptr);
+	vkDestroyShaderModule(VulkanCurrentDevice, FragmentShader, nullptr);
+}
+
 void FRenderer::SetupFrameBuffers()
 {
 	// Create framebuffers for swapchain images. This will connect renderpass to render images.
@@ -238,19 +928,20 @@ void FRenderer::SetupFrameBuffers()
 	FramebufferInfo.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
 	FramebufferInfo.pNext = nullptr;
 	FramebufferInfo.renderPass = VulkanRenderPass;
-	FramebufferInfo.attachmentCount = 1;
-	FramebufferInfo.width = AppSettings::WindowWidth;
-	FramebufferInfo.height = AppSettings::WindowHeight;
+	FramebufferInfo.attachmentCount = 2;
+	FramebufferInfo.width = VulkanSwapchainExtent.width;
+	FramebufferInfo.height = VulkanSwapchainExtent.height;
 	FramebufferInfo.layers = 1;
 
 	// Grab how many images we have in the swapchain.
 	const uint32 SwapchainImageCount = VulkanSwapchainImages.size();
 	VulkanFrameBuffers = std::vector<VkFramebuffer>(SwapchainImageCount);
 
-	// Create framebuffers for each of the swapchain image views
-	for(int32 Index = 0; Index < SwapchainImageCount; Index++)
+	// Create framebuffers for each of the swapchain image views, each with its own depth image.
+	for(uint32 Index = 0; Index < SwapchainImageCount; Index++)
 	{
-		FramebufferInfo.pAttachments = &VulkanSwapchainImageViews[Index];
+		const VkImageView Attachments[2] = { VulkanSwapchainImageViews[Index], VulkanDepthImageViews[Index] };
+		FramebufferInfo.pAttachments = Attachments;
 		VK_CHECK(vkCreateFramebuffer(
 			VulkanCurrentDevice,
 			&FramebufferInfo,
@@ -262,7 +953,7 @@ void FRenderer::SetupFrameBuffers()
 
 void FRenderer::SetupSyncStructures()
 {
-	// Create main render fence for CPU to wait for GPU tasks.
+	// Create render fences for CPU to wait for GPU tasks, one per frame in flight.
 	VkFenceCreateInfo FenceCreateInfo {};
 	FenceCreateInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
 	FenceCreateInfo.pNext = nullptr;
@@ -270,35 +961,162 @@ void FRenderer::SetupSyncStructures()
 	// Use create signalled flag with fence, so we can wait on it before using it on a GPU command (for the first frame)
 	FenceCreateInfo.flags = VK_FENCE_CREATE_SIGNALED_BIT;
 
-	VK_CHECK(vkCreateFence(
-		VulkanCurrentDevice,
-		&FenceCreateInfo,
-		nullptr,
-		&VulkanRenderFence
-	));
-
 	VkSemaphoreCreateInfo SemaphoreCreateInfo {};
 	SemaphoreCreateInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
 	SemaphoreCreateInfo.pNext = nullptr;
 	SemaphoreCreateInfo.flags = 0; // No flags required.
 
-	VK_CHECK(vkCreateSemaphore(
-		VulkanCurrentDevice,
-		&SemaphoreCreateInfo,
-		nullptr,
-		&VulkanPresentSemaphore
-	));
+	for(FFrameData& Frame : Frames)
+	{
+		VK_CHECK(vkCreateFence(
+			VulkanCurrentDevice,
+			&FenceCreateInfo,
+			nullptr,
+			&Frame.RenderFence
+		));
 
-	VK_CHECK(vkCreateSemaphore(
-		VulkanCurrentDevice,
-		&SemaphoreCreateInfo,
-		nullptr,
-		&VulkanRenderSemaphore
-	));
+		VK_CHECK(vkCreateSemaphore(
+			VulkanCurrentDevice,
+			&SemaphoreCreateInfo,
+			nullptr,
+			&Frame.PresentSemaphore
+		));
+
+		VK_CHECK(vkCreateSemaphore(
+			VulkanCurrentDevice,
+			&SemaphoreCreateInfo,
+			nullptr,
+			&Frame.RenderSemaphore
+		));
+	}
+
+	// No swapchain image is in use by any frame yet.
+	VulkanImagesInFlight = std::vector<VkFence>(VulkanSwapchainImages.size(), VK_NULL_HANDLE);
 }
 
-void FRenderer::Draw()
+void FRenderer::UploadSectionMeshes(FFrameData& Frame)
 {
+	PROFILE_FUNCTION();
+
+	if(!SectionMeshes)
+	{
+		return;
+	}
+
+	FGpuAllocator* Allocator = MeshAllocator.get();
+	std::vector<FGpuAllocation> Retired;
+	SectionMeshes->TakeRetiredRanges(Retired);
+
+	std::vector<FMeshSection*> Changed;
+	SectionMeshes->TakeChangedSections(Changed);
+	for(FMeshSection* Section : Changed)
+	{
+		const FChunkMesh& Mesh = Section->Mesh;
+		FGpuAllocation VertexRange;
+		if(!Mesh.Vertices.empty())
+		{
+			const VkDeviceSize VertexBytes = Mesh.Vertices.size() * sizeof(FMeshVertex);
+			const bool bUploaded = Allocator->Allocate(VertexBytes, 16, VertexRange)
+				&& UploadManager.get()->UploadBuffer(MeshHeap.get()->GetBuffer(Allocator->GetBlockHandle(VertexRange.Block)), VertexRange.Offset, Mesh.Vertices.data(), VertexBytes);
+
+			// Out of staging space, keep drawing the old mesh and try again next frame. A copy may
+			// already be queued into the new range, so it's freed like any other.
+			if(!bUploaded)
+			{
+				if(VertexRange.IsValid())
+				{
+					Retired.push_back(VertexRange);
+				}
+				SectionMeshes->RequeueUpload(Section);
+				continue;
+			}
+		}
+
+		if(Section->VertexRange.IsValid())
+		{
+			Retired.push_back(Section->VertexRange);
+		}
+		Section->VertexRange = VertexRange;
+		Section->NumIndices = std::min(Mesh.GetNumIndices(), MaxQuadsPerDraw * 6);	// Never clamps for a section.
+
+		// Only the GPU copy is drawn from here on.
+		Section->Mesh = FChunkMesh();
+	}
+
+	// Frames still in flight may draw the old ranges, this slot's fence covers all of them.
+	if(!Retired.empty())
+	{
+		Frame.DeletionQueue.Push([Allocator, Retired]() mutable
+		{
+			for(FGpuAllocation& Range : Retired)
+			{
+				Allocator->Free(Range);
+			}
+		});
+	}
+}
+
+void FRenderer::DrawSectionMeshes(VkCommandBuffer CommandBuffer, VkExtent2D Extent)
+{
+	PROFILE_FUNCTION();
+
+	if(!SectionMeshes || VulkanChunkPipeline == VK_NULL_HANDLE || !QuadIndexRange.IsValid())
+	{
+		return;
+	}
+
+	const FGpuAllocator* Allocator = MeshAllocator.get();
+	const FVulkanBufferHeap* Heap = MeshHeap.get();
+
+	vkCmdBindPipeline(CommandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, VulkanChunkPipeline);
+	vkCmdBindIndexBuffer(CommandBuffer, Heap->GetBuffer(Allocator->GetBlockHandle(QuadIndexRange.Block)), QuadIndexRange.Offset, VK_INDEX_TYPE_UINT16);
+
+	VkViewport Viewport {};
+	Viewport.width = (float)Extent.width;
+	Viewport.height = (float)Extent.height;
+	Viewport.maxDepth = 1.f;
+	vkCmdSetViewport(CommandBuffer, 0, 1, &Viewport);
+
+	VkRect2D Scissor {};
+	Scissor.extent = Extent;
+	vkCmdSetScissor(CommandBuffer, 0, 1, &Scissor);
+
+	FChunkPushConstants PushConstants;
+	Camera.GetViewProjection((float)Extent.width / (float)std::max(Extent.height, 1u), PushConstants.ViewProjection);
+	PushConstants.Origin[3] = 0.f;
+
+	const FFrustum Frustum(PushConstants.ViewProjection);
+
+	SectionMeshes->ForEachSection([&](const FMeshSection& Section)
+	{
+		// Not uploaded yet, or nothing in it.
+		if(Section.NumIndices == 0)
+		{
+			return;
+		}
+
+		const float Min[3] = { (float)(Section.X * SectionSize), (float)(Section.Y * SectionSize), (float)(Section.Z * SectionSize) };
+		const float Max[3] = { Min[0] + SectionSize, Min[1] + SectionSize, Min[2] + SectionSize };
+		if(!Frustum.IntersectsBox(Min, Max))
+		{
+			return;
+		}
+
+		const VkBuffer VertexBuffer = Heap->GetBuffer(Allocator->GetBlockHandle(Section.VertexRange.Block));
+		const VkDeviceSize VertexOffset = Section.VertexRange.Offset;
+		vkCmdBindVertexBuffers(CommandBuffer, 0, 1, &VertexBuffer, &VertexOffset);
+
+		std::copy(Min, Min + 3, PushConstants.Origin);
+		vkCmdPushConstants(CommandBuffer, VulkanChunkPipelineLayout, VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(PushConstants), &PushConstants);
+
+		vkCmdDrawIndexed(CommandBuffer, Section.NumIndices, 1, 0, 0, 0);
+	});
+}
+
+void FRenderer::Draw(double SimulationTime)
+{
+	PROFILE_FUNCTION();
+
 	uint32 SwapchainImageIndex;
 
 	if(!bHasInitialized)
@@ -306,44 +1124,104 @@ void FRenderer::Draw()
 		return;
 	}
 
-	if(SDL_GetWindowFlags(FApp::Get()->Window) & SDL_WINDOW_MINIMIZED)
+	if(!bHeadless && (SDL_GetWindowFlags(FApp::Get()->Window) & SDL_WINDOW_MINIMIZED))
 	{
 		return;
 	}
 
-	// Wait until GPU has finished rendering last frame. Timeout of 1 sec.
-	VK_CHECK(vkWaitForFences(
-		VulkanCurrentDevice, 
-		1, 
-		&VulkanRenderFence, 
-		true, 
-		VK_TIME_SECOND
-	));
+	FFrameData& Frame = GetCurrentFrame();
 
-	VK_CHECK(vkResetFences(
-		VulkanCurrentDevice,
-		1,
-		&VulkanRenderFence
-	));
+	// Time blocked on the GPU or swapchain below is what the frame pacer turns into sleep before the next frame.
+	const std::chrono::steady_clock::time_point FenceWaitStart = std::chrono::steady_clock::now();
+
+	// Wait until the GPU has finished the last frame that used this slot, Timeout of 1 sec.
+	// With more than one frame in flight this only blocks if the GPU is a whole ring behind.
+	{
+		PROFILE_SCOPE("WaitForFrameFence");
+		VK_CHECK(vkWaitForFences(
+			VulkanCurrentDevice, 
+			1, 
+			&Frame.RenderFence, 
+			true, 
+			VK_TIME_SECOND
+		));
+	}
+
+	// GPU is done with everything this slot owned, recycle it.
+	Frame.DeletionQueue.Flush();
+	Frame.TransientAllocator.Reset();
+	FlushRetiredSwapchains(false);
+
+	// Resized or out of date since last frame, swap in a new swapchain before acquiring from it.
+	if(bSwapchainDirty)
+	{
+		RecreateSwapchain();
+		if(bSwapchainDirty)
+		{
+			return;
+		}
+	}
 
-	// Now we are sure commands finished exec, it's safe to reset command buffer and begin recording.
-	VK_CHECK(vkResetCommandBuffer(VulkanMainCommandBuffer, 0));
+	// Request image from the swapchain, Timeout of 1 sec. Headless runs just cycle through their own images.
+	if(bHeadless)
+	{
+		SwapchainImageIndex = (uint32)(VulkanFrameNumber % VulkanSwapchainImages.size());
+	}
+	else
+	{
+		PROFILE_SCOPE("AcquireImage");
+		const VkResult AcquireResult = vkAcquireNextImageKHR(
+			VulkanCurrentDevice,
+			VulkanSwapchain,
+			VK_TIME_SECOND,
+			Frame.PresentSemaphore,
+			nullptr,
+			&SwapchainImageIndex
+		);
+
+		// Out of date means no image and an unsignalled semaphore, skip the frame and recreate first.
+		// Suboptimal still gave us an image, render this frame and recreate before the next one.
+		if(AcquireResult == VK_ERROR_OUT_OF_DATE_KHR)
+		{
+			bSwapchainDirty = true;
+			return;
+		}
+		if(AcquireResult == VK_SUBOPTIMAL_KHR)
+		{
+			bSwapchainDirty = true;
+		}
+		else
+		{
+			VK_CHECK(AcquireResult);
+		}
+	}
 
-	// Request image from the swapchain, Timeout of 1 sec.
-	VK_CHECK(vkAcquireNextImageKHR(
+	// The image we got may still be used by another frame in flight, wait for that frame.
+	VkFence& ImageFence = VulkanImagesInFlight[SwapchainImageIndex];
+	if(ImageFence != VK_NULL_HANDLE && ImageFence != Frame.RenderFence)
+	{
+		PROFILE_SCOPE("WaitForImageFence");
+		VK_CHECK(vkWaitForFences(
+			VulkanCurrentDevice,
+			1,
+			&ImageFence,
+			true,
+			VK_TIME_SECOND
+		));
+	}
+	ImageFence = Frame.RenderFence;
+
+	FramePacer.get()->AddBlockedTime(std::chrono::duration<double>(std::chrono::steady_clock::now() - FenceWaitStart).count());
+
+	// Only reset once we know we will submit, otherwise the next wait on this fence would hang.
+	VK_CHECK(vkResetFences(
 		VulkanCurrentDevice,
-		VulkanSwapchain,
-		VK_TIME_SECOND,
-		VulkanPresentSemaphore,
-		nullptr,
-		&SwapchainImageIndex
+		1,
+		&Frame.RenderFence
 	));
 
-	// Victor does this to shorten the name in code, but I don't likez it.
-	// Not entirely sure if the copy is required here, don't think so.
-	// but just incase it is, this is probably where bugs source could be.
-	// delete can can confirm it's not an issue.
-	// VkCommandBuffer Command = VulkanMainCommandBuffer;
+	// Now we are sure commands finished exec, it's safe to reset the pool and begin recording.
+	VK_CHECK(vkResetCommandPool(VulkanCurrentDevice, Frame.CommandPool, 0));
 
 	VkCommandBufferBeginInfo CommandBeginInfo {};
 	CommandBeginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
@@ -351,25 +1229,31 @@ void FRenderer::Draw()
 	CommandBeginInfo.pInheritanceInfo = nullptr;
 	CommandBeginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
 
-	VK_CHECK(vkBeginCommandBuffer(VulkanMainCommandBuffer, &CommandBeginInfo));
+	VK_CHECK(vkBeginCommandBuffer(Frame.MainCommandBuffer, &CommandBeginInfo));
+
+	// This slot's timestamps from frames in flight ago are ready now, collect them before reusing the queries.
+	GpuProfiler.get()->BeginFrame((uint32)(VulkanFrameNumber % Frames.size()), Frame.MainCommandBuffer);
+	FramePacer.get()->SetGpuFrameTime(GpuProfiler.get()->GetLastFrameSeconds());
+
+	// Edits meshed this frame go up with this frame's uploads, which the submit below waits for.
+	UploadSectionMeshes(Frame);
 
 //////////////////////////////////////////////////////////////////////////
 // BEGIN TEMP RENDER CODE TEST.
 //////////////////////////////////////////////////////////////////////////
 
-	VkExtent2D RenderExtent;
-	RenderExtent.width = AppSettings::WindowWidth;
-	RenderExtent.height = AppSettings::WindowHeight;
+	const VkExtent2D RenderExtent = VulkanSwapchainExtent;
 
-	// Make a clear-color from frame number. This will flash with a 120*pi frame period.
-	VkClearValue ClearValue;
-	float Flash = abs(sin(VulkanFrameNumber / 120.f));
-	ClearValue.color = {{0.f, 0.f, Flash, 1.f}};
+	// Make a clear-color from simulation time. This will flash with a 2*pi second period whatever the frame rate.
+	VkClearValue ClearValues[2];
+	float Flash = abs(sin((float)SimulationTime * 0.5f));
+	ClearValues[0].color = {{0.f, 0.f, Flash, 1.f}};
+	ClearValues[1].depthStencil = { 1.f, 0 };
 
 	// Start the main renderpass.
 	// We will use the clear color from above, and the framebuffer of the index the swapchain gave us.
 	VkRenderPassBeginInfo RenderPassInfo {};
-	RenderPassInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+	RenderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
 	RenderPassInfo.pNext = nullptr;
 	RenderPassInfo.renderPass = VulkanRenderPass;
 	RenderPassInfo.renderArea.offset.x = 0;
@@ -377,44 +1261,73 @@ void FRenderer::Draw()
 	RenderPassInfo.renderArea.extent = RenderExtent;
 	RenderPassInfo.framebuffer = VulkanFrameBuffers[SwapchainImageIndex];
 
-	// Connect clear values
-	RenderPassInfo.clearValueCount = 1;
-	RenderPassInfo.pClearValues = &ClearValue;
+	// Connect clear values, color then depth.
+	RenderPassInfo.clearValueCount = 2;
+	RenderPassInfo.pClearValues = ClearValues;
 
-	vkCmdBeginRenderPass(VulkanMainCommandBuffer, &RenderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
+	{
+		PROFILE_GPU_SCOPE(GpuProfiler.get(), Frame.MainCommandBuffer, "MainPass");
 
-	// @TODO: Once we start adding render cmds, they will go here.
+		vkCmdBeginRenderPass(Frame.MainCommandBuffer, &RenderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
 
-	// Finalize the render pass
-	vkCmdEndRenderPass(VulkanMainCommandBuffer);
+		DrawSectionMeshes(Frame.MainCommandBuffer, RenderExtent);
+
+		// Finalize the render pass
+		vkCmdEndRenderPass(Frame.MainCommandBuffer);
+	}
+
+	GpuProfiler.get()->EndFrame(Frame.MainCommandBuffer);
 
 	// Finalize the command buffer (we can no longer add commands, but it can now be executed)
-	VK_CHECK(vkEndCommandBuffer(VulkanMainCommandBuffer));
+	VK_CHECK(vkEndCommandBuffer(Frame.MainCommandBuffer));
+
+	// Kick off this frame's uploads, the graphics submit below waits for them on the GPU only.
+	const uint64 UploadValue = UploadManager.get()->Submit();
 
 	// Prepare the submission to the queue.
-	// We want to wait on the PresentSemaphore, as that semaphore is signaled when the swapchain is ready.
+	// We want to wait on the PresentSemaphore, as that semaphore is signaled when the swapchain is ready,
+	// and on the upload timeline before any vertex data is read.
 	// we will signal the RenderSemaphore, to signal that rendering has finished.
+	// Headless frames acquire and present nothing, so they only wait on uploads and signal no semaphore.
+	VkSemaphore WaitSemaphores[2] = { Frame.PresentSemaphore, UploadManager.get()->GetTimelineSemaphore() };
+	VkPipelineStageFlags WaitStages[2] = { VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, VK_PIPELINE_STAGE_VERTEX_INPUT_BIT };
+	uint64 WaitValues[2] = { 0, UploadValue };	// Binary semaphores ignore their value.
+	const uint32 FirstWait = bHeadless ? 1 : 0;
+
+	VkTimelineSemaphoreSubmitInfo TimelineInfo {};
+	TimelineInfo.sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO;
+	TimelineInfo.waitSemaphoreValueCount = 2 - FirstWait;
+	TimelineInfo.pWaitSemaphoreValues = WaitValues + FirstWait;
+
 	VkSubmitInfo SubmitInfo {};
 	SubmitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
-	SubmitInfo.pNext = nullptr;
-
-	VkPipelineStageFlags WaitStage = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
-	SubmitInfo.pWaitDstStageMask = &WaitStage;
-	SubmitInfo.waitSemaphoreCount = 1;
-	SubmitInfo.pWaitSemaphores = &VulkanPresentSemaphore;
-	SubmitInfo.signalSemaphoreCount = 1;
-	SubmitInfo.pSignalSemaphores = &VulkanRenderSemaphore;
+	SubmitInfo.pNext = &TimelineInfo;
+
+	SubmitInfo.pWaitDstStageMask = WaitStages + FirstWait;
+	SubmitInfo.waitSemaphoreCount = 2 - FirstWait;
+	SubmitInfo.pWaitSemaphores = WaitSemaphores + FirstWait;
+	SubmitInfo.signalSemaphoreCount = bHeadless ? 0 : 1;
+	SubmitInfo.pSignalSemaphores = &Frame.RenderSemaphore;
 	SubmitInfo.commandBufferCount = 1;
-	SubmitInfo.pCommandBuffers = &VulkanMainCommandBuffer;
+	SubmitInfo.pCommandBuffers = &Frame.MainCommandBuffer;
 	
 	// Submit command buffer to the queue and execute it.
-	// VulkanRenderFence will now block until the graphics commands finish execution
-	VK_CHECK(vkQueueSubmit(
-		VulkanGraphicsQueue,
-		1, 
-		&SubmitInfo, 
-		VulkanRenderFence
-	));
+	// Frame.RenderFence will now block until the graphics commands finish execution
+	{
+		PROFILE_SCOPE("QueueSubmit");
+		VK_CHECK(vkQueueSubmit(
+			VulkanGraphicsQueue,
+			1, 
+			&SubmitInfo, 
+			Frame.RenderFence
+		));
+	}
+
+	if(bHeadless)
+	{
+		VulkanFrameNumber++;
+		return;
+	}
 
 	// This will put the image we just rendered into the visible window.
 	// we want to wait on the RenderSemaphore for that,
@@ -424,11 +1337,160 @@ void FRenderer::Draw()
 	PresentInfo.pNext = nullptr;
 	PresentInfo.pSwapchains = &VulkanSwapchain;
 	PresentInfo.swapchainCount = 1;
-	PresentInfo.pWaitSemaphores = &VulkanRenderSemaphore;
+	PresentInfo.pWaitSemaphores = &Frame.RenderSemaphore;
 	PresentInfo.waitSemaphoreCount = 1;
 	PresentInfo.pImageIndices = &SwapchainImageIndex;
 
-	VK_CHECK(vkQueuePresentKHR(VulkanGraphicsQueue, &PresentInfo));
+	// Tags the present so the pacer can wait for it to reach the screen.
+	FramePacer.get()->OnPresent(PresentInfo);
+
+	{
+		PROFILE_SCOPE("QueuePresent");
+		const VkResult PresentResult = vkQueuePresentKHR(VulkanGraphicsQueue, &PresentInfo);
+
+		// The present is still queued either way, so its semaphore wait happens and the frame carries on.
+		if(PresentResult == VK_ERROR_OUT_OF_DATE_KHR || PresentResult == VK_SUBOPTIMAL_KHR)
+		{
+			bSwapchainDirty = true;
+		}
+		else
+		{
+			VK_CHECK(PresentResult);
+		}
+	}
 
 	VulkanFrameNumber++;
-}
\ No newline at end of file
+}
+
+bool FRenderer::SaveScreenshot(const char* Path)
+{
+	if(!bHeadless || VulkanFrameNumber == 0)
+	{
+		SDL_Log("Screenshots need a headless run with at least one frame rendered");
+		return false;
+	}
+
+	// Off the hot path, simplest to let everything finish and copy out on the graphics queue.
+	vkDeviceWaitIdle(VulkanCurrentDevice);
+
+	const uint32 Width = VulkanSwapchainExtent.width;
+	const uint32 Height = VulkanSwapchainExtent.height;
+	const VkImage Image = VulkanSwapchainImages[(VulkanFrameNumber - 1) % VulkanSwapchainImages.size()];
+
+	VkBufferCreateInfo BufferInfo {};
+	BufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+	BufferInfo.size = Width * Height * 4;
+	BufferInfo.usage = VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+	BufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+	VkBuffer ReadbackBuffer;
+	VK_CHECK(vkCreateBuffer(VulkanCurrentDevice, &BufferInfo, nullptr, &ReadbackBuffer));
+
+	VkMemoryRequirements Requirements;
+	vkGetBufferMemoryRequirements(VulkanCurrentDevice, ReadbackBuffer, &Requirements);
+
+	VkMemoryAllocateInfo AllocInfo {};
+	AllocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+	AllocInfo.allocationSize = Requirements.size;
+	AllocInfo.memoryTypeIndex = VulkanHelpers::FindMemoryType(
+		VulkanCurrentGPU,
+		Requirements.memoryTypeBits,
+		VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT
+	);
+
+	VkDeviceMemory ReadbackMemory;
+	VK_CHECK(vkAllocateMemory(VulkanCurrentDevice, &AllocInfo, nullptr, &ReadbackMemory));
+	VK_CHECK(vkBindBufferMemory(VulkanCurrentDevice, ReadbackBuffer, ReadbackMemory, 0));
+
+	VkCommandPoolCreateInfo CommandPoolInfo {};
+	CommandPoolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+	CommandPoolInfo.queueFamilyIndex = VulkanGraphicsQueueFamily;
+	CommandPoolInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+
+	VkCommandPool CommandPool;
+	VK_CHECK(vkCreateCommandPool(VulkanCurrentDevice, &CommandPoolInfo, nullptr, &CommandPool));
+
+	VkCommandBufferAllocateInfo CommandAllocInfo {};
+	CommandAllocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+	CommandAllocInfo.commandPool = CommandPool;
+	CommandAllocInfo.commandBufferCount = 1;
+	CommandAllocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+
+	VkCommandBuffer CommandBuffer;
+	VK_CHECK(vkAllocateCommandBuffers(VulkanCurrentDevice, &CommandAllocInfo, &CommandBuffer));
+
+	VkCommandBufferBeginInfo CommandBeginInfo {};
+	CommandBeginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+	CommandBeginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+	VK_CHECK(vkBeginCommandBuffer(CommandBuffer, &CommandBeginInfo));
+
+	// The render pass left the image in transfer src layout, only its writes need making visible.
+	VkImageMemoryBarrier ImageBarrier {};
+	ImageBarrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+	ImageBarrier.srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+	ImageBarrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+	ImageBarrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+	ImageBarrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+	ImageBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	ImageBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	ImageBarrier.image = Image;
+	ImageBarrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+	ImageBarrier.subresourceRange.levelCount = 1;
+	ImageBarrier.subresourceRange.layerCount = 1;
+
+	vkCmdPipelineBarrier(CommandBuffer, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, nullptr, 0, nullptr, 1, &ImageBarrier);
+
+	VkBufferImageCopy Region {};
+	Region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+	Region.imageSubresource.layerCount = 1;
+	Region.imageExtent = { Width, Height, 1 };
+	vkCmdCopyImageToBuffer(CommandBuffer, Image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, ReadbackBuffer, 1, &Region);
+
+	// Host reads need the copy's writes made visible to them as well.
+	VkMemoryBarrier HostBarrier {};
+	HostBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+	HostBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+	HostBarrier.dstAccessMask = VK_ACCESS_HOST_READ_BIT;
+	vkCmdPipelineBarrier(CommandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_HOST_BIT, 0, 1, &HostBarrier, 0, nullptr, 0, nullptr);
+
+	VK_CHECK(vkEndCommandBuffer(CommandBuffer));
+
+	VkSubmitInfo SubmitInfo {};
+	SubmitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+	SubmitInfo.commandBufferCount = 1;
+	SubmitInfo.pCommandBuffers = &CommandBuffer;
+	VK_CHECK(vkQueueSubmit(VulkanGraphicsQueue, 1, &SubmitInfo, VK_NULL_HANDLE));
+	VK_CHECK(vkQueueWaitIdle(VulkanGraphicsQueue));
+
+	// Images are BGRA, PPM wants RGB. The bytes are sRGB encoded, exactly what a window would show.
+	const uint8* Pixels = nullptr;
+	VK_CHECK(vkMapMemory(VulkanCurrentDevice, ReadbackMemory, 0, VK_WHOLE_SIZE, 0, (void**)&Pixels));
+
+	bool bWritten = false;
+	FILE* File = std::fopen(Path, "wb");
+	if(File)
+	{
+		std::vector<uint8> Row(Width * 3);
+		std::fprintf(File, "P6\n%u %u\n255\n", Width, Height);
+		for(uint32 Y = 0; Y < Height; Y++)
+		{
+			const uint8* Source = Pixels + Y * Width * 4;
+			for(uint32 X = 0; X < Width; X++)
+			{
+				Row[X * 3 + 0] = Source[X * 4 + 2];
+				Row[X * 3 + 1] = Source[X * 4 + 1];
+				Row[X * 3 + 2] = Source[X * 4 + 0];
+			}
+			std::fwrite(Row.data(), 1, Row.size(), File);
+		}
+		bWritten = std::fclose(File) == 0;
+	}
+
+	vkUnmapMemory(VulkanCurrentDevice, ReadbackMemory);
+	vkDestroyCommandPool(VulkanCurrentDevice, CommandPool, nullptr);
+	vkDestroyBuffer(VulkanCurrentDevice, ReadbackBuffer, nullptr);
+	vkFreeMemory(VulkanCurrentDevice, ReadbackMemory, nullptr);
+
+	SDL_Log("%s screenshot %s", bWritten ? "Saved" : "Couldn't save", Path);
+	return bWritten;
+}
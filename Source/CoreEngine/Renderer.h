@@ -3,7 +3,12 @@
 #pragma once
 
 #include "CoreMinimal.h"
+#include "Camera.h"
+#include "GpuAllocator.h"
+#include "LinearAllocator.h"
 #include "vulkan.h"
+#include <algorithm>
+#include <functional>
 #include <vector>
 
 #define VK_TIME_SECOND		1000000000
@@ -15,10 +20,60 @@
 // crash earlier provided we had whacked our swapchain tho.
 // pretty confident that no flashy flashy is related.
 
+/*
+	Queue of destroy calls for GPU objects that may still be in use by a frame
+	in flight. Flushed once the owning frame's fence has been waited on.
+*/
+struct FDeletionQueue
+{
+	std::vector<std::function<void()>> Deletors;
+
+	void Push(std::function<void()>&& Function)
+	{
+		Deletors.push_back(std::move(Function));
+	}
+
+	void Flush()
+	{
+		// Destroy in reverse order of creation.
+		for(auto It = Deletors.rbegin(); It != Deletors.rend(); It++)
+		{
+			(*It)();
+		}
+		Deletors.clear();
+	}
+};
+
+/*
+	Resources owned by a single frame in flight. FRenderer keeps a ring of these
+	indexed by VulkanFrameNumber, so the CPU can record the next frame while the
+	GPU is still busy with the previous ones.
+*/
+struct FFrameData
+{
+	VkCommandPool		CommandPool 		= VK_NULL_HANDLE;
+	VkCommandBuffer		MainCommandBuffer 	= VK_NULL_HANDLE;
+
+	VkSemaphore			PresentSemaphore 	= VK_NULL_HANDLE;
+	VkSemaphore			RenderSemaphore 	= VK_NULL_HANDLE;
+	VkFence				RenderFence 		= VK_NULL_HANDLE;
+
+	FLinearAllocator	TransientAllocator; 	// CPU scratch memory, reset when this slot comes round again.
+	FDeletionQueue		DeletionQueue; 			// Flushed when this slot comes round again.
+};
+
 /*
 	Render is responsible for rendering the game and talking to
 	FApp and SDL in order to draw to the main game window.
 */
+class FUploadManager;
+class FGpuAllocator;
+class FGpuProfiler;
+class FPipelineCache;
+class FFramePacer;
+class FVulkanBufferHeap;
+class FSectionMeshes;
+
 class FRenderer
 {
 public:
@@ -27,7 +82,68 @@ public:
 
 	void Initialize();
 	void Shutdown();
-	void Draw();
+
+	// Renders one frame. SimulationTime is already interpolated between the last two simulation ticks.
+	void Draw(double SimulationTime);
+
+	// Rebuilds the swapchain at the start of the next frame, SDL window size events call this.
+	void OnWindowResized()
+	{
+		bSwapchainDirty = true;
+	}
+
+	// Writes the last rendered frame as a binary PPM, headless only. Waits for the GPU to go idle.
+	bool SaveScreenshot(const char* Path);
+
+	// Resources for the frame currently being recorded.
+	FFrameData& GetCurrentFrame()
+	{
+		return Frames[VulkanFrameNumber % Frames.size()];
+	}
+
+	// Streams buffer data to the GPU, see FUploadManager.
+	FUploadManager* GetUploadManager() const
+	{
+		return UploadManager.get();
+	}
+
+	// Device local vertex / index ranges for chunk meshes, see FGpuAllocator.
+	FGpuAllocator* GetMeshAllocator() const
+	{
+		return MeshAllocator.get();
+	}
+
+	FVulkanBufferHeap* GetMeshHeap() const
+	{
+		return MeshHeap.get();
+	}
+
+	// Near field meshes, whatever changed is uploaded at the start of every frame.
+	void SetSectionMeshes(FSectionMeshes* InSectionMeshes)
+	{
+		SectionMeshes = InSectionMeshes;
+	}
+
+	// What section meshes are drawn from, sections outside its frustum are skipped.
+	void SetCamera(const FCamera& InCamera)
+	{
+		Camera = InCamera;
+	}
+
+	// Delays the start of each frame for latency, see FFramePacer.
+	FFramePacer* GetFramePacer() const
+	{
+		return FramePacer.get();
+	}
+
+	// Every pipeline must be created with this, see FPipelineCache.
+	VkPipelineCache GetPipelineCache() const;
+
+	// Timestamp zones for passes recorded into the current frame, see FGpuProfiler.
+	FGpuProfiler* GetGpuProfiler() const
+	{
+		return GpuProfiler.get();
+	}
 
 protected:
 
@@ -39,30 +155,78 @@ protected:
 
 	VkSwapchainKHR				VulkanSwapchain;
 	VkFormat					VulkanSwapchainImageFormat;
+	VkExtent2D					VulkanSwapchainExtent;		// What the swapchain actually gave us, not necessarily what we asked for.
 	std::vector<VkImage>		VulkanSwapchainImages;
 	std::vector<VkImageView>	VulkanSwapchainImageViews;
+	std::vector<VkDeviceMemory>	VulkanOffscreenMemory;		// Backing for the images when headless, there's no swapchain then.
+	std::vector<VkImage>		VulkanDepthImages;			// One per swapchain image, sized to match.
+	std::vector<VkImageView>	VulkanDepthImageViews;
+	std::vector<VkDeviceMemory>	VulkanDepthMemory;
 
 	VkQueue						VulkanGraphicsQueue;
 	uint32						VulkanGraphicsQueueFamily;
-	VkCommandPool				VulkanCommandPool;
-	VkCommandBuffer				VulkanMainCommandBuffer;
+	VkQueue						VulkanTransferQueue;		// Same as the graphics queue if there's no separate family.
+	uint32						VulkanTransferQueueFamily;
+
+	std::shared_ptr<FPipelineCache> 	PipelineCache;
+	std::shared_ptr<FUploadManager> 	UploadManager;
+	std::shared_ptr<FVulkanBufferHeap> 	MeshHeap;
+	std::shared_ptr<FGpuAllocator> 		MeshAllocator;
+	std::shared_ptr<FGpuProfiler> 		GpuProfiler;
+	std::shared_ptr<FFramePacer> 		FramePacer;
+	FSectionMeshes* 					SectionMeshes = nullptr;
+	FGpuAllocation 						QuadIndexRange;		// Shared by every section mesh draw, see QuadIndexPattern.
 
 	VkRenderPass				VulkanRenderPass;
 	std::vector<VkFramebuffer>	VulkanFrameBuffers;
 
-	VkSemaphore					VulkanPresentSemaphore;
-	VkSemaphore					VulkanRenderSemaphore;
-	VkFence						VulkanRenderFence;
-	int32						VulkanFrameNumber;
+	VkPipelineLayout			VulkanChunkPipelineLayout 	= VK_NULL_HANDLE;
+	VkPipeline					VulkanChunkPipeline 		= VK_NULL_HANDLE;	// Null if the shaders weren't found.
+	FCamera						Camera;
+
+	std::vector<FFrameData>		Frames;					// Ring of frames in flight, AppSettings::FramesInFlight deep.
+	std::vector<VkFence>		VulkanImagesInFlight;	// Fence of the frame last rendering to each swapchain image.
+	uint64						VulkanFrameNumber;		// Frames begun since startup, 64 bits so soak runs never wrap it.
 
 private:
 
 	void SetupVulkan();
+	void SetupUploads();
+	void SetupMeshMemory();
 	void SetupSwapchain();
+	void RecreateSwapchain();
+	void FlushRetiredSwapchains(bool bForce);
+	void SetupOffscreenTargets();
+	void SetupDepthTargets();
+	void SetupFramePacing();
 	void SetupCommands();
+	void SetupGpuProfiler();
 	void SetupRenderPass();
+	void SetupChunkPipeline();
 	void SetupFrameBuffers();
 	void SetupSyncStructures();
 
+	// Uploads changed section meshes, replaced ranges are freed once Frame comes round again.
+	void UploadSectionMeshes(FFrameData& Frame);
+
+	// Records a draw of every uploaded section mesh in the camera's frustum, inside the main render pass.
+	void DrawSectionMeshes(VkCommandBuffer CommandBuffer, VkExtent2D Extent);
+
+	/*
+		Swapchain objects replaced by a recreation. Frames still in flight may be
+		using them, so they're destroyed once every frame submitted before the
+		recreation is known to have finished.
+	*/
+	struct FRetiredSwapchain
+	{
+		uint64 			RetiredFrame;	// VulkanFrameNumber when it was replaced.
+		FDeletionQueue 	Resources;
+	};
+
+	std::vector<FRetiredSwapchain> RetiredSwapchains;
+
 	bool bHasInitialized = false;
+	bool bSwapchainDirty = false;
+	bool bHeadless = false;
+	bool bPresentWaitSupported = false;	// VK_KHR_present_id and present_wait are both enabled.
 };
\ No newline at end of file
@@ -0,0 +1,391 @@
+// Copyright Snaps 2022, All Rights Reserved.
+
+#include "SectionMeshes.h"
+#include "BinaryMesher.h"
+#include "CoreMacros.h"
+#include "VoxelChunk.h"
+#include <algorithm>
+
+// Background mesh jobs in flight per worker, few enough that they're done by the next frame.
+static const uint32 LoadJobsPerThread = 16;
+
+// Sections one worker meshes for edits per frame, a couple of milliseconds' worth.
+static const uint32 EditSectionsPerThread = 32;
+
+static const int32 SectionsPerChunk = 1 << SectionsPerChunkLog2;
+
+// Per worker scratch for mesh jobs.
+static thread_local FBinaryMesher GSectionMesher;
+static thread_local FMeshVolume GSectionVolume(SectionSize);
+
+// Sections are keyed like chunks, so section coordinates are limited to FChunkMap's range.
+static uint64 PackSectionKey(int32 X, int32 Y, int32 Z)
+{
+	return FChunkMap::PackKey(X, Y, Z);
+}
+
+FSectionMeshes::FSectionMeshes(FJobSystem* InJobSystem, const FChunkMap* InChunkMap)
+	: JobSystem(InJobSystem)
+	, ChunkMap(InChunkMap)
+	, MaxLoadJobsInFlight(InJobSystem->GetNumThreads() * LoadJobsPerThread)
+	, EditSectionsPerFrame(InJobSystem->GetNumThreads() * EditSectionsPerThread)
+{
+}
+
+FSectionMeshes::~FSectionMeshes()
+{
+	// Jobs point at our sections.
+	JobSystem->Wait(MeshJobs);
+}
+
+void FSectionMeshes::OnChunkLoaded(int32 X, int32 Y, int32 Z)
+{
+	LoadedChunks.push_back(FChunkMap::PackKey(X, Y, Z));
+}
+
+void FSectionMeshes::OnChunkUnloaded(int32 X, int32 Y, int32 Z)
+{
+	UnloadedChunks.push_back(FChunkMap::PackKey(X, Y, Z));
+}
+
+bool FSectionMeshes::QueueEdit(int32 X, int32 Y, int32 Z, FBlockId Block)
+{
+	// Most edits dirty one or two sections, so this many is about what one Update takes.
+	if(PendingEdits.size() >= EditSectionsPerFrame)
+	{
+		return false;
+	}
+
+	PendingEdits.push_back({ X, Y, Z, Block });
+	return true;
+}
+
+void FSectionMeshes::Update()
+{
+	PROFILE_FUNCTION();
+
+	// Last frame's background batch, chunks can't change while it reads them.
+	JobSystem->Wait(MeshJobs);
+	CollectMeshed();
+
+	EditedChunks.clear();
+	AppliedEdits.clear();
+	ApplyChunkChanges();
+
+	// Edits make it into this frame, every worker and the main thread mesh them before anything else.
+	// Chunks are written before any job reads them.
+	if(!PendingEdits.empty())
+	{
+		PROFILE_SCOPE("MeshEdits");
+		ApplyEdits();
+		ScheduleQueue(EditQueue, EDirty::Edit, UINT32_MAX);
+		JobSystem->Wait(MeshJobs);
+		CollectMeshed();
+
+		std::sort(EditedChunks.begin(), EditedChunks.end());
+		EditedChunks.erase(std::unique(EditedChunks.begin(), EditedChunks.end()), EditedChunks.end());
+	}
+
+	ScheduleQueue(LoadQueue, EDirty::Load, MaxLoadJobsInFlight);
+}
+
+void FSectionMeshes::Flush()
+{
+	PROFILE_FUNCTION();
+
+	do
+	{
+		Update();
+	}
+	while(NumDirty > 0 || !PendingEdits.empty());
+
+	JobSystem->Wait(MeshJobs);
+	CollectMeshed();
+}
+
+void FSectionMeshes::TakeChangedSections(std::vector<FMeshSection*>& OutSections)
+{
+	OutSections.clear();
+	for(uint64 Key : ChangedSections)
+	{
+		auto It = Sections.find(Key);
+		if(It != Sections.end())
+		{
+			It->second->bUploadQueued = false;
+			OutSections.push_back(&It->second->Section);
+		}
+	}
+	ChangedSections.clear();
+}
+
+void FSectionMeshes::RequeueUpload(FMeshSection* Section)
+{
+	auto It = Sections.find(PackSectionKey(Section->X, Section->Y, Section->Z));
+	if(It != Sections.end())
+	{
+		QueueUpload(It->second.get());
+	}
+}
+
+void FSectionMeshes::TakeRetiredRanges(std::vector<FGpuAllocation>& OutRanges)
+{
+	OutRanges.swap(RetiredRanges);
+	RetiredRanges.clear();
+}
+
+const FMeshSection* FSectionMeshes::FindSection(int32 X, int32 Y, int32 Z) const
+{
+	auto It = Sections.find(PackSectionKey(X, Y, Z));
+	return It != Sections.end() ? &It->second->Section : nullptr;
+}
+
+void FSectionMeshes::MeshSection(const FChunkMap& ChunkMap, int32 X, int32 Y, int32 Z, FChunkMesh& OutMesh)
+{
+	FVoxelChunk* Chunks[27];
+	ChunkMap.GatherNeighbours(X >> SectionsPerChunkLog2, Y >> SectionsPerChunkLog2, Z >> SectionsPerChunkLog2, Chunks);
+
+	// Faces belong to the solid voxels inside the section, with none there's nothing to mesh.
+	const FVoxelChunk* Home = Chunks[FChunkMap::NeighbourIndex(0, 0, 0)];
+	if(!Home || (Home->IsUniform() && Home->Get(0) == BlockAir))
+	{
+		OutMesh.Reset();
+		return;
+	}
+
+	// Neighbouring chunk and coordinate inside it for every padded coordinate, per axis.
+	const int32 PaddedSize = SectionSize + 2;
+	const int32 Section[3] = { X, Y, Z };
+	int32 Delta[3][PaddedSize];
+	int32 Local[3][PaddedSize];
+	for(int32 Axis = 0; Axis < 3; Axis++)
+	{
+		const int32 First = (Section[Axis] & (SectionsPerChunk - 1)) * SectionSize - 1;
+		for(int32 Index = 0; Index < PaddedSize; Index++)
+		{
+			const int32 Voxel = First + Index;
+			Delta[Axis][Index] = Voxel < 0 ? -1 : (Voxel >= ChunkSize ? 1 : 0);
+			Local[Axis][Index] = Voxel - Delta[Axis][Index] * ChunkSize;
+		}
+	}
+
+	// Buried sections, solid all the way through and all round, are most of them underground.
+	bool bBuried = Home->IsUniform();
+	for(int32 DeltaY = Delta[1][0]; bBuried && DeltaY <= Delta[1][PaddedSize - 1]; DeltaY++)
+	for(int32 DeltaZ = Delta[2][0]; bBuried && DeltaZ <= Delta[2][PaddedSize - 1]; DeltaZ++)
+	for(int32 DeltaX = Delta[0][0]; bBuried && DeltaX <= Delta[0][PaddedSize - 1]; DeltaX++)
+	{
+		const FVoxelChunk* Chunk = Chunks[FChunkMap::NeighbourIndex(DeltaX, DeltaY, DeltaZ)];
+		bBuried = Chunk && Chunk->IsUniform() && Chunk->Get(0) != BlockAir;
+	}
+	if(bBuried)
+	{
+		OutMesh.Reset();
+		return;
+	}
+
+	// The mesh volume's padded layout walks the same Y, Z, X order. A row's section part is a run
+	// of one chunk, only its two border voxels can be in the chunks either side.
+	FBlockId* Blocks = GSectionVolume.Blocks.data();
+	for(int32 PaddedY = 0; PaddedY < PaddedSize; PaddedY++)
+	for(int32 PaddedZ = 0; PaddedZ < PaddedSize; PaddedZ++)
+	{
+		const int32 DeltaY = Delta[1][PaddedY];
+		const int32 DeltaZ = Delta[2][PaddedZ];
+		const FVoxelChunk* Before = Chunks[FChunkMap::NeighbourIndex(Delta[0][0], DeltaY, DeltaZ)];
+		const FVoxelChunk* Row = Chunks[FChunkMap::NeighbourIndex(0, DeltaY, DeltaZ)];
+		const FVoxelChunk* After = Chunks[FChunkMap::NeighbourIndex(Delta[0][PaddedSize - 1], DeltaY, DeltaZ)];
+
+		Blocks[0] = Before ? Before->Get(Local[0][0], Local[1][PaddedY], Local[2][PaddedZ]) : BlockAir;
+		if(Row)
+		{
+			Row->CopyRun(FVoxelChunk::ToIndex(Local[0][1], Local[1][PaddedY], Local[2][PaddedZ]), SectionSize, Blocks + 1);
+		}
+		else
+		{
+			std::fill(Blocks + 1, Blocks + 1 + SectionSize, BlockAir);
+		}
+		Blocks[PaddedSize - 1] = After ? After->Get(Local[0][PaddedSize - 1], Local[1][PaddedY], Local[2][PaddedZ]) : BlockAir;
+		Blocks += PaddedSize;
+	}
+
+	GSectionMesher.Mesh(GSectionVolume, OutMesh);
+}
+
+void FSectionMeshes::MarkDirty(int32 MinX, int32 MinY, int32 MinZ, int32 MaxX, int32 MaxY, int32 MaxZ, EDirty Dirty)
+{
+	// A section's volume reaches one voxel past it on every side.
+	for(int32 Y = (MinY - 1) >> SectionSizeLog2; Y <= (MaxY + 1) >> SectionSizeLog2; Y++)
+	for(int32 Z = (MinZ - 1) >> SectionSizeLog2; Z <= (MaxZ + 1) >> SectionSizeLog2; Z++)
+	for(int32 X = (MinX - 1) >> SectionSizeLog2; X <= (MaxX + 1) >> SectionSizeLog2; X++)
+	{
+		const uint64 Key = PackSectionKey(X, Y, Z);
+		auto It = Sections.find(Key);
+		if(It == Sections.end() || It->second->Dirty >= Dirty)
+		{
+			continue;
+		}
+
+		// A section already waiting in the load queue moves up, its old entry there gets skipped.
+		FSectionEntry* Entry = It->second.get();
+		NumDirty += Entry->Dirty == EDirty::None ? 1 : 0;
+		Entry->Dirty = Dirty;
+		(Dirty == EDirty::Edit ? EditQueue : LoadQueue).push_back(Key);
+	}
+}
+
+void FSectionMeshes::ApplyChunkChanges()
+{
+	PROFILE_FUNCTION();
+
+	for(uint64 Key : UnloadedChunks)
+	{
+		int32 ChunkX, ChunkY, ChunkZ;
+		FChunkMap::UnpackKey(Key, ChunkX, ChunkY, ChunkZ);
+
+		for(int32 Y = 0; Y < SectionsPerChunk; Y++)
+		for(int32 Z = 0; Z < SectionsPerChunk; Z++)
+		for(int32 X = 0; X < SectionsPerChunk; X++)
+		{
+			auto It = Sections.find(PackSectionKey((ChunkX << SectionsPerChunkLog2) + X, (ChunkY << SectionsPerChunkLog2) + Y, (ChunkZ << SectionsPerChunkLog2) + Z));
+			if(It == Sections.end())
+			{
+				continue;
+			}
+
+			const FMeshSection& Section = It->second->Section;
+			if(Section.VertexRange.IsValid())
+			{
+				RetiredRanges.push_back(Section.VertexRange);
+			}
+			NumDirty -= It->second->Dirty != EDirty::None ? 1 : 0;
+			Sections.erase(It);
+		}
+
+		// Neighbours had the chunk culling their border faces, those faces are now on the edge of the world.
+		MarkDirty(ChunkX * ChunkSize, ChunkY * ChunkSize, ChunkZ * ChunkSize, ChunkX * ChunkSize + ChunkSize - 1, ChunkY * ChunkSize + ChunkSize - 1, ChunkZ * ChunkSize + ChunkSize - 1, EDirty::Load);
+	}
+	UnloadedChunks.clear();
+
+	for(uint64 Key : LoadedChunks)
+	{
+		if(!ChunkMap->FindKey(Key))
+		{
+			continue;
+		}
+
+		int32 ChunkX, ChunkY, ChunkZ;
+		FChunkMap::UnpackKey(Key, ChunkX, ChunkY, ChunkZ);
+
+		for(int32 Y = 0; Y < SectionsPerChunk; Y++)
+		for(int32 Z = 0; Z < SectionsPerChunk; Z++)
+		for(int32 X = 0; X < SectionsPerChunk; X++)
+		{
+			FMeshSection Section;
+			Section.X = (ChunkX << SectionsPerChunkLog2) + X;
+			Section.Y = (ChunkY << SectionsPerChunkLog2) + Y;
+			Section.Z = (ChunkZ << SectionsPerChunkLog2) + Z;
+
+			std::unique_ptr<FSectionEntry>& Entry = Sections[PackSectionKey(Section.X, Section.Y, Section.Z)];
+			if(!Entry)
+			{
+				Entry.reset(new FSectionEntry());
+				Entry->Owner = this;
+				Entry->Section = Section;
+			}
+		}
+
+		// The chunk's own sections, and the neighbours' that had nothing behind their border until now.
+		MarkDirty(ChunkX * ChunkSize, ChunkY * ChunkSize, ChunkZ * ChunkSize, ChunkX * ChunkSize + ChunkSize - 1, ChunkY * ChunkSize + ChunkSize - 1, ChunkZ * ChunkSize + ChunkSize - 1, EDirty::Load);
+	}
+	LoadedChunks.clear();
+}
+
+void FSectionMeshes::ApplyEdits()
+{
+	PROFILE_FUNCTION();
+
+	// Edits landing in sections that are already dirty don't add to the queue, they merge into its mesh.
+	for(; !PendingEdits.empty() && EditQueue.size() < EditSectionsPerFrame; PendingEdits.pop_front())
+	{
+		const FBlockEdit& Edit = PendingEdits.front();
+		const int32 ChunkX = Edit.X >> ChunkSizeLog2;
+		const int32 ChunkY = Edit.Y >> ChunkSizeLog2;
+		const int32 ChunkZ = Edit.Z >> ChunkSizeLog2;
+		FVoxelChunk* Chunk = ChunkMap->Find(ChunkX, ChunkY, ChunkZ);
+		if(!Chunk)
+		{
+			continue;
+		}
+
+		const int32 Index = FVoxelChunk::ToIndex(Edit.X & (ChunkSize - 1), Edit.Y & (ChunkSize - 1), Edit.Z & (ChunkSize - 1));
+		if(Chunk->Get(Index) == Edit.Block)
+		{
+			continue;
+		}
+
+		Chunk->Set(Index, Edit.Block);
+		MarkDirty(Edit.X, Edit.Y, Edit.Z, Edit.X, Edit.Y, Edit.Z, EDirty::Edit);
+		EditedChunks.push_back(FChunkMap::PackKey(ChunkX, ChunkY, ChunkZ));
+		AppliedEdits.push_back(Edit);
+	}
+}
+
+void FSectionMeshes::ScheduleQueue(std::deque<uint64>& Queue, EDirty Dirty, uint32 MaxJobs)
+{
+	while(!Queue.empty() && (uint32)MeshJobs.Value.load(std::memory_order_relaxed) < MaxJobs)
+	{
+		auto It = Sections.find(Queue.front());
+		Queue.pop_front();
+		if(It == Sections.end() || It->second->Dirty != Dirty)
+		{
+			continue;
+		}
+
+		It->second->Dirty = EDirty::None;
+		NumDirty--;
+		JobSystem->Schedule(&FSectionMeshes::MeshJob, It->second.get(), &MeshJobs);
+	}
+}
+
+void FSectionMeshes::CollectMeshed()
+{
+	std::vector<FSectionEntry*> Meshed;
+	{
+		std::lock_guard<std::mutex> Lock(DoneMutex);
+		Meshed.swap(MeshedSections);
+	}
+
+	for(FSectionEntry* Entry : Meshed)
+	{
+		FMeshSection& Section = Entry->Section;
+		NumMeshed++;
+
+		// Empty before and after, which is most sections, there's nothing to upload.
+		if(Entry->NewMesh.Vertices.empty() && Section.Mesh.Vertices.empty() && !Section.VertexRange.IsValid())
+		{
+			continue;
+		}
+
+		std::swap(Section.Mesh, Entry->NewMesh);
+		QueueUpload(Entry);
+	}
+}
+
+void FSectionMeshes::QueueUpload(FSectionEntry* Entry)
+{
+	if(!Entry->bUploadQueued)
+	{
+		Entry->bUploadQueued = true;
+		ChangedSections.push_back(PackSectionKey(Entry->Section.X, Entry->Section.Y, Entry->Section.Z));
+	}
+}
+
+void FSectionMeshes::MeshJob(void* Data)
+{
+	FSectionEntry* Entry = static_cast<FSectionEntry*>(Data);
+	const FMeshSection& Section = Entry->Section;
+	MeshSection(*Entry->Owner->ChunkMap, Section.X, Section.Y, Section.Z, Entry->NewMesh);
+
+	std::lock_guard<std::mutex> Lock(Entry->Owner->DoneMutex);
+	Entry->Owner->MeshedSections.push_back(Entry);
+}
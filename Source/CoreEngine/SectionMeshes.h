@@ -0,0 +1,215 @@
+// Copyright Snaps 2022, All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "ChunkMap.h"
+#include "GpuAllocator.h"
+#include "JobSystem.h"
+#include "MeshTypes.h"
+#include "VoxelTypes.h"
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+// Chunks are meshed in sections of SectionSize^3 voxels, 8 per chunk.
+static const int32 SectionSizeLog2 			= 4;
+static const int32 SectionSize 				= 1 << SectionSizeLog2;
+static const int32 SectionsPerChunkLog2 	= ChunkSizeLog2 - SectionSizeLog2;
+
+// A block set in world voxel coordinates.
+struct FBlockEdit
+{
+	int32 		X, Y, Z;
+	FBlockId 	Block;
+};
+
+/*
+	Full detail mesh of one section. X, Y, Z are in sections, the first voxel
+	is X * SectionSize, and the mesh is relative to it. The GPU range belongs
+	to the renderer, which fills it in when it uploads the mesh.
+*/
+struct FMeshSection
+{
+	int32 			X, Y, Z;
+	FChunkMesh 		Mesh;
+	FGpuAllocation 	VertexRange;
+	uint32 			NumIndices 	= 0;
+};
+
+/*
+	Near field terrain meshes, built from the chunks in a chunk map and kept up
+	to date as blocks change. Each chunk is split into sections that are meshed
+	and uploaded on their own, so an edit only costs the sections it touches:
+	the one it lands in, plus the neighbours that have the block in their one
+	voxel border when it lands on a section's edge.
+
+	Update first waits for the previous frame's mesh jobs, which were sized to
+	be done by then, and applies queued edits while nothing reads the chunks.
+	Sections dirtied by edits are then meshed straight away, the main thread
+	helping, so an edit is in the meshes handed to the renderer that same
+	frame. Edits to a section that's already dirty ride along for free, so
+	repeated edits to one spot cost one mesh. Each frame takes edits until
+	they've dirtied a batch of sections sized by the number of workers, the
+	rest wait for the next frame. An edit that waits hasn't touched the chunks
+	yet, it's never in one section's mesh and not its neighbour's. The queue
+	only takes about a frame's worth, past that QueueEdit refuses edits so a
+	flood of them pushes back on whatever makes them instead of piling up
+	latency. Sections of newly loaded chunks, or next to unloaded ones, are
+	meshed in the background a bounded batch per frame.
+
+	Edits write the chunks in place, the chunk map's owner must not write
+	chunks once they're in the map. Everything is main thread only.
+*/
+class FSectionMeshes
+{
+public:
+
+	FSectionMeshes(FJobSystem* InJobSystem, const FChunkMap* InChunkMap);
+	~FSectionMeshes();
+
+	FSectionMeshes(const FSectionMeshes&) = delete;
+	FSectionMeshes& operator=(const FSectionMeshes&) = delete;
+
+	// The chunk is in the chunk map now, or about to leave it. Picked up by the next Update.
+	void OnChunkLoaded(int32 X, int32 Y, int32 Z);
+	void OnChunkUnloaded(int32 X, int32 Y, int32 Z);
+
+	// Sets a block in world voxel coordinates on the next Update. Edits to chunks that aren't loaded are dropped.
+	// Returns false, and drops the edit, when the queue already holds more than a frame can mesh.
+	bool QueueEdit(int32 X, int32 Y, int32 Z, FBlockId Block);
+
+	// Once a frame, after the chunk map's owner has updated it. Only waits on edits.
+	void Update();
+
+	// Blocks until every dirty section is meshed, for tools and benchmarks.
+	void Flush();
+
+	// Sections whose mesh changed since the last call, for the renderer to upload. Includes sections
+	// that went empty, their old ranges have to go too.
+	void TakeChangedSections(std::vector<FMeshSection*>& OutSections);
+
+	// Hands a section back for another upload attempt next frame, e.g. when the staging ring was full.
+	void RequeueUpload(FMeshSection* Section);
+
+	// GPU ranges of sections that were dropped, for the renderer to free once no frame uses them.
+	void TakeRetiredRanges(std::vector<FGpuAllocation>& OutRanges);
+
+	// Chunks the last Update's edits changed, as FChunkMap::PackKey.
+	const std::vector<uint64>& GetEditedChunks() const
+	{
+		return EditedChunks;
+	}
+
+	// Edits the last Update applied, in order, for whatever else follows the blocks.
+	const std::vector<FBlockEdit>& GetAppliedEdits() const
+	{
+		return AppliedEdits;
+	}
+
+	const FMeshSection* FindSection(int32 X, int32 Y, int32 Z) const;
+
+	// Calls Function(Section) for every section, in no particular order.
+	template<typename FunctionType>
+	void ForEachSection(const FunctionType& Function) const
+	{
+		for(const auto& Pair : Sections)
+		{
+			Function(Pair.second->Section);
+		}
+	}
+
+	uint32 GetNumSections() const
+	{
+		return (uint32)Sections.size();
+	}
+
+	// Sections still waiting on a mesh.
+	uint32 GetNumDirty() const
+	{
+		return NumDirty;
+	}
+
+	// Edits queued but not applied yet, what didn't fit in the last Update's batch.
+	uint32 GetNumPendingEdits() const
+	{
+		return (uint32)PendingEdits.size();
+	}
+
+	// Section meshes built so far, including rebuilds.
+	uint64 GetNumMeshed() const
+	{
+		return NumMeshed;
+	}
+
+	// Meshes the section at X, Y, Z from the chunk map into OutMesh, what the mesh jobs run.
+	static void MeshSection(const FChunkMap& ChunkMap, int32 X, int32 Y, int32 Z, FChunkMesh& OutMesh);
+
+private:
+
+	enum class EDirty : uint8
+	{
+		None,
+		Load,		// Meshed in the background.
+		Edit		// Meshed before Update returns.
+	};
+
+	struct FSectionEntry
+	{
+		FSectionMeshes* Owner;
+		FMeshSection 	Section;
+		FChunkMesh 		NewMesh; 					// Written by the mesh job, swapped in on the main thread.
+		EDirty 			Dirty 			= EDirty::None;
+		bool 			bUploadQueued 	= false;
+	};
+
+	// Marks every section with a voxel of the inclusive box in its mesh volume, border included.
+	void MarkDirty(int32 MinX, int32 MinY, int32 MinZ, int32 MaxX, int32 MaxY, int32 MaxZ, EDirty Dirty);
+
+	void ApplyChunkChanges();
+
+	// Applies pending edits from the front until they've dirtied EditSectionsPerFrame or there are none left.
+	void ApplyEdits();
+
+	// Schedules dirty sections off the front of Queue, at most MaxJobs in flight. Keys whose section
+	// was dropped or is no longer marked Dirty are skipped.
+	void ScheduleQueue(std::deque<uint64>& Queue, EDirty Dirty, uint32 MaxJobs);
+
+	// Swaps in the meshes of finished jobs.
+	void CollectMeshed();
+
+	void QueueUpload(FSectionEntry* Entry);
+
+	static void MeshJob(void* Data);
+
+	FJobSystem* 		JobSystem;
+	const FChunkMap* 	ChunkMap;
+	uint32 				MaxLoadJobsInFlight;
+	uint32 				EditSectionsPerFrame;
+
+	std::unordered_map<uint64, std::unique_ptr<FSectionEntry>> Sections;
+
+	std::vector<uint64> 		LoadedChunks;
+	std::vector<uint64> 		UnloadedChunks;
+	std::deque<FBlockEdit> 		PendingEdits;
+	std::vector<uint64> 		EditedChunks;
+	std::vector<FBlockEdit> 	AppliedEdits;
+
+	// Dirty section keys, in the order they were marked.
+	std::deque<uint64> 			EditQueue;
+	std::deque<uint64> 			LoadQueue;
+	uint32 						NumDirty 	= 0;
+
+	std::vector<uint64> 		ChangedSections;
+	std::vector<FGpuAllocation> RetiredRanges;
+
+	FJobCounter 				MeshJobs;
+
+	// Handed back from jobs, picked up by Update.
+	std::mutex 					DoneMutex;
+	std::vector<FSectionEntry*> MeshedSections;
+
+	uint64 						NumMeshed 	= 0;
+};
@@ -0,0 +1,25 @@
+// Copyright Snaps 2022, All Rights Reserved.
+
+#version 450
+
+layout(location = 0) in vec3 InNormal;
+layout(location = 1) in vec2 InUV;
+layout(location = 2) in float InAO;
+layout(location = 3) flat in uint InLayer;
+
+layout(location = 0) out vec4 OutColor;
+
+const vec3 SunDirection = normalize(vec3(0.4, 1.0, 0.25));
+
+void main()
+{
+	// No block textures yet, each layer gets a flat colour with a faint voxel grid.
+	uint Hash = InLayer * 2654435761u;
+	vec3 Albedo = vec3((Hash >> 8) & 255u, (Hash >> 16) & 255u, (Hash >> 24) & 255u) / 255.0 * 0.6 + 0.3;
+	vec2 Cell = abs(fract(InUV) - 0.5);
+	float Grid = max(Cell.x, Cell.y) > 0.47 ? 0.85 : 1.0;
+
+	float Light = 0.35 + 0.65 * max(dot(InNormal, SunDirection), 0.0);
+	float Occlusion = mix(0.35, 1.0, InAO);
+	OutColor = vec4(Albedo * Light * Occlusion * Grid, 1.0);
+}
@@ -0,0 +1,44 @@
+// Copyright Snaps 2022, All Rights Reserved.
+
+#version 450
+
+// Unpacks FMeshVertex, see MeshTypes.h. Keep the bit layout in sync with PackVertex.
+layout(location = 0) in uvec2 InVertex;
+
+layout(push_constant) uniform FChunkPushConstants
+{
+	mat4 	ViewProjection;
+	vec4 	Origin; 			// World position of the mesh's first voxel, W unused.
+} Push;
+
+layout(location = 0) out vec3 OutNormal;
+layout(location = 1) out vec2 OutUV;
+layout(location = 2) out float OutAO;
+layout(location = 3) flat out uint OutLayer;
+
+// In EBlockFace order.
+const vec3 FaceNormals[6] = vec3[6](
+	vec3( 1.0,  0.0,  0.0),
+	vec3(-1.0,  0.0,  0.0),
+	vec3( 0.0,  1.0,  0.0),
+	vec3( 0.0, -1.0,  0.0),
+	vec3( 0.0,  0.0,  1.0),
+	vec3( 0.0,  0.0, -1.0)
+);
+
+void main()
+{
+	uint Packed = InVertex.x;
+	vec3 Position = vec3(Packed & 511u, (Packed >> 9) & 511u, (Packed >> 18) & 511u);
+	uint Face = (Packed >> 27) & 7u;
+
+	// Same axes as GetFaceAxes, textures tile once per voxel whatever the quad size.
+	uint NormalAxis = Face / 2u;
+	OutUV = vec2(Position[(NormalAxis + 1u) % 3u], Position[(NormalAxis + 2u) % 3u]);
+
+	OutNormal = FaceNormals[Face];
+	OutAO = float(Packed >> 30) / 3.0;
+	OutLayer = InVertex.y & 0xFFFFu;
+
+	gl_Position = Push.ViewProjection * vec4(Push.Origin.xyz + Position, 1.0);
+}
@@ -0,0 +1,384 @@
+// Copyright Snaps 2022, All Rights Reserved.
+
+#include "TlsfAllocator.h"
+#include "BitMath.h"
+
+void FTlsfAllocator::Initialize(uint64 InCapacity, uint64 InGranularity)
+{
+	Granularity = InGranularity;
+	GranularityLog2 = BitMath::CountTrailingZeros64(InGranularity);
+	Capacity = InCapacity & ~(Granularity - 1);
+	AllocatedBytes = 0;
+	NumAllocations = 0;
+
+	Nodes.clear();
+	UnusedNodes.clear();
+	FirstLevelBitmap = 0;
+	for(uint32 First = 0; First < NumFirstLevels; First++)
+	{
+		SecondLevelBitmaps[First] = 0;
+		for(uint32 Second = 0; Second < NumSecondLevels; Second++)
+		{
+			FreeHeads[First][Second] = InvalidNode;
+		}
+	}
+
+	// Start out with one free range covering everything.
+	const uint32 Node = NewNode();
+	Nodes[Node].Offset = 0;
+	Nodes[Node].Size = Capacity;
+	InsertFree(Node);
+}
+
+uint32 FTlsfAllocator::Allocate(uint64 Size, uint64 Alignment, uint64& OutOffset)
+{
+	Size = (Size + Granularity - 1) & ~(Granularity - 1);
+	if(Size == 0)
+	{
+		Size = Granularity;
+	}
+	if(Alignment < Granularity)
+	{
+		Alignment = Granularity;
+	}
+
+	// Over-ask by the worst case padding so any range in the found class can be aligned.
+	const uint64 SearchSize = Size + Alignment - Granularity;
+	if(SearchSize > Capacity)
+	{
+		return InvalidNode;
+	}
+
+	const uint32 Node = FindFree(SearchSize >> GranularityLog2);
+	if(Node == InvalidNode)
+	{
+		return InvalidNode;
+	}
+	RemoveFree(Node);
+
+	// Give the alignment padding at the front back as its own free range. The range before
+	// Node can't be free, free neighbours are always merged.
+	const uint64 AlignedOffset = (Nodes[Node].Offset + Alignment - 1) & ~(Alignment - 1);
+	const uint64 Padding = AlignedOffset - Nodes[Node].Offset;
+	if(Padding > 0)
+	{
+		const uint32 Front = NewNode();
+		Nodes[Front].Offset = Nodes[Node].Offset;
+		Nodes[Front].Size = Padding;
+		Nodes[Front].PrevPhysical = Nodes[Node].PrevPhysical;
+		Nodes[Front].NextPhysical = Node;
+		if(Nodes[Front].PrevPhysical != InvalidNode)
+		{
+			Nodes[Nodes[Front].PrevPhysical].NextPhysical = Front;
+		}
+
+		Nodes[Node].PrevPhysical = Front;
+		Nodes[Node].Offset = AlignedOffset;
+		Nodes[Node].Size -= Padding;
+		InsertFree(Front);
+	}
+
+	if(Nodes[Node].Size > Size)
+	{
+		SplitTail(Node, Nodes[Node].Size - Size);
+	}
+
+	Nodes[Node].bFree = false;
+	AllocatedBytes += Nodes[Node].Size;
+	NumAllocations++;
+
+	OutOffset = Nodes[Node].Offset;
+	return Node;
+}
+
+void FTlsfAllocator::Free(uint32 Node)
+{
+	AllocatedBytes -= Nodes[Node].Size;
+	NumAllocations--;
+	Nodes[Node].bFree = true;
+
+	// Merge with the free range before us, it takes our place.
+	const uint32 Prev = Nodes[Node].PrevPhysical;
+	if(Prev != InvalidNode && Nodes[Prev].bFree)
+	{
+		RemoveFree(Prev);
+		Nodes[Prev].Size += Nodes[Node].Size;
+		Nodes[Prev].NextPhysical = Nodes[Node].NextPhysical;
+		if(Nodes[Prev].NextPhysical != InvalidNode)
+		{
+			Nodes[Nodes[Prev].NextPhysical].PrevPhysical = Prev;
+		}
+
+		ReleaseNode(Node);
+		Node = Prev;
+	}
+
+	// And with the free range after us.
+	const uint32 Next = Nodes[Node].NextPhysical;
+	if(Next != InvalidNode && Nodes[Next].bFree)
+	{
+		RemoveFree(Next);
+		Nodes[Node].Size += Nodes[Next].Size;
+		Nodes[Node].NextPhysical = Nodes[Next].NextPhysical;
+		if(Nodes[Node].NextPhysical != InvalidNode)
+		{
+			Nodes[Nodes[Node].NextPhysical].PrevPhysical = Node;
+		}
+
+		ReleaseNode(Next);
+	}
+
+	InsertFree(Node);
+}
+
+uint64 FTlsfAllocator::GetLargestFreeRange() const
+{
+	if(FirstLevelBitmap == 0)
+	{
+		return 0;
+	}
+
+	// The largest range is somewhere in the highest non empty class.
+	const uint32 First = 63 - BitMath::CountLeadingZeros64(FirstLevelBitmap);
+	const uint32 Second = 63 - BitMath::CountLeadingZeros64(SecondLevelBitmaps[First]);
+
+	uint64 Largest = 0;
+	for(uint32 Node = FreeHeads[First][Second]; Node != InvalidNode; Node = Nodes[Node].NextFree)
+	{
+		Largest = Nodes[Node].Size > Largest ? Nodes[Node].Size : Largest;
+	}
+	return Largest;
+}
+
+bool FTlsfAllocator::Validate() const
+{
+	uint64 Covered = 0;
+	uint64 Allocated = 0;
+	uint32 NumAllocated = 0;
+	uint32 NumFree = 0;
+	uint32 Prev = InvalidNode;
+
+	// Find the first range, the one without a physical predecessor.
+	uint32 Node = InvalidNode;
+	for(uint32 Index = 0; Index < Nodes.size(); Index++)
+	{
+		if(Nodes[Index].Size > 0 && Nodes[Index].PrevPhysical == InvalidNode)
+		{
+			Node = Index;
+			break;
+		}
+	}
+
+	// Ranges must tile the whole capacity in order, with no two free ranges side by side.
+	for(; Node != InvalidNode; Node = Nodes[Node].NextPhysical)
+	{
+		const FNode& Range = Nodes[Node];
+		if(Range.Offset != Covered || Range.PrevPhysical != Prev || Range.Size == 0)
+		{
+			return false;
+		}
+		if(Range.bFree && Prev != InvalidNode && Nodes[Prev].bFree)
+		{
+			return false;
+		}
+
+		if(Range.bFree)
+		{
+			NumFree++;
+		}
+		else
+		{
+			Allocated += Range.Size;
+			NumAllocated++;
+		}
+
+		Covered += Range.Size;
+		Prev = Node;
+	}
+
+	if(Covered != Capacity || Allocated != AllocatedBytes || NumAllocated != NumAllocations)
+	{
+		return false;
+	}
+
+	// Every free range must be in the list for its class, and the bitmaps must match the lists.
+	uint32 NumListed = 0;
+	for(uint32 First = 0; First < NumFirstLevels; First++)
+	{
+		for(uint32 Second = 0; Second < NumSecondLevels; Second++)
+		{
+			const bool bHasBit = (SecondLevelBitmaps[First] & (1u << Second)) != 0;
+			if(bHasBit != (FreeHeads[First][Second] != InvalidNode))
+			{
+				return false;
+			}
+
+			for(uint32 Free = FreeHeads[First][Second]; Free != InvalidNode; Free = Nodes[Free].NextFree)
+			{
+				uint32 RangeFirst, RangeSecond;
+				MapSize(Nodes[Free].Size >> GranularityLog2, RangeFirst, RangeSecond);
+				if(!Nodes[Free].bFree || RangeFirst != First || RangeSecond != Second)
+				{
+					return false;
+				}
+				NumListed++;
+			}
+		}
+
+		if(((FirstLevelBitmap >> First) & 1) != (SecondLevelBitmaps[First] != 0 ? 1u : 0u))
+		{
+			return false;
+		}
+	}
+
+	return NumListed == NumFree;
+}
+
+void FTlsfAllocator::MapSize(uint64 Units, uint32& OutFirst, uint32& OutSecond)
+{
+	// Small sizes get one class per granule, above that each power of two splits into 16.
+	if(Units < NumSecondLevels)
+	{
+		OutFirst = 0;
+		OutSecond = (uint32)Units;
+		return;
+	}
+
+	const uint32 HighBit = 63 - BitMath::CountLeadingZeros64(Units);
+	OutFirst = HighBit - NumSecondLevelsLog2 + 1;
+	OutSecond = (uint32)(Units >> (HighBit - NumSecondLevelsLog2)) & (NumSecondLevels - 1);
+}
+
+uint32 FTlsfAllocator::FindFree(uint64 Units) const
+{
+	// Round up to the next class boundary, so whatever we find is big enough without a list walk.
+	if(Units >= NumSecondLevels)
+	{
+		const uint32 HighBit = 63 - BitMath::CountLeadingZeros64(Units);
+		Units += (1ull << (HighBit - NumSecondLevelsLog2)) - 1;
+	}
+
+	uint32 First, Second;
+	MapSize(Units, First, Second);
+	if(First >= NumFirstLevels)
+	{
+		return InvalidNode;
+	}
+
+	// Same first level, same or bigger second level class.
+	uint32 SecondBits = SecondLevelBitmaps[First] & (~0u << Second);
+	if(SecondBits == 0)
+	{
+		// Otherwise the smallest class of any bigger first level.
+		const uint64 FirstBits = First + 1 < 64 ? FirstLevelBitmap & (~0ull << (First + 1)) : 0;
+		if(FirstBits == 0)
+		{
+			return InvalidNode;
+		}
+
+		First = BitMath::CountTrailingZeros64(FirstBits);
+		SecondBits = SecondLevelBitmaps[First];
+	}
+
+	Second = BitMath::CountTrailingZeros64(SecondBits);
+	return FreeHeads[First][Second];
+}
+
+void FTlsfAllocator::InsertFree(uint32 Node)
+{
+	uint32 First, Second;
+	MapSize(Nodes[Node].Size >> GranularityLog2, First, Second);
+
+	const uint32 Head = FreeHeads[First][Second];
+	Nodes[Node].bFree = true;
+	Nodes[Node].PrevFree = InvalidNode;
+	Nodes[Node].NextFree = Head;
+	if(Head != InvalidNode)
+	{
+		Nodes[Head].PrevFree = Node;
+	}
+
+	FreeHeads[First][Second] = Node;
+	SecondLevelBitmaps[First] |= 1u << Second;
+	FirstLevelBitmap |= 1ull << First;
+}
+
+void FTlsfAllocator::RemoveFree(uint32 Node)
+{
+	uint32 First, Second;
+	MapSize(Nodes[Node].Size >> GranularityLog2, First, Second);
+
+	const uint32 Prev = Nodes[Node].PrevFree;
+	const uint32 Next = Nodes[Node].NextFree;
+	if(Prev != InvalidNode)
+	{
+		Nodes[Prev].NextFree = Next;
+	}
+	else
+	{
+		FreeHeads[First][Second] = Next;
+	}
+	if(Next != InvalidNode)
+	{
+		Nodes[Next].PrevFree = Prev;
+	}
+
+	if(FreeHeads[First][Second] == InvalidNode)
+	{
+		SecondLevelBitmaps[First] &= ~(1u << Second);
+		if(SecondLevelBitmaps[First] == 0)
+		{
+			FirstLevelBitmap &= ~(1ull << First);
+		}
+	}
+}
+
+void FTlsfAllocator::SplitTail(uint32 Node, uint64 Size)
+{
+	// The range after Node can't be free either, so the tail is never merged here.
+	const uint32 Tail = NewNode();
+	Nodes[Tail].Offset = Nodes[Node].Offset + Nodes[Node].Size - Size;
+	Nodes[Tail].Size = Size;
+	Nodes[Tail].PrevPhysical = Node;
+	Nodes[Tail].NextPhysical = Nodes[Node].NextPhysical;
+	if(Nodes[Tail].NextPhysical != InvalidNode)
+	{
+		Nodes[Nodes[Tail].NextPhysical].PrevPhysical = Tail;
+	}
+
+	Nodes[Node].NextPhysical = Tail;
+	Nodes[Node].Size -= Size;
+	InsertFree(Tail);
+}
+
+uint32 FTlsfAllocator::NewNode()
+{
+	uint32 Node;
+	if(!UnusedNodes.empty())
+	{
+		Node = UnusedNodes.back();
+		UnusedNodes.pop_back();
+	}
+	else
+	{
+		Node = (uint32)Nodes.size();
+		Nodes.push_back(FNode());
+	}
+
+	Nodes[Node].Offset = 0;
+	Nodes[Node].Size = 0;
+	Nodes[Node].PrevPhysical = InvalidNode;
+	Nodes[Node].NextPhysical = InvalidNode;
+	Nodes[Node].PrevFree = InvalidNode;
+	Nodes[Node].NextFree = InvalidNode;
+	Nodes[Node].bFree = false;
+	return Node;
+}
+
+void FTlsfAllocator::ReleaseNode(uint32 Node)
+{
+	// Zero size marks the node as unused for Validate.
+	Nodes[Node].Size = 0;
+	Nodes[Node].PrevPhysical = InvalidNode;
+	UnusedNodes.push_back(Node);
+}
@@ -0,0 +1,110 @@
+// Copyright Snaps 2022, All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include <vector>
+
+/*
+	Two level segregated fit range allocator. Hands out offsets into a range of
+	Capacity bytes in O(1): free ranges are binned by size class, a power of two
+	first level split into 16 linear second level classes, and two bitmaps find
+	the smallest non empty class that fits. Freed ranges merge with free
+	neighbours straight away so there are never two free ranges side by side.
+
+	Only manages offsets, the memory itself lives somewhere else (usually a GPU
+	memory block), which keeps it trivial to test without a device.
+*/
+class FTlsfAllocator
+{
+public:
+
+	static const uint32 InvalidNode = 0xFFFFFFFF;
+
+	// Granularity must be a power of two, every offset and size is rounded to it.
+	void Initialize(uint64 InCapacity, uint64 InGranularity = 16);
+
+	// Returns the node owning the range, or InvalidNode if no free range fits.
+	uint32 Allocate(uint64 Size, uint64 Alignment, uint64& OutOffset);
+	void Free(uint32 Node);
+
+	uint64 GetOffset(uint32 Node) const
+	{
+		return Nodes[Node].Offset;
+	}
+
+	uint64 GetSize(uint32 Node) const
+	{
+		return Nodes[Node].Size;
+	}
+
+	uint64 GetCapacity() const
+	{
+		return Capacity;
+	}
+
+	uint64 GetAllocatedBytes() const
+	{
+		return AllocatedBytes;
+	}
+
+	uint32 GetNumAllocations() const
+	{
+		return NumAllocations;
+	}
+
+	bool IsEmpty() const
+	{
+		return NumAllocations == 0;
+	}
+
+	uint64 GetLargestFreeRange() const;
+
+	// Walks every range and checks the bookkeeping, slow, for tests and debugging.
+	bool Validate() const;
+
+private:
+
+	static const uint32 NumSecondLevelsLog2 = 4;
+	static const uint32 NumSecondLevels 	= 1 << NumSecondLevelsLog2;
+	static const uint32 NumFirstLevels 		= 64 - NumSecondLevelsLog2 + 1;
+
+	struct FNode
+	{
+		uint64 	Offset;
+		uint64 	Size;
+		uint32 	PrevPhysical;
+		uint32 	NextPhysical;
+		uint32 	PrevFree;
+		uint32 	NextFree;
+		bool 	bFree;
+	};
+
+	// Size class of a range of Units granules.
+	static void MapSize(uint64 Units, uint32& OutFirst, uint32& OutSecond);
+
+	// Smallest non empty class whose every range holds at least Units granules.
+	uint32 FindFree(uint64 Units) const;
+
+	void InsertFree(uint32 Node);
+	void RemoveFree(uint32 Node);
+
+	// Splits Size bytes off the end of Node into a new free range.
+	void SplitTail(uint32 Node, uint64 Size);
+
+	uint32 NewNode();
+	void ReleaseNode(uint32 Node);
+
+	std::vector<FNode> 	Nodes;
+	std::vector<uint32> UnusedNodes;
+
+	uint64 	FirstLevelBitmap 					= 0;
+	uint32 	SecondLevelBitmaps[NumFirstLevels] 	= {};
+	uint32 	FreeHeads[NumFirstLevels][NumSecondLevels];
+
+	uint64 	Capacity 		= 0;
+	uint64 	Granularity 	= 16;
+	uint32 	GranularityLog2 = 4;
+	uint64 	AllocatedBytes 	= 0;
+	uint32 	NumAllocations 	= 0;
+};
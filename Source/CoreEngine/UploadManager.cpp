@@ -0,0 +1,273 @@
+// Copyright Snaps 2022, All Rights Reserved.
+
+#include "UploadManager.h"
+#include "VulkanHelpers.h"
+#include <cstring>
+
+// Staging allocations are kept 16 byte aligned, plenty for buffer copies and cheap to waste.
+static const VkDeviceSize StagingAlignment = 16;
+
+void FUploadManager::Initialize(
+	VkDevice InDevice,
+	VkPhysicalDevice PhysicalDevice,
+	VkQueue TransferQueue,
+	uint32 TransferFamily,
+	uint32 GraphicsFamily,
+	VkDeviceSize InStagingSize)
+{
+	Device = InDevice;
+	Queue = TransferQueue;
+	QueueFamilies[0] = TransferFamily;
+	QueueFamilies[1] = GraphicsFamily;
+	StagingSize = InStagingSize;
+
+	// Command buffers are recycled one by one as their submission completes.
+	VkCommandPoolCreateInfo CommandPoolInfo {};
+	CommandPoolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+	CommandPoolInfo.queueFamilyIndex = TransferFamily;
+	CommandPoolInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT | VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
+
+	VK_CHECK(vkCreateCommandPool(Device, &CommandPoolInfo, nullptr, &CommandPool));
+
+	// Timeline semaphore counts finished upload batches, the graphics queue waits on it.
+	VkSemaphoreTypeCreateInfo TimelineInfo {};
+	TimelineInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO;
+	TimelineInfo.semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE;
+	TimelineInfo.initialValue = 0;
+
+	VkSemaphoreCreateInfo SemaphoreInfo {};
+	SemaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+	SemaphoreInfo.pNext = &TimelineInfo;
+
+	VK_CHECK(vkCreateSemaphore(Device, &SemaphoreInfo, nullptr, &TimelineSemaphore));
+
+	// Staging ring, host visible and coherent so it can stay mapped with no flushes.
+	VkBufferCreateInfo BufferInfo {};
+	BufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+	BufferInfo.size = StagingSize;
+	BufferInfo.usage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
+	BufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+	VK_CHECK(vkCreateBuffer(Device, &BufferInfo, nullptr, &StagingBuffer));
+
+	VkMemoryRequirements Requirements;
+	vkGetBufferMemoryRequirements(Device, StagingBuffer, &Requirements);
+
+	VkMemoryAllocateInfo AllocInfo {};
+	AllocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+	AllocInfo.allocationSize = Requirements.size;
+	AllocInfo.memoryTypeIndex = VulkanHelpers::FindMemoryType(
+		PhysicalDevice,
+		Requirements.memoryTypeBits,
+		VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT
+	);
+
+	VK_CHECK(vkAllocateMemory(Device, &AllocInfo, nullptr, &StagingMemory));
+	VK_CHECK(vkBindBufferMemory(Device, StagingBuffer, StagingMemory, 0));
+	VK_CHECK(vkMapMemory(Device, StagingMemory, 0, VK_WHOLE_SIZE, 0, (void**)&StagingData));
+}
+
+void FUploadManager::Shutdown()
+{
+	// Renderer has waited for the device to go idle, nothing here is in use anymore.
+	InFlight.clear();
+	PendingCopies.clear();
+	FreeCommandBuffers.clear();
+
+	vkUnmapMemory(Device, StagingMemory);
+	vkDestroyBuffer(Device, StagingBuffer, nullptr);
+	vkFreeMemory(Device, StagingMemory, nullptr);
+
+	vkDestroySemaphore(Device, TimelineSemaphore, nullptr);
+	vkDestroyCommandPool(Device, CommandPool, nullptr);
+}
+
+bool FUploadManager::UploadBuffer(VkBuffer DstBuffer, VkDeviceSize DstOffset, const void* Data, VkDeviceSize Size)
+{
+	uint64 Cursor = AllocateStaging(Size);
+	if(Cursor == UINT64_MAX)
+	{
+		// Free up whatever the transfer queue already finished and try once more.
+		RetireCompleted();
+		Cursor = AllocateStaging(Size);
+		if(Cursor == UINT64_MAX)
+		{
+			return false;
+		}
+	}
+
+	const VkDeviceSize Offset = Cursor % StagingSize;
+	std::memcpy(StagingData + Offset, Data, (size_t)Size);
+
+	FPendingCopy Copy;
+	Copy.DstBuffer = DstBuffer;
+	Copy.Region.srcOffset = Offset;
+	Copy.Region.dstOffset = DstOffset;
+	Copy.Region.size = Size;
+	PendingCopies.push_back(Copy);
+	return true;
+}
+
+uint64 FUploadManager::Submit()
+{
+	RetireCompleted();
+
+	if(PendingCopies.empty())
+	{
+		return LastSubmittedValue;
+	}
+
+	VkCommandBuffer CommandBuffer = GetCommandBuffer();
+
+	VkCommandBufferBeginInfo BeginInfo {};
+	BeginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+	BeginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+
+	VK_CHECK(vkBeginCommandBuffer(CommandBuffer, &BeginInfo));
+
+	// Batch consecutive copies into the same buffer into one command.
+	size_t First = 0;
+	while(First < PendingCopies.size())
+	{
+		size_t Last = First + 1;
+		while(Last < PendingCopies.size() && PendingCopies[Last].DstBuffer == PendingCopies[First].DstBuffer)
+		{
+			Last++;
+		}
+
+		// Gather the regions in small batches on the stack, vkCmdCopyBuffer wants them in an array.
+		VkBufferCopy Regions[64];
+		size_t Index = First;
+		while(Index < Last)
+		{
+			uint32 NumRegions = 0;
+			for(; Index < Last && NumRegions < 64; Index++)
+			{
+				Regions[NumRegions++] = PendingCopies[Index].Region;
+			}
+			vkCmdCopyBuffer(CommandBuffer, StagingBuffer, PendingCopies[First].DstBuffer, NumRegions, Regions);
+		}
+
+		First = Last;
+	}
+
+	VK_CHECK(vkEndCommandBuffer(CommandBuffer));
+
+	// Signal the next timeline value once the copies land, graphics submits wait on it.
+	const uint64 SignalValue = LastSubmittedValue + 1;
+
+	VkTimelineSemaphoreSubmitInfo TimelineInfo {};
+	TimelineInfo.sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO;
+	TimelineInfo.signalSemaphoreValueCount = 1;
+	TimelineInfo.pSignalSemaphoreValues = &SignalValue;
+
+	VkSubmitInfo SubmitInfo {};
+	SubmitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+	SubmitInfo.pNext = &TimelineInfo;
+	SubmitInfo.commandBufferCount = 1;
+	SubmitInfo.pCommandBuffers = &CommandBuffer;
+	SubmitInfo.signalSemaphoreCount = 1;
+	SubmitInfo.pSignalSemaphores = &TimelineSemaphore;
+
+	VK_CHECK(vkQueueSubmit(Queue, 1, &SubmitInfo, VK_NULL_HANDLE));
+
+	FSubmission Submission;
+	Submission.TimelineValue = SignalValue;
+	Submission.RingEnd = RingWrite;
+	Submission.CommandBuffer = CommandBuffer;
+	InFlight.push_back(Submission);
+
+	PendingCopies.clear();
+	LastSubmittedValue = SignalValue;
+	return LastSubmittedValue;
+}
+
+void FUploadManager::RetireCompleted()
+{
+	if(InFlight.empty())
+	{
+		return;
+	}
+
+	uint64 CompletedValue = 0;
+	VK_CHECK(vkGetSemaphoreCounterValue(Device, TimelineSemaphore, &CompletedValue));
+
+	// Submissions complete in order, so the ring frees up from the read cursor forwards.
+	while(!InFlight.empty() && InFlight.front().TimelineValue <= CompletedValue)
+	{
+		RingRead = InFlight.front().RingEnd;
+		FreeCommandBuffers.push_back(InFlight.front().CommandBuffer);
+		InFlight.pop_front();
+	}
+}
+
+bool FUploadManager::IsComplete(uint64 TimelineValue) const
+{
+	uint64 CompletedValue = 0;
+	VK_CHECK(vkGetSemaphoreCounterValue(Device, TimelineSemaphore, &CompletedValue));
+	return CompletedValue >= TimelineValue;
+}
+
+void FUploadManager::SetupBufferSharing(VkBufferCreateInfo& BufferInfo) const
+{
+	// Concurrent sharing avoids queue family ownership transfers, the timeline wait is all the sync needed.
+	if(HasSeparateTransferQueue())
+	{
+		BufferInfo.sharingMode = VK_SHARING_MODE_CONCURRENT;
+		BufferInfo.queueFamilyIndexCount = 2;
+		BufferInfo.pQueueFamilyIndices = QueueFamilies;
+	}
+	else
+	{
+		BufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+		BufferInfo.queueFamilyIndexCount = 0;
+		BufferInfo.pQueueFamilyIndices = nullptr;
+	}
+	BufferInfo.usage |= VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+}
+
+uint64 FUploadManager::AllocateStaging(VkDeviceSize Size)
+{
+	const uint64 AlignedSize = (Size + StagingAlignment - 1) & ~(StagingAlignment - 1);
+	if(AlignedSize > StagingSize)
+	{
+		return UINT64_MAX;
+	}
+
+	// Allocations never straddle the end of the ring, skip to the start instead.
+	uint64 Cursor = RingWrite;
+	const uint64 Offset = Cursor % StagingSize;
+	if(Offset + AlignedSize > StagingSize)
+	{
+		Cursor += StagingSize - Offset;
+	}
+
+	if(Cursor + AlignedSize - RingRead > StagingSize)
+	{
+		return UINT64_MAX;
+	}
+
+	RingWrite = Cursor + AlignedSize;
+	return Cursor;
+}
+
+VkCommandBuffer FUploadManager::GetCommandBuffer()
+{
+	VkCommandBuffer CommandBuffer = VK_NULL_HANDLE;
+	if(!FreeCommandBuffers.empty())
+	{
+		CommandBuffer = FreeCommandBuffers.back();
+		FreeCommandBuffers.pop_back();
+		VK_CHECK(vkResetCommandBuffer(CommandBuffer, 0));
+		return CommandBuffer;
+	}
+
+	VkCommandBufferAllocateInfo AllocInfo {};
+	AllocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+	AllocInfo.commandPool = CommandPool;
+	AllocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+	AllocInfo.commandBufferCount = 1;
+
+	VK_CHECK(vkAllocateCommandBuffers(Device, &AllocInfo, &CommandBuffer));
+	return CommandBuffer;
+}
@@ -0,0 +1,115 @@
+// Copyright Snaps 2022, All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "vulkan.h"
+#include <deque>
+#include <vector>
+
+/*
+	Streams buffer data to the GPU through a persistently mapped staging ring.
+	Uploads are copied into the ring straight away and the copies are recorded
+	and submitted to the transfer queue once per frame. Completion is tracked
+	with a timeline semaphore which the graphics submit waits on, so the render
+	thread never blocks on an upload and staging space is reclaimed as soon as
+	the transfer queue gets through it.
+
+	On devices without a separate transfer family (lavapipe, most integrated
+	GPUs) the graphics queue is used instead and everything else stays the same.
+	Destination buffers must be created with SetupBufferSharing so they can be
+	written by the transfer family and read by the graphics family without
+	ownership transfers.
+
+	Not thread safe, uploads are queued and submitted from the render thread.
+*/
+class FUploadManager
+{
+public:
+
+	void Initialize(
+		VkDevice Device,
+		VkPhysicalDevice PhysicalDevice,
+		VkQueue TransferQueue,
+		uint32 TransferFamily,
+		uint32 GraphicsFamily,
+		VkDeviceSize StagingSize
+	);
+	void Shutdown();
+
+	// Copies Size bytes of Data into the staging ring and queues a copy to DstBuffer.
+	// Returns false if the ring has no room right now, the caller should retry next frame.
+	bool UploadBuffer(VkBuffer DstBuffer, VkDeviceSize DstOffset, const void* Data, VkDeviceSize Size);
+
+	// Submits every queued copy to the transfer queue. Returns the timeline value the graphics
+	// queue has to wait for before it may read anything uploaded so far.
+	uint64 Submit();
+
+	// Reclaims staging space from submissions the GPU has finished, never blocks.
+	void RetireCompleted();
+
+	bool IsComplete(uint64 TimelineValue) const;
+
+	// Fills in the sharing mode and queue families for a buffer that uploads will write to.
+	void SetupBufferSharing(VkBufferCreateInfo& BufferInfo) const;
+
+	VkSemaphore GetTimelineSemaphore() const
+	{
+		return TimelineSemaphore;
+	}
+
+	uint64 GetLastSubmittedValue() const
+	{
+		return LastSubmittedValue;
+	}
+
+	bool HasSeparateTransferQueue() const
+	{
+		return QueueFamilies[0] != QueueFamilies[1];
+	}
+
+	VkDeviceSize GetStagingBytesInUse() const
+	{
+		return RingWrite - RingRead;
+	}
+
+private:
+
+	struct FPendingCopy
+	{
+		VkBuffer		DstBuffer;
+		VkBufferCopy	Region;
+	};
+
+	struct FSubmission
+	{
+		uint64			TimelineValue;
+		uint64			RingEnd;		// Ring write cursor at submit, everything before it is free once complete.
+		VkCommandBuffer CommandBuffer;
+	};
+
+	// Absolute ring cursor of Size free bytes, or UINT64_MAX if the ring is too full.
+	uint64 AllocateStaging(VkDeviceSize Size);
+
+	VkCommandBuffer GetCommandBuffer();
+
+	VkDevice 					Device 				= VK_NULL_HANDLE;
+	VkQueue 					Queue 				= VK_NULL_HANDLE;
+	uint32						QueueFamilies[2] 	= {}; 	// Transfer then graphics family.
+	VkCommandPool				CommandPool 		= VK_NULL_HANDLE;
+	std::vector<VkCommandBuffer> FreeCommandBuffers;
+
+	VkSemaphore					TimelineSemaphore 	= VK_NULL_HANDLE;
+	uint64						LastSubmittedValue 	= 0;
+	std::deque<FSubmission>		InFlight;
+	std::vector<FPendingCopy>	PendingCopies;
+
+	VkBuffer					StagingBuffer 		= VK_NULL_HANDLE;
+	VkDeviceMemory				StagingMemory 		= VK_NULL_HANDLE;
+	uint8*						StagingData 		= nullptr;
+	VkDeviceSize				StagingSize 		= 0;
+
+	// Monotonic byte cursors into the ring, the offset in the buffer is cursor % StagingSize.
+	uint64						RingWrite 			= 0;
+	uint64						RingRead 			= 0;
+};
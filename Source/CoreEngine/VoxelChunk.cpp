@@ -0,0 +1,406 @@
+// Copyright Snaps 2022, All Rights Reserved.
+
+#include "VoxelChunk.h"
+#include <algorithm>
+
+// Largest palette before we give up on it and store block ids directly.
+static const uint32 MaxPaletteSize = 256;
+
+// Smallest supported index width able to address PaletteSize entries.
+static uint32 GetBitsForPaletteSize(uint32 PaletteSize)
+{
+	if(PaletteSize <= 1) return 0;
+	if(PaletteSize <= 2) return 1;
+	if(PaletteSize <= 4) return 2;
+	if(PaletteSize <= 16) return 4;
+	if(PaletteSize <= MaxPaletteSize) return 8;
+	return 16;
+}
+
+static uint8 GetWidthLog2(uint32 BitsPerIndex)
+{
+	uint8 WidthLog2 = 0;
+	while((1u << WidthLog2) < BitsPerIndex)
+	{
+		WidthLog2++;
+	}
+	return WidthLog2;
+}
+
+// Scratch palette indices used while building a chunk from dense data.
+static thread_local uint16 GDenseScratch[ChunkVolume];
+
+FVoxelChunk::FVoxelChunk(FBlockId FillValue)
+	: BitsPerIndex(0)
+	, IndexWidthLog2(0)
+	, UniformLight(0)
+{
+	Fill(FillValue);
+}
+
+void FVoxelChunk::Set(int32 Index, FBlockId Value)
+{
+	if(IsDirect())
+	{
+		WriteIndex(Index, Value);
+		return;
+	}
+
+	const uint32 OldEntry = BitsPerIndex ? ReadIndex(Index) : 0;
+	if(Palette[OldEntry] == Value)
+	{
+		return;
+	}
+
+	// May widen the indices or switch the chunk to direct storage.
+	const uint32 NewEntry = FindOrAddPaletteEntry(Value);
+	if(IsDirect())
+	{
+		WriteIndex(Index, Value);
+		return;
+	}
+
+	PaletteCounts[OldEntry]--;
+	PaletteCounts[NewEntry]++;
+	WriteIndex(Index, NewEntry);
+
+	// Every voxel is now the same block, collapse back down to a single value.
+	if(PaletteCounts[NewEntry] == ChunkVolume)
+	{
+		Fill(Value);
+	}
+}
+
+void FVoxelChunk::Fill(FBlockId Value)
+{
+	Palette.assign(1, Value);
+	PaletteCounts.assign(1, (uint16)ChunkVolume);
+	std::vector<uint64>().swap(Data);
+	BitsPerIndex = 0;
+	IndexWidthLog2 = 0;
+}
+
+void FVoxelChunk::FillLight(uint8 Light)
+{
+	UniformLight = Light;
+	std::vector<uint8>().swap(LightData);
+}
+
+void FVoxelChunk::CopyToDense(FBlockId* OutBlocks) const
+{
+	if(IsUniform())
+	{
+		for(int32 Index = 0; Index < ChunkVolume; Index++)
+		{
+			OutBlocks[Index] = Palette[0];
+		}
+		return;
+	}
+
+	// Decode a whole word at a time rather than voxel by voxel.
+	const uint32 PerWord = 64 >> IndexWidthLog2;
+	const uint64 Mask = (1ull << BitsPerIndex) - 1;
+	const bool bDirect = IsDirect();
+
+	for(size_t WordIndex = 0; WordIndex < Data.size(); WordIndex++)
+	{
+		uint64 Word = Data[WordIndex];
+		FBlockId* Out = OutBlocks + WordIndex * PerWord;
+
+		for(uint32 Entry = 0; Entry < PerWord; Entry++)
+		{
+			const uint32 Value = (uint32)(Word & Mask);
+			Out[Entry] = bDirect ? (FBlockId)Value : Palette[Value];
+			Word >>= BitsPerIndex;
+		}
+	}
+}
+
+void FVoxelChunk::CopyRun(int32 Index, int32 Count, FBlockId* OutBlocks) const
+{
+	if(IsUniform())
+	{
+		std::fill(OutBlocks, OutBlocks + Count, Palette[0]);
+		return;
+	}
+
+	const uint32 Shift = IndexShift();
+	const uint32 PerWord = 1u << Shift;
+	const uint64 Mask = (1ull << BitsPerIndex) - 1;
+	const bool bDirect = IsDirect();
+
+	uint32 Entry = (uint32)Index;
+	while(Count > 0)
+	{
+		const uint32 InWord = Entry & (PerWord - 1);
+		const int32 NumEntries = std::min((int32)(PerWord - InWord), Count);
+		uint64 Word = Data[Entry >> Shift] >> (InWord * BitsPerIndex);
+
+		for(int32 Offset = 0; Offset < NumEntries; Offset++)
+		{
+			const uint32 Value = (uint32)(Word & Mask);
+			*OutBlocks++ = bDirect ? (FBlockId)Value : Palette[Value];
+			Word >>= BitsPerIndex;
+		}
+		Entry += NumEntries;
+		Count -= NumEntries;
+	}
+}
+
+void FVoxelChunk::SetFromDense(const FBlockId* Blocks)
+{
+	Palette.clear();
+	PaletteCounts.clear();
+
+	// Build the palette, terrain has long runs of the same block so cache the last hit.
+	FBlockId LastValue = Blocks[0];
+	uint32 LastEntry = 0;
+	Palette.push_back(LastValue);
+	PaletteCounts.push_back(0);
+
+	bool bDirect = false;
+	for(int32 Index = 0; Index < ChunkVolume && !bDirect; Index++)
+	{
+		const FBlockId Value = Blocks[Index];
+		if(Value != LastValue)
+		{
+			uint32 Entry = 0;
+			while(Entry < Palette.size() && Palette[Entry] != Value)
+			{
+				Entry++;
+			}
+
+			if(Entry == Palette.size())
+			{
+				if(Palette.size() == MaxPaletteSize)
+				{
+					bDirect = true;
+					break;
+				}
+
+				Palette.push_back(Value);
+				PaletteCounts.push_back(0);
+			}
+
+			LastValue = Value;
+			LastEntry = Entry;
+		}
+
+		GDenseScratch[Index] = (uint16)LastEntry;
+		PaletteCounts[LastEntry]++;
+	}
+
+	// Too many distinct ids for a palette to pay off, store them raw.
+	if(bDirect)
+	{
+		Palette.clear();
+		PaletteCounts.clear();
+		BitsPerIndex = 16;
+		IndexWidthLog2 = 4;
+		std::vector<uint64>(ChunkVolume / 4, 0).swap(Data);
+
+		for(int32 Index = 0; Index < ChunkVolume; Index++)
+		{
+			WriteIndex(Index, Blocks[Index]);
+		}
+		return;
+	}
+
+	if(Palette.size() == 1)
+	{
+		Fill(Palette[0]);
+		return;
+	}
+
+	BitsPerIndex = (uint8)GetBitsForPaletteSize((uint32)Palette.size());
+	IndexWidthLog2 = GetWidthLog2(BitsPerIndex);
+	std::vector<uint64>(ChunkVolume * BitsPerIndex / 64, 0).swap(Data);
+
+	// Pack a whole word at a time, highest entry first so entry 0 ends up in the low bits.
+	const uint32 PerWord = 64 >> IndexWidthLog2;
+	for(size_t WordIndex = 0; WordIndex < Data.size(); WordIndex++)
+	{
+		const uint16* Entries = GDenseScratch + WordIndex * PerWord;
+		uint64 Word = 0;
+		for(uint32 Entry = PerWord; Entry-- > 0;)
+		{
+			Word = (Word << BitsPerIndex) | Entries[Entry];
+		}
+		Data[WordIndex] = Word;
+	}
+}
+
+void FVoxelChunk::Compact()
+{
+	if(IsUniform())
+	{
+		return;
+	}
+
+	// Direct chunks don't track counts, rebuilding from dense finds the real palette.
+	if(IsDirect())
+	{
+		std::vector<FBlockId> Blocks(ChunkVolume);
+		CopyToDense(Blocks.data());
+		SetFromDense(Blocks.data());
+		return;
+	}
+
+	// Map old palette entries onto a palette without unused entries.
+	std::vector<uint32> Remap(Palette.size(), 0);
+	std::vector<FBlockId> NewPalette;
+	std::vector<uint16> NewCounts;
+
+	for(size_t Entry = 0; Entry < Palette.size(); Entry++)
+	{
+		if(PaletteCounts[Entry] > 0)
+		{
+			Remap[Entry] = (uint32)NewPalette.size();
+			NewPalette.push_back(Palette[Entry]);
+			NewCounts.push_back(PaletteCounts[Entry]);
+		}
+	}
+
+	if(NewPalette.size() == 1)
+	{
+		Fill(NewPalette[0]);
+		return;
+	}
+
+	if(NewPalette.size() == Palette.size())
+	{
+		return;
+	}
+
+	Repack(GetBitsForPaletteSize((uint32)NewPalette.size()), &Remap);
+	Palette.swap(NewPalette);
+	PaletteCounts.swap(NewCounts);
+}
+
+size_t FVoxelChunk::GetMemoryUsage() const
+{
+	return sizeof(FVoxelChunk)
+		+ Palette.capacity() * sizeof(FBlockId)
+		+ PaletteCounts.capacity() * sizeof(uint16)
+		+ Data.capacity() * sizeof(uint64)
+		+ LightData.capacity();
+}
+
+bool FVoxelChunk::ResetStorage(uint32 InBitsPerIndex, uint32 PaletteSize, FBlockId*& OutPalette, uint16*& OutPaletteCounts, uint64*& OutData)
+{
+	const bool bValidWidth = InBitsPerIndex == 0 || InBitsPerIndex == 1 || InBitsPerIndex == 2 || InBitsPerIndex == 4
+		|| InBitsPerIndex == 8 || InBitsPerIndex == 16;
+	if(!bValidWidth)
+	{
+		return false;
+	}
+
+	// Uniform chunks have exactly one entry, direct ones none, the rest as many as their indices can address.
+	const uint32 MaxEntries = InBitsPerIndex == 16 ? 0 : std::min(1u << InBitsPerIndex, MaxPaletteSize);
+	const uint32 MinEntries = InBitsPerIndex == 16 ? 0 : 1;
+	if(PaletteSize < MinEntries || PaletteSize > MaxEntries)
+	{
+		return false;
+	}
+
+	Palette.resize(PaletteSize);
+	PaletteCounts.resize(PaletteSize);
+	Data.resize(ChunkVolume * InBitsPerIndex / 64);
+	BitsPerIndex = (uint8)InBitsPerIndex;
+	IndexWidthLog2 = GetWidthLog2(InBitsPerIndex);
+
+	OutPalette = Palette.data();
+	OutPaletteCounts = PaletteCounts.data();
+	OutData = Data.data();
+	return true;
+}
+
+uint32 FVoxelChunk::FindOrAddPaletteEntry(FBlockId Value)
+{
+	// Reuse the existing entry, or the first entry no voxel references anymore.
+	uint32 FreeEntry = (uint32)Palette.size();
+	for(uint32 Entry = 0; Entry < Palette.size(); Entry++)
+	{
+		if(Palette[Entry] == Value)
+		{
+			return Entry;
+		}
+
+		if(PaletteCounts[Entry] == 0 && FreeEntry == Palette.size())
+		{
+			FreeEntry = Entry;
+		}
+	}
+
+	if(FreeEntry < Palette.size())
+	{
+		Palette[FreeEntry] = Value;
+		return FreeEntry;
+	}
+
+	// Palette is full for the current index width, widen it.
+	if(Palette.size() >= (1u << BitsPerIndex))
+	{
+		if(Palette.size() >= MaxPaletteSize)
+		{
+			SwitchToDirect();
+			return 0;
+		}
+
+		Repack(BitsPerIndex == 0 ? 1 : BitsPerIndex * 2);
+	}
+
+	Palette.push_back(Value);
+	PaletteCounts.push_back(0);
+	return (uint32)Palette.size() - 1;
+}
+
+void FVoxelChunk::Repack(uint32 NewBitsPerIndex, const std::vector<uint32>* Remap)
+{
+	std::vector<uint64> OldData;
+	OldData.swap(Data);
+
+	const uint32 OldBits = BitsPerIndex;
+	const uint32 OldShift = 6 - IndexWidthLog2;
+	const uint64 OldMask = (1ull << OldBits) - 1;
+
+	BitsPerIndex = (uint8)NewBitsPerIndex;
+	IndexWidthLog2 = GetWidthLog2(NewBitsPerIndex);
+	std::vector<uint64>(ChunkVolume * NewBitsPerIndex / 64, 0).swap(Data);
+
+	// Uniform chunks have no old data, every voxel is palette entry 0.
+	if(OldBits == 0)
+	{
+		return;
+	}
+
+	for(int32 Index = 0; Index < ChunkVolume; Index++)
+	{
+		const uint64 Word = OldData[(uint32)Index >> OldShift];
+		const uint32 BitOffset = ((uint32)Index & ((1u << OldShift) - 1)) * OldBits;
+		uint32 Entry = (uint32)((Word >> BitOffset) & OldMask);
+
+		if(Remap)
+		{
+			Entry = (*Remap)[Entry];
+		}
+		WriteIndex(Index, Entry);
+	}
+}
+
+void FVoxelChunk::SwitchToDirect()
+{
+	std::vector<FBlockId> Blocks(ChunkVolume);
+	CopyToDense(Blocks.data());
+
+	Palette.clear();
+	PaletteCounts.clear();
+	BitsPerIndex = 16;
+	IndexWidthLog2 = 4;
+	std::vector<uint64>(ChunkVolume / 4, 0).swap(Data);
+
+	for(int32 Index = 0; Index < ChunkVolume; Index++)
+	{
+		WriteIndex(Index, Blocks[Index]);
+	}
+}
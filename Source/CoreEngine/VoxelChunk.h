@@ -0,0 +1,181 @@
+// Copyright Snaps 2022, All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "VoxelTypes.h"
+#include <vector>
+
+/*
+	Palette compressed 32^3 block storage. Every distinct block id in the chunk
+	gets a palette entry and voxels store a bit-packed index into the palette.
+	Index width grows 1 -> 2 -> 4 -> 8 bits as the palette grows, past 256 ids
+	the palette is dropped and ids are stored directly in 16 bits.
+	A chunk made of a single block id stores no index data at all. Palette chunks
+	collapse to that automatically, direct chunks only do so on Compact().
+
+	Voxels are laid out X fastest, then Z, then Y.
+
+	Light is kept next to the blocks as a byte per voxel, sky light in the high
+	nibble and block light in the low one (see FLightEngine). Like the palette it
+	collapses to a single value when every voxel has the same light, which is the
+	case for buried chunks and open sky.
+*/
+class FVoxelChunk
+{
+public:
+
+	explicit FVoxelChunk(FBlockId FillValue = BlockAir);
+
+	static int32 ToIndex(int32 X, int32 Y, int32 Z)
+	{
+		return X | (Z << ChunkSizeLog2) | (Y << (ChunkSizeLog2 * 2));
+	}
+
+	FBlockId Get(int32 X, int32 Y, int32 Z) const
+	{
+		return Get(ToIndex(X, Y, Z));
+	}
+
+	void Set(int32 X, int32 Y, int32 Z, FBlockId Value)
+	{
+		Set(ToIndex(X, Y, Z), Value);
+	}
+
+	FBlockId Get(int32 Index) const
+	{
+		if(BitsPerIndex == 0)
+		{
+			return Palette[0];
+		}
+
+		const uint32 Entry = ReadIndex(Index);
+		return IsDirect() ? (FBlockId)Entry : Palette[Entry];
+	}
+
+	void Set(int32 Index, FBlockId Value);
+
+	// Replace the whole chunk with a single block id.
+	void Fill(FBlockId Value);
+
+	// Bulk conversion to and from a flat ChunkVolume sized array, much faster than Get/Set per voxel.
+	void CopyToDense(FBlockId* OutBlocks) const;
+	void SetFromDense(const FBlockId* Blocks);
+
+	// Count consecutive voxels from Index on, e.g. part of an X row. Decodes a word at a time like CopyToDense.
+	void CopyRun(int32 Index, int32 Count, FBlockId* OutBlocks) const;
+
+	// Drop unused palette entries and shrink the index width as far as possible.
+	void Compact();
+
+	bool IsUniform() const
+	{
+		return BitsPerIndex == 0;
+	}
+
+	uint8 GetLight(int32 Index) const
+	{
+		return LightData.empty() ? UniformLight : LightData[Index];
+	}
+
+	// Expands to a byte per voxel on the first write that differs from the uniform light.
+	void SetLight(int32 Index, uint8 Light)
+	{
+		if(LightData.empty())
+		{
+			if(Light == UniformLight)
+			{
+				return;
+			}
+			LightData.assign(ChunkVolume, UniformLight);
+		}
+		LightData[Index] = Light;
+	}
+
+	// Replace the light of the whole chunk with a single value.
+	void FillLight(uint8 Light);
+
+	bool IsLightUniform() const
+	{
+		return LightData.empty();
+	}
+
+	uint32 GetBitsPerIndex() const
+	{
+		return BitsPerIndex;
+	}
+
+	// Number of palette entries, 0 when storing ids directly.
+	uint32 GetPaletteSize() const
+	{
+		return (uint32)Palette.size();
+	}
+
+	// Heap + inline bytes used by this chunk.
+	size_t GetMemoryUsage() const;
+
+	// Raw storage, for saving without going through dense blocks. Palette and counts are empty for
+	// direct chunks, Data is empty for uniform ones.
+	const std::vector<FBlockId>& GetPalette() const
+	{
+		return Palette;
+	}
+
+	const std::vector<uint16>& GetPaletteCounts() const
+	{
+		return PaletteCounts;
+	}
+
+	const std::vector<uint64>& GetData() const
+	{
+		return Data;
+	}
+
+	// Sizes the raw storage for a chunk with InBitsPerIndex and PaletteSize entries and hands it back
+	// to be filled in place, e.g. straight out of a file. Returns false, leaving the chunk alone, for
+	// combinations a chunk can't be in.
+	bool ResetStorage(uint32 InBitsPerIndex, uint32 PaletteSize, FBlockId*& OutPalette, uint16*& OutPaletteCounts, uint64*& OutData);
+
+private:
+
+	// Only valid when the chunk isn't uniform.
+	uint32 ReadIndex(int32 Index) const
+	{
+		const uint32 Shift = IndexShift();
+		const uint64 Word = Data[(uint32)Index >> Shift];
+		const uint32 BitOffset = ((uint32)Index & ((1u << Shift) - 1)) * BitsPerIndex;
+		return (uint32)(Word >> BitOffset) & ((1u << BitsPerIndex) - 1);
+	}
+
+	void WriteIndex(int32 Index, uint32 Value)
+	{
+		const uint32 Shift = IndexShift();
+		uint64& Word = Data[(uint32)Index >> Shift];
+		const uint32 BitOffset = ((uint32)Index & ((1u << Shift) - 1)) * BitsPerIndex;
+		const uint64 Mask = ((1ull << BitsPerIndex) - 1) << BitOffset;
+		Word = (Word & ~Mask) | ((uint64)Value << BitOffset);
+	}
+
+	// log2 of how many indices fit in one 64 bit word.
+	uint32 IndexShift() const
+	{
+		return 6 - IndexWidthLog2;
+	}
+
+	bool IsDirect() const
+	{
+		return BitsPerIndex == 16;
+	}
+
+	uint32 FindOrAddPaletteEntry(FBlockId Value);
+	void Repack(uint32 NewBitsPerIndex, const std::vector<uint32>* Remap = nullptr);
+	void SwitchToDirect();
+
+	std::vector<FBlockId> 	Palette; 		// Block id for each palette index.
+	std::vector<uint16> 	PaletteCounts; 	// How many voxels reference each palette index.
+	std::vector<uint64> 	Data; 			// Bit-packed palette indices (or raw ids in direct mode).
+	uint8 					BitsPerIndex; 	// 0, 1, 2, 4, 8 or 16.
+	uint8 					IndexWidthLog2; // log2(BitsPerIndex).
+	uint8 					UniformLight; 	// Light of every voxel while LightData is empty.
+	std::vector<uint8> 		LightData; 		// Sky << 4 | block light per voxel, empty when uniform.
+};
@@ -0,0 +1,18 @@
+// Copyright Snaps 2022, All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+/*
+	Basic voxel types and chunk dimensions shared by the engine and the
+	standalone voxel libraries.
+*/
+
+using FBlockId = uint16;
+
+static const FBlockId 	BlockAir 		= 0;
+
+static const int32 		ChunkSizeLog2 	= 5;
+static const int32 		ChunkSize 		= 1 << ChunkSizeLog2;			// 32 voxels along each axis.
+static const int32 		ChunkVolume 	= ChunkSize * ChunkSize * ChunkSize;
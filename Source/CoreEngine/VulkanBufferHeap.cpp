@@ -0,0 +1,92 @@
+// Copyright Snaps 2022, All Rights Reserved.
+
+#include "VulkanBufferHeap.h"
+#include "UploadManager.h"
+#include "VulkanHelpers.h"
+
+void FVulkanBufferHeap::Initialize(
+	VkDevice InDevice,
+	VkPhysicalDevice InPhysicalDevice,
+	VkBufferUsageFlags InUsage,
+	VkMemoryPropertyFlags InMemoryFlags,
+	const FUploadManager* InUploads)
+{
+	Device = InDevice;
+	PhysicalDevice = InPhysicalDevice;
+	Usage = InUsage;
+	MemoryFlags = InMemoryFlags;
+	Uploads = InUploads;
+}
+
+void FVulkanBufferHeap::Shutdown()
+{
+	for(uint64 Handle = 0; Handle < Blocks.size(); Handle++)
+	{
+		if(Blocks[(size_t)Handle].Buffer != VK_NULL_HANDLE)
+		{
+			FreeBlock(Handle);
+		}
+	}
+	Blocks.clear();
+	FreeSlots.clear();
+}
+
+bool FVulkanBufferHeap::AllocateBlock(uint64 Size, uint64& OutHandle)
+{
+	FBlock Block;
+
+	VkBufferCreateInfo BufferInfo {};
+	BufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+	BufferInfo.size = Size;
+	BufferInfo.usage = Usage;
+	BufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+	if(Uploads)
+	{
+		Uploads->SetupBufferSharing(BufferInfo);
+	}
+
+	if(vkCreateBuffer(Device, &BufferInfo, nullptr, &Block.Buffer) != VK_SUCCESS)
+	{
+		return false;
+	}
+
+	VkMemoryRequirements Requirements;
+	vkGetBufferMemoryRequirements(Device, Block.Buffer, &Requirements);
+
+	VkMemoryAllocateInfo AllocInfo {};
+	AllocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+	AllocInfo.allocationSize = Requirements.size;
+	AllocInfo.memoryTypeIndex = VulkanHelpers::FindMemoryType(PhysicalDevice, Requirements.memoryTypeBits, MemoryFlags);
+
+	// Out of device memory is an expected failure here, the allocator reports it to the caller.
+	if(AllocInfo.memoryTypeIndex == UINT32_MAX || vkAllocateMemory(Device, &AllocInfo, nullptr, &Block.Memory) != VK_SUCCESS)
+	{
+		vkDestroyBuffer(Device, Block.Buffer, nullptr);
+		return false;
+	}
+
+	VK_CHECK(vkBindBufferMemory(Device, Block.Buffer, Block.Memory, 0));
+
+	if(!FreeSlots.empty())
+	{
+		OutHandle = FreeSlots.back();
+		FreeSlots.pop_back();
+		Blocks[(size_t)OutHandle] = Block;
+	}
+	else
+	{
+		OutHandle = Blocks.size();
+		Blocks.push_back(Block);
+	}
+	return true;
+}
+
+void FVulkanBufferHeap::FreeBlock(uint64 Handle)
+{
+	FBlock& Block = Blocks[(size_t)Handle];
+	vkDestroyBuffer(Device, Block.Buffer, nullptr);
+	vkFreeMemory(Device, Block.Memory, nullptr);
+
+	Block = FBlock();
+	FreeSlots.push_back((uint32)Handle);
+}
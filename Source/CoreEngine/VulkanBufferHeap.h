@@ -0,0 +1,56 @@
+// Copyright Snaps 2022, All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "GpuAllocator.h"
+#include "vulkan.h"
+#include <vector>
+
+class FUploadManager;
+
+/*
+	IGpuMemoryHeap backed by real device memory. Every block is one VkBuffer
+	bound to its own vkAllocateMemory allocation, so sub-allocations are just
+	offsets into that buffer and can be bound with vkCmdBindVertexBuffers /
+	vkCmdBindIndexBuffer directly.
+*/
+class FVulkanBufferHeap : public IGpuMemoryHeap
+{
+public:
+
+	// Uploads, if given, decides the sharing mode so the upload queue can write into the blocks.
+	void Initialize(
+		VkDevice InDevice,
+		VkPhysicalDevice InPhysicalDevice,
+		VkBufferUsageFlags InUsage,
+		VkMemoryPropertyFlags InMemoryFlags,
+		const FUploadManager* InUploads
+	);
+	void Shutdown();
+
+	virtual bool AllocateBlock(uint64 Size, uint64& OutHandle) override;
+	virtual void FreeBlock(uint64 Handle) override;
+
+	VkBuffer GetBuffer(uint64 Handle) const
+	{
+		return Blocks[(size_t)Handle].Buffer;
+	}
+
+private:
+
+	struct FBlock
+	{
+		VkBuffer 		Buffer 	= VK_NULL_HANDLE;
+		VkDeviceMemory 	Memory 	= VK_NULL_HANDLE;
+	};
+
+	VkDevice 				Device 			= VK_NULL_HANDLE;
+	VkPhysicalDevice 		PhysicalDevice 	= VK_NULL_HANDLE;
+	VkBufferUsageFlags 		Usage 			= 0;
+	VkMemoryPropertyFlags 	MemoryFlags 	= 0;
+	const FUploadManager* 	Uploads 		= nullptr;
+
+	std::vector<FBlock> 	Blocks;
+	std::vector<uint32> 	FreeSlots;
+};
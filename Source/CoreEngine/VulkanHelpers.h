@@ -0,0 +1,38 @@
+// Copyright Snaps 2022, All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "SDL.h"
+#include "vulkan.h"
+
+#define VK_CHECK(x)                                                 \
+do                                                              	\
+{                                                               	\
+	VkResult err = x;                                           	\
+	if (err)                                                    	\
+	{                                                           	\
+		SDL_Log("Detected Vulkan error: ", err); 					\
+		abort();                                                	\
+	}                                                           	\
+} while (0)
+
+namespace VulkanHelpers
+{
+	// First memory type allowed by TypeBits that has all of the Required flags, UINT32_MAX if none does.
+	inline uint32 FindMemoryType(VkPhysicalDevice PhysicalDevice, uint32 TypeBits, VkMemoryPropertyFlags Required)
+	{
+		VkPhysicalDeviceMemoryProperties MemoryProperties;
+		vkGetPhysicalDeviceMemoryProperties(PhysicalDevice, &MemoryProperties);
+
+		for(uint32 Index = 0; Index < MemoryProperties.memoryTypeCount; Index++)
+		{
+			const bool bAllowed = (TypeBits & (1u << Index)) != 0;
+			if(bAllowed && (MemoryProperties.memoryTypes[Index].propertyFlags & Required) == Required)
+			{
+				return Index;
+			}
+		}
+		return UINT32_MAX;
+	}
+}
@@ -0,0 +1,694 @@
+// Copyright Snaps 2022, All Rights Reserved.
+
+#include "WorldGenerator.h"
+#include "CoreMacros.h"
+#include "NoiseGenerator.h"
+#include "VoxelChunk.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+
+static const int32 ColumnArea = ChunkSize * ChunkSize;
+
+// Surface heights land in roughly BaseHeight +- HeightRange, anything from SnowLine up is snow whatever the biome.
+static const int32 BaseHeight 	= 72;
+static const float HeightRange 	= 44.0f;
+static const int32 SnowLine 	= 104;
+static const int32 SoilDepth 	= 3;
+
+// Top block and the SoilDepth blocks under it, by biome.
+static const FBlockId SurfaceBlocks[] 	= { BlockGrass, BlockGrass, BlockSand, BlockSnow };
+static const FBlockId SoilBlocks[] 		= { BlockDirt, BlockDirt, BlockSand, BlockDirt };
+
+// Spaghetti caves, carved where two 3D noises are both near zero. Each is zero on a surface and two
+// surfaces meet along a line, so the carved space is a winding tunnel. Nothing is carved below CaveFloor.
+static const float CaveThreshold 	= 0.06f;
+static const int32 CaveFloor 		= 4;
+
+// Odds out of 1024 that a tree grows on a voxel column, by biome. Deserts grow cacti instead.
+static const uint32 TreeChance[] = { 3, 24, 4, 6 };
+
+// Leaves reach TreeRadius from the trunk, which has to stay under a chunk so the 3x3 neighbourhood
+// covers every tree that can reach a column.
+static const int32 TreeRadius 		= 2;
+static const int32 MaxTreeHeight 	= 8;
+
+// One column in DungeonRarity gets a dungeon, a hollow cobblestone room somewhere under the surface.
+static const uint32 DungeonRarity 	= 12;
+static const int32 DungeonSize 		= 9;
+static const int32 DungeonHeight 	= 6;
+
+// Per feature salts, keeps tree and dungeon placement independent of each other.
+static const uint32 TreeSalt 	= 0x68E31DA4u;
+static const uint32 DungeonSalt = 0xB5297A4Du;
+
+// Order of FWorldColumn::Neighbours.
+static const int32 NeighbourOffsets[8][2] =
+{
+	{ -1, -1 }, { 0, -1 }, { 1, -1 },
+	{ -1,  0 },            { 1,  0 },
+	{ -1,  1 }, { 0,  1 }, { 1,  1 }
+};
+
+/*
+	A column of chunks being generated. Stage jobs only touch their own column,
+	the main thread owns everything else.
+*/
+struct FWorldColumn
+{
+	FWorldGenerator* 	Generator 	= nullptr;
+	int32 				X 			= 0;
+	int32 				Z 			= 0;
+
+	// Next stage to run, Count once finished. Only changes at the end of a stage job.
+	std::atomic<uint8> 	NextStage 	{ 0 };
+	std::atomic<bool> 	bBusy 		{ false };
+
+	// Decoration jobs of neighbours reading this column, it can't be unloaded under them.
+	std::atomic<int32> 	NumReaders 	{ 0 };
+
+	bool 				bPublished 	= false;
+
+	// Held while decorating, in NeighbourOffsets order.
+	FWorldColumn* 		Neighbours[8] = {};
+
+	// Per voxel column, X fastest. Neighbours read these while decorating, none change after Caves.
+	int16 				Height[ColumnArea];			// Surface before caves.
+	int16 				TopSolid[ColumnArea];		// Highest solid block after caves, -1 for none.
+	EBiome 				Biome[ColumnArea];
+	int16 				MinHeight 	= 0;
+	int16 				MaxHeight 	= 0;
+
+	FVoxelChunk 		Chunks[WorldHeightChunks];
+};
+
+// Per worker scratch, one chunk of blocks and two of noise.
+static thread_local FBlockId GBlockScratch[ChunkVolume];
+static thread_local float GNoiseScratchA[ChunkVolume];
+static thread_local float GNoiseScratchB[ChunkVolume];
+
+static uint32 HashPosition(uint32 Seed, int32 X, int32 Z)
+{
+	uint32 Hash = (uint32)X * 0x8DA6B343u ^ (uint32)Z * 0xCB1AB31Fu ^ Seed;
+	Hash ^= Hash >> 15;
+	Hash *= 0x2C1B3C6Du;
+	Hash ^= Hash >> 12;
+	Hash *= 0x297A2D39u;
+	Hash ^= Hash >> 15;
+	return Hash;
+}
+
+static int32 DistanceSquared(const FWorldColumn& Column, int32 X, int32 Z)
+{
+	return (Column.X - X) * (Column.X - X) + (Column.Z - Z) * (Column.Z - Z);
+}
+
+static EBiome PickBiome(float Temperature, float Humidity, int32 Height)
+{
+	if(Height >= SnowLine || Temperature < -0.35f)
+	{
+		return EBiome::Snow;
+	}
+	if(Temperature > 0.3f && Humidity < 0.0f)
+	{
+		return EBiome::Desert;
+	}
+	return Humidity > 0.2f ? EBiome::Forest : EBiome::Plains;
+}
+
+// Decoration overlapping itself resolves by priority rather than by order, so it doesn't matter which
+// tree is placed first. Terrain always wins.
+static int32 GetDecorationPriority(FBlockId Block)
+{
+	switch(Block)
+	{
+		case BlockAir: 		return 0;
+		case BlockLeaves: 	return 1;
+		case BlockCactus: 	return 2;
+		case BlockLog: 		return 3;
+		default: 			return 4;
+	}
+}
+
+// Places a decoration block at a world position, if it is inside Column.
+static void PlaceDecoration(FWorldColumn& Column, int32 WorldX, int32 WorldY, int32 WorldZ, FBlockId Block)
+{
+	const int32 X = WorldX - Column.X * ChunkSize;
+	const int32 Z = WorldZ - Column.Z * ChunkSize;
+	if(X < 0 || X >= ChunkSize || Z < 0 || Z >= ChunkSize || WorldY < 0 || WorldY >= WorldHeight)
+	{
+		return;
+	}
+
+	FVoxelChunk& Chunk = Column.Chunks[WorldY >> ChunkSizeLog2];
+	const int32 Y = WorldY & (ChunkSize - 1);
+	if(GetDecorationPriority(Chunk.Get(X, Y, Z)) < GetDecorationPriority(Block))
+	{
+		Chunk.Set(X, Y, Z, Block);
+	}
+}
+
+// A trunk with two wide layers of leaves around its top and two narrow ones above, corners trimmed by the hash.
+static void PlaceTree(FWorldColumn& Column, int32 WorldX, int32 WorldY, int32 WorldZ, uint32 Hash)
+{
+	const int32 TrunkHeight = 4 + (int32)((Hash >> 10) % 3);
+	const int32 TopY = WorldY + TrunkHeight;
+
+	for(int32 LeafY = TopY - 2; LeafY <= TopY + 1; LeafY++)
+	{
+		const int32 Radius = LeafY < TopY ? TreeRadius : 1;
+		for(int32 DeltaZ = -Radius; DeltaZ <= Radius; DeltaZ++)
+		for(int32 DeltaX = -Radius; DeltaX <= Radius; DeltaX++)
+		{
+			const bool bCorner = std::abs(DeltaX) == Radius && std::abs(DeltaZ) == Radius;
+			const uint32 CornerBit = 16 + (uint32)(LeafY - TopY + 2) * 4 + (DeltaX > 0 ? 2 : 0) + (DeltaZ > 0 ? 1 : 0);
+			if(bCorner && (LeafY == TopY + 1 || ((Hash >> CornerBit) & 1)))
+			{
+				continue;
+			}
+			PlaceDecoration(Column, WorldX + DeltaX, LeafY, WorldZ + DeltaZ, BlockLeaves);
+		}
+	}
+
+	for(int32 LogY = WorldY; LogY < TopY; LogY++)
+	{
+		PlaceDecoration(Column, WorldX, LogY, WorldZ, BlockLog);
+	}
+}
+
+static void PlaceCactus(FWorldColumn& Column, int32 WorldX, int32 WorldY, int32 WorldZ, uint32 Hash)
+{
+	const int32 CactusHeight = 1 + (int32)((Hash >> 10) % 3);
+	for(int32 Y = WorldY; Y < WorldY + CactusHeight; Y++)
+	{
+		PlaceDecoration(Column, WorldX, Y, WorldZ, BlockCactus);
+	}
+}
+
+FWorldGenerator::FWorldGenerator(FJobSystem* InJobSystem, uint32 InSeed, int32 InViewDistance)
+	: JobSystem(InJobSystem)
+	, Seed(InSeed)
+	, ViewDistance(std::max(InViewDistance, 1))
+	, MaxJobsInFlight(InJobSystem->GetNumThreads() * 2)
+	, ChunkMap((uint32)((2 * InViewDistance + 7) * (2 * InViewDistance + 7) * WorldHeightChunks))
+{
+	// Every noise gets its own seed, otherwise the biome maps would follow the hills.
+	FNoiseSettings Settings;
+	Settings.Type = ENoiseType::OpenSimplex2;
+
+	Settings.Seed = (int32)Seed;
+	Settings.Frequency = 0.0045f;
+	Settings.Octaves = 5;
+	Settings.WarpAmplitude = 24.0f;
+	Settings.WarpFrequency = 0.004f;
+	HeightNoise = std::make_unique<FNoiseGenerator>(Settings);
+
+	Settings.Frequency = 0.0012f;
+	Settings.Octaves = 2;
+	Settings.WarpAmplitude = 0.0f;
+	Settings.Seed = (int32)(Seed + 1);
+	TemperatureNoise = std::make_unique<FNoiseGenerator>(Settings);
+	Settings.Seed = (int32)(Seed + 2);
+	HumidityNoise = std::make_unique<FNoiseGenerator>(Settings);
+
+	Settings.Frequency = 0.016f;
+	Settings.Octaves = 1;
+	Settings.Seed = (int32)(Seed + 3);
+	CaveNoiseA = std::make_unique<FNoiseGenerator>(Settings);
+	Settings.Seed = (int32)(Seed + 4);
+	CaveNoiseB = std::make_unique<FNoiseGenerator>(Settings);
+}
+
+FWorldGenerator::~FWorldGenerator()
+{
+	// Jobs point at our columns.
+	JobSystem->Wait(JobsInFlight);
+}
+
+void FWorldGenerator::Update(double ViewerX, double ViewerZ)
+{
+	PROFILE_FUNCTION();
+
+	// Chunk map readers never hold on to chunks past a frame, so whatever was unloaded last update can go.
+	ChunkMap.ReclaimRetiredTables();
+	RetiredColumns.clear();
+	PublishedColumns.clear();
+	UnloadedColumns.clear();
+
+	const int32 ViewerColumnX = (int32)std::floor(ViewerX / ChunkSize);
+	const int32 ViewerColumnZ = (int32)std::floor(ViewerZ / ChunkSize);
+	if(!bHasCenter || ViewerColumnX != CenterX || ViewerColumnZ != CenterZ || bUnloadDeferred)
+	{
+		bHasCenter = true;
+		CenterX = ViewerColumnX;
+		CenterZ = ViewerColumnZ;
+		LoadColumns();
+	}
+
+	ScheduleReadyStages();
+}
+
+void FWorldGenerator::Flush()
+{
+	PROFILE_FUNCTION();
+
+	for(;;)
+	{
+		ScheduleReadyStages();
+		if(JobsInFlight.IsDone())
+		{
+			break;
+		}
+		JobSystem->Wait(JobsInFlight);
+	}
+}
+
+FWorldGenStageStats FWorldGenerator::GetStageStats(EWorldGenStage Stage) const
+{
+	const FStageCounters& Counters = StageCounters[(uint32)Stage];
+
+	FWorldGenStageStats Stats;
+	Stats.NumColumns = Counters.NumColumns.load(std::memory_order_relaxed);
+	Stats.Seconds = Counters.Nanoseconds.load(std::memory_order_relaxed) * 1e-9;
+	return Stats;
+}
+
+std::string FWorldGenerator::FormatStats() const
+{
+	std::string Result;
+	for(uint32 Stage = 0; Stage < (uint32)EWorldGenStage::Count; Stage++)
+	{
+		const FWorldGenStageStats Stats = GetStageStats((EWorldGenStage)Stage);
+
+		char Line[256];
+		std::snprintf(Line, sizeof(Line), "%-12s %8llu columns %10.2f ms %8.1f us/column %8.0f columns/s per worker\n",
+			GetStageName((EWorldGenStage)Stage),
+			(unsigned long long)Stats.NumColumns,
+			Stats.Seconds * 1000.0,
+			Stats.NumColumns > 0 ? Stats.Seconds * 1e6 / Stats.NumColumns : 0.0,
+			Stats.Seconds > 0.0 ? Stats.NumColumns / Stats.Seconds : 0.0
+		);
+		Result += Line;
+	}
+	return Result;
+}
+
+const char* FWorldGenerator::GetStageName(EWorldGenStage Stage)
+{
+	switch(Stage)
+	{
+		case EWorldGenStage::Heightmap: 	return "Heightmap";
+		case EWorldGenStage::Biome: 		return "Biome";
+		case EWorldGenStage::Caves: 		return "Caves";
+		case EWorldGenStage::Decoration: 	return "Decoration";
+		case EWorldGenStage::Structures: 	return "Structures";
+		default: 							return "Done";
+	}
+}
+
+void FWorldGenerator::RunStageJob(void* Data)
+{
+	FWorldColumn* Column = static_cast<FWorldColumn*>(Data);
+	Column->Generator->RunStage(*Column);
+}
+
+// Columns within LoadRadius are generated, diagonal neighbours of the outermost fully generated ones
+// reach about sqrt(2) further. Unloading a little further out again stops columns on the edge from
+// being dropped and regenerated as the viewer moves back and forth over a chunk border.
+void FWorldGenerator::LoadColumns()
+{
+	PROFILE_FUNCTION();
+
+	const int32 LoadRadius = ViewDistance + 2;
+	const int32 UnloadRadius = ViewDistance + 3;
+
+	// Columns jobs are still using are left for a later update.
+	bUnloadDeferred = false;
+	for(auto It = Columns.begin(); It != Columns.end();)
+	{
+		FWorldColumn* Column = It->second.get();
+		if(DistanceSquared(*Column, CenterX, CenterZ) <= UnloadRadius * UnloadRadius)
+		{
+			++It;
+			continue;
+		}
+
+		if(Column->bBusy.load(std::memory_order_acquire) || Column->NumReaders.load(std::memory_order_acquire) > 0)
+		{
+			bUnloadDeferred = true;
+			++It;
+			continue;
+		}
+
+		if(Column->bPublished)
+		{
+			for(int32 ChunkY = 0; ChunkY < WorldHeightChunks; ChunkY++)
+			{
+				ChunkMap.Remove(Column->X, ChunkY, Column->Z);
+			}
+			UnloadedColumns.push_back(FChunkMap::PackKey(Column->X, 0, Column->Z));
+		}
+		RetiredColumns.push_back(std::move(It->second));
+		It = Columns.erase(It);
+	}
+
+	for(int32 DeltaZ = -LoadRadius; DeltaZ <= LoadRadius; DeltaZ++)
+	for(int32 DeltaX = -LoadRadius; DeltaX <= LoadRadius; DeltaX++)
+	{
+		if(DeltaX * DeltaX + DeltaZ * DeltaZ > LoadRadius * LoadRadius)
+		{
+			continue;
+		}
+
+		std::unique_ptr<FWorldColumn>& Column = Columns[FChunkMap::PackKey(CenterX + DeltaX, 0, CenterZ + DeltaZ)];
+		if(!Column)
+		{
+			Column = std::make_unique<FWorldColumn>();
+			Column->Generator = this;
+			Column->X = CenterX + DeltaX;
+			Column->Z = CenterZ + DeltaZ;
+		}
+	}
+
+	// Only columns in range keep generating, nearest first.
+	PendingColumns.clear();
+	for(const auto& Pair : Columns)
+	{
+		FWorldColumn* Column = Pair.second.get();
+		if(!Column->bPublished && DistanceSquared(*Column, CenterX, CenterZ) <= LoadRadius * LoadRadius)
+		{
+			PendingColumns.push_back(Column);
+		}
+	}
+
+	std::sort(PendingColumns.begin(), PendingColumns.end(), [this](const FWorldColumn* A, const FWorldColumn* B)
+	{
+		return DistanceSquared(*A, CenterX, CenterZ) < DistanceSquared(*B, CenterX, CenterZ);
+	});
+}
+
+void FWorldGenerator::ScheduleReadyStages()
+{
+	PROFILE_FUNCTION();
+
+	size_t NumPending = 0;
+	for(FWorldColumn* Column : PendingColumns)
+	{
+		if(!Column->bBusy.load(std::memory_order_acquire))
+		{
+			const EWorldGenStage Stage = (EWorldGenStage)Column->NextStage.load(std::memory_order_acquire);
+			if(Stage == EWorldGenStage::Count)
+			{
+				for(int32 ChunkY = 0; ChunkY < WorldHeightChunks; ChunkY++)
+				{
+					ChunkMap.Insert(Column->X, ChunkY, Column->Z, &Column->Chunks[ChunkY]);
+				}
+				Column->bPublished = true;
+				PublishedColumns.push_back(FChunkMap::PackKey(Column->X, 0, Column->Z));
+				continue;
+			}
+
+			// Throttled so a big move doesn't bury the job system in columns the viewer may never reach.
+			if((uint32)JobsInFlight.Value.load(std::memory_order_relaxed) < MaxJobsInFlight
+				&& (Stage != EWorldGenStage::Decoration || GatherNeighbours(*Column)))
+			{
+				Column->bBusy.store(true, std::memory_order_relaxed);
+				JobSystem->Schedule(&FWorldGenerator::RunStageJob, Column, &JobsInFlight);
+			}
+		}
+
+		PendingColumns[NumPending++] = Column;
+	}
+	PendingColumns.resize(NumPending);
+}
+
+// Holds all 8 neighbours for decoration if they all have their terrain.
+bool FWorldGenerator::GatherNeighbours(FWorldColumn& Column)
+{
+	FWorldColumn* Neighbours[8];
+	for(int32 Index = 0; Index < 8; Index++)
+	{
+		auto Found = Columns.find(FChunkMap::PackKey(Column.X + NeighbourOffsets[Index][0], 0, Column.Z + NeighbourOffsets[Index][1]));
+		if(Found == Columns.end() || Found->second->NextStage.load(std::memory_order_acquire) <= (uint8)EWorldGenStage::Caves)
+		{
+			return false;
+		}
+		Neighbours[Index] = Found->second.get();
+	}
+
+	for(int32 Index = 0; Index < 8; Index++)
+	{
+		Neighbours[Index]->NumReaders.fetch_add(1, std::memory_order_relaxed);
+		Column.Neighbours[Index] = Neighbours[Index];
+	}
+	return true;
+}
+
+void FWorldGenerator::RunStage(FWorldColumn& Column)
+{
+	const EWorldGenStage Stage = (EWorldGenStage)Column.NextStage.load(std::memory_order_relaxed);
+	PROFILE_SCOPE(GetStageName(Stage));
+
+	const std::chrono::steady_clock::time_point StartTime = std::chrono::steady_clock::now();
+
+	switch(Stage)
+	{
+		case EWorldGenStage::Heightmap: 	GenerateHeightmap(Column); 	break;
+		case EWorldGenStage::Biome: 		GenerateBiomes(Column); 	break;
+		case EWorldGenStage::Caves: 		GenerateCaves(Column); 		break;
+		case EWorldGenStage::Decoration: 	GenerateDecoration(Column); break;
+		case EWorldGenStage::Structures: 	GenerateStructures(Column); break;
+		default: 							break;
+	}
+
+	const std::chrono::steady_clock::duration Elapsed = std::chrono::steady_clock::now() - StartTime;
+	FStageCounters& Counters = StageCounters[(uint32)Stage];
+	Counters.NumColumns.fetch_add(1, std::memory_order_relaxed);
+	Counters.Nanoseconds.fetch_add((uint64)std::chrono::duration_cast<std::chrono::nanoseconds>(Elapsed).count(), std::memory_order_relaxed);
+
+	if(Stage == EWorldGenStage::Decoration)
+	{
+		for(FWorldColumn*& Neighbour : Column.Neighbours)
+		{
+			Neighbour->NumReaders.fetch_sub(1, std::memory_order_release);
+			Neighbour = nullptr;
+		}
+	}
+
+	Column.NextStage.store((uint8)((uint32)Stage + 1), std::memory_order_release);
+	Column.bBusy.store(false, std::memory_order_release);
+}
+
+void FWorldGenerator::GenerateHeightmap(FWorldColumn& Column) const
+{
+	HeightNoise->GenerateGrid2D((float)(Column.X * ChunkSize), (float)(Column.Z * ChunkSize), 1.0f, ChunkSize, ChunkSize, GNoiseScratchA);
+
+	int32 MinHeight = WorldHeight;
+	int32 MaxHeight = 0;
+	for(int32 Index = 0; Index < ColumnArea; Index++)
+	{
+		const int32 Height = std::min(std::max(BaseHeight + (int32)std::floor(GNoiseScratchA[Index] * HeightRange), 1), WorldHeight - MaxTreeHeight - 1);
+		Column.Height[Index] = (int16)Height;
+		MinHeight = std::min(MinHeight, Height);
+		MaxHeight = std::max(MaxHeight, Height);
+	}
+	Column.MinHeight = (int16)MinHeight;
+	Column.MaxHeight = (int16)MaxHeight;
+
+	// Chunks entirely above or below the surface are uniform, only the ones it passes through need voxels.
+	for(int32 ChunkY = 0; ChunkY < WorldHeightChunks; ChunkY++)
+	{
+		const int32 BaseY = ChunkY * ChunkSize;
+		FVoxelChunk& Chunk = Column.Chunks[ChunkY];
+
+		if(BaseY > MaxHeight)
+		{
+			Chunk.Fill(BlockAir);
+			continue;
+		}
+
+		if(BaseY + ChunkSize - 1 <= MinHeight)
+		{
+			Chunk.Fill(BlockStone);
+			continue;
+		}
+
+		for(int32 Y = 0; Y < ChunkSize; Y++)
+		{
+			FBlockId* Layer = GBlockScratch + Y * ColumnArea;
+			for(int32 Index = 0; Index < ColumnArea; Index++)
+			{
+				Layer[Index] = BaseY + Y <= Column.Height[Index] ? BlockStone : BlockAir;
+			}
+		}
+		Chunk.SetFromDense(GBlockScratch);
+	}
+}
+
+void FWorldGenerator::GenerateBiomes(FWorldColumn& Column) const
+{
+	const float WorldX = (float)(Column.X * ChunkSize);
+	const float WorldZ = (float)(Column.Z * ChunkSize);
+	TemperatureNoise->GenerateGrid2D(WorldX, WorldZ, 1.0f, ChunkSize, ChunkSize, GNoiseScratchA);
+	HumidityNoise->GenerateGrid2D(WorldX, WorldZ, 1.0f, ChunkSize, ChunkSize, GNoiseScratchB);
+
+	for(int32 Index = 0; Index < ColumnArea; Index++)
+	{
+		Column.Biome[Index] = PickBiome(GNoiseScratchA[Index], GNoiseScratchB[Index], Column.Height[Index]);
+	}
+
+	// Paint the surface and the soil under it in every chunk the surface layers pass through.
+	const int32 MinChunkY = std::max(Column.MinHeight - SoilDepth, 0) >> ChunkSizeLog2;
+	const int32 MaxChunkY = Column.MaxHeight >> ChunkSizeLog2;
+	for(int32 ChunkY = MinChunkY; ChunkY <= MaxChunkY; ChunkY++)
+	{
+		const int32 BaseY = ChunkY * ChunkSize;
+		FVoxelChunk& Chunk = Column.Chunks[ChunkY];
+		Chunk.CopyToDense(GBlockScratch);
+
+		for(int32 Index = 0; Index < ColumnArea; Index++)
+		{
+			const int32 Surface = Column.Height[Index];
+			const uint32 Biome = (uint32)Column.Biome[Index];
+			const int32 MinY = std::max(Surface - SoilDepth, BaseY);
+			const int32 MaxY = std::min(Surface, BaseY + ChunkSize - 1);
+
+			for(int32 WorldY = MinY; WorldY <= MaxY; WorldY++)
+			{
+				GBlockScratch[(WorldY - BaseY) * ColumnArea + Index] = WorldY == Surface ? SurfaceBlocks[Biome] : SoilBlocks[Biome];
+			}
+		}
+		Chunk.SetFromDense(GBlockScratch);
+	}
+}
+
+void FWorldGenerator::GenerateCaves(FWorldColumn& Column) const
+{
+	const float WorldX = (float)(Column.X * ChunkSize);
+	const float WorldZ = (float)(Column.Z * ChunkSize);
+
+	for(int32 Index = 0; Index < ColumnArea; Index++)
+	{
+		Column.TopSolid[Index] = -1;
+	}
+
+	// Bottom up, so the last solid block seen in a voxel column is its highest.
+	const int32 MaxChunkY = Column.MaxHeight >> ChunkSizeLog2;
+	for(int32 ChunkY = 0; ChunkY <= MaxChunkY; ChunkY++)
+	{
+		const int32 BaseY = ChunkY * ChunkSize;
+		CaveNoiseA->GenerateGrid3D(WorldX, (float)BaseY, WorldZ, 1.0f, ChunkSize, ChunkSize, ChunkSize, GNoiseScratchA);
+		CaveNoiseB->GenerateGrid3D(WorldX, (float)BaseY, WorldZ, 1.0f, ChunkSize, ChunkSize, ChunkSize, GNoiseScratchB);
+
+		FVoxelChunk& Chunk = Column.Chunks[ChunkY];
+		Chunk.CopyToDense(GBlockScratch);
+
+		for(int32 Y = 0; Y < ChunkSize; Y++)
+		{
+			const int32 WorldY = BaseY + Y;
+			for(int32 Index = 0; Index < ColumnArea; Index++)
+			{
+				const int32 Voxel = Y * ColumnArea + Index;
+				if(GBlockScratch[Voxel] == BlockAir)
+				{
+					continue;
+				}
+
+				if(WorldY >= CaveFloor && std::fabs(GNoiseScratchA[Voxel]) < CaveThreshold && std::fabs(GNoiseScratchB[Voxel]) < CaveThreshold)
+				{
+					GBlockScratch[Voxel] = BlockAir;
+				}
+				else
+				{
+					Column.TopSolid[Index] = (int16)WorldY;
+				}
+			}
+		}
+		Chunk.SetFromDense(GBlockScratch);
+	}
+}
+
+// Every tree that can reach this column is visited, the ones rooted in neighbours too, and only the
+// blocks inside this column are placed. Both columns a tree straddles agree on it because it only
+// depends on the root column's heights and biomes.
+void FWorldGenerator::GenerateDecoration(FWorldColumn& Column) const
+{
+	const FWorldColumn* Sources[9];
+	for(int32 Index = 0; Index < 8; Index++)
+	{
+		Sources[Index] = Column.Neighbours[Index];
+	}
+	Sources[8] = &Column;
+
+	const int32 MinX = Column.X * ChunkSize - TreeRadius;
+	const int32 MaxX = Column.X * ChunkSize + ChunkSize - 1 + TreeRadius;
+	const int32 MinZ = Column.Z * ChunkSize - TreeRadius;
+	const int32 MaxZ = Column.Z * ChunkSize + ChunkSize - 1 + TreeRadius;
+
+	for(const FWorldColumn* Source : Sources)
+	{
+		for(int32 Index = 0; Index < ColumnArea; Index++)
+		{
+			const int32 TreeX = Source->X * ChunkSize + (Index & (ChunkSize - 1));
+			const int32 TreeZ = Source->Z * ChunkSize + (Index >> ChunkSizeLog2);
+			if(TreeX < MinX || TreeX > MaxX || TreeZ < MinZ || TreeZ > MaxZ)
+			{
+				continue;
+			}
+
+			const EBiome Biome = Source->Biome[Index];
+			const uint32 Hash = HashPosition(Seed ^ TreeSalt, TreeX, TreeZ);
+			if((Hash & 1023) >= TreeChance[(uint32)Biome])
+			{
+				continue;
+			}
+
+			// Not where a cave has opened up the surface.
+			const int32 Ground = Source->TopSolid[Index];
+			if(Ground != Source->Height[Index])
+			{
+				continue;
+			}
+
+			if(Biome == EBiome::Desert)
+			{
+				PlaceCactus(Column, TreeX, Ground + 1, TreeZ, Hash);
+			}
+			else
+			{
+				PlaceTree(Column, TreeX, Ground + 1, TreeZ, Hash);
+			}
+		}
+	}
+}
+
+void FWorldGenerator::GenerateStructures(FWorldColumn& Column) const
+{
+	const uint32 Hash = HashPosition(Seed ^ DungeonSalt, Column.X, Column.Z);
+
+	// Somewhere under the lowest point of the surface, and inside the column so no neighbour is involved.
+	const int32 DepthRange = Column.MinHeight - 12 - DungeonHeight - CaveFloor;
+	if(Hash % DungeonRarity == 0 && DepthRange > 0)
+	{
+		const int32 MinX = 2 + (int32)((Hash >> 8) % (ChunkSize - DungeonSize - 4));
+		const int32 MinZ = 2 + (int32)((Hash >> 16) % (ChunkSize - DungeonSize - 4));
+		const int32 MinY = CaveFloor + (int32)((Hash >> 24) % (uint32)DepthRange);
+
+		for(int32 Y = 0; Y < DungeonHeight; Y++)
+		for(int32 Z = 0; Z < DungeonSize; Z++)
+		for(int32 X = 0; X < DungeonSize; X++)
+		{
+			const bool bWall = X == 0 || X == DungeonSize - 1 || Y == 0 || Y == DungeonHeight - 1 || Z == 0 || Z == DungeonSize - 1;
+			const int32 WorldY = MinY + Y;
+			Column.Chunks[WorldY >> ChunkSizeLog2].Set(MinX + X, WorldY & (ChunkSize - 1), MinZ + Z, bWall ? BlockCobblestone : BlockAir);
+		}
+	}
+
+	// Last stage, decoration and structures may have left palette entries nothing uses.
+	for(FVoxelChunk& Chunk : Column.Chunks)
+	{
+		Chunk.Compact();
+	}
+}
@@ -0,0 +1,175 @@
+// Copyright Snaps 2022, All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "ChunkMap.h"
+#include "JobSystem.h"
+#include "VoxelTypes.h"
+#include <atomic>
+#include <unordered_map>
+#include <vector>
+
+class FNoiseGenerator;
+struct FWorldColumn;
+
+// Block ids the world generator places.
+static const FBlockId BlockStone 		= 1;
+static const FBlockId BlockDirt 		= 2;
+static const FBlockId BlockGrass 		= 3;
+static const FBlockId BlockSand 		= 4;
+static const FBlockId BlockSnow 		= 5;
+static const FBlockId BlockLog 			= 6;
+static const FBlockId BlockLeaves 		= 7;
+static const FBlockId BlockCactus 		= 8;
+static const FBlockId BlockCobblestone 	= 9;
+
+// Generated worlds are columns of WorldHeightChunks chunks, chunk Y 0 at the bottom.
+static const int32 WorldHeightChunks 	= 8;
+static const int32 WorldHeight 			= WorldHeightChunks * ChunkSize;
+
+// Generation stages, in the order every column goes through them.
+enum class EWorldGenStage : uint8
+{
+	Heightmap,		// Surface height per voxel column, stone filled up to it.
+	Biome,			// Biome per voxel column, surface layers painted to match.
+	Caves,			// Caves carved, terrain is final. Neighbours may decorate against it from here on.
+	Decoration,		// Trees and cacti, needs the terrain of all 8 horizontal neighbours.
+	Structures,		// Dungeons, then the column's chunks go into the chunk map.
+	Count
+};
+
+enum class EBiome : uint8
+{
+	Plains,
+	Forest,
+	Desert,
+	Snow
+};
+
+// Work done by one stage so far. Seconds is summed over worker threads, not wall clock.
+struct FWorldGenStageStats
+{
+	uint64 	NumColumns 	= 0;
+	double 	Seconds 	= 0.0;
+};
+
+/*
+	Staged world generator. Columns of chunks around the viewer are generated
+	in stages on the job system, Update kicks whatever is ready each frame and
+	never waits on it. A column's stages run one after another, different
+	columns run in parallel. Decoration waits until all 8 horizontal neighbours
+	have their terrain, since trees near a border hang over into the next column.
+
+	Output only depends on the seed and the column's coordinates, never on
+	thread count or the order columns happen to finish in: every stage only
+	writes its own column, and decoration only reads the parts of neighbours
+	that stop changing once their terrain is done (heights and biomes), so a
+	tree over a border is placed the same way by both columns. Noise is bit
+	identical across instruction sets, so worlds also match between machines.
+
+	Finished columns have their chunks inserted into the chunk map. Columns
+	that fall out of range are dropped and regenerated identically if the
+	viewer comes back.
+*/
+class FWorldGenerator
+{
+public:
+
+	FWorldGenerator(FJobSystem* InJobSystem, uint32 InSeed, int32 InViewDistance);
+	~FWorldGenerator();
+
+	FWorldGenerator(const FWorldGenerator&) = delete;
+	FWorldGenerator& operator=(const FWorldGenerator&) = delete;
+
+	// Main thread. Loads columns within the view distance of the viewer (world units), drops far ones,
+	// publishes finished columns and schedules every stage whose dependencies are met.
+	void Update(double ViewerX, double ViewerZ);
+
+	// Runs stages on the calling thread too until every loaded column is as far along as its neighbours
+	// allow. For tools and benchmarks, the engine itself never blocks on generation.
+	void Flush();
+
+	// Finished chunks only, keyed by chunk coordinate.
+	const FChunkMap& GetChunkMap() const
+	{
+		return ChunkMap;
+	}
+
+	// Columns published by the last Update and any Flush since, as FChunkMap::PackKey(X, 0, Z).
+	const std::vector<uint64>& GetPublishedColumns() const
+	{
+		return PublishedColumns;
+	}
+
+	// Published columns the last Update took out of the chunk map, same keys as above.
+	const std::vector<uint64>& GetUnloadedColumns() const
+	{
+		return UnloadedColumns;
+	}
+
+	uint32 GetNumColumns() const
+	{
+		return (uint32)Columns.size();
+	}
+
+	// Columns still waiting on a stage or on their neighbours.
+	uint32 GetNumPendingColumns() const
+	{
+		return (uint32)PendingColumns.size();
+	}
+
+	FWorldGenStageStats GetStageStats(EWorldGenStage Stage) const;
+
+	// One line per stage with its throughput, for logs.
+	std::string FormatStats() const;
+
+	static const char* GetStageName(EWorldGenStage Stage);
+
+private:
+
+	static void RunStageJob(void* Data);
+
+	void LoadColumns();
+	void ScheduleReadyStages();
+	bool GatherNeighbours(FWorldColumn& Column);
+
+	void RunStage(FWorldColumn& Column);
+	void GenerateHeightmap(FWorldColumn& Column) const;
+	void GenerateBiomes(FWorldColumn& Column) const;
+	void GenerateCaves(FWorldColumn& Column) const;
+	void GenerateDecoration(FWorldColumn& Column) const;
+	void GenerateStructures(FWorldColumn& Column) const;
+
+	struct FStageCounters
+	{
+		std::atomic<uint64> NumColumns 	{ 0 };
+		std::atomic<uint64> Nanoseconds { 0 };
+	};
+
+	FJobSystem* 		JobSystem;
+	uint32 				Seed;
+	int32 				ViewDistance; 		// In chunks, columns further than this are generated up to their terrain only.
+	uint32 				MaxJobsInFlight;
+
+	std::unique_ptr<FNoiseGenerator> 	HeightNoise;
+	std::unique_ptr<FNoiseGenerator> 	TemperatureNoise;
+	std::unique_ptr<FNoiseGenerator> 	HumidityNoise;
+	std::unique_ptr<FNoiseGenerator> 	CaveNoiseA;
+	std::unique_ptr<FNoiseGenerator> 	CaveNoiseB;
+
+	std::unordered_map<uint64, std::unique_ptr<FWorldColumn>> 	Columns;
+	std::vector<FWorldColumn*> 									PendingColumns; 	// Unfinished, nearest to the viewer first.
+	std::vector<std::unique_ptr<FWorldColumn>> 					RetiredColumns; 	// Unloaded, freed next Update once no reader can hold their chunks.
+	std::vector<uint64> 										PublishedColumns;
+	std::vector<uint64> 										UnloadedColumns;
+
+	FChunkMap 			ChunkMap;
+	FJobCounter 		JobsInFlight;
+	FStageCounters 		StageCounters[(uint32)EWorldGenStage::Count];
+
+	bool 				bHasCenter 		= false;
+	bool 				bUnloadDeferred = false; 	// A column out of range was still in use, try again next update.
+	int32 				CenterX 		= 0;
+	int32 				CenterZ 		= 0;
+};
@@ -0,0 +1,66 @@
+// Copyright Snaps 2022, All Rights Reserved.
+
+#include "CoreMinimal.h"
+#include "RegionFile.h"
+#include <cstdio>
+#include <cstring>
+
+/*
+	Offline maintenance for region files, run while the engine isn't using them.
+	Usage: RegionTool info <RegionFiles...>
+	       RegionTool compact <RegionFiles...>
+*/
+
+static bool PrintInfo(const char* Path)
+{
+	FRegionFile Region;
+	if(!Region.Open(Path, false))
+	{
+		std::printf("%s: not a region file\n", Path);
+		return false;
+	}
+
+	const uint32 NumSectors = Region.GetNumSectors();
+	std::printf("%s: %u chunks, %u sectors (%.1f KB), %u free (%.1f%%)\n",
+		Path,
+		Region.GetNumChunks(),
+		NumSectors,
+		NumSectors * (double)FRegionFile::SectorSize / 1024.0,
+		Region.GetNumFreeSectors(),
+		NumSectors > 0 ? Region.GetNumFreeSectors() * 100.0 / NumSectors : 0.0
+	);
+	return true;
+}
+
+static bool CompactFile(const char* Path)
+{
+	uint64 BytesBefore = 0;
+	uint64 BytesAfter = 0;
+	if(!FRegionFile::Compact(Path, &BytesBefore, &BytesAfter))
+	{
+		std::printf("%s: compaction failed, file left as it was\n", Path);
+		return false;
+	}
+
+	std::printf("%s: %.1f KB -> %.1f KB\n", Path, BytesBefore / 1024.0, BytesAfter / 1024.0);
+	return true;
+}
+
+int main(int ArgCount, char** Args)
+{
+	const bool bInfo = ArgCount > 2 && std::strcmp(Args[1], "info") == 0;
+	const bool bCompact = ArgCount > 2 && std::strcmp(Args[1], "compact") == 0;
+	if(!bInfo && !bCompact)
+	{
+		std::printf("Usage: RegionTool info <RegionFiles...>\n       RegionTool compact <RegionFiles...>\n");
+		return 1;
+	}
+
+	// Keep going past bad files so one can't hold up the rest of a world.
+	bool bSucceeded = true;
+	for(int32 Arg = 2; Arg < ArgCount; Arg++)
+	{
+		bSucceeded &= bInfo ? PrintInfo(Args[Arg]) : CompactFile(Args[Arg]);
+	}
+	return bSucceeded ? 0 : 1;
+}
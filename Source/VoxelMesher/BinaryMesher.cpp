@@ -0,0 +1,461 @@
+// Copyright Snaps 2022, All Rights Reserved.
+
+#include "BinaryMesher.h"
+#include "BinaryMesherKernel.h"
+#include "BitMath.h"
+#include <cassert>
+
+#if VOXEL_MESHER_X64
+#if defined(_MSC_VER)
+#include <intrin.h>
+#else
+#include <cpuid.h>
+#endif
+#elif defined(__ARM_NEON) || defined(_M_ARM64)
+#include <arm_neon.h>
+#define VOXEL_MESHER_NEON 1
+#endif
+
+// Columns are 64 bits and the column grid is 64 x 64, whatever the volume size.
+static const int32 ColumnBits = 64;
+static const int32 ColumnGridSize = ColumnBits * ColumnBits;
+
+// Starting slot count of the plane table, kept at most half full.
+static const int32 MinPlaneTableSize = 256;
+
+static const int32 PlaneKeyAOShift = 16;
+
+static uint32 HashPlaneKey(uint32 Key, uint32 TableMask)
+{
+	return (Key * 0x9E3779B1u >> 16) & TableMask;
+}
+
+static uint64 BuildOccupancyRow(const FBlockId* Row, int32 Count)
+{
+	uint64 Bits = 0;
+	for(int32 X = 0; X < Count; X++)
+	{
+		Bits |= (uint64)(Row[X] != BlockAir) << X;
+	}
+	return Bits;
+}
+
+static void CullColumns(const uint64* Columns, const uint64* Neighbours, uint64* OutFaces, int32 Count, uint64 InteriorMask)
+{
+	int32 Index = 0;
+
+#if VOXEL_MESHER_NEON
+	const uint64x2_t Interior = vdupq_n_u64(InteriorMask);
+	for(; Index + 2 <= Count; Index += 2)
+	{
+		const uint64x2_t Faces = vbicq_u64(vld1q_u64(Columns + Index), vld1q_u64(Neighbours + Index));
+		vst1q_u64(OutFaces + Index, vandq_u64(vshrq_n_u64(Faces, 1), Interior));
+	}
+#endif
+
+	for(; Index < Count; Index++)
+	{
+		OutFaces[Index] = ((Columns[Index] & ~Neighbours[Index]) >> 1) & InteriorMask;
+	}
+}
+
+static void CullColumnsAlongAxis(const uint64* Columns, uint64* OutFaces, int32 Count, int32 Shift, uint64 InteriorMask)
+{
+	int32 Index = 0;
+
+#if VOXEL_MESHER_NEON
+	const uint64x2_t Interior = vdupq_n_u64(InteriorMask);
+	for(; Index + 2 <= Count; Index += 2)
+	{
+		const uint64x2_t Column = vld1q_u64(Columns + Index);
+		const uint64x2_t Neighbour = Shift > 0 ? vshrq_n_u64(Column, 1) : vshlq_n_u64(Column, 1);
+		vst1q_u64(OutFaces + Index, vandq_u64(vshrq_n_u64(vbicq_u64(Column, Neighbour), 1), Interior));
+	}
+#endif
+
+	for(; Index < Count; Index++)
+	{
+		const uint64 Column = Columns[Index];
+		const uint64 Neighbour = Shift > 0 ? Column >> 1 : Column << 1;
+		OutFaces[Index] = ((Column & ~Neighbour) >> 1) & InteriorMask;
+	}
+}
+
+#if VOXEL_MESHER_NEON
+const FBinaryMesherKernel BinaryMesherKernelDefault = { "NEON", &BuildOccupancyRow, &CullColumns, &CullColumnsAlongAxis };
+#else
+const FBinaryMesherKernel BinaryMesherKernelDefault = { "Scalar", &BuildOccupancyRow, &CullColumns, &CullColumnsAlongAxis };
+#endif
+
+#if VOXEL_MESHER_X64
+
+// Same checks as NoiseGenerator: the CPU has AVX2 and the OS saves YMM state (XCR0 bits 1 and 2).
+static bool DetectAvx2()
+{
+#if defined(_MSC_VER)
+	int32 Leaf1[4], Leaf7[4];
+	__cpuidex(Leaf1, 1, 0);
+	__cpuidex(Leaf7, 7, 0);
+#else
+	uint32 Leaf1[4], Leaf7[4];
+	__cpuid_count(1, 0, Leaf1[0], Leaf1[1], Leaf1[2], Leaf1[3]);
+	__cpuid_count(7, 0, Leaf7[0], Leaf7[1], Leaf7[2], Leaf7[3]);
+#endif
+
+	const bool bOsXSave = (Leaf1[2] & (1u << 27)) != 0;
+	const bool bAvx = (Leaf1[2] & (1u << 28)) != 0;
+	if(!bOsXSave || !bAvx)
+	{
+		return false;
+	}
+
+#if defined(_MSC_VER)
+	const uint64 XState = _xgetbv(0);
+#else
+	uint32 Low, High;
+	__asm__("xgetbv" : "=a"(Low), "=d"(High) : "c"(0));
+	const uint64 XState = ((uint64)High << 32) | Low;
+#endif
+
+	return (XState & 0x6) == 0x6 && (Leaf7[1] & (1u << 5)) != 0;
+}
+
+#endif
+
+static const FBinaryMesherKernel& GetBestKernel()
+{
+#if VOXEL_MESHER_X64
+	// Cpuid is slow-ish and the answer never changes, ask once.
+	static const bool bAvx2 = DetectAvx2();
+	if(bAvx2)
+	{
+		return BinaryMesherKernelAvx2;
+	}
+#endif
+
+	return BinaryMesherKernelDefault;
+}
+
+FBinaryMesher::FBinaryMesher()
+	: Kernel(&GetBestKernel())
+	, Columns(ColumnGridSize)
+	, FaceColumns(ColumnGridSize)
+	, PlaneTableKeys(MinPlaneTableSize, 0)
+	, PlaneTableIndices(MinPlaneTableSize, 0)
+{
+}
+
+const char* FBinaryMesher::GetSimdPath()
+{
+	return GetBestKernel().Name;
+}
+
+bool FBinaryMesher::BuildOccupancy(const FMeshVolume& Volume)
+{
+	const int32 PaddedSize = Volume.PaddedSize;
+	const int32 NumBlocks = (int32)Volume.Blocks.size();
+	const int32 NumWords = (NumBlocks + ColumnBits - 1) / ColumnBits;
+
+	// Padded rows are only a few blocks over 32, so rather than building each row with a
+	// scalar tail, pack the whole volume 64 blocks at a time and cut the rows out of that.
+	OccupancyStream.resize(NumWords + 1);
+	OccupancyStream[NumWords] = 0;
+	for(int32 Word = 0; Word < NumWords; Word++)
+	{
+		const int32 First = Word * ColumnBits;
+		const int32 Count = NumBlocks - First < ColumnBits ? NumBlocks - First : ColumnBits;
+		OccupancyStream[Word] = Kernel->BuildOccupancyRow(Volume.Blocks.data() + First, Count);
+	}
+
+	const uint64 FullColumn = BitMath::LowBitsMask64(PaddedSize);
+	uint64 AnySolid = 0;
+	uint64 AllSolid = FullColumn;
+
+	for(int32 Y = 0; Y < PaddedSize; Y++)
+	{
+		for(int32 Z = 0; Z < PaddedSize; Z++)
+		{
+			const uint32 BitOffset = (uint32)((Z + Y * PaddedSize) * PaddedSize);
+			const uint32 Word = BitOffset / ColumnBits;
+			const uint32 Shift = BitOffset % ColumnBits;
+
+			uint64 Bits = OccupancyStream[Word] >> Shift;
+			if(Shift)
+			{
+				Bits |= OccupancyStream[Word + 1] << (ColumnBits - Shift);
+			}
+			Bits &= FullColumn;
+
+			Columns[Y * ColumnBits + Z] = Bits;
+			AnySolid |= Bits;
+			AllSolid &= Bits;
+		}
+	}
+
+	// Nothing solid or nothing but solid, no faces either way.
+	return AnySolid != 0 && AllSolid != FullColumn;
+}
+
+uint32 FBinaryMesher::FindOrAddPlane(uint32 Key, int32 PlaneSize)
+{
+	const uint32 TableMask = (uint32)PlaneTableKeys.size() - 1;
+	uint32 Slot = HashPlaneKey(Key, TableMask);
+	while(PlaneTableKeys[Slot] != 0)
+	{
+		if(PlaneTableKeys[Slot] == Key)
+		{
+			return PlaneTableIndices[Slot];
+		}
+		Slot = (Slot + 1) & TableMask;
+	}
+
+	const uint32 PlaneIndex = (uint32)PlaneKeys.size();
+	PlaneTableKeys[Slot] = Key;
+	PlaneTableIndices[Slot] = (uint16)PlaneIndex;
+	PlaneKeys.push_back(Key);
+	PlaneSlots.push_back(Slot);
+	PlaneSlices.push_back(0);
+
+	// Planes are always left zeroed by MergePlanes, only new ones need clearing.
+	const size_t Required = PlaneKeys.size() * PlaneSize;
+	if(Planes.size() < Required)
+	{
+		Planes.resize(Required, 0);
+	}
+
+	if(PlaneKeys.size() * 2 > PlaneTableKeys.size())
+	{
+		GrowPlaneTable();
+	}
+	return PlaneIndex;
+}
+
+void FBinaryMesher::GrowPlaneTable()
+{
+	const size_t NewSize = PlaneTableKeys.size() * 2;
+	PlaneTableKeys.assign(NewSize, 0);
+	PlaneTableIndices.assign(NewSize, 0);
+
+	const uint32 TableMask = (uint32)NewSize - 1;
+	for(size_t PlaneIndex = 0; PlaneIndex < PlaneKeys.size(); PlaneIndex++)
+	{
+		uint32 Slot = HashPlaneKey(PlaneKeys[PlaneIndex], TableMask);
+		while(PlaneTableKeys[Slot] != 0)
+		{
+			Slot = (Slot + 1) & TableMask;
+		}
+		PlaneTableKeys[Slot] = PlaneKeys[PlaneIndex];
+		PlaneTableIndices[Slot] = (uint16)PlaneIndex;
+		PlaneSlots[PlaneIndex] = Slot;
+	}
+}
+
+void FBinaryMesher::MergePlanes(EBlockFace Face, int32 Size, bool bTransposed, std::vector<FMeshQuad>& OutQuads)
+{
+	const int32 PlaneSize = Size * Size;
+
+	for(size_t PlaneIndex = 0; PlaneIndex < PlaneKeys.size(); PlaneIndex++)
+	{
+		const FBlockId BlockId = (FBlockId)PlaneKeys[PlaneIndex];
+		const uint8 AO = (uint8)(PlaneKeys[PlaneIndex] >> PlaneKeyAOShift);
+		uint64* Plane = Planes.data() + PlaneIndex * PlaneSize;
+
+		// Bits run along V and rows along U when transposed.
+		const bool bMergeBits = bTransposed ? IsAOConstantAlongV(AO) : IsAOConstantAlongU(AO);
+		const bool bMergeRows = bTransposed ? IsAOConstantAlongU(AO) : IsAOConstantAlongV(AO);
+
+		// With AO in the key most planes only have faces in a few slices.
+		uint64 Slices = PlaneSlices[PlaneIndex];
+		while(Slices)
+		{
+			const int32 Slice = (int32)BitMath::CountTrailingZeros64(Slices);
+			Slices &= Slices - 1;
+
+			uint64* Rows = Plane + Slice * Size;
+			for(int32 Row = 0; Row < Size; Row++)
+			{
+				while(Rows[Row])
+				{
+					// First run of set bits in this row.
+					const uint32 Bit = BitMath::CountTrailingZeros64(Rows[Row]);
+					const uint32 Width = bMergeBits ? BitMath::CountTrailingZeros64(~(Rows[Row] >> Bit)) : 1;
+					const uint64 RunMask = BitMath::LowBitsMask64(Width) << Bit;
+
+					// Extend down while the next row covers the whole run.
+					int32 Height = 1;
+					while(bMergeRows && Row + Height < Size && (Rows[Row + Height] & RunMask) == RunMask)
+					{
+						Rows[Row + Height] &= ~RunMask;
+						Height++;
+					}
+
+					Rows[Row] &= ~RunMask;
+					OutQuads.push_back(bTransposed ?
+						MakeFaceQuad(Face, Slice, Row, (int32)Bit, Height, (int32)Width, BlockId, AO) :
+						MakeFaceQuad(Face, Slice, (int32)Bit, Row, (int32)Width, Height, BlockId, AO)
+					);
+				}
+			}
+		}
+
+		PlaneTableKeys[PlaneSlots[PlaneIndex]] = 0;
+	}
+
+	PlaneKeys.clear();
+	PlaneSlots.clear();
+	PlaneSlices.clear();
+}
+
+uint64 FBinaryMesher::BuildColumnAO(EBlockFace Face, int32 Y, int32 Z, uint64 OutCornerBits[8]) const
+{
+	int32 NormalAxis, UAxis, VAxis;
+	GetFaceAxes(Face, NormalAxis, UAxis, VAxis);
+
+	// Occupancy of the 3x3 voxels in the layer in front of the face, [V][U] offsets from -1 to 1.
+	// Bit X of a column shifted down by 1 + DX is the voxel at interior X + DX.
+	uint64 Around[3][3];
+	uint64 Occluded = 0;
+	for(int32 DV = -1; DV <= 1; DV++)
+	{
+		for(int32 DU = -1; DU <= 1; DU++)
+		{
+			int32 Offset[3];
+			Offset[NormalAxis] = IsPositiveFace(Face) ? 1 : -1;
+			Offset[UAxis] = DU;
+			Offset[VAxis] = DV;
+
+			const uint64 Column = Columns[(Y + 1 + Offset[1]) * ColumnBits + (Z + 1 + Offset[2])] >> (1 + Offset[0]);
+			Around[DV + 1][DU + 1] = Column;
+			Occluded |= (DU != 0 || DV != 0) ? Column : 0;
+		}
+	}
+
+	// ComputeCornerAO for 64 voxels at once: nothing when both sides are set, otherwise one side
+	// and the diagonal give 1, either one of them alone 2 and neither 3.
+	static const int32 CornerU[4] = { 0, 2, 2, 0 };
+	static const int32 CornerV[4] = { 0, 0, 2, 2 };
+	for(int32 Corner = 0; Corner < 4; Corner++)
+	{
+		const uint64 Side1 = Around[1][CornerU[Corner]];
+		const uint64 Side2 = Around[CornerV[Corner]][1];
+		const uint64 Diagonal = Around[CornerV[Corner]][CornerU[Corner]];
+		const uint64 Open = ~(Side1 & Side2);
+		const uint64 OneSide = Side1 ^ Side2;
+
+		OutCornerBits[Corner * 2] = Open & ~(OneSide ^ Diagonal);
+		OutCornerBits[Corner * 2 + 1] = Open & ~(OneSide & Diagonal);
+	}
+	return Occluded;
+}
+
+void FBinaryMesher::MeshFace(const FMeshVolume& Volume, EBlockFace Face, std::vector<FMeshQuad>& OutQuads)
+{
+	const int32 Size = Volume.Size;
+	const int32 PlaneSize = Size * Size;
+	const uint64 InteriorMask = BitMath::LowBitsMask64(Size);
+
+	// Only the interior Y rows are culled, every Z column of them in one SIMD friendly run.
+	const int32 FirstColumn = ColumnBits;
+	const int32 NumColumns = Size * ColumnBits;
+	const uint64* Source = Columns.data() + FirstColumn;
+	uint64* Faces = FaceColumns.data() + FirstColumn;
+
+	switch(Face)
+	{
+		case EBlockFace::PosX: Kernel->CullColumnsAlongAxis(Source, Faces, NumColumns, 1, InteriorMask); break;
+		case EBlockFace::NegX: Kernel->CullColumnsAlongAxis(Source, Faces, NumColumns, -1, InteriorMask); break;
+		case EBlockFace::PosY: Kernel->CullColumns(Source, Source + ColumnBits, Faces, NumColumns, InteriorMask); break;
+		case EBlockFace::NegY: Kernel->CullColumns(Source, Source - ColumnBits, Faces, NumColumns, InteriorMask); break;
+		case EBlockFace::PosZ: Kernel->CullColumns(Source, Source + 1, Faces, NumColumns, InteriorMask); break;
+		case EBlockFace::NegZ: Kernel->CullColumns(Source, Source - 1, Faces, NumColumns, InteriorMask); break;
+		default: break;
+	}
+
+	// Sort visible faces into per block planes. X faces slice along X with rows along Z and bits along Y,
+	// Z faces slice along Z with rows along Y and bits along X, Y faces slice along Y with rows along Z
+	// and bits along X, which is transposed compared to the face's own U (Z) and V (X) axes.
+	const int32 PaddedSize = Volume.PaddedSize;
+	const FBlockId* Origin = Volume.Blocks.data() + Volume.Index(0, 0, 0);
+	const int32 NormalAxis = (int32)Face / 2;
+	const uint32 OpenKey = (uint32)QuadNoOcclusion << PlaneKeyAOShift;
+
+	for(int32 Y = 0; Y < Size; Y++)
+	{
+		for(int32 Z = 0; Z < Size; Z++)
+		{
+			uint64 FaceBits = FaceColumns[(Y + 1) * ColumnBits + (Z + 1)];
+			if(FaceBits == 0)
+			{
+				continue;
+			}
+
+			uint64 CornerBits[8];
+			const uint64 Occluded = bAmbientOcclusion ? BuildColumnAO(Face, Y, Z, CornerBits) : 0;
+			const FBlockId* Row = Origin + (Z + Y * PaddedSize) * PaddedSize;
+
+			while(FaceBits)
+			{
+				const int32 X = (int32)BitMath::CountTrailingZeros64(FaceBits);
+				FaceBits &= FaceBits - 1;
+
+				uint32 Key = Row[X] | OpenKey;
+				if((Occluded >> X) & 1)
+				{
+					uint32 AO = 0;
+					for(int32 Bit = 0; Bit < 8; Bit++)
+					{
+						AO |= (uint32)((CornerBits[Bit] >> X) & 1) << Bit;
+					}
+					Key = Row[X] | AO << PlaneKeyAOShift;
+				}
+
+				const uint32 PlaneIndex = FindOrAddPlane(Key, PlaneSize);
+				uint64* Plane = Planes.data() + (size_t)PlaneIndex * PlaneSize;
+				if(NormalAxis == 0)
+				{
+					Plane[X * Size + Z] |= 1ull << Y;
+					PlaneSlices[PlaneIndex] |= 1ull << X;
+				}
+				else if(NormalAxis == 1)
+				{
+					Plane[Y * Size + Z] |= 1ull << X;
+					PlaneSlices[PlaneIndex] |= 1ull << Y;
+				}
+				else
+				{
+					Plane[Z * Size + Y] |= 1ull << X;
+					PlaneSlices[PlaneIndex] |= 1ull << Z;
+				}
+			}
+		}
+	}
+
+	MergePlanes(Face, Size, NormalAxis == 1, OutQuads);
+}
+
+void FBinaryMesher::MeshQuads(const FMeshVolume& Volume, std::vector<FMeshQuad>& OutQuads)
+{
+	// Bigger volumes would need more than 64 bits per padded column.
+	assert(Volume.Size <= MaxBinaryMeshSize);
+	if(Volume.Size > MaxBinaryMeshSize || !BuildOccupancy(Volume))
+	{
+		return;
+	}
+
+	for(int32 Face = 0; Face < (int32)EBlockFace::Count; Face++)
+	{
+		MeshFace(Volume, (EBlockFace)Face, OutQuads);
+	}
+}
+
+void FBinaryMesher::Mesh(const FMeshVolume& Volume, FChunkMesh& OutMesh)
+{
+	Quads.clear();
+	MeshQuads(Volume, Quads);
+
+	OutMesh.Reset();
+	for(const FMeshQuad& Quad : Quads)
+	{
+		OutMesh.AddQuad(Quad);
+	}
+}
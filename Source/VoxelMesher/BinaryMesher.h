@@ -0,0 +1,95 @@
+// Copyright Snaps 2022, All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "MeshTypes.h"
+
+struct FBinaryMesherKernel;
+
+// Largest volume the binary mesher takes, a padded column has to fit in 64 bits.
+static const int32 MaxBinaryMeshSize = 62;
+static_assert(ChunkSize <= MaxBinaryMeshSize, "Chunks no longer fit the binary mesher's 64 bit columns");
+
+/*
+	Bitmask based greedy mesher. Occupancy is stored as one uint64 per X column
+	of the padded volume, so face culling for 64 voxels at a time is a shift and
+	an and-not: X faces compare a column against itself shifted by one, Y and Z
+	faces compare it against the neighbouring column. Visible faces are then
+	sorted into per block bit planes and merged with bit scans instead of per
+	voxel compares.
+
+	Ambient occlusion comes out of the same columns: the 3x3 columns in front of
+	a face give the occluders around every corner for the whole column at once.
+	Planes are per block and AO, so only faces with the same AO merge.
+
+	Covers exactly the same faces with the same AO as FGreedyMesher, quads can
+	differ slightly since Y faces merge along X first. Volume size must be
+	MaxBinaryMeshSize or less, bigger volumes produce no quads. Keeps scratch memory
+	between calls, use one mesher per thread.
+*/
+class FBinaryMesher
+{
+public:
+
+	FBinaryMesher();
+
+	void MeshQuads(const FMeshVolume& Volume, std::vector<FMeshQuad>& OutQuads);
+	void Mesh(const FMeshVolume& Volume, FChunkMesh& OutMesh);
+
+	// On by default. Off leaves every quad at QuadNoOcclusion and merges on block id alone.
+	void SetAmbientOcclusion(bool bEnabled)
+	{
+		bAmbientOcclusion = bEnabled;
+	}
+
+	// Name of the SIMD path meshers use on this CPU, "AVX2", "NEON" or "Scalar".
+	static const char* GetSimdPath();
+
+private:
+
+	// Fills the occupancy columns. Returns false if there can't be any faces.
+	bool BuildOccupancy(const FMeshVolume& Volume);
+
+	// Culls one face direction and merges the visible faces into quads.
+	void MeshFace(const FMeshVolume& Volume, EBlockFace Face, std::vector<FMeshQuad>& OutQuads);
+
+	// AO of every voxel's Face side in the interior column at Y, Z, as two bit masks per corner, low bit
+	// first, see FMeshQuad::AO. Returns the voxels with anything around them, all others are unoccluded.
+	uint64 BuildColumnAO(EBlockFace Face, int32 Y, int32 Z, uint64 OutCornerBits[8]) const;
+
+	// Greedy merge of every plane for one face direction, consumes the planes.
+	// Transposed planes have rows along the face's U axis and bits along V.
+	void MergePlanes(EBlockFace Face, int32 Size, bool bTransposed, std::vector<FMeshQuad>& OutQuads);
+
+	// Plane for a block id and AO packed as the block in the low 16 bits and AO above it.
+	uint32 FindOrAddPlane(uint32 Key, int32 PlaneSize);
+	void GrowPlaneTable();
+
+	bool 					bAmbientOcclusion = true;
+
+	// Column loops for the best instruction set the CPU supports.
+	const FBinaryMesherKernel* 	Kernel;
+
+	// Occupancy of the whole padded volume as one bit stream in block order.
+	std::vector<uint64> 	OccupancyStream;
+
+	// Occupancy of the padded volume, indexed [Y * 64 + Z] with bits along X.
+	std::vector<uint64> 	Columns;
+
+	// Visible faces for the direction being meshed, same layout as Columns minus the padding bit.
+	std::vector<uint64> 	FaceColumns;
+
+	// Open addressed table from plane key to plane index, 0 keys are empty slots.
+	std::vector<uint32> 	PlaneTableKeys;
+	std::vector<uint16> 	PlaneTableIndices;
+
+	// Face planes for the face direction being merged, [Slice][Row] of bit rows, with
+	// the key, table slot and a mask of the slices in use for each.
+	std::vector<uint32> 	PlaneKeys;
+	std::vector<uint32> 	PlaneSlots;
+	std::vector<uint64> 	PlaneSlices;
+	std::vector<uint64> 	Planes;
+
+	std::vector<FMeshQuad> 	Quads;
+};
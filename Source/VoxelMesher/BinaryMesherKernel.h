@@ -0,0 +1,43 @@
+// Copyright Snaps 2022, All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "MeshTypes.h"
+
+// AVX2 is picked at runtime on x64, other platforms only have the default kernel.
+#if defined(_M_X64) || defined(__x86_64__)
+#define VOXEL_MESHER_X64 1
+#endif
+
+/*
+	The column loops of FBinaryMesher that have a vector version. The default
+	kernel is scalar, or NEON on ARM where it is always there. The AVX2 one
+	lives in its own file built with AVX2 enabled, so the rest of the mesher
+	still runs on any x64 CPU and FBinaryMesher only picks it after checking
+	the CPU supports it.
+*/
+
+// Bit X is set when Row[X] is solid, for up to 64 blocks.
+typedef uint64 (*FBuildOccupancyRowFunction)(const FBlockId* Row, int32 Count);
+
+// Faces where a solid voxel in Columns has air at the same bit of Neighbours. Results are
+// shifted down by the padding bit so bit 0 is the first interior voxel.
+typedef void (*FCullColumnsFunction)(const uint64* Columns, const uint64* Neighbours, uint64* OutFaces, int32 Count, uint64 InteriorMask);
+
+// Faces along the column itself. Shift is +1 for the positive direction (air after the
+// voxel) and -1 for the negative direction (air before it).
+typedef void (*FCullColumnsAlongAxisFunction)(const uint64* Columns, uint64* OutFaces, int32 Count, int32 Shift, uint64 InteriorMask);
+
+struct FBinaryMesherKernel
+{
+	const char* 					Name = nullptr;
+	FBuildOccupancyRowFunction 		BuildOccupancyRow = nullptr;
+	FCullColumnsFunction 			CullColumns = nullptr;
+	FCullColumnsAlongAxisFunction 	CullColumnsAlongAxis = nullptr;
+};
+
+extern const FBinaryMesherKernel BinaryMesherKernelDefault;
+
+// Null members when not built for x64.
+extern const FBinaryMesherKernel BinaryMesherKernelAvx2;
@@ -0,0 +1,80 @@
+// Copyright Snaps 2022, All Rights Reserved.
+
+#include "BinaryMesherKernel.h"
+
+// Built with AVX2 enabled, only called once FBinaryMesher has checked the CPU supports it.
+
+#if VOXEL_MESHER_X64
+
+#include <immintrin.h>
+
+static uint64 BuildOccupancyRowAvx2(const FBlockId* Row, int32 Count)
+{
+	uint64 Bits = 0;
+	int32 X = 0;
+
+	// 32 blocks per step: compare against air, narrow to bytes and take the sign bits.
+	const __m256i Air = _mm256_setzero_si256();
+	for(; X + 32 <= Count; X += 32)
+	{
+		const __m256i Low = _mm256_cmpeq_epi16(_mm256_loadu_si256((const __m256i*)(Row + X)), Air);
+		const __m256i High = _mm256_cmpeq_epi16(_mm256_loadu_si256((const __m256i*)(Row + X + 16)), Air);
+		const __m256i Packed = _mm256_permute4x64_epi64(_mm256_packs_epi16(Low, High), 0xD8);
+		const uint32 AirBits = (uint32)_mm256_movemask_epi8(Packed);
+		Bits |= (uint64)(~AirBits) << X;
+	}
+
+	for(; X < Count; X++)
+	{
+		Bits |= (uint64)(Row[X] != BlockAir) << X;
+	}
+	return Bits;
+}
+
+static void CullColumnsAvx2(const uint64* Columns, const uint64* Neighbours, uint64* OutFaces, int32 Count, uint64 InteriorMask)
+{
+	int32 Index = 0;
+
+	const __m256i Interior = _mm256_set1_epi64x((long long)InteriorMask);
+	for(; Index + 4 <= Count; Index += 4)
+	{
+		const __m256i Column = _mm256_loadu_si256((const __m256i*)(Columns + Index));
+		const __m256i Neighbour = _mm256_loadu_si256((const __m256i*)(Neighbours + Index));
+		const __m256i Faces = _mm256_andnot_si256(Neighbour, Column);
+		_mm256_storeu_si256((__m256i*)(OutFaces + Index), _mm256_and_si256(_mm256_srli_epi64(Faces, 1), Interior));
+	}
+
+	for(; Index < Count; Index++)
+	{
+		OutFaces[Index] = ((Columns[Index] & ~Neighbours[Index]) >> 1) & InteriorMask;
+	}
+}
+
+static void CullColumnsAlongAxisAvx2(const uint64* Columns, uint64* OutFaces, int32 Count, int32 Shift, uint64 InteriorMask)
+{
+	int32 Index = 0;
+
+	const __m256i Interior = _mm256_set1_epi64x((long long)InteriorMask);
+	for(; Index + 4 <= Count; Index += 4)
+	{
+		const __m256i Column = _mm256_loadu_si256((const __m256i*)(Columns + Index));
+		const __m256i Neighbour = Shift > 0 ? _mm256_srli_epi64(Column, 1) : _mm256_slli_epi64(Column, 1);
+		const __m256i Faces = _mm256_andnot_si256(Neighbour, Column);
+		_mm256_storeu_si256((__m256i*)(OutFaces + Index), _mm256_and_si256(_mm256_srli_epi64(Faces, 1), Interior));
+	}
+
+	for(; Index < Count; Index++)
+	{
+		const uint64 Column = Columns[Index];
+		const uint64 Neighbour = Shift > 0 ? Column >> 1 : Column << 1;
+		OutFaces[Index] = ((Column & ~Neighbour) >> 1) & InteriorMask;
+	}
+}
+
+const FBinaryMesherKernel BinaryMesherKernelAvx2 = { "AVX2", &BuildOccupancyRowAvx2, &CullColumnsAvx2, &CullColumnsAlongAxisAvx2 };
+
+#else
+
+const FBinaryMesherKernel BinaryMesherKernelAvx2 = { nullptr, nullptr, nullptr, nullptr };
+
+#endif
@@ -0,0 +1,189 @@
+// Copyright Snaps 2022, All Rights Reserved.
+
+#include "GreedyMesher.h"
+
+// Distance between neighbouring blocks along X, Y and Z in a padded volume.
+static void GetAxisStrides(const FMeshVolume& Volume, int32 OutStrides[3])
+{
+	OutStrides[0] = 1;
+	OutStrides[1] = Volume.PaddedSize * Volume.PaddedSize;
+	OutStrides[2] = Volume.PaddedSize;
+}
+
+void FGreedyMesher::BuildFaceMask(const FMeshVolume& Volume, EBlockFace Face, int32 Slice)
+{
+	int32 NormalAxis, UAxis, VAxis;
+	GetFaceAxes(Face, NormalAxis, UAxis, VAxis);
+
+	int32 Strides[3];
+	GetAxisStrides(Volume, Strides);
+
+	const int32 Size = Volume.Size;
+	const int32 NeighbourOffset = IsPositiveFace(Face) ? Strides[NormalAxis] : -Strides[NormalAxis];
+	const int32 UStride = Strides[UAxis];
+	const int32 VStride = Strides[VAxis];
+	const FBlockId* Blocks = Volume.Blocks.data() + Volume.Index(0, 0, 0) + Slice * Strides[NormalAxis];
+
+	for(int32 V = 0; V < Size; V++)
+	{
+		const FBlockId* Row = Blocks + V * VStride;
+		uint32* MaskRow = Mask.data() + V * Size;
+
+		for(int32 U = 0; U < Size; U++)
+		{
+			const FBlockId* Block = Row + U * UStride;
+
+			// A face is visible when a solid block touches air.
+			const bool bVisible = *Block != BlockAir && Block[NeighbourOffset] == BlockAir;
+			if(!bVisible)
+			{
+				MaskRow[U] = BlockAir;
+				continue;
+			}
+
+			uint8 AO = QuadNoOcclusion;
+			if(bAmbientOcclusion)
+			{
+				// Occluders sit in the air layer the face looks into, around each corner.
+				const FBlockId* Front = Block + NeighbourOffset;
+				const bool bLowU = Front[-UStride] != BlockAir;
+				const bool bHighU = Front[UStride] != BlockAir;
+				const bool bLowV = Front[-VStride] != BlockAir;
+				const bool bHighV = Front[VStride] != BlockAir;
+
+				AO = ComputeCornerAO(bLowU, bLowV, Front[-UStride - VStride] != BlockAir)
+					| ComputeCornerAO(bHighU, bLowV, Front[UStride - VStride] != BlockAir) << 2
+					| ComputeCornerAO(bHighU, bHighV, Front[UStride + VStride] != BlockAir) << 4
+					| ComputeCornerAO(bLowU, bHighV, Front[-UStride + VStride] != BlockAir) << 6;
+			}
+
+			MaskRow[U] = *Block | (uint32)AO << MaskAOShift;
+		}
+	}
+}
+
+void FGreedyMesher::MeshQuads(const FMeshVolume& Volume, std::vector<FMeshQuad>& OutQuads)
+{
+	const int32 Size = Volume.Size;
+	Mask.resize(Size * Size);
+
+	for(int32 FaceIndex = 0; FaceIndex < (int32)EBlockFace::Count; FaceIndex++)
+	{
+		const EBlockFace Face = (EBlockFace)FaceIndex;
+
+		for(int32 Slice = 0; Slice < Size; Slice++)
+		{
+			BuildFaceMask(Volume, Face, Slice);
+
+			for(int32 V = 0; V < Size; V++)
+			{
+				uint32* MaskRow = Mask.data() + V * Size;
+
+				for(int32 U = 0; U < Size;)
+				{
+					const uint32 Key = MaskRow[U];
+					if(Key == BlockAir)
+					{
+						U++;
+						continue;
+					}
+
+					// Grow along U while the block and AO match, as long as the AO doesn't change along U.
+					const uint8 AO = (uint8)(Key >> MaskAOShift);
+					const int32 MaxWidth = IsAOConstantAlongU(AO) ? Size - U : 1;
+					const int32 MaxHeight = IsAOConstantAlongV(AO) ? Size - V : 1;
+
+					int32 Width = 1;
+					while(Width < MaxWidth && MaskRow[U + Width] == Key)
+					{
+						Width++;
+					}
+
+					// Grow along V while the whole row underneath matches.
+					int32 Height = 1;
+					for(; Height < MaxHeight; Height++)
+					{
+						const uint32* NextRow = MaskRow + Height * Size;
+
+						bool bRowMatches = true;
+						for(int32 Offset = 0; Offset < Width && bRowMatches; Offset++)
+						{
+							bRowMatches = NextRow[U + Offset] == Key;
+						}
+
+						if(!bRowMatches)
+						{
+							break;
+						}
+					}
+
+					OutQuads.push_back(MakeFaceQuad(Face, Slice, U, V, Width, Height, (FBlockId)Key, AO));
+
+					// Consume the merged faces so they don't get emitted again.
+					for(int32 Row = 0; Row < Height; Row++)
+					{
+						uint32* ClearRow = MaskRow + Row * Size + U;
+						for(int32 Offset = 0; Offset < Width; Offset++)
+						{
+							ClearRow[Offset] = BlockAir;
+						}
+					}
+
+					U += Width;
+				}
+			}
+		}
+	}
+}
+
+void FGreedyMesher::MeshQuadsNaive(const FMeshVolume& Volume, std::vector<FMeshQuad>& OutQuads)
+{
+	const int32 Size = Volume.Size;
+	Mask.resize(Size * Size);
+
+	for(int32 FaceIndex = 0; FaceIndex < (int32)EBlockFace::Count; FaceIndex++)
+	{
+		const EBlockFace Face = (EBlockFace)FaceIndex;
+
+		for(int32 Slice = 0; Slice < Size; Slice++)
+		{
+			BuildFaceMask(Volume, Face, Slice);
+
+			for(int32 V = 0; V < Size; V++)
+			{
+				for(int32 U = 0; U < Size; U++)
+				{
+					const uint32 Key = Mask[U + V * Size];
+					if(Key != BlockAir)
+					{
+						OutQuads.push_back(MakeFaceQuad(Face, Slice, U, V, 1, 1, (FBlockId)Key, (uint8)(Key >> MaskAOShift)));
+					}
+				}
+			}
+		}
+	}
+}
+
+void FGreedyMesher::Mesh(const FMeshVolume& Volume, FChunkMesh& OutMesh)
+{
+	Quads.clear();
+	MeshQuads(Volume, Quads);
+
+	OutMesh.Reset();
+	for(const FMeshQuad& Quad : Quads)
+	{
+		OutMesh.AddQuad(Quad);
+	}
+}
+
+void FGreedyMesher::MeshNaive(const FMeshVolume& Volume, FChunkMesh& OutMesh)
+{
+	Quads.clear();
+	MeshQuadsNaive(Volume, Quads);
+
+	OutMesh.Reset();
+	for(const FMeshQuad& Quad : Quads)
+	{
+		OutMesh.AddQuad(Quad);
+	}
+}
@@ -0,0 +1,47 @@
+// Copyright Snaps 2022, All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "MeshTypes.h"
+
+/*
+	Greedy chunk mesher. For every face direction and slice of the volume it
+	builds a mask of visible faces, then merges runs of the same block id into
+	the largest rectangles it can find. Faces carry ambient occlusion from the
+	blocks around their corners and only merge with faces of the same block and
+	the same AO. Keeps its scratch memory between calls, so use one mesher per
+	thread.
+*/
+class FGreedyMesher
+{
+public:
+
+	// Merged quads for every visible face in the volume.
+	void MeshQuads(const FMeshVolume& Volume, std::vector<FMeshQuad>& OutQuads);
+
+	// One quad per visible face, no merging. Baseline to compare against.
+	void MeshQuadsNaive(const FMeshVolume& Volume, std::vector<FMeshQuad>& OutQuads);
+
+	// Same as above but straight to render vertices.
+	void Mesh(const FMeshVolume& Volume, FChunkMesh& OutMesh);
+	void MeshNaive(const FMeshVolume& Volume, FChunkMesh& OutMesh);
+
+	// On by default. Off leaves every quad at QuadNoOcclusion and merges on block id alone.
+	void SetAmbientOcclusion(bool bEnabled)
+	{
+		bAmbientOcclusion = bEnabled;
+	}
+
+private:
+
+	// Mask entries are the block id in the low 16 bits and the face's AO above it, 0 for no face.
+	static const int32 MaskAOShift = 16;
+
+	// Fills Mask with every visible face in one slice.
+	void BuildFaceMask(const FMeshVolume& Volume, EBlockFace Face, int32 Slice);
+
+	bool 					bAmbientOcclusion = true;
+	std::vector<uint32> 	Mask;
+	std::vector<FMeshQuad> 	Quads;
+};
@@ -0,0 +1,60 @@
+// Copyright Snaps 2022, All Rights Reserved.
+
+#include "LodMesher.h"
+
+// Node meshes come out in voxel units, a node has to fit the packed vertex position.
+static_assert((ChunkSize << FLodMesher::MaxLod) <= MaxVertexPosition, "LOD nodes too big for FMeshVertex positions");
+
+// Out of line definition, std::min and std::max take it by reference.
+const int32 FLodMesher::MaxLod;
+
+void FLodMesher::MeshQuads(const FMeshVolume& Volume, uint8 WalledSides, std::vector<FMeshQuad>& OutQuads)
+{
+	if(WalledSides == 0)
+	{
+		Mesher.MeshQuads(Volume, OutQuads);
+		return;
+	}
+
+	// Clear the border layer on every walled side of a copy.
+	Walled.Size = Volume.Size;
+	Walled.PaddedSize = Volume.PaddedSize;
+	Walled.Blocks = Volume.Blocks;
+
+	const int32 Size = Volume.Size;
+	for(int32 Face = 0; Face < (int32)EBlockFace::Count; Face++)
+	{
+		if(!(WalledSides & GetSideBit((EBlockFace)Face)))
+		{
+			continue;
+		}
+
+		int32 NormalAxis, UAxis, VAxis;
+		GetFaceAxes((EBlockFace)Face, NormalAxis, UAxis, VAxis);
+
+		int32 Position[3];
+		Position[NormalAxis] = IsPositiveFace((EBlockFace)Face) ? Size : -1;
+		for(int32 V = -1; V <= Size; V++)
+		for(int32 U = -1; U <= Size; U++)
+		{
+			Position[UAxis] = U;
+			Position[VAxis] = V;
+			Walled.Set(Position[0], Position[1], Position[2], BlockAir);
+		}
+	}
+
+	Mesher.MeshQuads(Walled, OutQuads);
+}
+
+void FLodMesher::Mesh(const FMeshVolume& Volume, int32 Lod, uint8 WalledSides, FChunkMesh& OutMesh)
+{
+	Quads.clear();
+	MeshQuads(Volume, WalledSides, Quads);
+
+	const int32 Scale = GetScale(Lod);
+	OutMesh.Reset();
+	for(const FMeshQuad& Quad : Quads)
+	{
+		OutMesh.AddQuad(Quad, Scale);
+	}
+}
@@ -0,0 +1,53 @@
+// Copyright Snaps 2022, All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "BinaryMesher.h"
+#include "MeshTypes.h"
+
+/*
+	Mesher for downsampled chunks. The volume holds LOD cells instead of voxels,
+	each cell standing for 2^Lod voxels along every axis, and the mesh comes out
+	scaled back up to voxel units. A node at LOD n covers 2^n chunks per axis
+	for the same number of cells, so its triangle count is close to that of a
+	single full detail chunk.
+
+	Neighbouring nodes at different LODs don't agree on where the surface is,
+	which would leave cracks along their shared border. Sides in WalledSides
+	(one bit per EBlockFace) ignore the volume's border and emit every face
+	there as if the neighbour were air, closing the node off with a wall of
+	large merged quads that acts as its skirt. Both nodes on a LOD border are
+	walled, so any gap between their surfaces is covered by one of the walls.
+	Sides against the same LOD cull against the border as usual.
+
+	Keeps scratch memory between calls, use one mesher per thread.
+*/
+class FLodMesher
+{
+public:
+
+	static const int32 MaxLod = 3;
+
+	static int32 GetScale(int32 Lod)
+	{
+		return 1 << Lod;
+	}
+
+	static uint8 GetSideBit(EBlockFace Face)
+	{
+		return (uint8)(1 << (int32)Face);
+	}
+
+	// Appends quads in cell units.
+	void MeshQuads(const FMeshVolume& Volume, uint8 WalledSides, std::vector<FMeshQuad>& OutQuads);
+
+	// Render vertices in voxel units.
+	void Mesh(const FMeshVolume& Volume, int32 Lod, uint8 WalledSides, FChunkMesh& OutMesh);
+
+private:
+
+	FBinaryMesher 			Mesher;
+	FMeshVolume 			Walled;
+	std::vector<FMeshQuad> 	Quads;
+};
@@ -0,0 +1,35 @@
+// Copyright Snaps 2022, All Rights Reserved.
+
+#include "MeshTypes.h"
+
+void FChunkMesh::AddQuad(const FMeshQuad& Quad, int32 Scale)
+{
+	int32 NormalAxis, UAxis, VAxis;
+	GetFaceAxes(Quad.Face, NormalAxis, UAxis, VAxis);
+	const bool bPositive = IsPositiveFace(Quad.Face);
+
+	const int32 Origin[3] = { Quad.X * Scale, Quad.Y * Scale, Quad.Z * Scale };
+
+	// Corners go (0,0) (W,0) (W,H) (0,H) in face space.
+	const int32 CornerU[4] = { 0, Quad.Width * Scale, Quad.Width * Scale, 0 };
+	const int32 CornerV[4] = { 0, 0, Quad.Height * Scale, Quad.Height * Scale };
+
+	// QuadIndexPattern splits along the first and third vertex. The shared edge
+	// runs through the darker pair of opposite corners, otherwise a lone dark
+	// corner shades one triangle instead of fading across the quad, so start
+	// from corner 1 when that's the 1-3 pair.
+	const int32 Diagonal = GetCornerAO(Quad.AO, 0) + GetCornerAO(Quad.AO, 2) > GetCornerAO(Quad.AO, 1) + GetCornerAO(Quad.AO, 3) ? 1 : 0;
+
+	// U x V points along +normal, so positive faces are counter clockwise going
+	// round the corners forwards and negative faces go backwards to face outwards.
+	const int32 Step = bPositive ? 1 : 3;
+
+	for(int32 Vertex = 0; Vertex < 4; Vertex++)
+	{
+		const int32 Corner = (Diagonal + Vertex * Step) & 3;
+		int32 Position[3] = { Origin[0], Origin[1], Origin[2] };
+		Position[UAxis] += CornerU[Corner];
+		Position[VAxis] += CornerV[Corner];
+		Vertices.push_back(PackVertex(Position[0], Position[1], Position[2], Quad.Face, GetCornerAO(Quad.AO, Corner), Quad.BlockId));
+	}
+}
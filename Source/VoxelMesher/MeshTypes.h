@@ -0,0 +1,223 @@
+// Copyright Snaps 2022, All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "VoxelTypes.h"
+#include <algorithm>
+#include <vector>
+
+/*
+	Face directions, in the order meshers emit them.
+*/
+enum class EBlockFace : uint8
+{
+	PosX,
+	NegX,
+	PosY,
+	NegY,
+	PosZ,
+	NegZ,
+	Count
+};
+
+/*
+	Dense block volume handed to the meshers. Holds a cube of Size^3 blocks plus
+	a one block border copied from the neighbouring chunks, so faces on the chunk
+	edge can be culled without looking anything up. Coordinates run from -1 to
+	Size inclusive, laid out X fastest, then Z, then Y like FVoxelChunk.
+*/
+struct FMeshVolume
+{
+	explicit FMeshVolume(int32 InSize = ChunkSize)
+		: Size(InSize)
+		, PaddedSize(InSize + 2)
+		, Blocks(PaddedSize * PaddedSize * PaddedSize, BlockAir)
+	{
+	}
+
+	int32 Index(int32 X, int32 Y, int32 Z) const
+	{
+		return (X + 1) + (Z + 1) * PaddedSize + (Y + 1) * PaddedSize * PaddedSize;
+	}
+
+	FBlockId Get(int32 X, int32 Y, int32 Z) const
+	{
+		return Blocks[Index(X, Y, Z)];
+	}
+
+	void Set(int32 X, int32 Y, int32 Z, FBlockId Block)
+	{
+		Blocks[Index(X, Y, Z)] = Block;
+	}
+
+	void Clear()
+	{
+		std::fill(Blocks.begin(), Blocks.end(), BlockAir);
+	}
+
+	int32 					Size;
+	int32 					PaddedSize;
+	std::vector<FBlockId> 	Blocks;
+};
+
+// Ambient occlusion of a quad corner, from 0 (both sides blocked) to 3 (nothing around it).
+static const uint8 MaxCornerAO 		= 3;
+
+// All four corners unoccluded, see FMeshQuad::AO.
+static const uint8 QuadNoOcclusion 	= 0xFF;
+
+/*
+	Axis aligned rectangle of faces produced by a mesher. X/Y/Z is the minimum
+	corner on the face plane in voxel units, Width runs along the first tangent
+	axis of the face and Height along the second (see GetFaceAxes).
+
+	AO holds 2 bits of ambient occlusion per corner, corners in the order
+	(0,0) (W,0) (W,H) (0,H) in face space starting from the low bits. Meshers
+	only merge faces whose AO matches and only along axes it doesn't change on
+	(see IsAOConstantAlongU), so every face of a quad had the same.
+*/
+struct FMeshQuad
+{
+	uint8 		X;
+	uint8 		Y;
+	uint8 		Z;
+	uint8 		Width;
+	uint8 		Height;
+	EBlockFace 	Face;
+	FBlockId 	BlockId;
+	uint8 		AO;
+};
+
+// Vertex positions are whole voxels, up to 511 along each axis so LOD nodes fit too.
+static const int32 VertexPositionBits 	= 9;
+static const int32 MaxVertexPosition 	= (1 << VertexPositionBits) - 1;
+
+/*
+	Render vertex for chunk meshes, 8 bytes unpacked by the vertex shader
+	(Shaders/Chunk.vert). Everything but the block id goes in the first word:
+	X, Y and Z relative to the mesh origin, then the face and the corner's AO.
+	The normal comes from the face and UVs are the position along the face's
+	axes, so textures still tile once per voxel across merged quads. The block
+	id is the texture array layer.
+*/
+struct FMeshVertex
+{
+	uint32 	PositionFaceAO; 	// X | Y << 9 | Z << 18 | Face << 27 | AO << 30.
+	uint32 	BlockId; 			// High 16 bits unused.
+};
+
+static_assert(sizeof(FMeshVertex) == 8, "Chunk pipeline vertex input expects 8 byte vertices");
+
+inline FMeshVertex PackVertex(int32 X, int32 Y, int32 Z, EBlockFace Face, uint8 AO, FBlockId BlockId)
+{
+	FMeshVertex Vertex;
+	Vertex.PositionFaceAO = (uint32)X
+		| (uint32)Y << VertexPositionBits
+		| (uint32)Z << (VertexPositionBits * 2)
+		| (uint32)Face << (VertexPositionBits * 3)
+		| (uint32)AO << (VertexPositionBits * 3 + 3);
+	Vertex.BlockId = BlockId;
+	return Vertex;
+}
+
+// Indices of one quad's two triangles, every mesh is drawn with this pattern repeated per quad.
+static const uint32 QuadIndexPattern[6] = { 0, 1, 2, 0, 2, 3 };
+
+/*
+	CPU side chunk mesh, four vertices per quad. There are no per mesh indices:
+	quads are ordered so QuadIndexPattern winds them outwards and splits them
+	along the right diagonal, and the renderer draws every mesh with one shared
+	index buffer of that pattern.
+*/
+struct FChunkMesh
+{
+	std::vector<FMeshVertex> 	Vertices;
+
+	void Reset()
+	{
+		Vertices.clear();
+	}
+
+	uint32 GetNumQuads() const
+	{
+		return (uint32)Vertices.size() / 4;
+	}
+
+	uint32 GetNumIndices() const
+	{
+		return GetNumQuads() * 6;
+	}
+
+	// Scale multiplies positions, for LOD meshes whose cells span several voxels. Quads are
+	// split along whichever diagonal keeps their AO from interpolating unevenly.
+	void AddQuad(const FMeshQuad& Quad, int32 Scale = 1);
+};
+
+// Normal axis (0 = X, 1 = Y, 2 = Z) and the two tangent axes Width and Height run along.
+inline void GetFaceAxes(EBlockFace Face, int32& OutNormalAxis, int32& OutUAxis, int32& OutVAxis)
+{
+	OutNormalAxis = (int32)Face / 2;
+	OutUAxis = (OutNormalAxis + 1) % 3;
+	OutVAxis = (OutNormalAxis + 2) % 3;
+}
+
+inline bool IsPositiveFace(EBlockFace Face)
+{
+	return ((int32)Face & 1) == 0;
+}
+
+inline uint8 GetCornerAO(uint8 AO, int32 Corner)
+{
+	return (AO >> (Corner * 2)) & MaxCornerAO;
+}
+
+/*
+	Whether a face's AO stays the same along Width (U) or Height (V). Stretching a
+	quad along an axis its AO changes on would smear one face's shading across the
+	whole run, so meshers only merge faces along the axes their AO is constant on.
+	Such quads never need their diagonal flipped either.
+*/
+inline bool IsAOConstantAlongU(uint8 AO)
+{
+	return GetCornerAO(AO, 0) == GetCornerAO(AO, 1) && GetCornerAO(AO, 3) == GetCornerAO(AO, 2);
+}
+
+inline bool IsAOConstantAlongV(uint8 AO)
+{
+	return GetCornerAO(AO, 0) == GetCornerAO(AO, 3) && GetCornerAO(AO, 1) == GetCornerAO(AO, 2);
+}
+
+/*
+	Classic voxel AO for a face corner from the three blocks touching it in the
+	layer in front of the face: the two along the edges and the one diagonal.
+	Two sides fully close the corner whatever the diagonal is.
+*/
+inline uint8 ComputeCornerAO(bool bSide1, bool bSide2, bool bCorner)
+{
+	return (bSide1 && bSide2) ? 0 : (uint8)(MaxCornerAO - bSide1 - bSide2 - bCorner);
+}
+
+// Quad for a Width x Height run of faces starting at (U, V) in the given slice along the face normal.
+inline FMeshQuad MakeFaceQuad(EBlockFace Face, int32 Slice, int32 U, int32 V, int32 Width, int32 Height, FBlockId BlockId, uint8 AO = QuadNoOcclusion)
+{
+	int32 NormalAxis, UAxis, VAxis;
+	GetFaceAxes(Face, NormalAxis, UAxis, VAxis);
+
+	// Positive faces sit on the far side of the voxel.
+	int32 Position[3];
+	Position[NormalAxis] = Slice + (IsPositiveFace(Face) ? 1 : 0);
+	Position[UAxis] = U;
+	Position[VAxis] = V;
+
+	FMeshQuad Quad;
+	Quad.X = (uint8)Position[0];
+	Quad.Y = (uint8)Position[1];
+	Quad.Z = (uint8)Position[2];
+	Quad.Width = (uint8)Width;
+	Quad.Height = (uint8)Height;
+	Quad.Face = Face;
+	Quad.BlockId = BlockId;
+	Quad.AO = AO;
+	return Quad;
+}
@@ -0,0 +1,212 @@
+// Copyright Snaps 2022, All Rights Reserved.
+
+#include "NoiseGenerator.h"
+#include "NoiseKernel.h"
+#include <algorithm>
+
+#if VOXEL_NOISE_X64
+#if defined(_MSC_VER)
+#include <intrin.h>
+#else
+#include <cpuid.h>
+#endif
+#endif
+
+#if VOXEL_NOISE_X64
+
+static void Cpuid(uint32 Leaf, uint32 SubLeaf, uint32 OutRegisters[4])
+{
+#if defined(_MSC_VER)
+	int32 Registers[4];
+	__cpuidex(Registers, (int32)Leaf, (int32)SubLeaf);
+	for(int32 Index = 0; Index < 4; Index++)
+	{
+		OutRegisters[Index] = (uint32)Registers[Index];
+	}
+#else
+	__cpuid_count(Leaf, SubLeaf, OutRegisters[0], OutRegisters[1], OutRegisters[2], OutRegisters[3]);
+#endif
+}
+
+// Register state the OS saves on context switches, a CPU feature is useless without it.
+static uint64 GetEnabledXStateFeatures()
+{
+#if defined(_MSC_VER)
+	return _xgetbv(0);
+#else
+	uint32 Low, High;
+	__asm__("xgetbv" : "=a"(Low), "=d"(High) : "c"(0));
+	return ((uint64)High << 32) | Low;
+#endif
+}
+
+static bool DetectIsa(ENoiseIsa Isa)
+{
+	uint32 Leaf1[4];
+	Cpuid(1, 0, Leaf1);
+
+	const bool bSse41 = (Leaf1[2] & (1u << 19)) != 0;
+	if(Isa == ENoiseIsa::Sse41)
+	{
+		return bSse41;
+	}
+
+	// AVX needs the OS to save YMM state (XCR0 bits 1 and 2), AVX-512 also opmask and ZMM (bits 5 to 7).
+	const bool bOsXSave = (Leaf1[2] & (1u << 27)) != 0;
+	const bool bAvx = (Leaf1[2] & (1u << 28)) != 0;
+	if(!bSse41 || !bOsXSave || !bAvx)
+	{
+		return false;
+	}
+
+	const uint64 XState = GetEnabledXStateFeatures();
+	if((XState & 0x6) != 0x6)
+	{
+		return false;
+	}
+
+	uint32 Leaf7[4];
+	Cpuid(7, 0, Leaf7);
+
+	const bool bAvx2 = (Leaf7[1] & (1u << 5)) != 0;
+	if(Isa == ENoiseIsa::Avx2)
+	{
+		return bAvx2;
+	}
+
+	const bool bAvx512F = (Leaf7[1] & (1u << 16)) != 0;
+	return Isa == ENoiseIsa::Avx512 && bAvx2 && bAvx512F && (XState & 0xE6) == 0xE6;
+}
+
+#endif
+
+static const FNoiseKernel& GetKernel(ENoiseIsa Isa)
+{
+	switch(Isa)
+	{
+		case ENoiseIsa::Sse41: 		return NoiseKernelSse41;
+		case ENoiseIsa::Avx2: 		return NoiseKernelAvx2;
+		case ENoiseIsa::Avx512: 	return NoiseKernelAvx512;
+		default: 					return NoiseKernelScalar;
+	}
+}
+
+bool FNoiseGenerator::IsIsaSupported(ENoiseIsa Isa)
+{
+	if(Isa == ENoiseIsa::Scalar)
+	{
+		return true;
+	}
+
+#if VOXEL_NOISE_X64
+	if(Isa < ENoiseIsa::Count && GetKernel(Isa).Row2D)
+	{
+		// Cpuid is slow-ish and the answer never changes, ask once per ISA.
+		static const bool bSupported[] =
+		{
+			true,
+			DetectIsa(ENoiseIsa::Sse41),
+			DetectIsa(ENoiseIsa::Avx2),
+			DetectIsa(ENoiseIsa::Avx512)
+		};
+		return bSupported[(uint32)Isa];
+	}
+#endif
+
+	return false;
+}
+
+ENoiseIsa FNoiseGenerator::GetBestIsa()
+{
+	for(uint32 Isa = (uint32)ENoiseIsa::Count - 1; Isa > 0; Isa--)
+	{
+		if(IsIsaSupported((ENoiseIsa)Isa))
+		{
+			return (ENoiseIsa)Isa;
+		}
+	}
+	return ENoiseIsa::Scalar;
+}
+
+const char* FNoiseGenerator::GetIsaName(ENoiseIsa Isa)
+{
+	switch(Isa)
+	{
+		case ENoiseIsa::Sse41: 		return "SSE4.1";
+		case ENoiseIsa::Avx2: 		return "AVX2";
+		case ENoiseIsa::Avx512: 	return "AVX-512";
+		default: 					return "Scalar";
+	}
+}
+
+FNoiseGenerator::FNoiseGenerator(const FNoiseSettings& InSettings, ENoiseIsa InIsa)
+	: Settings(InSettings)
+	, Isa(IsIsaSupported(InIsa) ? InIsa : GetBestIsa())
+	, Kernel(&GetKernel(Isa))
+	, Params(new FNoiseKernelParams())
+{
+	Params->Type = Settings.Type;
+	Params->CellularReturn = Settings.CellularReturn;
+	Params->Seed = Settings.Seed;
+	Params->Frequency = Settings.Frequency;
+	Params->Octaves = std::max(Settings.Octaves, 1);
+	Params->Lacunarity = Settings.Lacunarity;
+	Params->Gain = Settings.Gain;
+	Params->WarpAmplitude = Settings.WarpAmplitude;
+	Params->WarpFrequency = Settings.WarpFrequency;
+
+	// Computed once here rather than per kernel, every ISA must scale by the exact same value.
+	float Amplitude = 1.0f;
+	float AmplitudeSum = 0.0f;
+	for(int32 Octave = 0; Octave < Params->Octaves; Octave++)
+	{
+		AmplitudeSum += Amplitude;
+		Amplitude *= Settings.Gain;
+	}
+	Params->FractalBounding = 1.0f / AmplitudeSum;
+}
+
+FNoiseGenerator::~FNoiseGenerator()
+{
+}
+
+void FNoiseGenerator::GenerateRow2D(float X, float Z, float Step, int32 Count, float* Out) const
+{
+	Kernel->Row2D(*Params, X, 0.0f, Z, Step, Count, Out);
+}
+
+void FNoiseGenerator::GenerateRow3D(float X, float Y, float Z, float Step, int32 Count, float* Out) const
+{
+	Kernel->Row3D(*Params, X, Y, Z, Step, Count, Out);
+}
+
+void FNoiseGenerator::GenerateGrid2D(float X, float Z, float Step, int32 SizeX, int32 SizeZ, float* Out) const
+{
+	for(int32 Row = 0; Row < SizeZ; Row++)
+	{
+		Kernel->Row2D(*Params, X, 0.0f, Z + Row * Step, Step, SizeX, Out + Row * SizeX);
+	}
+}
+
+void FNoiseGenerator::GenerateGrid3D(float X, float Y, float Z, float Step, int32 SizeX, int32 SizeY, int32 SizeZ, float* Out) const
+{
+	for(int32 Layer = 0; Layer < SizeY; Layer++)
+	for(int32 Row = 0; Row < SizeZ; Row++)
+	{
+		Kernel->Row3D(*Params, X, Y + Layer * Step, Z + Row * Step, Step, SizeX, Out + (Layer * SizeZ + Row) * SizeX);
+	}
+}
+
+float FNoiseGenerator::Sample2D(float X, float Z) const
+{
+	float Value;
+	Kernel->Row2D(*Params, X, 0.0f, Z, 0.0f, 1, &Value);
+	return Value;
+}
+
+float FNoiseGenerator::Sample3D(float X, float Y, float Z) const
+{
+	float Value;
+	Kernel->Row3D(*Params, X, Y, Z, 0.0f, 1, &Value);
+	return Value;
+}
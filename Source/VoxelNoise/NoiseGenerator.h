@@ -0,0 +1,111 @@
+// Copyright Snaps 2022, All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+struct FNoiseKernel;
+struct FNoiseKernelParams;
+
+enum class ENoiseType : uint8
+{
+	Perlin,
+	OpenSimplex2,
+	Cellular
+};
+
+// What cellular noise outputs, distances are to the nearest (F1) and second nearest (F2) feature point.
+enum class ECellularReturn : uint8
+{
+	Distance,		// F1 - 1
+	Distance2Sub,	// F2 - F1 - 1, ridges along cell borders
+	CellValue		// Random value per cell in [-1, 1), flat cells
+};
+
+// Instruction sets the noise kernels are built for, slowest first.
+enum class ENoiseIsa : uint8
+{
+	Scalar,
+	Sse41,
+	Avx2,
+	Avx512,
+	Count
+};
+
+struct FNoiseSettings
+{
+	ENoiseType 		Type 			= ENoiseType::OpenSimplex2;
+	int32 			Seed 			= 1337;
+	float 			Frequency 		= 0.01f;
+
+	// fBm, each octave runs at Lacunarity times the frequency and Gain times the amplitude of the last.
+	int32 			Octaves 		= 1;
+	float 			Lacunarity 		= 2.0f;
+	float 			Gain 			= 0.5f;
+
+	ECellularReturn CellularReturn 	= ECellularReturn::Distance;
+
+	// Domain warp, offsets sample positions by up to WarpAmplitude world units of OpenSimplex2 noise
+	// before sampling. Zero turns it off.
+	float 			WarpAmplitude 	= 0.0f;
+	float 			WarpFrequency 	= 0.01f;
+};
+
+/*
+	Batch noise for terrain generation. Whole rows are evaluated at once with
+	the widest instruction set the CPU supports, picked at runtime, so one
+	build runs everywhere and still uses AVX2 or AVX-512 where it can.
+
+	Output is bit identical across instruction sets for the same settings, a
+	world generated on an AVX-512 machine matches one generated with the
+	scalar fallback. Output is roughly in [-1, 1].
+
+	Immutable after construction, safe to share between threads.
+*/
+class FNoiseGenerator
+{
+public:
+
+	// Isa defaults to the best one the CPU supports, unsupported requests fall back to that too.
+	explicit FNoiseGenerator(const FNoiseSettings& InSettings, ENoiseIsa Isa = ENoiseIsa::Count);
+	~FNoiseGenerator();
+
+	FNoiseGenerator(const FNoiseGenerator&) = delete;
+	FNoiseGenerator& operator=(const FNoiseGenerator&) = delete;
+
+	// Out[Index] = noise at (X + Index * Step, Z), for heightmaps and other per column values.
+	void GenerateRow2D(float X, float Z, float Step, int32 Count, float* Out) const;
+
+	// Out[Index] = noise at (X + Index * Step, Y, Z).
+	void GenerateRow3D(float X, float Y, float Z, float Step, int32 Count, float* Out) const;
+
+	// SizeX by SizeZ samples from (X, Z), X fastest.
+	void GenerateGrid2D(float X, float Z, float Step, int32 SizeX, int32 SizeZ, float* Out) const;
+
+	// SizeX by SizeY by SizeZ samples from (X, Y, Z), X fastest then Z then Y like chunk voxels.
+	void GenerateGrid3D(float X, float Y, float Z, float Step, int32 SizeX, int32 SizeY, int32 SizeZ, float* Out) const;
+
+	float Sample2D(float X, float Z) const;
+	float Sample3D(float X, float Y, float Z) const;
+
+	const FNoiseSettings& GetSettings() const
+	{
+		return Settings;
+	}
+
+	ENoiseIsa GetIsa() const
+	{
+		return Isa;
+	}
+
+	static bool IsIsaSupported(ENoiseIsa Isa);
+	static ENoiseIsa GetBestIsa();
+	static const char* GetIsaName(ENoiseIsa Isa);
+
+private:
+
+	FNoiseSettings 							Settings;
+	ENoiseIsa 								Isa;
+	const FNoiseKernel* 					Kernel;
+	std::unique_ptr<FNoiseKernelParams> 	Params;
+};
@@ -0,0 +1,554 @@
+// Copyright Snaps 2022, All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "NoiseGenerator.h"
+
+// The vector paths are x64 only, other platforms get the scalar kernel.
+#if defined(_M_X64) || defined(__x86_64__)
+#define VOXEL_NOISE_X64 1
+#endif
+
+/*
+	Noise kernels shared by every instruction set. Each NoiseKernel*.cpp wraps
+	its vector registers in an FSimd type and instantiates TNoiseKernel with it,
+	so all ISAs run the exact same sequence of operations per lane.
+
+	That is what keeps results bit identical across ISAs: only operations that
+	IEEE 754 rounds exactly are used (add, sub, mul, sqrt, floor, compares,
+	int conversion, 32 bit integer math), in the same order everywhere. No FMA,
+	no reciprocal or rsqrt estimates, no float division, and the library is
+	built with contraction off so the compiler can't fuse a mul and an add
+	behind our back.
+
+	FSimd provides:
+		FFloat, FInt (32 bit, wrapping), FMask and Width
+		Operators + - * and unary - on FFloat, comparisons returning FMask
+		Operators + - * ^ & | on FInt, >> (logical) by a scalar count
+		Float(c), Int(c), LaneIndex(), Store(Out, V)
+		Floor, Min, Max, Sqrt, ToFloat (signed), ToInt (truncating)
+		Select(Mask, True, False), SelectInt(Mask, True, False)
+		TestBit(FInt, Bit), IntEqual, IntLess, MaskAnd, MaskOr, MaskNot
+*/
+
+// Everything the kernels need from FNoiseSettings, plus values derived once per generator.
+struct FNoiseKernelParams
+{
+	ENoiseType 		Type;
+	ECellularReturn CellularReturn;
+	int32 			Seed;
+	float 			Frequency;
+	int32 			Octaves;
+	float 			Lacunarity;
+	float 			Gain;
+	float 			FractalBounding;	// 1 / sum of octave amplitudes, keeps fBm in range.
+	float 			WarpAmplitude;
+	float 			WarpFrequency;
+};
+
+// Fills Out[0..Count) with noise at (X + Index * Step, Y, Z). 2D noise reads X and Z, Y is ignored.
+typedef void (*FNoiseRowFunction)(const FNoiseKernelParams& Params, float X, float Y, float Z, float Step, int32 Count, float* Out);
+
+struct FNoiseKernel
+{
+	FNoiseRowFunction Row2D = nullptr;
+	FNoiseRowFunction Row3D = nullptr;
+};
+
+// One per instruction set, null members where the ISA isn't compiled for this platform.
+extern const FNoiseKernel NoiseKernelScalar;
+extern const FNoiseKernel NoiseKernelSse41;
+extern const FNoiseKernel NoiseKernelAvx2;
+extern const FNoiseKernel NoiseKernelAvx512;
+
+template<typename FSimd>
+struct TNoiseKernel
+{
+	typedef typename FSimd::FFloat 	FFloat;
+	typedef typename FSimd::FInt 	FInt;
+	typedef typename FSimd::FMask 	FMask;
+
+	// Large primes spread lattice coordinates over the hash, pre-multiplied into the coordinates.
+	static const uint32 PrimeX = 501125321u;
+	static const uint32 PrimeY = 1136930381u;
+	static const uint32 PrimeZ = 1720413743u;
+
+	// Output scales bringing each noise to roughly [-1, 1], from the largest value seen over ~30 million
+	// samples per noise with 1% headroom.
+	static constexpr float PerlinScale2D 		= 0.655182248f;
+	static constexpr float PerlinScale3D 		= 0.991172467f;
+	static constexpr float OpenSimplexScale2D 	= 44.7786730f;
+	static constexpr float OpenSimplexScale3D 	= 32.3688292f;
+
+	// Feature points stay this far inside their cell, keeps the nearest one inside the 3x3(x3) search.
+	static constexpr float CellularJitter2D = 0.43701595f;
+	static constexpr float CellularJitter3D = 0.39614353f;
+
+	// Different seeds per warped axis, so the offsets aren't all the same noise.
+	static const uint32 WarpSeedX = 0x9E3779B9u;
+	static const uint32 WarpSeedY = 0x7F4A7C15u;
+	static const uint32 WarpSeedZ = 0x85EBCA6Bu;
+
+	// OpenSimplex2 evaluates two offset copies of its 3D lattice, the second with a flipped seed.
+	static const uint32 SeedFlip3D = 0x52D547B2u;
+
+	static FInt Hash(FInt Seed, FInt X, FInt Y)
+	{
+		FInt Value = Seed ^ X ^ Y;
+		Value = Value * FSimd::Int(0x27D4EB2Du);
+		return Value ^ (Value >> 15);
+	}
+
+	static FInt Hash(FInt Seed, FInt X, FInt Y, FInt Z)
+	{
+		FInt Value = Seed ^ X ^ Y ^ Z;
+		Value = Value * FSimd::Int(0x27D4EB2Du);
+		return Value ^ (Value >> 15);
+	}
+
+	// One of 8 gradients (+-1, +-2) and (+-2, +-1), picked by hash bits.
+	static FFloat GradientDot(FInt Hash, FFloat X, FFloat Y)
+	{
+		const FMask bSwap = FSimd::TestBit(Hash, 1u << 0);
+		FFloat U = FSimd::Select(bSwap, Y, X);
+		FFloat V = FSimd::Select(bSwap, X, Y);
+		U = FSimd::Select(FSimd::TestBit(Hash, 1u << 1), -U, U);
+		V = FSimd::Select(FSimd::TestBit(Hash, 1u << 2), -V, V);
+		return U + V + V;
+	}
+
+	// One of the 12 cube edge gradients of improved Perlin noise, 4 of them twice to make 16.
+	static FFloat GradientDot(FInt Hash, FFloat X, FFloat Y, FFloat Z)
+	{
+		const FInt Index = Hash & FSimd::Int(15);
+		const FFloat U = FSimd::Select(FSimd::IntLess(Index, FSimd::Int(8)), X, Y);
+		const FFloat V = FSimd::Select(FSimd::IntLess(Index, FSimd::Int(4)), Y,
+			FSimd::Select(FSimd::IntEqual(Index & FSimd::Int(13), FSimd::Int(12)), X, Z));
+		return FSimd::Select(FSimd::TestBit(Index, 1u << 0), -U, U) + FSimd::Select(FSimd::TestBit(Index, 1u << 1), -V, V);
+	}
+
+	static FFloat Quintic(FFloat T)
+	{
+		return T * T * T * (T * (T * FSimd::Float(6.0f) - FSimd::Float(15.0f)) + FSimd::Float(10.0f));
+	}
+
+	static FFloat Lerp(FFloat A, FFloat B, FFloat T)
+	{
+		return A + T * (B - A);
+	}
+
+	static FFloat Pow4(FFloat A)
+	{
+		const FFloat Square = A * A;
+		return Square * Square;
+	}
+
+	static FFloat Perlin(FInt Seed, FFloat X, FFloat Y)
+	{
+		const FFloat X0 = FSimd::Floor(X);
+		const FFloat Y0 = FSimd::Floor(Y);
+		const FFloat DX0 = X - X0;
+		const FFloat DY0 = Y - Y0;
+		const FFloat DX1 = DX0 - FSimd::Float(1.0f);
+		const FFloat DY1 = DY0 - FSimd::Float(1.0f);
+
+		const FInt PX0 = FSimd::ToInt(X0) * FSimd::Int(PrimeX);
+		const FInt PY0 = FSimd::ToInt(Y0) * FSimd::Int(PrimeY);
+		const FInt PX1 = PX0 + FSimd::Int(PrimeX);
+		const FInt PY1 = PY0 + FSimd::Int(PrimeY);
+
+		const FFloat SX = Quintic(DX0);
+		const FFloat SY = Quintic(DY0);
+
+		const FFloat Row0 = Lerp(GradientDot(Hash(Seed, PX0, PY0), DX0, DY0), GradientDot(Hash(Seed, PX1, PY0), DX1, DY0), SX);
+		const FFloat Row1 = Lerp(GradientDot(Hash(Seed, PX0, PY1), DX0, DY1), GradientDot(Hash(Seed, PX1, PY1), DX1, DY1), SX);
+		return Lerp(Row0, Row1, SY) * FSimd::Float(PerlinScale2D);
+	}
+
+	static FFloat Perlin(FInt Seed, FFloat X, FFloat Y, FFloat Z)
+	{
+		const FFloat X0 = FSimd::Floor(X);
+		const FFloat Y0 = FSimd::Floor(Y);
+		const FFloat Z0 = FSimd::Floor(Z);
+		const FFloat DX0 = X - X0;
+		const FFloat DY0 = Y - Y0;
+		const FFloat DZ0 = Z - Z0;
+		const FFloat DX1 = DX0 - FSimd::Float(1.0f);
+		const FFloat DY1 = DY0 - FSimd::Float(1.0f);
+		const FFloat DZ1 = DZ0 - FSimd::Float(1.0f);
+
+		const FInt PX0 = FSimd::ToInt(X0) * FSimd::Int(PrimeX);
+		const FInt PY0 = FSimd::ToInt(Y0) * FSimd::Int(PrimeY);
+		const FInt PZ0 = FSimd::ToInt(Z0) * FSimd::Int(PrimeZ);
+		const FInt PX1 = PX0 + FSimd::Int(PrimeX);
+		const FInt PY1 = PY0 + FSimd::Int(PrimeY);
+		const FInt PZ1 = PZ0 + FSimd::Int(PrimeZ);
+
+		const FFloat SX = Quintic(DX0);
+		const FFloat SY = Quintic(DY0);
+		const FFloat SZ = Quintic(DZ0);
+
+		const FFloat Row00 = Lerp(GradientDot(Hash(Seed, PX0, PY0, PZ0), DX0, DY0, DZ0), GradientDot(Hash(Seed, PX1, PY0, PZ0), DX1, DY0, DZ0), SX);
+		const FFloat Row10 = Lerp(GradientDot(Hash(Seed, PX0, PY1, PZ0), DX0, DY1, DZ0), GradientDot(Hash(Seed, PX1, PY1, PZ0), DX1, DY1, DZ0), SX);
+		const FFloat Row01 = Lerp(GradientDot(Hash(Seed, PX0, PY0, PZ1), DX0, DY0, DZ1), GradientDot(Hash(Seed, PX1, PY0, PZ1), DX1, DY0, DZ1), SX);
+		const FFloat Row11 = Lerp(GradientDot(Hash(Seed, PX0, PY1, PZ1), DX0, DY1, DZ1), GradientDot(Hash(Seed, PX1, PY1, PZ1), DX1, DY1, DZ1), SX);
+
+		const FFloat Slice0 = Lerp(Row00, Row10, SY);
+		const FFloat Slice1 = Lerp(Row01, Row11, SY);
+		return Lerp(Slice0, Slice1, SZ) * FSimd::Float(PerlinScale3D);
+	}
+
+	// OpenSimplex2 (KdotJPG), the fast variant: simplex noise on a skewed triangular lattice.
+	static FFloat OpenSimplex2(FInt Seed, FFloat X, FFloat Y)
+	{
+		static constexpr float Skew = 0.366025403784439f;		// (sqrt(3) - 1) / 2
+		static constexpr float Unskew = -0.211324865405187f;	// (1 / sqrt(3) - 1) / 2
+		static constexpr float RadiusSquared = 0.5f;
+
+		const FFloat Skewed = (X + Y) * FSimd::Float(Skew);
+		const FFloat XS = X + Skewed;
+		const FFloat YS = Y + Skewed;
+		const FFloat XSB = FSimd::Floor(XS);
+		const FFloat YSB = FSimd::Floor(YS);
+		const FFloat XI = XS - XSB;
+		const FFloat YI = YS - YSB;
+
+		const FInt PX = FSimd::ToInt(XSB) * FSimd::Int(PrimeX);
+		const FInt PY = FSimd::ToInt(YSB) * FSimd::Int(PrimeY);
+
+		// Offsets from the base vertex, then the opposite vertex, then whichever of the other two is closer.
+		const FFloat T = (XI + YI) * FSimd::Float(Unskew);
+		const FFloat DX0 = XI + T;
+		const FFloat DY0 = YI + T;
+		const FFloat A0 = FSimd::Float(RadiusSquared) - DX0 * DX0 - DY0 * DY0;
+		FFloat Value = FSimd::Select(A0 > FSimd::Float(0.0f), Pow4(A0) * GradientDot(Hash(Seed, PX, PY), DX0, DY0), FSimd::Float(0.0f));
+
+		const FFloat DX1 = DX0 - FSimd::Float(1.0f + 2.0f * Unskew);
+		const FFloat DY1 = DY0 - FSimd::Float(1.0f + 2.0f * Unskew);
+		const FFloat A1 = FSimd::Float(RadiusSquared) - DX1 * DX1 - DY1 * DY1;
+		Value = Value + FSimd::Select(A1 > FSimd::Float(0.0f),
+			Pow4(A1) * GradientDot(Hash(Seed, PX + FSimd::Int(PrimeX), PY + FSimd::Int(PrimeY)), DX1, DY1), FSimd::Float(0.0f));
+
+		const FMask bUpper = DY0 > DX0;
+		const FFloat DX2 = DX0 - FSimd::Select(bUpper, FSimd::Float(Unskew), FSimd::Float(Unskew + 1.0f));
+		const FFloat DY2 = DY0 - FSimd::Select(bUpper, FSimd::Float(Unskew + 1.0f), FSimd::Float(Unskew));
+		const FInt PX2 = PX + FSimd::SelectInt(bUpper, FSimd::Int(0), FSimd::Int(PrimeX));
+		const FInt PY2 = PY + FSimd::SelectInt(bUpper, FSimd::Int(PrimeY), FSimd::Int(0));
+		const FFloat A2 = FSimd::Float(RadiusSquared) - DX2 * DX2 - DY2 * DY2;
+		Value = Value + FSimd::Select(A2 > FSimd::Float(0.0f), Pow4(A2) * GradientDot(Hash(Seed, PX2, PY2), DX2, DY2), FSimd::Float(0.0f));
+
+		return Value * FSimd::Float(OpenSimplexScale2D);
+	}
+
+	// OpenSimplex2 (KdotJPG), the fast variant on a rotated body centred cubic lattice. The rotation
+	// keeps Y as the lattice's main diagonal, so horizontal slices (XZ) don't show grid artifacts.
+	static FFloat OpenSimplex2(FInt Seed, FFloat X, FFloat Y, FFloat Z)
+	{
+		static constexpr float RotateXZ = -0.211324865405187f;
+		static constexpr float Root3Over3 = 0.577350269189626f;
+		static constexpr float RadiusSquared = 0.6f;
+
+		const FFloat XZ = X + Z;
+		const FFloat S2 = XZ * FSimd::Float(RotateXZ);
+		const FFloat YY = Y * FSimd::Float(Root3Over3);
+		FFloat XR = X + S2 + YY;
+		FFloat ZR = Z + S2 + YY;
+		FFloat YR = XZ * FSimd::Float(-Root3Over3) + YY;
+
+		// Nearest lattice point, rounding as floor(v + 0.5) so it doesn't depend on the rounding mode.
+		const FFloat XRB = FSimd::Floor(XR + FSimd::Float(0.5f));
+		const FFloat YRB = FSimd::Floor(YR + FSimd::Float(0.5f));
+		const FFloat ZRB = FSimd::Floor(ZR + FSimd::Float(0.5f));
+		FFloat XI = XR - XRB;
+		FFloat YI = YR - YRB;
+		FFloat ZI = ZR - ZRB;
+
+		// Sign masks for "offset is positive", which decide the direction of the second closest point.
+		FMask bXPositive = XI >= FSimd::Float(0.0f);
+		FMask bYPositive = YI >= FSimd::Float(0.0f);
+		FMask bZPositive = ZI >= FSimd::Float(0.0f);
+		FFloat AX = FSimd::Select(bXPositive, XI, -XI);
+		FFloat AY = FSimd::Select(bYPositive, YI, -YI);
+		FFloat AZ = FSimd::Select(bZPositive, ZI, -ZI);
+
+		FInt PX = FSimd::ToInt(XRB) * FSimd::Int(PrimeX);
+		FInt PY = FSimd::ToInt(YRB) * FSimd::Int(PrimeY);
+		FInt PZ = FSimd::ToInt(ZRB) * FSimd::Int(PrimeZ);
+
+		FFloat Value = FSimd::Float(0.0f);
+		FFloat A = (FSimd::Float(RadiusSquared) - XI * XI) - (YI * YI + ZI * ZI);
+
+		for(int32 Lattice = 0; ; Lattice++)
+		{
+			// Closest point on this lattice copy.
+			Value = Value + FSimd::Select(A > FSimd::Float(0.0f), Pow4(A) * GradientDot(Hash(Seed, PX, PY, PZ), XI, YI, ZI), FSimd::Float(0.0f));
+
+			// Second closest point, one step along the axis with the largest offset.
+			const FMask bXMax = FSimd::MaskAnd(AX >= AY, AX >= AZ);
+			const FMask bYMax = FSimd::MaskAnd(FSimd::MaskNot(bXMax), FSimd::MaskAnd(AY > AX, AY >= AZ));
+			const FMask bZMax = FSimd::MaskNot(FSimd::MaskOr(bXMax, bYMax));
+
+			const FFloat AMax = FSimd::Select(bXMax, AX, FSimd::Select(bYMax, AY, AZ));
+			const FFloat B = A + AMax + AMax;
+
+			const FFloat StepX = FSimd::Select(bXMax, FSimd::Select(bXPositive, FSimd::Float(-1.0f), FSimd::Float(1.0f)), FSimd::Float(0.0f));
+			const FFloat StepY = FSimd::Select(bYMax, FSimd::Select(bYPositive, FSimd::Float(-1.0f), FSimd::Float(1.0f)), FSimd::Float(0.0f));
+			const FFloat StepZ = FSimd::Select(bZMax, FSimd::Select(bZPositive, FSimd::Float(-1.0f), FSimd::Float(1.0f)), FSimd::Float(0.0f));
+			const FInt StepPX = FSimd::SelectInt(bXMax, FSimd::SelectInt(bXPositive, FSimd::Int(PrimeX), FSimd::Int(0u - PrimeX)), FSimd::Int(0));
+			const FInt StepPY = FSimd::SelectInt(bYMax, FSimd::SelectInt(bYPositive, FSimd::Int(PrimeY), FSimd::Int(0u - PrimeY)), FSimd::Int(0));
+			const FInt StepPZ = FSimd::SelectInt(bZMax, FSimd::SelectInt(bZPositive, FSimd::Int(PrimeZ), FSimd::Int(0u - PrimeZ)), FSimd::Int(0));
+
+			const FFloat BFalloff = B - FSimd::Float(1.0f);
+			const FFloat Second = Pow4(BFalloff) * GradientDot(Hash(Seed, PX + StepPX, PY + StepPY, PZ + StepPZ), XI + StepX, YI + StepY, ZI + StepZ);
+			Value = Value + FSimd::Select(B > FSimd::Float(1.0f), Second, FSimd::Float(0.0f));
+
+			if(Lattice == 1)
+			{
+				break;
+			}
+
+			// Move to the other lattice copy, offset by half a cell on every axis towards the point.
+			AX = FSimd::Float(0.5f) - AX;
+			AY = FSimd::Float(0.5f) - AY;
+			AZ = FSimd::Float(0.5f) - AZ;
+			XI = FSimd::Select(bXPositive, -AX, AX);
+			YI = FSimd::Select(bYPositive, -AY, AY);
+			ZI = FSimd::Select(bZPositive, -AZ, AZ);
+			A = A + (FSimd::Float(0.75f) - AX) - (AY + AZ);
+			PX = PX + FSimd::SelectInt(bXPositive, FSimd::Int(PrimeX), FSimd::Int(0));
+			PY = PY + FSimd::SelectInt(bYPositive, FSimd::Int(PrimeY), FSimd::Int(0));
+			PZ = PZ + FSimd::SelectInt(bZPositive, FSimd::Int(PrimeZ), FSimd::Int(0));
+			bXPositive = FSimd::MaskNot(bXPositive);
+			bYPositive = FSimd::MaskNot(bYPositive);
+			bZPositive = FSimd::MaskNot(bZPositive);
+			Seed = Seed ^ FSimd::Int(SeedFlip3D);
+		}
+
+		return Value * FSimd::Float(OpenSimplexScale3D);
+	}
+
+	// Point in [-Jitter, Jitter) taken from 10 bits of Hash starting at Shift.
+	static FFloat CellOffset(FInt Hash, int32 Shift, float Jitter)
+	{
+		const FFloat Unit = FSimd::ToFloat((Hash >> Shift) & FSimd::Int(1023));
+		return Unit * FSimd::Float(2.0f * Jitter / 1024.0f) - FSimd::Float(Jitter);
+	}
+
+	static FFloat CellularResult(const FNoiseKernelParams& Params, FFloat Distance0, FFloat Distance1, FInt ClosestHash)
+	{
+		switch(Params.CellularReturn)
+		{
+			case ECellularReturn::Distance2Sub:
+				return FSimd::Sqrt(Distance1) - FSimd::Sqrt(Distance0) - FSimd::Float(1.0f);
+			case ECellularReturn::CellValue:
+				return FSimd::ToFloat(ClosestHash) * FSimd::Float(1.0f / 2147483648.0f);
+			default:
+				return FSimd::Sqrt(Distance0) - FSimd::Float(1.0f);
+		}
+	}
+
+	// Worley noise, distances to the nearest jittered feature point of the surrounding cells.
+	static FFloat Cellular(const FNoiseKernelParams& Params, FInt Seed, FFloat X, FFloat Y)
+	{
+		const FFloat XR = FSimd::Floor(X + FSimd::Float(0.5f));
+		const FFloat YR = FSimd::Floor(Y + FSimd::Float(0.5f));
+		const FInt PX = FSimd::ToInt(XR) * FSimd::Int(PrimeX);
+		const FInt PY = FSimd::ToInt(YR) * FSimd::Int(PrimeY);
+
+		FFloat Distance0 = FSimd::Float(1e10f);
+		FFloat Distance1 = FSimd::Float(1e10f);
+		FInt ClosestHash = FSimd::Int(0);
+
+		for(int32 CellX = -1; CellX <= 1; CellX++)
+		{
+			const FFloat DX = (XR - X) + FSimd::Float((float)CellX);
+			const FInt CellPX = PX + FSimd::Int((uint32)CellX * PrimeX);
+
+			for(int32 CellY = -1; CellY <= 1; CellY++)
+			{
+				const FFloat DY = (YR - Y) + FSimd::Float((float)CellY);
+				const FInt CellHash = Hash(Seed, CellPX, PY + FSimd::Int((uint32)CellY * PrimeY));
+
+				const FFloat PointX = DX + CellOffset(CellHash, 0, CellularJitter2D);
+				const FFloat PointY = DY + CellOffset(CellHash, 10, CellularJitter2D);
+				const FFloat Distance = PointX * PointX + PointY * PointY;
+
+				Distance1 = FSimd::Max(FSimd::Min(Distance1, Distance), Distance0);
+				ClosestHash = FSimd::SelectInt(Distance < Distance0, CellHash, ClosestHash);
+				Distance0 = FSimd::Min(Distance0, Distance);
+			}
+		}
+
+		return CellularResult(Params, Distance0, Distance1, ClosestHash);
+	}
+
+	static FFloat Cellular(const FNoiseKernelParams& Params, FInt Seed, FFloat X, FFloat Y, FFloat Z)
+	{
+		const FFloat XR = FSimd::Floor(X + FSimd::Float(0.5f));
+		const FFloat YR = FSimd::Floor(Y + FSimd::Float(0.5f));
+		const FFloat ZR = FSimd::Floor(Z + FSimd::Float(0.5f));
+		const FInt PX = FSimd::ToInt(XR) * FSimd::Int(PrimeX);
+		const FInt PY = FSimd::ToInt(YR) * FSimd::Int(PrimeY);
+		const FInt PZ = FSimd::ToInt(ZR) * FSimd::Int(PrimeZ);
+
+		FFloat Distance0 = FSimd::Float(1e10f);
+		FFloat Distance1 = FSimd::Float(1e10f);
+		FInt ClosestHash = FSimd::Int(0);
+
+		for(int32 CellX = -1; CellX <= 1; CellX++)
+		{
+			const FFloat DX = (XR - X) + FSimd::Float((float)CellX);
+			const FInt CellPX = PX + FSimd::Int((uint32)CellX * PrimeX);
+
+			for(int32 CellY = -1; CellY <= 1; CellY++)
+			{
+				const FFloat DY = (YR - Y) + FSimd::Float((float)CellY);
+				const FInt CellPY = PY + FSimd::Int((uint32)CellY * PrimeY);
+
+				for(int32 CellZ = -1; CellZ <= 1; CellZ++)
+				{
+					const FFloat DZ = (ZR - Z) + FSimd::Float((float)CellZ);
+					const FInt CellHash = Hash(Seed, CellPX, CellPY, PZ + FSimd::Int((uint32)CellZ * PrimeZ));
+
+					const FFloat PointX = DX + CellOffset(CellHash, 0, CellularJitter3D);
+					const FFloat PointY = DY + CellOffset(CellHash, 10, CellularJitter3D);
+					const FFloat PointZ = DZ + CellOffset(CellHash, 20, CellularJitter3D);
+					const FFloat Distance = PointX * PointX + PointY * PointY + PointZ * PointZ;
+
+					Distance1 = FSimd::Max(FSimd::Min(Distance1, Distance), Distance0);
+					ClosestHash = FSimd::SelectInt(Distance < Distance0, CellHash, ClosestHash);
+					Distance0 = FSimd::Min(Distance0, Distance);
+				}
+			}
+		}
+
+		return CellularResult(Params, Distance0, Distance1, ClosestHash);
+	}
+
+	static FFloat Single(const FNoiseKernelParams& Params, FInt Seed, FFloat X, FFloat Y)
+	{
+		switch(Params.Type)
+		{
+			case ENoiseType::Perlin: 		return Perlin(Seed, X, Y);
+			case ENoiseType::Cellular: 		return Cellular(Params, Seed, X, Y);
+			default: 						return OpenSimplex2(Seed, X, Y);
+		}
+	}
+
+	static FFloat Single(const FNoiseKernelParams& Params, FInt Seed, FFloat X, FFloat Y, FFloat Z)
+	{
+		switch(Params.Type)
+		{
+			case ENoiseType::Perlin: 		return Perlin(Seed, X, Y, Z);
+			case ENoiseType::Cellular: 		return Cellular(Params, Seed, X, Y, Z);
+			default: 						return OpenSimplex2(Seed, X, Y, Z);
+		}
+	}
+
+	// Fractal Brownian motion, octaves at rising frequency and falling amplitude with a new seed each.
+	static FFloat Fractal(const FNoiseKernelParams& Params, FFloat X, FFloat Y)
+	{
+		FFloat Sum = FSimd::Float(0.0f);
+		float Amplitude = 1.0f;
+		for(int32 Octave = 0; Octave < Params.Octaves; Octave++)
+		{
+			const FInt Seed = FSimd::Int((uint32)Params.Seed + (uint32)Octave);
+			Sum = Sum + Single(Params, Seed, X, Y) * FSimd::Float(Amplitude);
+			X = X * FSimd::Float(Params.Lacunarity);
+			Y = Y * FSimd::Float(Params.Lacunarity);
+			Amplitude *= Params.Gain;
+		}
+		return Sum * FSimd::Float(Params.FractalBounding);
+	}
+
+	static FFloat Fractal(const FNoiseKernelParams& Params, FFloat X, FFloat Y, FFloat Z)
+	{
+		FFloat Sum = FSimd::Float(0.0f);
+		float Amplitude = 1.0f;
+		for(int32 Octave = 0; Octave < Params.Octaves; Octave++)
+		{
+			const FInt Seed = FSimd::Int((uint32)Params.Seed + (uint32)Octave);
+			Sum = Sum + Single(Params, Seed, X, Y, Z) * FSimd::Float(Amplitude);
+			X = X * FSimd::Float(Params.Lacunarity);
+			Y = Y * FSimd::Float(Params.Lacunarity);
+			Z = Z * FSimd::Float(Params.Lacunarity);
+			Amplitude *= Params.Gain;
+		}
+		return Sum * FSimd::Float(Params.FractalBounding);
+	}
+
+	// Position of lane 0 of the batch starting at Index, then one Step per lane.
+	static FFloat RowPositions(float X, float Step, int32 Index)
+	{
+		return FSimd::Float(X) + (FSimd::LaneIndex() + FSimd::Float((float)Index)) * FSimd::Float(Step);
+	}
+
+	// Writes a full batch, or only the lanes still inside the row for the last one.
+	static void StoreBatch(float* Out, FFloat Value, int32 Remaining)
+	{
+		if(Remaining >= FSimd::Width)
+		{
+			FSimd::Store(Out, Value);
+			return;
+		}
+
+		float Batch[FSimd::Width];
+		FSimd::Store(Batch, Value);
+		for(int32 Lane = 0; Lane < Remaining; Lane++)
+		{
+			Out[Lane] = Batch[Lane];
+		}
+	}
+
+	static void Row2D(const FNoiseKernelParams& Params, float X, float, float Z, float Step, int32 Count, float* Out)
+	{
+		for(int32 Index = 0; Index < Count; Index += FSimd::Width)
+		{
+			FFloat PX = RowPositions(X, Step, Index);
+			FFloat PZ = FSimd::Float(Z);
+
+			if(Params.WarpAmplitude != 0.0f)
+			{
+				// Warp in world space, before the main frequency, so amplitude is in world units.
+				const FFloat WX = PX * FSimd::Float(Params.WarpFrequency);
+				const FFloat WZ = PZ * FSimd::Float(Params.WarpFrequency);
+				const FInt Seed = FSimd::Int((uint32)Params.Seed);
+				const FFloat OffsetX = OpenSimplex2(Seed ^ FSimd::Int(WarpSeedX), WX, WZ);
+				const FFloat OffsetZ = OpenSimplex2(Seed ^ FSimd::Int(WarpSeedZ), WX, WZ);
+				PX = PX + OffsetX * FSimd::Float(Params.WarpAmplitude);
+				PZ = PZ + OffsetZ * FSimd::Float(Params.WarpAmplitude);
+			}
+
+			const FFloat Value = Fractal(Params, PX * FSimd::Float(Params.Frequency), PZ * FSimd::Float(Params.Frequency));
+			StoreBatch(Out + Index, Value, Count - Index);
+		}
+	}
+
+	static void Row3D(const FNoiseKernelParams& Params, float X, float Y, float Z, float Step, int32 Count, float* Out)
+	{
+		for(int32 Index = 0; Index < Count; Index += FSimd::Width)
+		{
+			FFloat PX = RowPositions(X, Step, Index);
+			FFloat PY = FSimd::Float(Y);
+			FFloat PZ = FSimd::Float(Z);
+
+			if(Params.WarpAmplitude != 0.0f)
+			{
+				const FFloat WX = PX * FSimd::Float(Params.WarpFrequency);
+				const FFloat WY = PY * FSimd::Float(Params.WarpFrequency);
+				const FFloat WZ = PZ * FSimd::Float(Params.WarpFrequency);
+				const FInt Seed = FSimd::Int((uint32)Params.Seed);
+				const FFloat OffsetX = OpenSimplex2(Seed ^ FSimd::Int(WarpSeedX), WX, WY, WZ);
+				const FFloat OffsetY = OpenSimplex2(Seed ^ FSimd::Int(WarpSeedY), WX, WY, WZ);
+				const FFloat OffsetZ = OpenSimplex2(Seed ^ FSimd::Int(WarpSeedZ), WX, WY, WZ);
+				PX = PX + OffsetX * FSimd::Float(Params.WarpAmplitude);
+				PY = PY + OffsetY * FSimd::Float(Params.WarpAmplitude);
+				PZ = PZ + OffsetZ * FSimd::Float(Params.WarpAmplitude);
+			}
+
+			const FFloat Value = Fractal(Params, PX * FSimd::Float(Params.Frequency), PY * FSimd::Float(Params.Frequency), PZ * FSimd::Float(Params.Frequency));
+			StoreBatch(Out + Index, Value, Count - Index);
+		}
+	}
+};
@@ -0,0 +1,86 @@
+// Copyright Snaps 2022, All Rights Reserved.
+
+#include "NoiseKernel.h"
+
+// Built with AVX2 enabled (FMA deliberately not), only called once NoiseGenerator has checked the CPU supports it.
+
+#if VOXEL_NOISE_X64
+
+#include <immintrin.h>
+
+namespace
+{
+	struct FSimdAvx2
+	{
+		struct FMask
+		{
+			__m256 V;
+		};
+
+		struct FInt
+		{
+			__m256i V;
+
+			friend FInt operator+(FInt A, FInt B) 		{ return { _mm256_add_epi32(A.V, B.V) }; }
+			friend FInt operator-(FInt A, FInt B) 		{ return { _mm256_sub_epi32(A.V, B.V) }; }
+			friend FInt operator*(FInt A, FInt B) 		{ return { _mm256_mullo_epi32(A.V, B.V) }; }
+			friend FInt operator^(FInt A, FInt B) 		{ return { _mm256_xor_si256(A.V, B.V) }; }
+			friend FInt operator&(FInt A, FInt B) 		{ return { _mm256_and_si256(A.V, B.V) }; }
+			friend FInt operator|(FInt A, FInt B) 		{ return { _mm256_or_si256(A.V, B.V) }; }
+			friend FInt operator>>(FInt A, int32 Count) { return { _mm256_srl_epi32(A.V, _mm_cvtsi32_si128(Count)) }; }
+		};
+
+		struct FFloat
+		{
+			__m256 V;
+
+			friend FFloat operator+(FFloat A, FFloat B) { return { _mm256_add_ps(A.V, B.V) }; }
+			friend FFloat operator-(FFloat A, FFloat B) { return { _mm256_sub_ps(A.V, B.V) }; }
+			friend FFloat operator*(FFloat A, FFloat B) { return { _mm256_mul_ps(A.V, B.V) }; }
+			friend FFloat operator-(FFloat A) 			{ return { _mm256_xor_ps(A.V, _mm256_set1_ps(-0.0f)) }; }
+			friend FMask operator<(FFloat A, FFloat B) 	{ return { _mm256_cmp_ps(A.V, B.V, _CMP_LT_OQ) }; }
+			friend FMask operator<=(FFloat A, FFloat B) { return { _mm256_cmp_ps(A.V, B.V, _CMP_LE_OQ) }; }
+			friend FMask operator>(FFloat A, FFloat B) 	{ return { _mm256_cmp_ps(A.V, B.V, _CMP_GT_OQ) }; }
+			friend FMask operator>=(FFloat A, FFloat B) { return { _mm256_cmp_ps(A.V, B.V, _CMP_GE_OQ) }; }
+		};
+
+		static const int32 Width = 8;
+
+		static FFloat Float(float Value) 						{ return { _mm256_set1_ps(Value) }; }
+		static FInt Int(uint32 Value) 							{ return { _mm256_set1_epi32((int32)Value) }; }
+		static FFloat LaneIndex() 								{ return { _mm256_setr_ps(0.0f, 1.0f, 2.0f, 3.0f, 4.0f, 5.0f, 6.0f, 7.0f) }; }
+		static void Store(float* Out, FFloat Value) 			{ _mm256_storeu_ps(Out, Value.V); }
+
+		static FFloat Floor(FFloat Value) 						{ return { _mm256_floor_ps(Value.V) }; }
+		static FFloat Sqrt(FFloat Value) 						{ return { _mm256_sqrt_ps(Value.V) }; }
+		static FFloat Min(FFloat A, FFloat B) 					{ return { _mm256_min_ps(A.V, B.V) }; }
+		static FFloat Max(FFloat A, FFloat B) 					{ return { _mm256_max_ps(A.V, B.V) }; }
+
+		static FFloat ToFloat(FInt Value) 						{ return { _mm256_cvtepi32_ps(Value.V) }; }
+		static FInt ToInt(FFloat Value) 						{ return { _mm256_cvttps_epi32(Value.V) }; }
+
+		static FFloat Select(FMask Mask, FFloat True, FFloat False) 	{ return { _mm256_blendv_ps(False.V, True.V, Mask.V) }; }
+		static FInt SelectInt(FMask Mask, FInt True, FInt False) 		{ return { _mm256_castps_si256(_mm256_blendv_ps(_mm256_castsi256_ps(False.V), _mm256_castsi256_ps(True.V), Mask.V)) }; }
+
+		static FMask TestBit(FInt Value, uint32 Bit)
+		{
+			const __m256i BitMask = _mm256_set1_epi32((int32)Bit);
+			return { _mm256_castsi256_ps(_mm256_cmpeq_epi32(_mm256_and_si256(Value.V, BitMask), BitMask)) };
+		}
+
+		static FMask IntEqual(FInt A, FInt B) 					{ return { _mm256_castsi256_ps(_mm256_cmpeq_epi32(A.V, B.V)) }; }
+		static FMask IntLess(FInt A, FInt B) 					{ return { _mm256_castsi256_ps(_mm256_cmpgt_epi32(B.V, A.V)) }; }
+
+		static FMask MaskAnd(FMask A, FMask B) 					{ return { _mm256_and_ps(A.V, B.V) }; }
+		static FMask MaskOr(FMask A, FMask B) 					{ return { _mm256_or_ps(A.V, B.V) }; }
+		static FMask MaskNot(FMask A) 							{ return { _mm256_xor_ps(A.V, _mm256_castsi256_ps(_mm256_set1_epi32(-1))) }; }
+	};
+}
+
+const FNoiseKernel NoiseKernelAvx2 = { &TNoiseKernel<FSimdAvx2>::Row2D, &TNoiseKernel<FSimdAvx2>::Row3D };
+
+#else
+
+const FNoiseKernel NoiseKernelAvx2 = { nullptr, nullptr };
+
+#endif
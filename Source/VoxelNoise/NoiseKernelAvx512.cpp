@@ -0,0 +1,86 @@
+// Copyright Snaps 2022, All Rights Reserved.
+
+#include "NoiseKernel.h"
+
+// Built with AVX-512F enabled, only called once NoiseGenerator has checked the CPU and OS support it.
+// Sticks to AVX-512F instructions, so float xor goes through the integer unit.
+
+#if VOXEL_NOISE_X64
+
+#include <immintrin.h>
+
+namespace
+{
+	struct FSimdAvx512
+	{
+		struct FMask
+		{
+			__mmask16 V;
+		};
+
+		struct FInt
+		{
+			__m512i V;
+
+			friend FInt operator+(FInt A, FInt B) 		{ return { _mm512_add_epi32(A.V, B.V) }; }
+			friend FInt operator-(FInt A, FInt B) 		{ return { _mm512_sub_epi32(A.V, B.V) }; }
+			friend FInt operator*(FInt A, FInt B) 		{ return { _mm512_mullo_epi32(A.V, B.V) }; }
+			friend FInt operator^(FInt A, FInt B) 		{ return { _mm512_xor_si512(A.V, B.V) }; }
+			friend FInt operator&(FInt A, FInt B) 		{ return { _mm512_and_si512(A.V, B.V) }; }
+			friend FInt operator|(FInt A, FInt B) 		{ return { _mm512_or_si512(A.V, B.V) }; }
+			friend FInt operator>>(FInt A, int32 Count) { return { _mm512_srl_epi32(A.V, _mm_cvtsi32_si128(Count)) }; }
+		};
+
+		struct FFloat
+		{
+			__m512 V;
+
+			friend FFloat operator+(FFloat A, FFloat B) { return { _mm512_add_ps(A.V, B.V) }; }
+			friend FFloat operator-(FFloat A, FFloat B) { return { _mm512_sub_ps(A.V, B.V) }; }
+			friend FFloat operator*(FFloat A, FFloat B) { return { _mm512_mul_ps(A.V, B.V) }; }
+			friend FFloat operator-(FFloat A) 			{ return { _mm512_castsi512_ps(_mm512_xor_si512(_mm512_castps_si512(A.V), _mm512_set1_epi32(INT32_MIN))) }; }
+			friend FMask operator<(FFloat A, FFloat B) 	{ return { _mm512_cmp_ps_mask(A.V, B.V, _CMP_LT_OQ) }; }
+			friend FMask operator<=(FFloat A, FFloat B) { return { _mm512_cmp_ps_mask(A.V, B.V, _CMP_LE_OQ) }; }
+			friend FMask operator>(FFloat A, FFloat B) 	{ return { _mm512_cmp_ps_mask(A.V, B.V, _CMP_GT_OQ) }; }
+			friend FMask operator>=(FFloat A, FFloat B) { return { _mm512_cmp_ps_mask(A.V, B.V, _CMP_GE_OQ) }; }
+		};
+
+		static const int32 Width = 16;
+
+		static FFloat Float(float Value) 						{ return { _mm512_set1_ps(Value) }; }
+		static FInt Int(uint32 Value) 							{ return { _mm512_set1_epi32((int32)Value) }; }
+		static void Store(float* Out, FFloat Value) 			{ _mm512_storeu_ps(Out, Value.V); }
+
+		static FFloat LaneIndex()
+		{
+			return { _mm512_set_ps(15.0f, 14.0f, 13.0f, 12.0f, 11.0f, 10.0f, 9.0f, 8.0f, 7.0f, 6.0f, 5.0f, 4.0f, 3.0f, 2.0f, 1.0f, 0.0f) };
+		}
+
+		static FFloat Floor(FFloat Value) 						{ return { _mm512_roundscale_ps(Value.V, _MM_FROUND_TO_NEG_INF | _MM_FROUND_NO_EXC) }; }
+		static FFloat Sqrt(FFloat Value) 						{ return { _mm512_sqrt_ps(Value.V) }; }
+		static FFloat Min(FFloat A, FFloat B) 					{ return { _mm512_min_ps(A.V, B.V) }; }
+		static FFloat Max(FFloat A, FFloat B) 					{ return { _mm512_max_ps(A.V, B.V) }; }
+
+		static FFloat ToFloat(FInt Value) 						{ return { _mm512_cvtepi32_ps(Value.V) }; }
+		static FInt ToInt(FFloat Value) 						{ return { _mm512_cvttps_epi32(Value.V) }; }
+
+		static FFloat Select(FMask Mask, FFloat True, FFloat False) 	{ return { _mm512_mask_blend_ps(Mask.V, False.V, True.V) }; }
+		static FInt SelectInt(FMask Mask, FInt True, FInt False) 		{ return { _mm512_mask_blend_epi32(Mask.V, False.V, True.V) }; }
+
+		static FMask TestBit(FInt Value, uint32 Bit) 			{ return { _mm512_test_epi32_mask(Value.V, _mm512_set1_epi32((int32)Bit)) }; }
+		static FMask IntEqual(FInt A, FInt B) 					{ return { _mm512_cmpeq_epi32_mask(A.V, B.V) }; }
+		static FMask IntLess(FInt A, FInt B) 					{ return { _mm512_cmplt_epi32_mask(A.V, B.V) }; }
+
+		static FMask MaskAnd(FMask A, FMask B) 					{ return { (__mmask16)(A.V & B.V) }; }
+		static FMask MaskOr(FMask A, FMask B) 					{ return { (__mmask16)(A.V | B.V) }; }
+		static FMask MaskNot(FMask A) 							{ return { (__mmask16)~A.V }; }
+	};
+}
+
+const FNoiseKernel NoiseKernelAvx512 = { &TNoiseKernel<FSimdAvx512>::Row2D, &TNoiseKernel<FSimdAvx512>::Row3D };
+
+#else
+
+const FNoiseKernel NoiseKernelAvx512 = { nullptr, nullptr };
+
+#endif
@@ -0,0 +1,47 @@
+// Copyright Snaps 2022, All Rights Reserved.
+
+#include "NoiseKernel.h"
+#include <cmath>
+
+// Reference path and the fallback for CPUs (or platforms) without any of the vector paths.
+// Written lane for lane like the vector wrappers so it produces the exact same bits.
+
+namespace
+{
+	struct FSimdScalar
+	{
+		typedef float 	FFloat;
+		typedef uint32 	FInt;
+		typedef bool 	FMask;
+
+		static const int32 Width = 1;
+
+		static FFloat Float(float Value) 						{ return Value; }
+		static FInt Int(uint32 Value) 							{ return Value; }
+		static FFloat LaneIndex() 								{ return 0.0f; }
+		static void Store(float* Out, FFloat Value) 			{ *Out = Value; }
+
+		static FFloat Floor(FFloat Value) 						{ return std::floor(Value); }
+		static FFloat Sqrt(FFloat Value) 						{ return std::sqrt(Value); }
+
+		// Same operand order as minps / maxps, which return the second operand when equal.
+		static FFloat Min(FFloat A, FFloat B) 					{ return A < B ? A : B; }
+		static FFloat Max(FFloat A, FFloat B) 					{ return A > B ? A : B; }
+
+		static FFloat ToFloat(FInt Value) 						{ return (float)(int32)Value; }
+		static FInt ToInt(FFloat Value) 						{ return (uint32)(int32)Value; }
+
+		static FFloat Select(FMask Mask, FFloat True, FFloat False) 	{ return Mask ? True : False; }
+		static FInt SelectInt(FMask Mask, FInt True, FInt False) 		{ return Mask ? True : False; }
+
+		static FMask TestBit(FInt Value, uint32 Bit) 			{ return (Value & Bit) != 0; }
+		static FMask IntEqual(FInt A, FInt B) 					{ return A == B; }
+		static FMask IntLess(FInt A, FInt B) 					{ return (int32)A < (int32)B; }
+
+		static FMask MaskAnd(FMask A, FMask B) 					{ return A && B; }
+		static FMask MaskOr(FMask A, FMask B) 					{ return A || B; }
+		static FMask MaskNot(FMask A) 							{ return !A; }
+	};
+}
+
+const FNoiseKernel NoiseKernelScalar = { &TNoiseKernel<FSimdScalar>::Row2D, &TNoiseKernel<FSimdScalar>::Row3D };
@@ -0,0 +1,86 @@
+// Copyright Snaps 2022, All Rights Reserved.
+
+#include "NoiseKernel.h"
+
+// Built with SSE4.1 enabled, only called once NoiseGenerator has checked the CPU supports it.
+
+#if VOXEL_NOISE_X64
+
+#include <immintrin.h>
+
+namespace
+{
+	struct FSimdSse41
+	{
+		struct FMask
+		{
+			__m128 V;
+		};
+
+		struct FInt
+		{
+			__m128i V;
+
+			friend FInt operator+(FInt A, FInt B) 		{ return { _mm_add_epi32(A.V, B.V) }; }
+			friend FInt operator-(FInt A, FInt B) 		{ return { _mm_sub_epi32(A.V, B.V) }; }
+			friend FInt operator*(FInt A, FInt B) 		{ return { _mm_mullo_epi32(A.V, B.V) }; }
+			friend FInt operator^(FInt A, FInt B) 		{ return { _mm_xor_si128(A.V, B.V) }; }
+			friend FInt operator&(FInt A, FInt B) 		{ return { _mm_and_si128(A.V, B.V) }; }
+			friend FInt operator|(FInt A, FInt B) 		{ return { _mm_or_si128(A.V, B.V) }; }
+			friend FInt operator>>(FInt A, int32 Count) { return { _mm_srl_epi32(A.V, _mm_cvtsi32_si128(Count)) }; }
+		};
+
+		struct FFloat
+		{
+			__m128 V;
+
+			friend FFloat operator+(FFloat A, FFloat B) { return { _mm_add_ps(A.V, B.V) }; }
+			friend FFloat operator-(FFloat A, FFloat B) { return { _mm_sub_ps(A.V, B.V) }; }
+			friend FFloat operator*(FFloat A, FFloat B) { return { _mm_mul_ps(A.V, B.V) }; }
+			friend FFloat operator-(FFloat A) 			{ return { _mm_xor_ps(A.V, _mm_set1_ps(-0.0f)) }; }
+			friend FMask operator<(FFloat A, FFloat B) 	{ return { _mm_cmplt_ps(A.V, B.V) }; }
+			friend FMask operator<=(FFloat A, FFloat B) { return { _mm_cmple_ps(A.V, B.V) }; }
+			friend FMask operator>(FFloat A, FFloat B) 	{ return { _mm_cmpgt_ps(A.V, B.V) }; }
+			friend FMask operator>=(FFloat A, FFloat B) { return { _mm_cmpge_ps(A.V, B.V) }; }
+		};
+
+		static const int32 Width = 4;
+
+		static FFloat Float(float Value) 						{ return { _mm_set1_ps(Value) }; }
+		static FInt Int(uint32 Value) 							{ return { _mm_set1_epi32((int32)Value) }; }
+		static FFloat LaneIndex() 								{ return { _mm_setr_ps(0.0f, 1.0f, 2.0f, 3.0f) }; }
+		static void Store(float* Out, FFloat Value) 			{ _mm_storeu_ps(Out, Value.V); }
+
+		static FFloat Floor(FFloat Value) 						{ return { _mm_floor_ps(Value.V) }; }
+		static FFloat Sqrt(FFloat Value) 						{ return { _mm_sqrt_ps(Value.V) }; }
+		static FFloat Min(FFloat A, FFloat B) 					{ return { _mm_min_ps(A.V, B.V) }; }
+		static FFloat Max(FFloat A, FFloat B) 					{ return { _mm_max_ps(A.V, B.V) }; }
+
+		static FFloat ToFloat(FInt Value) 						{ return { _mm_cvtepi32_ps(Value.V) }; }
+		static FInt ToInt(FFloat Value) 						{ return { _mm_cvttps_epi32(Value.V) }; }
+
+		static FFloat Select(FMask Mask, FFloat True, FFloat False) 	{ return { _mm_blendv_ps(False.V, True.V, Mask.V) }; }
+		static FInt SelectInt(FMask Mask, FInt True, FInt False) 		{ return { _mm_castps_si128(_mm_blendv_ps(_mm_castsi128_ps(False.V), _mm_castsi128_ps(True.V), Mask.V)) }; }
+
+		static FMask TestBit(FInt Value, uint32 Bit)
+		{
+			const __m128i BitMask = _mm_set1_epi32((int32)Bit);
+			return { _mm_castsi128_ps(_mm_cmpeq_epi32(_mm_and_si128(Value.V, BitMask), BitMask)) };
+		}
+
+		static FMask IntEqual(FInt A, FInt B) 					{ return { _mm_castsi128_ps(_mm_cmpeq_epi32(A.V, B.V)) }; }
+		static FMask IntLess(FInt A, FInt B) 					{ return { _mm_castsi128_ps(_mm_cmplt_epi32(A.V, B.V)) }; }
+
+		static FMask MaskAnd(FMask A, FMask B) 					{ return { _mm_and_ps(A.V, B.V) }; }
+		static FMask MaskOr(FMask A, FMask B) 					{ return { _mm_or_ps(A.V, B.V) }; }
+		static FMask MaskNot(FMask A) 							{ return { _mm_xor_ps(A.V, _mm_castsi128_ps(_mm_set1_epi32(-1))) }; }
+	};
+}
+
+const FNoiseKernel NoiseKernelSse41 = { &TNoiseKernel<FSimdSse41>::Row2D, &TNoiseKernel<FSimdSse41>::Row3D };
+
+#else
+
+const FNoiseKernel NoiseKernelSse41 = { nullptr, nullptr };
+
+#endif